@@ -44,6 +44,8 @@
 #include "ds_client.h"
 
 #include<sys/time.h>
+#include <pthread.h>
+#include <time.h>
 
 //Timeout to wait for wds service notification from qmi
 #define DS_CLIENT_SERVICE_TIMEOUT (4000)
@@ -51,6 +53,8 @@
 #define DS_CLIENT_SERVICE_TIMEOUT_TOTAL (40000)
 //Timeout for the service to respond to sync msg
 #define DS_CLIENT_SYNC_MSG_TIMEOUT (5000)
+//Age after which the cached emergency profile is looked up again
+#define DS_CLIENT_PROFILE_CACHE_MAX_AGE_US (10 * 60 * 1000000ULL)
 /*Request messages the WDS client can send to the WDS service*/
 typedef union
 {
@@ -95,16 +99,144 @@ typedef struct {
     dsi_hndl_t dsi_net_handle;
     //Handle to caller's data
     ds_caller_data caller_data;
+    //Data call state, driven by start/stop and net_ev_cb
+    pthread_mutex_t lock;
+    ds_client_call_state_type state;
+    uint64_t connect_start_us;
+    //Signalled when the call goes idle
+    pthread_cond_t cond;
+    //Opened ahead of an ATL request; events are not forwarded until
+    //the call is started by its caller
+    int speculative;
+    int profile_index;
+    int pdp_type;
+    //The profile came from the cache; a failed connect drops it
+    int cached_profile;
 } ds_client_session_data;
 
+/*The WDS client, created once and kept. A monitor thread creates it
+  and creates it again when the service goes away; callers wait for it
+  to be ready rather than retrying themselves*/
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int started;
+    qmi_client_type client;
+    int ready;
+    //Set by the error callback, the client is released by the monitor
+    int stale;
+    //Callers using the client; it is not released while in use
+    int users;
+} ds_client_wds_type;
+
+//cond is set up again on CLOCK_MONOTONIC by ds_client_wds_once
+static ds_client_wds_type ds_client_wds = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, NULL, 0, 0, 0
+};
+static pthread_once_t ds_client_wds_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t ds_client_call_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static ds_client_call_stats_type ds_client_call_stats;
+
+/*A call brought up on an emergency notification, before the ATL
+  request for it. The next open takes it over; a thread tears it down
+  if nobody does within the grace period*/
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    //Set while the speculative call is being opened
+    int busy;
+    ds_client_session_data *session;
+    uint64_t start_us;
+    uint32_t grace_ms;
+    ds_client_cb_data callback;
+    void *caller_cookie;
+    ds_client_prewarm_stats_type stats;
+} ds_client_prewarm_type;
+
+//cond is set up again on CLOCK_MONOTONIC by ds_client_prewarm_once
+static ds_client_prewarm_type ds_client_prewarm = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, NULL, 0, 0,
+    {NULL}, NULL, {0, 0, 0, 0, 0, 0, 0, 0, 0}
+};
+static pthread_once_t ds_client_prewarm_once = PTHREAD_ONCE_INIT;
+
+/*Emergency profile last found. The lookup takes a WDS client and a
+  sync request per profile, so it is reused until the WDS service
+  restarts, a call on it fails to connect, or it ages out; no SIM or
+  profile change indication reaches this client, so these bound how
+  long a profile of a previous subscription can be used. The lookup
+  runs without the lock; opens arriving meanwhile wait on cond for it*/
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int valid;
+    uint64_t found_us;
+    int looking_up;
+    //Bumped by each invalidation; a lookup that spans one is not cached
+    uint32_t generation;
+    int profile_index;
+    int pdp_type;
+    ds_client_open_stats_type stats;
+} ds_client_profile_cache_type;
+
+static ds_client_profile_cache_type ds_client_profile_cache = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0, 0,
+    {0, 0, 0, 0, 0, 0}
+};
+
+static uint64_t ds_client_monotonic_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*Timed waits are against CLOCK_MONOTONIC, so that a wall clock set
+  from the network or by the user does not stretch or cut them short*/
+static void ds_client_monotonic_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/*Deadline timeout_ms from now, for a cond set up by
+  ds_client_monotonic_cond_init*/
+static void ds_client_monotonic_deadline(struct timespec *ts, uint32_t timeout_ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if(ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static void ds_client_wds_init()
+{
+    ds_client_monotonic_cond_init(&ds_client_wds.cond);
+}
+
+static void ds_client_prewarm_init()
+{
+    ds_client_monotonic_cond_init(&ds_client_prewarm.cond);
+}
+
 void net_ev_cb(dsi_hndl_t handle, void* user_data,
                dsi_net_evt_t evt, dsi_evt_payload_t *payload_ptr)
 {
     int i;
     (void)handle;
-    (void)user_data;
     (void)payload_ptr;
-    ds_caller_data *callback_data = (ds_caller_data *)user_data;
+    ds_client_session_data *session = (ds_client_session_data *)user_data;
+    ds_caller_data *callback_data = &session->caller_data;
+    uint64_t connect_us;
+    int forward;
+    int failed;
 
     LOC_LOGD("%s:%d]: Enter. Callback data: %p\n", __func__, __LINE__, callback_data);
     if(evt > DSI_EVT_INVALID && evt < DSI_EVT_MAX)
@@ -121,15 +253,46 @@ void net_ev_cb(dsi_hndl_t handle, void* user_data,
         case DSI_EVT_WDS_CONNECTED:
         {
             LOC_LOGD("%s:%d]: Emergency call started\n", __func__, __LINE__);
-            callback_data->event_cb(E_DS_CLIENT_DATA_CALL_CONNECTED,
-                                    callback_data->caller_cookie);
+            pthread_mutex_lock(&session->lock);
+            if(session->state == DS_CLIENT_CALL_CONNECTING) {
+                session->state = DS_CLIENT_CALL_UP;
+                connect_us = ds_client_monotonic_us() - session->connect_start_us;
+                pthread_mutex_lock(&ds_client_call_stats_lock);
+                ds_client_call_stats.connects++;
+                ds_client_call_stats.connect_total_us += connect_us;
+                if(connect_us > ds_client_call_stats.connect_max_us)
+                    ds_client_call_stats.connect_max_us = connect_us;
+                pthread_mutex_unlock(&ds_client_call_stats_lock);
+                LOC_LOGD("%s:%d]: Connected in %llu us\n", __func__, __LINE__,
+                         (unsigned long long)connect_us);
+            }
+            forward = !session->speculative;
+            pthread_mutex_unlock(&session->lock);
+            if(forward)
+                callback_data->event_cb(E_DS_CLIENT_DATA_CALL_CONNECTED,
+                                        callback_data->caller_cookie);
             break;
         }
         case DSI_EVT_NET_NO_NET:
         {
             LOC_LOGD("%s:%d]: Emergency call stopped\n", __func__, __LINE__);
-            callback_data->event_cb(E_DS_CLIENT_DATA_CALL_DISCONNECTED,
-                                    callback_data->caller_cookie);
+            pthread_mutex_lock(&session->lock);
+            failed = (session->state == DS_CLIENT_CALL_CONNECTING);
+            if(failed) {
+                pthread_mutex_lock(&ds_client_call_stats_lock);
+                ds_client_call_stats.connect_failures++;
+                pthread_mutex_unlock(&ds_client_call_stats_lock);
+            }
+            session->state = DS_CLIENT_CALL_IDLE;
+            pthread_cond_broadcast(&session->cond);
+            forward = !session->speculative;
+            pthread_mutex_unlock(&session->lock);
+            //The cached profile may belong to a previous SIM
+            if(failed && session->cached_profile)
+                ds_client_invalidate_profile_cache();
+            if(forward)
+                callback_data->event_cb(E_DS_CLIENT_DATA_CALL_DISCONNECTED,
+                                        callback_data->caller_cookie);
             break;
         }
         default:
@@ -139,7 +302,27 @@ void net_ev_cb(dsi_hndl_t handle, void* user_data,
     LOC_LOGD("%s:%d]:Exit\n", __func__, __LINE__);
 }
 
-/*This function is called to obtain a handle to the QMI WDS service*/
+/*Called by QCCI when the WDS service goes away*/
+static void ds_client_wds_error_cb(qmi_client_type user_handle,
+                                   qmi_client_error_type error,
+                                   void *err_cb_data)
+{
+    (void)err_cb_data;
+    LOC_LOGE("%s:%d]: WDS client %p error %d\n", __func__, __LINE__,
+             user_handle, error);
+    pthread_mutex_lock(&ds_client_wds.lock);
+    if(ds_client_wds.client == user_handle) {
+        ds_client_wds.ready = 0;
+        ds_client_wds.stale = 1;
+        pthread_cond_broadcast(&ds_client_wds.cond);
+    }
+    pthread_mutex_unlock(&ds_client_wds.lock);
+    //The profiles may differ when the service is back
+    ds_client_invalidate_profile_cache();
+}
+
+/*This function is called to obtain a handle to the QMI WDS service.
+  It makes one attempt; the WDS monitor retries*/
 static ds_client_status_enum_type
 ds_client_qmi_ctrl_point_init(qmi_client_type *p_wds_qmi_client)
 {
@@ -148,13 +331,16 @@ ds_client_qmi_ctrl_point_init(qmi_client_type *p_wds_qmi_client)
     qmi_service_info *p_service_info = NULL;
     uint32_t num_services = 0, num_entries = 0;
     qmi_client_error_type ret = QMI_NO_ERR;
-    unsigned char no_signal = 0;
-    int timeout = 0;
 
     LOC_LOGD("%s:%d]:Enter\n", __func__, __LINE__);
 
-    // load proprietary symbols from their respective libs
-    load_proprietary_symbols();
+    // load proprietary symbols from their respective libs, once
+    if(load_proprietary_symbols() != LOC_LOADER_BACKEND_AVAILABLE) {
+        LOC_LOGE("%s:%d]: Data services backend unavailable\n",
+                 __func__, __LINE__);
+        status = E_DS_CLIENT_FAILURE_UNSUPPORTED;
+        goto err;
+    }
 
     //Get service object for QMI_WDS service
     qmi_idl_service_object_type ds_client_service_object =
@@ -169,37 +355,14 @@ ds_client_qmi_ctrl_point_init(qmi_client_type *p_wds_qmi_client)
     //get service addressing information
     ret = qmi_client_get_service_list(ds_client_service_object, NULL, NULL,
                                       &num_services);
-    LOC_LOGD("%s:%d]: qmi_client_get_service_list() first try ret %d, "
+    LOC_LOGD("%s:%d]: qmi_client_get_service_list() ret %d, "
                    "num_services %d]\n", __func__, __LINE__, ret, num_services);
-    if(ret != QMI_NO_ERR) {
-        do {
-            ret = qmi_client_get_service_list(ds_client_service_object, NULL,
-                                              NULL, &num_services);
-            if(ret != QMI_NO_ERR) {
-                ret = qmi_client_get_service_list(ds_client_service_object, NULL,
-                                                      NULL, &num_services);
-            }
-            timeout += DS_CLIENT_SERVICE_TIMEOUT;
-            LOC_LOGV("%s:%d]: qmi_client_get_service_list() returned ret: %d,"
-                     "no_signal: %d, total timeout: %d\n", __func__, __LINE__,
-                     ret, no_signal, timeout);
-        } while( (timeout < DS_CLIENT_SERVICE_TIMEOUT_TOTAL) &&
-                 no_signal &&
-                 (ret != QMI_NO_ERR) );
-    }
 
     //Handle failure cases
     if(num_services == 0 || ret != QMI_NO_ERR) {
-        if(!no_signal) {
-            LOC_LOGE("%s:%d]: qmi_client_get_service_list failed even though"
-                     "service is up!  Error: %d \n", __func__, __LINE__, ret);
-            status = E_DS_CLIENT_FAILURE_INTERNAL;
-        }
-        else {
-            LOC_LOGE("%s:%d]: qmi_client_get_service_list failed after retries"
-                     "Error: %d \n", __func__, __LINE__, ret);
-            status = E_DS_CLIENT_FAILURE_TIMEOUT;
-        }
+        LOC_LOGE("%s:%d]: WDS service not up yet. Error: %d \n",
+                 __func__, __LINE__, ret);
+        status = E_DS_CLIENT_FAILURE_SERVICE_NOT_PRESENT;
         goto err;
     }
 
@@ -238,6 +401,13 @@ ds_client_qmi_ctrl_point_init(qmi_client_type *p_wds_qmi_client)
     LOC_LOGD("%s:%d]: WDS client initialized with qmi_client_init\n", __func__,
          __LINE__);
 
+    //Learn about service loss, so the client gets replaced
+    ret = qmi_client_register_error_cb(wds_qmi_client, ds_client_wds_error_cb, NULL);
+    if(ret != QMI_NO_ERR) {
+        LOC_LOGE("%s:%d]: qmi_client_register_error_cb Error. ret: %d\n",
+                 __func__, __LINE__, ret);
+    }
+
     //Store WDS QMI client handle in the parameter passed in
     *p_wds_qmi_client = wds_qmi_client;
 
@@ -252,6 +422,90 @@ err:
     return status;
 }
 
+/*Keeps the WDS client ready: creates it, retries every
+  DS_CLIENT_SERVICE_TIMEOUT while the service is not up, and replaces
+  it after the service went away*/
+static void *ds_client_wds_monitor(void *arg)
+{
+    ds_client_wds_type *wds = &ds_client_wds;
+    qmi_client_type client;
+    struct timespec ts;
+    (void)arg;
+
+    pthread_mutex_lock(&wds->lock);
+    while(1) {
+        if(wds->ready) {
+            pthread_cond_wait(&wds->cond, &wds->lock);
+            continue;
+        }
+        if(wds->stale) {
+            if(wds->users > 0) {
+                pthread_cond_wait(&wds->cond, &wds->lock);
+                continue;
+            }
+            LOC_LOGD("%s:%d]: Releasing stale WDS client\n", __func__, __LINE__);
+            qmi_client_release(wds->client);
+            wds->client = NULL;
+            wds->stale = 0;
+        }
+
+        pthread_mutex_unlock(&wds->lock);
+        ds_client_status_enum_type status = ds_client_qmi_ctrl_point_init(&client);
+        pthread_mutex_lock(&wds->lock);
+
+        if(status == E_DS_CLIENT_SUCCESS) {
+            wds->client = client;
+            wds->ready = 1;
+            pthread_cond_broadcast(&wds->cond);
+        }
+        else {
+            ds_client_monotonic_deadline(&ts, DS_CLIENT_SERVICE_TIMEOUT);
+            pthread_cond_timedwait(&wds->cond, &wds->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&wds->lock);
+    return NULL;
+}
+
+/*Takes the WDS client for a request, waiting up to
+  DS_CLIENT_SERVICE_TIMEOUT_TOTAL for the service to be ready. Pair
+  with ds_client_wds_put*/
+static ds_client_status_enum_type ds_client_wds_get(qmi_client_type *p_client)
+{
+    ds_client_wds_type *wds = &ds_client_wds;
+    ds_client_status_enum_type status = E_DS_CLIENT_SUCCESS;
+    struct timespec ts;
+
+    pthread_once(&ds_client_wds_once, ds_client_wds_init);
+    ds_client_monotonic_deadline(&ts, DS_CLIENT_SERVICE_TIMEOUT_TOTAL);
+
+    pthread_mutex_lock(&wds->lock);
+    while(wds->started && !wds->ready) {
+        if(pthread_cond_timedwait(&wds->cond, &wds->lock, &ts) != 0)
+            break;
+    }
+    if(wds->ready) {
+        wds->users++;
+        *p_client = wds->client;
+    }
+    else {
+        LOC_LOGE("%s:%d]: WDS client not ready\n", __func__, __LINE__);
+        status = wds->started ? E_DS_CLIENT_FAILURE_TIMEOUT :
+                                E_DS_CLIENT_FAILURE_NOT_INITIALIZED;
+    }
+    pthread_mutex_unlock(&wds->lock);
+    return status;
+}
+
+static void ds_client_wds_put()
+{
+    ds_client_wds_type *wds = &ds_client_wds;
+    pthread_mutex_lock(&wds->lock);
+    wds->users--;
+    pthread_cond_broadcast(&wds->cond);
+    pthread_mutex_unlock(&wds->lock);
+}
+
 /*This function reads the error code from within the response struct*/
 static ds_client_status_enum_type ds_client_convert_qmi_response(
     uint32_t req_id,
@@ -424,11 +678,11 @@ err:
     return ret;
 }
 
-/*
-  Starts data call using the handle and the profile index
-*/
-ds_client_status_enum_type
-ds_client_start_call(dsClientHandleType client_handle, int profile_index, int pdp_type)
+/*Starts data call using the handle and the profile index. claim hands
+  a pre-warmed call to the caller, its events are forwarded from then on*/
+static ds_client_status_enum_type
+ds_client_start_session(dsClientHandleType client_handle, int profile_index,
+                        int pdp_type, int claim)
 {
     ds_client_status_enum_type ret = E_DS_CLIENT_FAILURE_GENERAL;
     dsi_call_param_value_t param_info;
@@ -440,6 +694,31 @@ ds_client_start_call(dsClientHandleType client_handle, int profile_index, int pd
         goto err;
     }
     dsi_handle = ds_global_data->dsi_net_handle;
+
+    pthread_mutex_lock(&ds_global_data->lock);
+    if(claim)
+        ds_global_data->speculative = 0;
+    if(ds_global_data->state == DS_CLIENT_CALL_UP ||
+       ds_global_data->state == DS_CLIENT_CALL_CONNECTING) {
+        //The call is there or on its way, nothing to bring up
+        ds_client_call_state_type state = ds_global_data->state;
+        pthread_mutex_unlock(&ds_global_data->lock);
+        LOC_LOGD("%s:%d]: Data call already %s\n", __func__, __LINE__,
+                 state == DS_CLIENT_CALL_UP ? "up" : "connecting");
+        pthread_mutex_lock(&ds_client_call_stats_lock);
+        ds_client_call_stats.reused++;
+        pthread_mutex_unlock(&ds_client_call_stats_lock);
+        if(state == DS_CLIENT_CALL_UP) {
+            ds_global_data->caller_data.event_cb(E_DS_CLIENT_DATA_CALL_CONNECTED,
+                                                 ds_global_data->caller_data.caller_cookie);
+        }
+        ret = E_DS_CLIENT_SUCCESS;
+        goto err;
+    }
+    ds_global_data->state = DS_CLIENT_CALL_CONNECTING;
+    ds_global_data->connect_start_us = ds_client_monotonic_us();
+    pthread_mutex_unlock(&ds_global_data->lock);
+
     //Set profile index as call parameter
     param_info.buf_val = NULL;
     param_info.num_val = profile_index;
@@ -462,6 +741,12 @@ ds_client_start_call(dsClientHandleType client_handle, int profile_index, int pd
     }
     else {
         LOC_LOGE("%s:%d]: Could not send req to start data call \n", __func__, __LINE__);
+        pthread_mutex_lock(&ds_global_data->lock);
+        ds_global_data->state = DS_CLIENT_CALL_IDLE;
+        pthread_mutex_unlock(&ds_global_data->lock);
+        pthread_mutex_lock(&ds_client_call_stats_lock);
+        ds_client_call_stats.connect_failures++;
+        pthread_mutex_unlock(&ds_client_call_stats_lock);
         ret = E_DS_CLIENT_FAILURE_GENERAL;
         goto err;
     }
@@ -472,43 +757,39 @@ err:
 
 }
 
-/*Function to open an emergency call. Does the following things:
+/*
+  Starts data call using the handle and the profile index
+*/
+ds_client_status_enum_type
+ds_client_start_call(dsClientHandleType client_handle, int profile_index, int pdp_type)
+{
+    return ds_client_start_session(client_handle, profile_index, pdp_type, 1);
+}
+
+/*Finds the profile that supports emergency calls:
  - Obtains a handle to the WDS service
  - Obtains a list of profiles configured in the modem
  - Queries each profile and obtains settings to check if emergency calls
-   are supported
- - Returns the profile index that supports emergency calls
- - Returns handle to dsi_netctrl*/
-ds_client_status_enum_type
-ds_client_open_call(dsClientHandleType *client_handle,
-                    ds_client_cb_data *callback,
-                    void *caller_cookie,
-                    int *profile_index,
-                    int *pdp_type)
+   are supported*/
+static ds_client_status_enum_type
+ds_client_find_emergency_profile(int *profile_index, int *pdp_type)
 {
     ds_client_status_enum_type ret = E_DS_CLIENT_FAILURE_GENERAL;
     ds_client_resp_union_type profile_list_resp_msg;
     ds_client_resp_union_type profile_settings_resp_msg;
     wds_profile_identifier_type_v01 profile_identifier;
     uint32_t i=0;
-    dsi_hndl_t dsi_handle;
-    ds_client_session_data **ds_global_data = (ds_client_session_data **)client_handle;
     unsigned char call_profile_index_found = 0;
-    uint32_t emergency_profile_index=0;
     qmi_client_type wds_qmi_client;
 
     profile_list_resp_msg.p_get_profile_list_resp = NULL;
     profile_settings_resp_msg.p_get_profile_setting_resp = NULL;
 
     LOC_LOGD("%s:%d]:Enter\n", __func__, __LINE__);
-    if(callback == NULL || ds_global_data == NULL) {
-        LOC_LOGE("%s:%d]: Null callback parameter\n", __func__, __LINE__);
-        goto err;
-    }
 
-    ret = ds_client_qmi_ctrl_point_init(&wds_qmi_client);
+    ret = ds_client_wds_get(&wds_qmi_client);
     if(ret != E_DS_CLIENT_SUCCESS) {
-        LOC_LOGE("%s:%d]: ds_client_qmi_ctrl_point_init failed. ret: %d\n",
+        LOC_LOGE("%s:%d]: ds_client_wds_get failed. ret: %d\n",
                  __func__, __LINE__, ret);
         goto err;
     }
@@ -520,7 +801,7 @@ ds_client_open_call(dsClientHandleType *client_handle,
         LOC_LOGE("%s:%d]: Could not allocate memory for"
                  "p_get_profile_list_resp\n", __func__, __LINE__);
         ret = E_DS_CLIENT_FAILURE_NOT_ENOUGH_MEMORY;
-        goto err;
+        goto release;
     }
 
     LOC_LOGD("%s:%d]: Getting profile list\n", __func__, __LINE__);
@@ -530,7 +811,7 @@ ds_client_open_call(dsClientHandleType *client_handle,
     if(ret != E_DS_CLIENT_SUCCESS) {
         LOC_LOGE("%s:%d]: ds_client_get_profile_list failed. ret: %d\n",
                  __func__, __LINE__, ret);
-        goto err;
+        goto release;
     }
     LOC_LOGD("%s:%d]: Got profile list; length = %d\n", __func__, __LINE__,
              profile_list_resp_msg.p_get_profile_list_resp->profile_list_len);
@@ -544,7 +825,7 @@ ds_client_open_call(dsClientHandleType *client_handle,
         LOC_LOGE("%s:%d]: Could not allocate memory for"
                  "p_get_profile_setting_resp\n", __func__, __LINE__);
         ret = E_DS_CLIENT_FAILURE_NOT_ENOUGH_MEMORY;
-        goto err;
+        goto release;
     }
 
     //Loop over the list of profiles to find a profile that supports
@@ -567,7 +848,7 @@ ds_client_open_call(dsClientHandleType *client_handle,
         if(ret != E_DS_CLIENT_SUCCESS) {
             LOC_LOGE("%s:%d]: ds_client_get_profile_settings failed. ret: %d\n",
                      __func__, __LINE__, ret);
-            goto err;
+            goto release;
         }
         LOC_LOGD("%s:%d]: Got profile setting for profile %d; name: %s\n",
                  __func__, __LINE__, i,
@@ -578,7 +859,7 @@ ds_client_open_call(dsClientHandleType *client_handle,
                 LOC_LOGD("%s:%d]: Found emergency profile in profile %d"
                          , __func__, __LINE__, i);
                 call_profile_index_found = 1;
-                emergency_profile_index = profile_identifier.profile_index;
+                *profile_index = profile_identifier.profile_index;
 
                 if(profile_settings_resp_msg.p_get_profile_setting_resp->pdp_type_valid) {
                     *pdp_type = (int)profile_settings_resp_msg.p_get_profile_setting_resp->pdp_type;
@@ -619,49 +900,383 @@ ds_client_open_call(dsClientHandleType *client_handle,
                0, sizeof(wds_get_profile_settings_resp_msg_v01));
     }
 
-    //Release qmi client handle
-    if(qmi_client_release(wds_qmi_client) != QMI_NO_ERR) {
-        LOC_LOGE("%s:%d]: Could not release qmi client handle\n",
+    if(!call_profile_index_found) {
+        LOC_LOGE("%s:%d]: Could not find a profile that supports emergency calls",
                  __func__, __LINE__);
         ret = E_DS_CLIENT_FAILURE_GENERAL;
     }
 
-    if(call_profile_index_found) {
-        *profile_index = emergency_profile_index;
-        *ds_global_data = (ds_client_session_data *)calloc(1, sizeof(ds_client_session_data));
-        if(*ds_global_data == NULL) {
-            LOC_LOGE("%s:%d]: Could not allocate memory for ds_global_data. Failing\n",
-                     __func__, __LINE__);
-            ret = E_DS_CLIENT_FAILURE_NOT_ENOUGH_MEMORY;
-            goto err;
-        }
+release:
+    //The client is kept for the next lookup
+    ds_client_wds_put();
+err:
+    if(profile_list_resp_msg.p_get_profile_list_resp)
+        free(profile_list_resp_msg.p_get_profile_list_resp);
+    if(profile_settings_resp_msg.p_get_profile_setting_resp)
+        free(profile_settings_resp_msg.p_get_profile_setting_resp);
+    LOC_LOGD("%s:%d]:Exit\n", __func__, __LINE__);
+    return ret;
+}
 
-        (*ds_global_data)->caller_data.event_cb = callback->event_cb;
-        (*ds_global_data)->caller_data.caller_cookie = caller_cookie;
-        dsi_handle = dsi_get_data_srvc_hndl(net_ev_cb, &(*ds_global_data)->caller_data);
-        if(dsi_handle == NULL) {
-            LOC_LOGE("%s:%d]: Could not get data handle. Retry Later\n",
-                     __func__, __LINE__);
-            ret = E_DS_CLIENT_RETRY_LATER;
-            goto err;
-        }
-        else
-            (*ds_global_data)->dsi_net_handle = dsi_handle;
+/*Opens a session for an emergency call:
+ - Looks up the profile that supports emergency calls, unless it is
+   cached for the current subscription
+ - Returns the profile index that supports emergency calls
+ - Returns handle to dsi_netctrl*/
+static ds_client_status_enum_type
+ds_client_open_session(ds_client_session_data **ds_global_data,
+                       ds_client_cb_data *callback,
+                       void *caller_cookie,
+                       int *profile_index,
+                       int *pdp_type,
+                       int speculative)
+{
+    ds_client_status_enum_type ret = E_DS_CLIENT_FAILURE_GENERAL;
+    dsi_hndl_t dsi_handle;
+    ds_client_profile_cache_type *cache = &ds_client_profile_cache;
+    uint64_t start_us = ds_client_monotonic_us();
+    uint64_t latency_us;
+    uint32_t generation;
+    int cached = 0;
+
+    LOC_LOGD("%s:%d]:Enter\n", __func__, __LINE__);
+
+    //Share a lookup already running rather than starting another
+    pthread_mutex_lock(&cache->lock);
+    if(cache->valid &&
+       start_us - cache->found_us > DS_CLIENT_PROFILE_CACHE_MAX_AGE_US) {
+        LOC_LOGD("%s:%d]: Cached profile expired\n", __func__, __LINE__);
+        cache->valid = 0;
+        cache->generation++;
+    }
+    while(!cache->valid && cache->looking_up) {
+        pthread_cond_wait(&cache->cond, &cache->lock);
+    }
+    if(cache->valid) {
+        *profile_index = cache->profile_index;
+        *pdp_type = cache->pdp_type;
+        cached = 1;
+        ret = E_DS_CLIENT_SUCCESS;
     }
     else {
-        LOC_LOGE("%s:%d]: Could not find a profile that supports emergency calls",
+        cache->looking_up = 1;
+        generation = cache->generation;
+        pthread_mutex_unlock(&cache->lock);
+
+        ret = ds_client_find_emergency_profile(profile_index, pdp_type);
+
+        pthread_mutex_lock(&cache->lock);
+        if(ret == E_DS_CLIENT_SUCCESS && generation == cache->generation) {
+            cache->profile_index = *profile_index;
+            cache->pdp_type = *pdp_type;
+            cache->found_us = ds_client_monotonic_us();
+            cache->valid = 1;
+        }
+        cache->looking_up = 0;
+        //On failure a waiter starts its own lookup
+        pthread_cond_broadcast(&cache->cond);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if(ret != E_DS_CLIENT_SUCCESS) {
+        goto err;
+    }
+
+    *ds_global_data = (ds_client_session_data *)calloc(1, sizeof(ds_client_session_data));
+    if(*ds_global_data == NULL) {
+        LOC_LOGE("%s:%d]: Could not allocate memory for ds_global_data. Failing\n",
                  __func__, __LINE__);
-        ret = E_DS_CLIENT_FAILURE_GENERAL;
+        ret = E_DS_CLIENT_FAILURE_NOT_ENOUGH_MEMORY;
+        goto err;
     }
+
+    (*ds_global_data)->caller_data.event_cb = callback->event_cb;
+    (*ds_global_data)->caller_data.caller_cookie = caller_cookie;
+    pthread_mutex_init(&(*ds_global_data)->lock, NULL);
+    ds_client_monotonic_cond_init(&(*ds_global_data)->cond);
+    (*ds_global_data)->state = DS_CLIENT_CALL_IDLE;
+    (*ds_global_data)->speculative = speculative;
+    (*ds_global_data)->profile_index = *profile_index;
+    (*ds_global_data)->pdp_type = *pdp_type;
+    (*ds_global_data)->cached_profile = cached;
+    dsi_handle = dsi_get_data_srvc_hndl(net_ev_cb, *ds_global_data);
+    if(dsi_handle == NULL) {
+        LOC_LOGE("%s:%d]: Could not get data handle. Retry Later\n",
+                 __func__, __LINE__);
+        pthread_cond_destroy(&(*ds_global_data)->cond);
+        pthread_mutex_destroy(&(*ds_global_data)->lock);
+        free(*ds_global_data);
+        *ds_global_data = NULL;
+        ret = E_DS_CLIENT_RETRY_LATER;
+        goto err;
+    }
+    else
+        (*ds_global_data)->dsi_net_handle = dsi_handle;
+
+    latency_us = ds_client_monotonic_us() - start_us;
+    pthread_mutex_lock(&cache->lock);
+    if(cached) {
+        cache->stats.cached_opens++;
+        cache->stats.cached_total_us += latency_us;
+        if(latency_us > cache->stats.cached_max_us)
+            cache->stats.cached_max_us = latency_us;
+    }
+    else {
+        cache->stats.lookup_opens++;
+        cache->stats.lookup_total_us += latency_us;
+        if(latency_us > cache->stats.lookup_max_us)
+            cache->stats.lookup_max_us = latency_us;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    LOC_LOGD("%s:%d]: Opened in %llu us, profile %s\n", __func__, __LINE__,
+             (unsigned long long)latency_us, cached ? "cached" : "looked up");
 err:
-    if(profile_list_resp_msg.p_get_profile_list_resp)
-        free(profile_list_resp_msg.p_get_profile_list_resp);
-    if(profile_settings_resp_msg.p_get_profile_setting_resp)
-        free(profile_settings_resp_msg.p_get_profile_setting_resp);
     LOC_LOGD("%s:%d]:Exit\n", __func__, __LINE__);
     return ret;
 }
 
+/*Hands the pre-warmed call, if there is one, to the caller. Waits for
+  one that is still being opened*/
+static ds_client_session_data *
+ds_client_prewarm_take(ds_client_cb_data *callback, void *caller_cookie)
+{
+    ds_client_prewarm_type *prewarm = &ds_client_prewarm;
+    ds_client_session_data *session;
+    uint64_t head_start_us = 0;
+    int up;
+
+    pthread_once(&ds_client_prewarm_once, ds_client_prewarm_init);
+    pthread_mutex_lock(&prewarm->lock);
+    while(prewarm->busy)
+        pthread_cond_wait(&prewarm->cond, &prewarm->lock);
+    session = prewarm->session;
+    if(session != NULL) {
+        prewarm->session = NULL;
+        head_start_us = ds_client_monotonic_us() - prewarm->start_us;
+        pthread_cond_broadcast(&prewarm->cond);
+    }
+    pthread_mutex_unlock(&prewarm->lock);
+    if(session == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&session->lock);
+    session->caller_data.event_cb = callback->event_cb;
+    session->caller_data.caller_cookie = caller_cookie;
+    up = (session->state == DS_CLIENT_CALL_UP);
+    pthread_mutex_unlock(&session->lock);
+
+    pthread_mutex_lock(&prewarm->lock);
+    prewarm->stats.handovers++;
+    if(up)
+        prewarm->stats.handovers_up++;
+    prewarm->stats.head_start_total_us += head_start_us;
+    if(head_start_us > prewarm->stats.head_start_max_us)
+        prewarm->stats.head_start_max_us = head_start_us;
+    pthread_mutex_unlock(&prewarm->lock);
+    LOC_LOGD("%s:%d]: Pre-warmed call handed over after %llu us, %s\n",
+             __func__, __LINE__, (unsigned long long)head_start_us,
+             up ? "up" : "not up yet");
+    return session;
+}
+
+/*Function to open an emergency call. Takes over the pre-warmed call if
+  there is one, otherwise opens a new session*/
+ds_client_status_enum_type
+ds_client_open_call(dsClientHandleType *client_handle,
+                    ds_client_cb_data *callback,
+                    void *caller_cookie,
+                    int *profile_index,
+                    int *pdp_type)
+{
+    ds_client_session_data **ds_global_data = (ds_client_session_data **)client_handle;
+    ds_client_session_data *session;
+
+    if(callback == NULL || ds_global_data == NULL) {
+        LOC_LOGE("%s:%d]: Null callback parameter\n", __func__, __LINE__);
+        return E_DS_CLIENT_FAILURE_GENERAL;
+    }
+    session = ds_client_prewarm_take(callback, caller_cookie);
+    if(session != NULL) {
+        *profile_index = session->profile_index;
+        *pdp_type = session->pdp_type;
+        *ds_global_data = session;
+        return E_DS_CLIENT_SUCCESS;
+    }
+    return ds_client_open_session(ds_global_data, callback, caller_cookie,
+                                  profile_index, pdp_type, 0);
+}
+
+/*Brings the pre-warmed call up and waits for it to be taken over. If it
+  is not within the grace period, it is stopped and closed*/
+static void *ds_client_prewarm_thread(void *arg)
+{
+    ds_client_prewarm_type *prewarm = &ds_client_prewarm;
+    ds_client_session_data *session = NULL;
+    ds_client_status_enum_type ret;
+    int profile_index = 0, pdp_type = 0;
+    struct timespec ts;
+    uint64_t teardown_start_us, teardown_us;
+    (void)arg;
+
+    ret = ds_client_open_session(&session, &prewarm->callback, prewarm->caller_cookie,
+                                 &profile_index, &pdp_type, 1);
+    if(ret == E_DS_CLIENT_SUCCESS) {
+        ret = ds_client_start_session(session, profile_index, pdp_type, 0);
+        if(ret != E_DS_CLIENT_SUCCESS) {
+            ds_client_close_call((dsClientHandleType *)&session);
+        }
+    }
+
+    pthread_mutex_lock(&prewarm->lock);
+    prewarm->busy = 0;
+    if(ret != E_DS_CLIENT_SUCCESS) {
+        LOC_LOGE("%s:%d]: Could not pre-warm data call. ret: %d\n",
+                 __func__, __LINE__, ret);
+        prewarm->stats.failures++;
+        pthread_cond_broadcast(&prewarm->cond);
+        pthread_mutex_unlock(&prewarm->lock);
+        return NULL;
+    }
+    prewarm->session = session;
+    pthread_cond_broadcast(&prewarm->cond);
+
+    ds_client_monotonic_deadline(&ts, prewarm->grace_ms);
+    while(prewarm->session == session) {
+        if(pthread_cond_timedwait(&prewarm->cond, &prewarm->lock, &ts) != 0)
+            break;
+    }
+    if(prewarm->session != session) {
+        //Handed over
+        pthread_mutex_unlock(&prewarm->lock);
+        return NULL;
+    }
+    prewarm->session = NULL;
+    pthread_mutex_unlock(&prewarm->lock);
+
+    LOC_LOGD("%s:%d]: Pre-warmed call not used, tearing down\n", __func__, __LINE__);
+    teardown_start_us = ds_client_monotonic_us();
+    if(ds_client_stop_call(session) == E_DS_CLIENT_SUCCESS) {
+        ds_client_monotonic_deadline(&ts, DS_CLIENT_SERVICE_TIMEOUT);
+        pthread_mutex_lock(&session->lock);
+        while(session->state != DS_CLIENT_CALL_IDLE) {
+            if(pthread_cond_timedwait(&session->cond, &session->lock, &ts) != 0)
+                break;
+        }
+        pthread_mutex_unlock(&session->lock);
+    }
+    ds_client_close_call((dsClientHandleType *)&session);
+    teardown_us = ds_client_monotonic_us() - teardown_start_us;
+
+    pthread_mutex_lock(&prewarm->lock);
+    prewarm->stats.expired++;
+    prewarm->stats.teardown_total_us += teardown_us;
+    if(teardown_us > prewarm->stats.teardown_max_us)
+        prewarm->stats.teardown_max_us = teardown_us;
+    pthread_mutex_unlock(&prewarm->lock);
+    LOC_LOGD("%s:%d]: Pre-warmed call torn down in %llu us\n", __func__, __LINE__,
+             (unsigned long long)teardown_us);
+    return NULL;
+}
+
+/*
+  Starts bringing up an emergency call ahead of the ATL request
+*/
+ds_client_status_enum_type
+ds_client_prewarm_call(ds_client_cb_data *callback,
+                       void *caller_cookie,
+                       uint32_t grace_ms)
+{
+    ds_client_prewarm_type *prewarm = &ds_client_prewarm;
+    ds_client_status_enum_type ret = E_DS_CLIENT_SUCCESS;
+    pthread_t thread;
+
+    if(callback == NULL) {
+        LOC_LOGE("%s:%d]: Null callback parameter\n", __func__, __LINE__);
+        return E_DS_CLIENT_FAILURE_GENERAL;
+    }
+
+    pthread_once(&ds_client_prewarm_once, ds_client_prewarm_init);
+    pthread_mutex_lock(&prewarm->lock);
+    if(prewarm->busy || prewarm->session != NULL) {
+        LOC_LOGD("%s:%d]: Data call already pre-warmed\n", __func__, __LINE__);
+    }
+    else {
+        prewarm->callback = *callback;
+        prewarm->caller_cookie = caller_cookie;
+        prewarm->grace_ms = grace_ms;
+        prewarm->start_us = ds_client_monotonic_us();
+        if(pthread_create(&thread, NULL, ds_client_prewarm_thread, NULL) == 0) {
+            pthread_detach(thread);
+            prewarm->busy = 1;
+            prewarm->stats.prewarms++;
+        }
+        else {
+            LOC_LOGE("%s:%d]: Could not start pre-warm thread\n", __func__, __LINE__);
+            ret = E_DS_CLIENT_FAILURE_GENERAL;
+        }
+    }
+    pthread_mutex_unlock(&prewarm->lock);
+    return ret;
+}
+
+void ds_client_get_prewarm_stats(ds_client_prewarm_stats_type *stats)
+{
+    ds_client_prewarm_type *prewarm = &ds_client_prewarm;
+    if(stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&prewarm->lock);
+    *stats = prewarm->stats;
+    pthread_mutex_unlock(&prewarm->lock);
+}
+
+/*
+  Drops the cached emergency profile
+*/
+void ds_client_invalidate_profile_cache()
+{
+    ds_client_profile_cache_type *cache = &ds_client_profile_cache;
+    pthread_mutex_lock(&cache->lock);
+    cache->valid = 0;
+    cache->generation++;
+    pthread_mutex_unlock(&cache->lock);
+    LOC_LOGD("%s:%d]: Profile cache dropped\n", __func__, __LINE__);
+}
+
+ds_client_call_state_type ds_client_get_call_state(dsClientHandleType client_handle)
+{
+    ds_client_session_data *session = (ds_client_session_data *)client_handle;
+    ds_client_call_state_type state;
+    if(session == NULL) {
+        return DS_CLIENT_CALL_IDLE;
+    }
+    pthread_mutex_lock(&session->lock);
+    state = session->state;
+    pthread_mutex_unlock(&session->lock);
+    return state;
+}
+
+void ds_client_get_call_stats(ds_client_call_stats_type *stats)
+{
+    if(stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&ds_client_call_stats_lock);
+    *stats = ds_client_call_stats;
+    pthread_mutex_unlock(&ds_client_call_stats_lock);
+}
+
+void ds_client_get_open_stats(ds_client_open_stats_type *stats)
+{
+    ds_client_profile_cache_type *cache = &ds_client_profile_cache;
+    if(stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
+
 ds_client_status_enum_type ds_client_stop_call(dsClientHandleType client_handle)
 {
     ds_client_status_enum_type ret = E_DS_CLIENT_SUCCESS;
@@ -674,6 +1289,15 @@ ds_client_status_enum_type ds_client_stop_call(dsClientHandleType client_handle)
         goto err;
     }
 
+    pthread_mutex_lock(&p_ds_global_data->lock);
+    if(p_ds_global_data->state == DS_CLIENT_CALL_IDLE) {
+        pthread_mutex_unlock(&p_ds_global_data->lock);
+        LOC_LOGD("%s:%d]: No data call to stop\n", __func__, __LINE__);
+        goto err;
+    }
+    p_ds_global_data->state = DS_CLIENT_CALL_TEARING_DOWN;
+    pthread_mutex_unlock(&p_ds_global_data->lock);
+
     if(dsi_stop_data_call(p_ds_global_data->dsi_net_handle) == DSI_SUCCESS) {
         LOC_LOGD("%s:%d]: Sent request to stop data call\n", __func__, __LINE__);
     }
@@ -702,6 +1326,8 @@ void ds_client_close_call(dsClientHandleType *client_handle)
     }
     dsi_rel_data_srvc_hndl((*ds_global_data)->dsi_net_handle);
     (*ds_global_data)->dsi_net_handle = NULL;
+    pthread_cond_destroy(&(*ds_global_data)->cond);
+    pthread_mutex_destroy(&(*ds_global_data)->lock);
     free(*ds_global_data);
     *ds_global_data = NULL;
     LOC_LOGD("%s:%d]: Released Data handle\n", __func__, __LINE__);
@@ -714,11 +1340,33 @@ int ds_client_init()
 {
     int ret = 0;
     LOC_LOGD("%s:%d]:Enter\n", __func__, __LINE__);
-    if(DSI_SUCCESS != dsi_init(DSI_MODE_GENERAL))
+    if(load_proprietary_symbols() != LOC_LOADER_BACKEND_AVAILABLE)
+    {
+        LOC_LOGE("%s:%d]:Data services backend unavailable\n", __func__, __LINE__);
+        ret = -1;
+    }
+    else if(DSI_SUCCESS != dsi_init(DSI_MODE_GENERAL))
     {
         LOC_LOGE("%s:%d]:dsi_init failed\n", __func__, __LINE__);
         ret = -1;
     }
+    else {
+        //The WDS client is made ready ahead of the first call
+        pthread_t monitor;
+        pthread_once(&ds_client_wds_once, ds_client_wds_init);
+        pthread_mutex_lock(&ds_client_wds.lock);
+        if(!ds_client_wds.started) {
+            if(pthread_create(&monitor, NULL, ds_client_wds_monitor, NULL) == 0) {
+                pthread_detach(monitor);
+                ds_client_wds.started = 1;
+            }
+            else {
+                LOC_LOGE("%s:%d]: Could not start WDS monitor\n", __func__, __LINE__);
+                ret = -1;
+            }
+        }
+        pthread_mutex_unlock(&ds_client_wds.lock);
+    }
     LOC_LOGD("%s:%d]:Exit\n", __func__, __LINE__);
     return ret;
 }
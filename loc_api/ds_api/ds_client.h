@@ -29,6 +29,8 @@
 #ifndef _DS_CLIENT_H_
 #define _DS_CLIENT_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -95,6 +97,49 @@ typedef enum {
     DATA_CALL_CLOSE
 }data_call_request_enum_type;
 
+/*Time taken by ds_client_open_call, with the emergency profile taken
+  from the cache or looked up in the modem*/
+typedef struct {
+    uint64_t cached_opens;
+    uint64_t cached_total_us;
+    uint64_t cached_max_us;
+    uint64_t lookup_opens;
+    uint64_t lookup_total_us;
+    uint64_t lookup_max_us;
+}ds_client_open_stats_type;
+
+typedef enum {
+    DS_CLIENT_CALL_IDLE = 0,
+    DS_CLIENT_CALL_CONNECTING,
+    DS_CLIENT_CALL_UP,
+    DS_CLIENT_CALL_TEARING_DOWN
+}ds_client_call_state_type;
+
+/*Data calls brought up; a start while the call is already up or
+  connecting is counted as reused and costs no new bring-up*/
+typedef struct {
+    uint64_t connects;
+    uint64_t connect_total_us;
+    uint64_t connect_max_us;
+    uint64_t connect_failures;
+    uint64_t reused;
+}ds_client_call_stats_type;
+
+/*Calls pre-warmed on an emergency notification. A handover is the
+  call taken over by ds_client_open_call, head start is how long it
+  had been coming up by then; an expired call is torn down unused*/
+typedef struct {
+    uint64_t prewarms;
+    uint64_t failures;
+    uint64_t handovers;
+    uint64_t handovers_up;
+    uint64_t head_start_total_us;
+    uint64_t head_start_max_us;
+    uint64_t expired;
+    uint64_t teardown_total_us;
+    uint64_t teardown_max_us;
+}ds_client_prewarm_stats_type;
+
 typedef void (*ds_client_event_ind_cb_type)(ds_client_status_enum_type result,
                                              void* loc_adapter_cookie);
 typedef struct {
@@ -104,7 +149,8 @@ typedef struct {
 /*
   This function is to be called as a first step by each process that
   needs to use data services. This call internally calls dsi_init()
-  and prepares the module for making data calls.
+  and prepares the module for making data calls. It also starts
+  bringing up the WDS client that is kept for all calls.
   Needs to be called once for every process
 */
 int ds_client_init();
@@ -120,6 +166,18 @@ ds_client_status_enum_type ds_client_open_call(dsClientHandleType *client_handle
                                                int *profile_index,
                                                int *pdp_type);
 
+/*
+  The emergency profile found by ds_client_open_call is cached. It is
+  dropped when the WDS service restarts, when a call on it fails to
+  connect, after a maximum age, or by this call.
+*/
+void ds_client_invalidate_profile_cache();
+
+/*
+  Latency of ds_client_open_call, with and without the cache
+*/
+void ds_client_get_open_stats(ds_client_open_stats_type *stats);
+
 /*
   Starts a data call using the profile number provided
  */
@@ -127,6 +185,25 @@ ds_client_status_enum_type ds_client_start_call(dsClientHandleType client_handle
                                                 int profile_index,
                                                 int pdp_type);
 
+/*
+  State of the data call associated with the handle, and the time
+  taken to bring data calls up
+*/
+ds_client_call_state_type ds_client_get_call_state(dsClientHandleType client_handle);
+void ds_client_get_call_stats(ds_client_call_stats_type *stats);
+
+/*
+  Starts bringing up an emergency call before it is requested, e.g. on
+  an emergency NI notification. The next ds_client_open_call takes it
+  over, and ds_client_start_call on it reports the call connected as
+  soon as it is. It is stopped and closed if not taken over within
+  grace_ms.
+*/
+ds_client_status_enum_type ds_client_prewarm_call(ds_client_cb_data *callback,
+                                                  void *loc_adapter_cookie,
+                                                  uint32_t grace_ms);
+void ds_client_get_prewarm_stats(ds_client_prewarm_stats_type *stats);
+
 /*
   Stops a data call associated with the handle
 */
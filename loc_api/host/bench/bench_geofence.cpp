@@ -0,0 +1,227 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Geofences kept on the host, over a modem that holds a few of them:
+   - BM_GeofenceNearest: LocGeofenceStore::nearest, per query, with
+     1k to 100k fences in the store
+   - BM_GeofenceRotation: a final fix through LocApiV02 until the
+     rotation it posts is done, moving one store cell per fix or
+     staying put; requests counts the QMI requests per fix */
+
+#include <string.h>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+#include <LocGeofenceStore.h>
+#include "ind_corpus.h"
+
+/* the fences are spread over a 1 degree square, as around a city */
+static const double kOriginLat = 37.0;
+static const double kOriginLon = -122.5;
+static const double kSpan = 1.0;
+static const double kCell = 0.01;
+
+static std::vector<LocGeofenceStore::Fence> makeFences(size_t count)
+{
+    std::mt19937 rng(count);
+    std::uniform_real_distribution<double> offset(0.0, kSpan);
+    std::uniform_int_distribution<uint32_t> radius(100, 1000);
+    std::vector<LocGeofenceStore::Fence> fences(count);
+
+    for (size_t i = 0; i < count; i++) {
+        LocGeofenceStore::Fence& fence = fences[i];
+        memset(&fence, 0, sizeof(fence));
+        fence.clientId = i + 1;
+        fence.latitude = kOriginLat + offset(rng);
+        fence.longitude = kOriginLon + offset(rng);
+        fence.radius = radius(rng);
+        fence.breachMask = QMI_LOC_GEOFENCE_BREACH_ENTERING_MASK_V02 |
+                           QMI_LOC_GEOFENCE_BREACH_LEAVING_MASK_V02;
+        fence.responsiveness = eQMI_LOC_GEOFENCE_RESPONSIVENESS_MED_V02;
+        fence.state = eQMI_LOC_GEOFENCE_STATE_ACTIVE_V02;
+    }
+    return fences;
+}
+
+static void BM_GeofenceNearest(benchmark::State& state)
+{
+    std::vector<LocGeofenceStore::Fence> fences = makeFences(state.range(0));
+    size_t maxCount = state.range(1);
+    LocGeofenceStore store(kCell);
+    for (size_t i = 0; i < fences.size(); i++) {
+        store.add(fences[i]);
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> offset(0.0, kSpan);
+    std::vector<double> lats(1024), lons(1024);
+    for (size_t i = 0; i < lats.size(); i++) {
+        lats[i] = kOriginLat + offset(rng);
+        lons[i] = kOriginLon + offset(rng);
+    }
+
+    std::vector<uint32_t> ids;
+    size_t i = 0;
+    for (auto _ : state) {
+        store.nearest(lats[i], lons[i], maxCount, ids);
+        benchmark::DoNotOptimize(ids.data());
+        i = (i + 1) % lats.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GeofenceNearest)
+    ->ArgNames({"fences", "nearest"})
+    ->ArgsProduct({{1000, 10000, 100000}, {20, 100}});
+
+/* a modem with a fixed number of geofence slots, answering the adds
+   and deletes with their indication, as the modem does */
+struct GeofenceModem {
+    size_t capacity;
+    uint32_t nextId;
+    std::unordered_set<uint32_t> ids;
+};
+
+static int geofenceModemResponder(uint32_t req_id, const void* req,
+                                  uint32_t req_len, void* resp,
+                                  uint32_t resp_len, void* context)
+{
+    GeofenceModem* modem = (GeofenceModem*)context;
+
+    switch (req_id) {
+    case QMI_LOC_ADD_CIRCULAR_GEOFENCE_REQ_V02:
+    {
+        const qmiLocAddCircularGeofenceReqMsgT_v02* addReq =
+            (const qmiLocAddCircularGeofenceReqMsgT_v02*)req;
+        qmiLocAddCircularGeofenceIndMsgT_v02 ind;
+        memset(&ind, 0, sizeof(ind));
+        ind.transactionId_valid = 1;
+        ind.transactionId = addReq->transactionId;
+        if (modem->ids.size() >= modem->capacity) {
+            ind.status = eQMI_LOC_MAX_GEOFENCE_PROGRAMMED_V02;
+        } else {
+            ind.status = eQMI_LOC_SUCCESS_V02;
+            ind.geofenceId_valid = 1;
+            ind.geofenceId = modem->nextId++;
+            modem->ids.insert(ind.geofenceId);
+        }
+        qmi_stub_indicate_async(QMI_LOC_ADD_CIRCULAR_GEOFENCE_IND_V02,
+                                &ind, sizeof(ind), 0);
+        break;
+    }
+    case QMI_LOC_DELETE_GEOFENCE_REQ_V02:
+    {
+        const qmiLocDeleteGeofenceReqMsgT_v02* deleteReq =
+            (const qmiLocDeleteGeofenceReqMsgT_v02*)req;
+        qmiLocDeleteGeofenceIndMsgT_v02 ind;
+        memset(&ind, 0, sizeof(ind));
+        ind.status = modem->ids.erase(deleteReq->geofenceId) ?
+            eQMI_LOC_SUCCESS_V02 : eQMI_LOC_INVALID_PARAMETER_V02;
+        ind.geofenceId_valid = 1;
+        ind.geofenceId = deleteReq->geofenceId;
+        ind.transactionId_valid = 1;
+        ind.transactionId = deleteReq->transactionId;
+        qmi_stub_indicate_async(QMI_LOC_DELETE_GEOFENCE_IND_V02,
+                                &ind, sizeof(ind), 0);
+        break;
+    }
+    default:
+    {
+        static qmiLocStatusEnumT_v02 success = eQMI_LOC_SUCCESS_V02;
+        return hostModemResponder(req_id, req, req_len, resp, resp_len,
+                                  &success);
+    }
+    }
+    return QMI_NO_ERR;
+}
+
+/* range(2) is the number of cells moved per fix: 1 rotates on every
+   fix, 0 is the cost of a fix while the modem set is current */
+static void BM_GeofenceRotation(benchmark::State& state)
+{
+    std::vector<LocGeofenceStore::Fence> fences = makeFences(state.range(0));
+    GeofenceModem modem;
+    modem.capacity = state.range(1);
+    modem.nextId = 1;
+    int step = state.range(2);
+
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    qmi_stub_set_responder(geofenceModemResponder, &modem);
+
+    HostLocApi& api = session.api();
+    for (size_t i = 0; i < fences.size(); i++) {
+        const LocGeofenceStore::Fence& fence = fences[i];
+        if (loc_core::LOC_API_ADAPTER_ERR_SUCCESS !=
+            api.addGeofence(fence.clientId, fence.latitude, fence.longitude,
+                            fence.radius, fence.breachMask,
+                            fence.responsiveness)) {
+            state.SkipWithError("addGeofence failed");
+            return;
+        }
+    }
+
+    // a final fix crossing the square west to east, a cell at a time
+    qmiLocEventPositionReportIndMsgT_v02 fix =
+        *locIndSample("position").as<qmiLocEventPositionReportIndMsgT_v02>();
+    fix.latitude = kOriginLat + kSpan / 2;
+    fix.longitude = kOriginLon;
+    locClientEventIndUnionType payload;
+    payload.pPositionReportEvent = &fix;
+    int cells = (int)(kSpan / kCell);
+    int cell = 0;
+
+    // settle on the first position, so both variants start full
+    api.eventCb(LOC_CLIENT_INVALID_HANDLE_VALUE,
+                QMI_LOC_EVENT_POSITION_REPORT_IND_V02, payload);
+    session.msgTask().flush();
+
+    uint64_t requests = qmi_stub_request_count();
+    for (auto _ : state) {
+        cell = (cell + step) % cells;
+        fix.longitude = kOriginLon + (cell + 0.5) * kCell;
+        api.eventCb(LOC_CLIENT_INVALID_HANDLE_VALUE,
+                    QMI_LOC_EVENT_POSITION_REPORT_IND_V02, payload);
+        session.msgTask().flush();
+    }
+    requests = qmi_stub_request_count() - requests;
+
+    state.counters["requests"] = benchmark::Counter(
+        requests, benchmark::Counter::kAvgIterations);
+    state.counters["modem_fences"] = modem.ids.size();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GeofenceRotation)
+    ->ArgNames({"fences", "capacity", "step"})
+    ->ArgsProduct({{10000, 100000}, {100, 500}, {0, 1}})
+    ->UseRealTime();
@@ -0,0 +1,322 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Indication and conversion hot paths of the loc api, fed from the
+   canned corpus in ind_corpus.cpp:
+   - BM_IndCb: locClientIndCb dispatch, decode included, per message
+   - BM_Report*: LocApiV02 conversion of one event to loc eng format
+   - BM_FixEpoch: the indications of one 1 Hz fix, the per-fix cost
+   - BM_SyncProcessInd: loc_sync_process_ind matching with 1 to 8
+     requests outstanding
+   - BM_SendReq: validateRequest and the stub send, per request; the
+     stub send alone is BM_QmiSendMsgSync */
+
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+#include <loc_api_v02_log.h>
+#include "ind_corpus.h"
+
+using namespace loc_core;
+
+extern "C" qmi_client_error_type (*qmi_client_send_msg_sync)(
+    qmi_client_type client_handle, uint32_t req_id, void *list_req,
+    uint32_t req_len, void* list_resp, uint32_t resp_len, uint32_t timeout);
+
+static void corpusArgs(benchmark::internal::Benchmark* b)
+{
+    for (size_t i = 0; i < locIndCorpus().size(); i++) {
+        b->Arg(i);
+    }
+}
+
+static void BM_IndCb(benchmark::State& state)
+{
+    const LocIndSample& ind = locIndCorpus()[state.range(0)];
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+
+    for (auto _ : state) {
+        qmi_stub_indicate(ind.msgId, ind.payload.data(), ind.payload.size());
+    }
+    state.SetLabel(ind.name);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IndCb)->Apply(corpusArgs);
+
+/* LocApiV02::eventCb straight to the conversion, without the client */
+static void reportEvent(benchmark::State& state, const char* name)
+{
+    const LocIndSample& ind = locIndSample(name);
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    locClientEventIndUnionType payload;
+    payload.pPositionReportEvent =
+        ind.as<qmiLocEventPositionReportIndMsgT_v02>();
+
+    for (auto _ : state) {
+        session.api().eventCb(LOC_CLIENT_INVALID_HANDLE_VALUE, ind.msgId,
+                              payload);
+    }
+    state.SetLabel(name);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_ReportPosition(benchmark::State& state)
+{
+    reportEvent(state, "position");
+}
+BENCHMARK(BM_ReportPosition);
+
+static void BM_ReportSv(benchmark::State& state)
+{
+    switch (state.range(0)) {
+    case 12: reportEvent(state, "sv_12"); break;
+    case 40: reportEvent(state, "sv_40"); break;
+    default: reportEvent(state, "sv_80"); break;
+    }
+}
+BENCHMARK(BM_ReportSv)->Arg(12)->Arg(40)->Arg(80);
+
+static void BM_ReportNmea(benchmark::State& state)
+{
+    reportEvent(state, "nmea_gga");
+}
+BENCHMARK(BM_ReportNmea);
+
+static void BM_ReportNiRequest(benchmark::State& state)
+{
+    reportEvent(state, "ni_supl");
+}
+BENCHMARK(BM_ReportNiRequest);
+
+/* a position, an SV report and the NMEA sentences of one fix */
+static void BM_FixEpoch(benchmark::State& state)
+{
+    static const char* const epoch[] = {
+        "sv_40", "nmea_gsv", "nmea_gsv", "nmea_gsv", "nmea_gga", "position"
+    };
+    const size_t count = sizeof(epoch) / sizeof(epoch[0]);
+    std::vector<const LocIndSample*> inds;
+    for (size_t i = 0; i < count; i++) {
+        inds.push_back(&locIndSample(epoch[i]));
+    }
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; i++) {
+            qmi_stub_indicate(inds[i]->msgId, inds[i]->payload.data(),
+                              inds[i]->payload.size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FixEpoch);
+
+/* requests parked in loc_sync_send_req, each on an indication of its own
+   that only comes at the end of the benchmark */
+static const uint32_t kParkedReqs[] = {
+    QMI_LOC_GET_FIX_CRITERIA_REQ_V02,
+    QMI_LOC_GET_NMEA_TYPES_REQ_V02,
+    QMI_LOC_GET_LOW_POWER_MODE_REQ_V02,
+    QMI_LOC_GET_SERVER_REQ_V02,
+    QMI_LOC_GET_ENGINE_LOCK_REQ_V02,
+    QMI_LOC_GET_SBAS_CONFIG_REQ_V02,
+    QMI_LOC_GET_OPERATION_MODE_REQ_V02,
+};
+
+struct Parked {
+    locClientHandleType handle;
+    uint32_t reqId;
+    pthread_t thread;
+};
+
+static void* parkedMain(void* arg)
+{
+    Parked* parked = (Parked*)arg;
+    // the largest of the GET indications fits
+    static __thread uint8_t ind[8192];
+    locClientReqUnionType reqUnion;
+    memset(&reqUnion, 0, sizeof(reqUnion));
+    // the indication ids are those of the requests
+    loc_sync_send_req(parked->handle, parked->reqId, reqUnion, 60000,
+                      parked->reqId, ind);
+    return NULL;
+}
+
+struct ProcessIndContext {
+    locClientHandleType handle;
+    uint64_t ns;
+};
+
+/* the measured request: its indication is matched on the responder's
+   stack, before the request waits, among the parked ones */
+static int processIndResponder(uint32_t req_id, const void* req,
+                               uint32_t req_len, void* resp,
+                               uint32_t resp_len, void* context)
+{
+    (void)req;
+    (void)req_len;
+    (void)resp;
+    (void)resp_len;
+
+    if (QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02 == req_id) {
+        ProcessIndContext* ctx = (ProcessIndContext*)context;
+        qmiLocSetProtocolConfigParametersIndMsgT_v02 ind;
+        memset(&ind, 0, sizeof(ind));
+        uint64_t startNs = hostNowNs();
+        loc_sync_process_ind(ctx->handle,
+                             QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02,
+                             &ind);
+        ctx->ns += hostNowNs() - startNs;
+    }
+    return QMI_NO_ERR;
+}
+
+static void BM_SyncProcessInd(benchmark::State& state)
+{
+    const size_t parkedCount = state.range(0) - 1;
+    locClientHandleType handle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+    if (eLOC_CLIENT_SUCCESS != hostClientOpen(0, &handle)) {
+        state.SkipWithError("locClientOpen failed");
+        return;
+    }
+    ProcessIndContext ctx = { handle, 0 };
+    qmi_stub_set_responder(processIndResponder, &ctx);
+
+    uint64_t requests = qmi_stub_request_count();
+    std::vector<Parked> parked(parkedCount);
+    for (size_t i = 0; i < parkedCount; i++) {
+        parked[i].handle = handle;
+        parked[i].reqId = kParkedReqs[i];
+        pthread_create(&parked[i].thread, NULL, parkedMain, &parked[i]);
+    }
+    // a parked request holds its slot once it is sent
+    while (qmi_stub_request_count() < requests + parkedCount) {
+        usleep(100);
+    }
+
+    qmiLocSetProtocolConfigParametersReqMsgT_v02 req;
+    memset(&req, 0, sizeof(req));
+    qmiLocSetProtocolConfigParametersIndMsgT_v02 ind;
+    locClientReqUnionType reqUnion;
+    reqUnion.pSetProtocolConfigParametersReq = &req;
+
+    for (auto _ : state) {
+        loc_sync_send_req(handle,
+                          QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02,
+                          reqUnion, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                          QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02,
+                          &ind);
+    }
+    state.counters["process_ind_ns"] =
+        benchmark::Counter(ctx.ns, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations());
+
+    for (size_t i = 0; i < parkedCount; i++) {
+        loc_sync_process_ind(handle, kParkedReqs[i], NULL);
+        pthread_join(parked[i].thread, NULL);
+    }
+    locClientClose(&handle);
+    qmi_stub_reset();
+}
+BENCHMARK(BM_SyncProcessInd)->DenseRange(1, 8)->UseRealTime();
+
+/* requests across the validateRequest switch, with and without payload */
+static const uint32_t kSendReqs[] = {
+    QMI_LOC_REG_EVENTS_REQ_V02,
+    QMI_LOC_START_REQ_V02,
+    QMI_LOC_STOP_REQ_V02,
+    QMI_LOC_INJECT_UTC_TIME_REQ_V02,
+    QMI_LOC_INJECT_POSITION_REQ_V02,
+    QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02,
+    QMI_LOC_INJECT_SENSOR_DATA_REQ_V02,
+    QMI_LOC_ADD_CIRCULAR_GEOFENCE_REQ_V02,
+    QMI_LOC_INJECT_PREDICTED_ORBITS_DATA_REQ_V02,
+    QMI_LOC_GET_FIX_CRITERIA_REQ_V02,
+};
+
+/* large enough for any request */
+static uint8_t sendReqPayload[65536];
+
+static void BM_SendReq(benchmark::State& state)
+{
+    const uint32_t reqId = kSendReqs[state.range(0)];
+    locClientHandleType handle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+    if (eLOC_CLIENT_SUCCESS != hostClientOpen(0, &handle)) {
+        state.SkipWithError("locClientOpen failed");
+        return;
+    }
+    locClientReqUnionType reqUnion;
+    // the union only holds pointers, any member points to the payload
+    reqUnion.pInformClientRevisionReq =
+        (const qmiLocInformClientRevisionReqMsgT_v02*)sendReqPayload;
+
+    for (auto _ : state) {
+        locClientStatusEnumType status =
+            locClientSendReq(handle, reqId, reqUnion);
+        benchmark::DoNotOptimize(status);
+    }
+    state.SetLabel(loc_get_v02_event_name(reqId));
+    state.SetItemsProcessed(state.iterations());
+
+    locClientClose(&handle);
+    qmi_stub_reset();
+}
+BENCHMARK(BM_SendReq)->DenseRange(0, sizeof(kSendReqs) / sizeof(kSendReqs[0]) - 1);
+
+static void BM_QmiSendMsgSync(benchmark::State& state)
+{
+    load_proprietary_symbols();
+    qmiLocGenRespMsgT_v02 resp;
+
+    for (auto _ : state) {
+        qmi_client_error_type rc =
+            qmi_client_send_msg_sync(NULL, QMI_LOC_REG_EVENTS_REQ_V02,
+                                     sendReqPayload,
+                                     sizeof(qmiLocRegEventsReqMsgT_v02),
+                                     &resp, sizeof(resp), 0);
+        benchmark::DoNotOptimize(rc);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QmiSendMsgSync);
@@ -0,0 +1,270 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Host NMEA synthesis (LocNmeaGenerator):
+   - BM_NmeaGga, BM_NmeaRmc, BM_NmeaGsa: one sentence from a fix
+   - BM_NmeaGsv: the GSV sentences of 12 or 32 SVs
+   - BM_NmeaEpoch: everything synthesized for one 1 Hz fix, as
+     reportSv and reportPosition do it
+   - BM_NmeaGgaPrintf: the same GGA with snprintf, for comparison
+   - BM_ReportPositionNmea: a position report through LocApiV02 with
+     synthesis on; BM_ReportPosition in bench_indications.cpp is the
+     cost without */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+#include <LocNmeaGenerator.h>
+#include "ind_corpus.h"
+
+static GpsLocation makeLocation()
+{
+    GpsLocation location;
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+    location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+                     GPS_LOCATION_HAS_SPEED | GPS_LOCATION_HAS_BEARING |
+                     GPS_LOCATION_HAS_ACCURACY;
+    location.latitude = 37.4219999;
+    location.longitude = -122.0840575;
+    location.altitude = 12.5;
+    location.speed = 13.4f;
+    location.bearing = 271.3f;
+    location.accuracy = 4.2f;
+    location.timestamp = 1413630000123LL;
+    return location;
+}
+
+static GpsLocationExtended makeExtended()
+{
+    GpsLocationExtended ext;
+    memset(&ext, 0, sizeof(ext));
+    ext.size = sizeof(ext);
+    ext.flags = GPS_LOCATION_EXTENDED_HAS_DOP |
+                GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL |
+                GPS_LOCATION_EXTENDED_HAS_MAG_DEV;
+    ext.altitudeMeanSeaLevel = 42.3f;
+    ext.pdop = 1.8f;
+    ext.hdop = 0.9f;
+    ext.vdop = 1.5f;
+    ext.magneticDeviation = -13.2f;
+    return ext;
+}
+
+/* GPS first, then GLONASS from the 21st SV on */
+static GpsSvStatus makeSvStatus(int count)
+{
+    GpsSvStatus svStatus;
+    memset(&svStatus, 0, sizeof(svStatus));
+    svStatus.size = sizeof(svStatus);
+    svStatus.num_svs = count;
+    for (int i = 0; i < count; i++) {
+        GpsSvInfo& sv = svStatus.sv_list[i];
+        sv.size = sizeof(sv);
+        sv.prn = (i < 20) ? i + 1 : 65 + i - 20;
+        sv.snr = 20.0f + i % 25;
+        sv.elevation = 5.0f + (i * 7) % 85;
+        sv.azimuth = (float)((i * 37) % 360);
+        if (i < 20 && i % 2 == 0) {
+            svStatus.used_in_fix_mask |= 1U << i;
+        }
+    }
+    return svStatus;
+}
+
+static size_t sentenceBytes(const LocNmeaGenerator& generator)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < generator.count(); i++) {
+        size_t length;
+        generator.sentence(i, length);
+        bytes += length;
+    }
+    return bytes;
+}
+
+static void BM_NmeaGga(benchmark::State& state)
+{
+    LocNmeaGenerator generator;
+    GpsLocation location = makeLocation();
+    GpsLocationExtended ext = makeExtended();
+
+    for (auto _ : state) {
+        generator.reset();
+        generator.appendGga(location, ext);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * sentenceBytes(generator));
+}
+BENCHMARK(BM_NmeaGga);
+
+static void BM_NmeaRmc(benchmark::State& state)
+{
+    LocNmeaGenerator generator;
+    GpsLocation location = makeLocation();
+    GpsLocationExtended ext = makeExtended();
+
+    for (auto _ : state) {
+        generator.reset();
+        generator.appendRmc(location, ext);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * sentenceBytes(generator));
+}
+BENCHMARK(BM_NmeaRmc);
+
+static void BM_NmeaGsa(benchmark::State& state)
+{
+    LocNmeaGenerator generator;
+    GpsLocation location = makeLocation();
+    GpsLocationExtended ext = makeExtended();
+    GpsSvStatus svStatus = makeSvStatus(12);
+    generator.appendGsv(svStatus);
+
+    for (auto _ : state) {
+        generator.reset();
+        generator.appendGsa(location, ext);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * sentenceBytes(generator));
+}
+BENCHMARK(BM_NmeaGsa);
+
+static void BM_NmeaGsv(benchmark::State& state)
+{
+    LocNmeaGenerator generator;
+    GpsSvStatus svStatus = makeSvStatus(state.range(0));
+
+    for (auto _ : state) {
+        generator.reset();
+        generator.appendGsv(svStatus);
+        benchmark::ClobberMemory();
+    }
+    state.counters["sentences"] = generator.count();
+    state.SetBytesProcessed(state.iterations() * sentenceBytes(generator));
+}
+BENCHMARK(BM_NmeaGsv)->Arg(12)->Arg(GPS_MAX_SVS);
+
+static void BM_NmeaEpoch(benchmark::State& state)
+{
+    LocNmeaGenerator generator;
+    GpsLocation location = makeLocation();
+    GpsLocationExtended ext = makeExtended();
+    GpsSvStatus svStatus = makeSvStatus(state.range(0));
+    size_t sentences = 0;
+    size_t bytes = 0;
+
+    for (auto _ : state) {
+        generator.reset();
+        generator.appendGsv(svStatus);
+        sentences = generator.count();
+        bytes = sentenceBytes(generator);
+        generator.reset();
+        generator.appendGga(location, ext);
+        generator.appendRmc(location, ext);
+        generator.appendGsa(location, ext);
+        benchmark::ClobberMemory();
+    }
+    sentences += generator.count();
+    bytes += sentenceBytes(generator);
+    state.counters["sentences"] = sentences;
+    state.SetItemsProcessed(state.iterations() * sentences);
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_NmeaEpoch)->Arg(12)->Arg(GPS_MAX_SVS);
+
+/* the GGA of BM_NmeaGga, formatted the way loc eng does it */
+static int printfGga(char* buffer, size_t size, const GpsLocation& location,
+                     const GpsLocationExtended& ext, int svsUsed)
+{
+    time_t seconds = location.timestamp / 1000;
+    struct tm utc;
+    gmtime_r(&seconds, &utc);
+    double lat = fabs(location.latitude);
+    double lon = fabs(location.longitude);
+    double latMinutes = (lat - (int)lat) * 60.0;
+    double lonMinutes = (lon - (int)lon) * 60.0;
+
+    int length = snprintf(buffer, size,
+        "$GPGGA,%02d%02d%02d.%02d,%02d%09.6lf,%c,%03d%09.6lf,%c,1,%02d,"
+        "%.1f,%.1lf,M,%.1lf,M,,",
+        utc.tm_hour, utc.tm_min, utc.tm_sec,
+        (int)(location.timestamp % 1000) / 10,
+        (int)lat, latMinutes, location.latitude < 0 ? 'S' : 'N',
+        (int)lon, lonMinutes, location.longitude < 0 ? 'W' : 'E',
+        svsUsed, ext.hdop, (double)ext.altitudeMeanSeaLevel,
+        location.altitude - ext.altitudeMeanSeaLevel);
+
+    uint8_t checksum = 0;
+    for (int i = 1; i < length; i++) {
+        checksum ^= buffer[i];
+    }
+    return length + snprintf(buffer + length, size - length, "*%02X\r\n",
+                             checksum);
+}
+
+static void BM_NmeaGgaPrintf(benchmark::State& state)
+{
+    char buffer[LOC_NMEA_BUFFER_SIZE];
+    GpsLocation location = makeLocation();
+    GpsLocationExtended ext = makeExtended();
+    int length = 0;
+
+    for (auto _ : state) {
+        length = printfGga(buffer, sizeof(buffer), location, ext, 10);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_NmeaGgaPrintf);
+
+static void BM_ReportPositionNmea(benchmark::State& state)
+{
+    const LocIndSample& ind = locIndSample("position");
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    session.api().setNmeaSynthesis(true);
+    session.msgTask().flush();
+
+    locClientEventIndUnionType payload;
+    payload.pPositionReportEvent =
+        ind.as<qmiLocEventPositionReportIndMsgT_v02>();
+    for (auto _ : state) {
+        session.api().eventCb(LOC_CLIENT_INVALID_HANDLE_VALUE, ind.msgId,
+                              payload);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReportPositionNmea);
@@ -0,0 +1,185 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Sensor data injection (LocSensorInjector):
+   - BM_SensorRing: a push and a pop on an idle LocRingBuffer
+   - BM_SensorRingProducers: 1 to 4 threads pushing while one thread
+     drains, as producers and the injection thread do; items are the
+     samples queued, dropped the share of pushes that found it full
+   - BM_SensorStream: one second of accel and gyro samples at 100 to
+     400 Hz through LocApiV02, injected at 5 or 25 batches a second;
+     push_ns is the producer cost, latency_us and latency_max_us the
+     queue to ack latency of the messages */
+
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+#include <LocRingBuffer.h>
+
+/* the layout LocSensorInjector queues */
+struct RingSample {
+    uint64_t queuedNs;
+    uint32_t timestampMs;
+    float x;
+    float y;
+    float z;
+};
+
+typedef LocRingBuffer<RingSample, 512> SensorRing;
+
+static void BM_SensorRing(benchmark::State& state)
+{
+    SensorRing* ring = new SensorRing;
+    RingSample sample;
+    memset(&sample, 0, sizeof(sample));
+
+    for (auto _ : state) {
+        ring->push(sample);
+        ring->pop(sample);
+        benchmark::DoNotOptimize(sample);
+    }
+    state.SetItemsProcessed(state.iterations());
+    delete ring;
+}
+BENCHMARK(BM_SensorRing);
+
+static SensorRing* sRing;
+static std::atomic<bool> sDraining;
+
+static void drainRing()
+{
+    RingSample sample;
+    while (sDraining.load(std::memory_order_relaxed)) {
+        while (sRing->pop(sample)) {
+        }
+    }
+}
+
+static void BM_SensorRingProducers(benchmark::State& state)
+{
+    std::thread consumer;
+    if (0 == state.thread_index()) {
+        sRing = new SensorRing;
+        sDraining = true;
+        consumer = std::thread(drainRing);
+    }
+
+    RingSample sample;
+    memset(&sample, 0, sizeof(sample));
+    uint64_t dropped = 0;
+    for (auto _ : state) {
+        sample.timestampMs++;
+        if (!sRing->push(sample)) {
+            dropped++;
+        }
+    }
+
+    if (0 == state.thread_index()) {
+        sDraining = false;
+        consumer.join();
+        delete sRing;
+    }
+    state.counters["dropped"] = benchmark::Counter(
+        dropped, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() - dropped);
+}
+BENCHMARK(BM_SensorRingProducers)->ThreadRange(1, 4)->UseRealTime();
+
+static void sensorReady(HostLocApi& api, bool enable,
+                        uint16_t samplesPerBatch, uint16_t batchesPerSecond)
+{
+    qmiLocEventSensorStreamingReadyStatusIndMsgT_v02 status;
+    memset(&status, 0, sizeof(status));
+    status.accelReady_valid = 1;
+    status.accelReady.injectEnable = enable;
+    status.accelReady.dataFrequency.samplesPerBatch = samplesPerBatch;
+    status.accelReady.dataFrequency.batchesPerSecond = batchesPerSecond;
+    status.gyroReady_valid = 1;
+    status.gyroReady = status.accelReady;
+
+    locClientEventIndUnionType payload;
+    payload.pSensorStreamingReadyStatusEvent = &status;
+    api.eventCb(LOC_CLIENT_INVALID_HANDLE_VALUE,
+                QMI_LOC_EVENT_SENSOR_STREAMING_READY_STATUS_IND_V02, payload);
+}
+
+static void BM_SensorStream(benchmark::State& state)
+{
+    uint32_t rateHz = state.range(0);
+    uint16_t batchesPerSecond = state.range(1);
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    HostLocApi& api = session.api();
+    sensorReady(api, true, rateHz / batchesPerSecond, batchesPerSecond);
+
+    LocSensorInjector::Stats stats;
+    uint64_t pushNs = 0;
+    uint64_t pushes = 0;
+    for (auto _ : state) {
+        pushNs += hostPacedStream(rateHz, [&api](uint64_t dueNs) {
+            uint32_t timestampMs = (uint32_t)(dueNs / 1000000ULL);
+            api.injectSensorSample(LocSensorInjector::SENSOR_ACCEL,
+                                   timestampMs, 0.1f, 0.2f, 9.8f);
+            api.injectSensorSample(LocSensorInjector::SENSOR_GYRO,
+                                   timestampMs, 0.01f, 0.02f, 0.03f);
+        });
+        pushes += 2 * rateHz;
+
+        // the tail of the stream goes out with the next batch
+        hostWaitInjected(stats, [&api](LocSensorInjector::Stats& s) {
+            api.getSensorInjectionStats(s);
+        });
+    }
+    // stop the injection thread before the session closes the client
+    sensorReady(api, false, 0, 0);
+    usleep(1000000 / batchesPerSecond);
+
+    api.getSensorInjectionStats(stats);
+    state.counters["push_ns"] = benchmark::Counter(
+        pushes ? (double)pushNs / pushes : 0);
+    state.counters["injected"] = stats.samplesInjected;
+    state.counters["dropped"] = stats.samplesDropped;
+    state.counters["messages"] = stats.messagesSent;
+    state.counters["failed"] = stats.messagesFailed;
+    state.counters["latency_us"] = stats.messagesSent ?
+        (double)stats.latencyTotalUs / stats.messagesSent : 0;
+    state.counters["latency_max_us"] = stats.latencyMaxUs;
+}
+BENCHMARK(BM_SensorStream)
+    ->ArgNames({"hz", "batches"})
+    ->ArgsProduct({{100, 200, 400}, {5, 25}})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,103 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Round trip of a synchronous request over the stub transport: the
+   response, then the indication from the stub modem thread. This is
+   the floor under every loc_sync_send_req in LocApiV02. */
+
+#include <string.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+
+static void BM_SyncSendReq(benchmark::State& state)
+{
+    locClientHandleType handle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+    if (eLOC_CLIENT_SUCCESS != hostClientOpen(0, &handle)) {
+        state.SkipWithError("locClientOpen failed");
+        return;
+    }
+    qmiLocStatusEnumT_v02 status = eQMI_LOC_SUCCESS_V02;
+    qmi_stub_set_responder(hostModemResponder, &status);
+
+    qmiLocSetProtocolConfigParametersReqMsgT_v02 req;
+    memset(&req, 0, sizeof(req));
+    qmiLocSetProtocolConfigParametersIndMsgT_v02 ind;
+    locClientReqUnionType reqUnion;
+    reqUnion.pSetProtocolConfigParametersReq = &req;
+
+    for (auto _ : state) {
+        locClientStatusEnumType st =
+            loc_sync_send_req(handle,
+                              QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02,
+                              reqUnion, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                              QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02,
+                              &ind);
+        benchmark::DoNotOptimize(st);
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    locClientClose(&handle);
+    qmi_stub_reset();
+}
+BENCHMARK(BM_SyncSendReq)->UseRealTime();
+
+/* the same requests pipelined, state.range(0) per batch */
+static void BM_SyncSendBatch(benchmark::State& state)
+{
+    const size_t count = state.range(0);
+    locClientHandleType handle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+    if (eLOC_CLIENT_SUCCESS != hostClientOpen(0, &handle)) {
+        state.SkipWithError("locClientOpen failed");
+        return;
+    }
+    qmiLocStatusEnumT_v02 status = eQMI_LOC_SUCCESS_V02;
+    qmi_stub_set_responder(hostModemResponder, &status);
+
+    qmiLocSetProtocolConfigParametersReqMsgT_v02 req;
+    memset(&req, 0, sizeof(req));
+    std::vector<qmiLocSetProtocolConfigParametersIndMsgT_v02> inds(count);
+    std::vector<loc_sync_batch_req_s_type> reqs(count);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; i++) {
+            reqs[i].req_id = QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02;
+            reqs[i].req_payload.pSetProtocolConfigParametersReq = &req;
+            reqs[i].ind_id = QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02;
+            reqs[i].ind_payload_ptr = &inds[i];
+        }
+        loc_sync_send_batch(handle, reqs.data(), count,
+                            LOC_ENGINE_SYNC_REQUEST_TIMEOUT);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+
+    locClientClose(&handle);
+    qmi_stub_reset();
+}
+BENCHMARK(BM_SyncSendBatch)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
@@ -0,0 +1,188 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Logging overhead of the hot log sites, per indication, with the
+   sites filtered out (off), logged to /dev/null (log) or traced with
+   loc_trace (trace); traced records go to a counting sink and the
+   rings are drained inside the timed loop:
+   - BM_TraceSites: the four sites an NMEA indication passes, IND,
+     IND_LOOKUP, IND_MASK and NMEA, on their own
+   - BM_TraceIndication: that NMEA indication through locClientIndCb
+     and LocApiV02::reportNmea */
+
+#include <stdio.h>
+#include <string.h>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+#include <loc_trace.h>
+#include <loc_util_log.h>
+#include "ind_corpus.h"
+
+/* records between drains; a traced indication writes four, the rings
+   hold LOC_TRACE_RING_SIZE (1024) */
+#define TRACE_DRAIN_ITERATIONS 64
+
+enum LogMode {
+    LOG_MODE_OFF = 0,
+    LOG_MODE_LOG,
+    LOG_MODE_TRACE
+};
+
+static const char* const kLogModeNames[] = { "off", "log", "trace" };
+
+/* the instant sites, not the spans */
+static const uint32_t kTraceSites = (1u << (LOC_TRACE_NMEA + 1)) - 1;
+
+static void countRecords(const locTraceRecordType* records, size_t count,
+                         void* context)
+{
+    (void)records;
+    *(uint64_t*)context += count;
+}
+
+/* the log level, log file and trace mask of one mode, for the length
+   of one benchmark */
+class LogModeScope {
+public:
+    inline LogModeScope(int mode) :
+        mMode(mode), mLevel(loc_host_log_level), mNull(NULL), mRecords(0) {
+        switch (mode) {
+        case LOG_MODE_LOG:
+            mNull = fopen("/dev/null", "w");
+            loc_host_set_log_file(mNull);
+            loc_host_set_log_level(LOC_HOST_LOG_VERBOSE);
+            break;
+        case LOG_MODE_TRACE:
+            loc_trace_set_sink(countRecords, &mRecords);
+            loc_trace_set_mask(kTraceSites);
+            break;
+        default:
+            break;
+        }
+    }
+    inline ~LogModeScope() {
+        if (LOG_MODE_TRACE == mMode) {
+            loc_trace_set_mask(0);
+            loc_trace_flush();
+            loc_trace_set_sink(NULL, NULL);
+        }
+        loc_host_set_log_level(mLevel);
+        loc_host_set_log_file(NULL);
+        if (NULL != mNull) {
+            fclose(mNull);
+        }
+    }
+    /* drain now and then, so the drain is paid inside the loop */
+    inline void drain(size_t iteration) const {
+        if (LOG_MODE_TRACE == mMode &&
+            0 == iteration % TRACE_DRAIN_ITERATIONS) {
+            loc_trace_flush();
+        }
+    }
+    inline uint64_t records() const { return mRecords; }
+
+private:
+    int mMode;
+    int mLevel;
+    FILE* mNull;
+    uint64_t mRecords;
+};
+
+static void BM_TraceSites(benchmark::State& state)
+{
+    const LocIndSample& ind = locIndSample("nmea_gga");
+    const qmiLocEventNmeaIndMsgT_v02* nmea =
+        ind.as<qmiLocEventNmeaIndMsgT_v02>();
+    uint32_t length = strlen(nmea->nmea);
+    uint64_t regMask = 0x0000000100000004ULL;
+    LogModeScope scope(state.range(0));
+    size_t iteration = 0;
+
+    for (auto _ : state) {
+        LOC_TRACE_OR_LOG(LOC_TRACE_IND, ind.msgId, ind.payload.size(), 0, 0,
+                         LOC_LOGV,
+                         "%s:%d]: Indication: msg_id=%d buf_len=%d pCallbackData = %p\n",
+                         __func__, __LINE__, ind.msgId,
+                         (uint32_t)ind.payload.size(), (void*)&ind);
+        LOC_TRACE_OR_LOG(LOC_TRACE_IND_LOOKUP, ind.msgId, ind.payload.size(),
+                         0, 0, LOC_LOGV,
+                         "%s:%d]: indId %d is an event size = %d\n",
+                         __func__, __LINE__, ind.msgId,
+                         (uint32_t)ind.payload.size());
+        LOC_TRACE_OR_LOG(LOC_TRACE_IND_MASK, ind.msgId, regMask >> 32,
+                         regMask & 0xFFFFFFFF, 2, LOC_LOGV,
+                         "%s:%d]: eventId %d registered mask = 0x%04x%04x, "
+                         "eventMask = 0x%04x%04x\n", __func__, __LINE__,
+                         ind.msgId, (uint32_t)(regMask >> 32),
+                         (uint32_t)(regMask & 0xFFFFFFFF),
+                         (uint32_t)(regMask >> 32),
+                         (uint32_t)(regMask & 0xFFFFFFFF));
+        LOC_TRACE_OR_LOG(LOC_TRACE_NMEA, length,
+                         (uint32_t)nmea->nmea[1] << 24 |
+                         (uint32_t)nmea->nmea[2] << 16 |
+                         (uint32_t)nmea->nmea[3] << 8 | nmea->nmea[4],
+                         0, 0, LOC_LOGD, "NMEA <%s", nmea->nmea);
+        scope.drain(++iteration);
+    }
+    loc_trace_flush();
+
+    state.SetLabel(kLogModeNames[state.range(0)]);
+    state.counters["records"] = benchmark::Counter(
+        scope.records(), benchmark::Counter::kAvgIterations);
+    state.counters["dropped"] = loc_trace_get_dropped();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceSites)->DenseRange(LOG_MODE_OFF, LOG_MODE_TRACE);
+
+static void BM_TraceIndication(benchmark::State& state)
+{
+    const LocIndSample& ind = locIndSample("nmea_gga");
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    LogModeScope scope(state.range(0));
+    size_t iteration = 0;
+
+    for (auto _ : state) {
+        qmi_stub_indicate(ind.msgId, ind.payload.data(), ind.payload.size());
+        scope.drain(++iteration);
+    }
+    loc_trace_flush();
+
+    state.SetLabel(kLogModeNames[state.range(0)]);
+    state.counters["records"] = benchmark::Counter(
+        scope.records(), benchmark::Counter::kAvgIterations);
+    state.counters["dropped"] = loc_trace_get_dropped();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceIndication)
+    ->DenseRange(LOG_MODE_OFF, LOG_MODE_TRACE)
+    ->UseRealTime();
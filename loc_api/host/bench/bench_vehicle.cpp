@@ -0,0 +1,166 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Vehicle data injection (LocVehicleInjector) through LocApiV02:
+   - BM_VehiclePush: acceleration samples pushed back to back, the
+     producer cost and the most the two messages take in; dropped is
+     the share of pushes that found both messages in use
+   - BM_VehicleStream: one second of acceleration, angular rate and
+     odometry at 100 Hz to 1 kHz, as a CAN feed sends them; push_ns is
+     the producer cost per epoch, latency_us and latency_max_us the
+     queue to ack latency of the messages */
+
+#include <string.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include <HostLocApi.h>
+
+static const qmiLocAxesMaskT_v02 kAxes =
+    QMI_LOC_MASK_X_AXIS_V02 | QMI_LOC_MASK_Y_AXIS_V02 |
+    QMI_LOC_MASK_Z_AXIS_V02;
+
+static const qmiLocVehicleOdometryWheelFlagsMaskT_v02 kWheels =
+    QMI_LOC_MASK_VEHICLE_ODOMETRY_LEFT_AND_RIGHT_AVERAGE_V02 |
+    QMI_LOC_MASK_VEHICLE_ODOMETRY_LEFT_V02 |
+    QMI_LOC_MASK_VEHICLE_ODOMETRY_RIGHT_V02;
+
+static void vehicleReady(HostLocApi& api, uint8_t ready)
+{
+    qmiLocEventVehicleDataReadyIndMsgT_v02 status;
+    memset(&status, 0, sizeof(status));
+    status.vehicleAccelReadyStatus_valid = 1;
+    status.vehicleAccelReadyStatus = ready;
+    status.vehicleAngularRateReadyStatus_valid = 1;
+    status.vehicleAngularRateReadyStatus = ready;
+    status.vehicleOdometryReadyStatus_valid = 1;
+    status.vehicleOdometryReadyStatus = ready;
+
+    locClientEventIndUnionType payload;
+    payload.pVehicleDataReadyEvent = &status;
+    api.eventCb(LOC_CLIENT_INVALID_HANDLE_VALUE,
+                QMI_LOC_EVENT_VEHICLE_DATA_READY_STATUS_IND_V02, payload);
+}
+
+/* wait for the injection thread to send what was queued, then stop it
+   before the session closes the client */
+static void vehicleDrain(HostLocApi& api, LocVehicleInjector::Stats& stats)
+{
+    hostWaitInjected(stats, [&api](LocVehicleInjector::Stats& s) {
+        api.getVehicleInjectionStats(s);
+    });
+
+    vehicleReady(api, 0);
+    usleep(10000);
+    api.getVehicleInjectionStats(stats);
+}
+
+static void vehicleCounters(benchmark::State& state,
+                            const LocVehicleInjector::Stats& stats)
+{
+    state.counters["injected"] = stats.samplesInjected;
+    state.counters["messages"] = stats.messagesSent;
+    state.counters["failed"] = stats.messagesFailed;
+    state.counters["latency_us"] = stats.messagesSent ?
+        (double)stats.latencyTotalUs / stats.messagesSent : 0;
+    state.counters["latency_max_us"] = stats.latencyMaxUs;
+}
+
+static void BM_VehiclePush(benchmark::State& state)
+{
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    HostLocApi& api = session.api();
+    vehicleReady(api, 1);
+
+    float values[3] = { 0.1f, 0.2f, 9.8f };
+    uint64_t timestampUs = hostNowNs() / 1000;
+    for (auto _ : state) {
+        timestampUs += 1000;
+        api.injectVehicleSensorSample(LocVehicleInjector::VEHICLE_ACCEL,
+                                      timestampUs, kAxes, values);
+    }
+
+    LocVehicleInjector::Stats stats;
+    vehicleDrain(api, stats);
+    vehicleCounters(state, stats);
+    state.counters["dropped"] = benchmark::Counter(
+        stats.samplesDropped, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(stats.samplesQueued);
+}
+BENCHMARK(BM_VehiclePush);
+
+static void BM_VehicleStream(benchmark::State& state)
+{
+    uint32_t rateHz = state.range(0);
+    HostSession session;
+    if (!session.started()) {
+        state.SkipWithError("session not started");
+        return;
+    }
+    HostLocApi& api = session.api();
+    vehicleReady(api, 1);
+
+    float accel[3] = { 0.1f, 0.2f, 9.8f };
+    float angularRate[3] = { 0.01f, 0.02f, 0.03f };
+    uint64_t distanceMm[3] = { 1000000, 1000000, 1000000 };
+    uint64_t pushNs = 0;
+    uint64_t epochs = 0;
+    for (auto _ : state) {
+        pushNs += hostPacedStream(rateHz, [&](uint64_t dueNs) {
+            uint64_t timestampUs = dueNs / 1000;
+            // 20 m/s
+            for (int w = 0; w < 3; w++) {
+                distanceMm[w] += 20000 / rateHz;
+            }
+            api.injectVehicleSensorSample(LocVehicleInjector::VEHICLE_ACCEL,
+                                          timestampUs, kAxes, accel);
+            api.injectVehicleSensorSample(
+                LocVehicleInjector::VEHICLE_ANGULAR_RATE,
+                timestampUs, kAxes, angularRate);
+            api.injectVehicleOdometrySample(timestampUs, kWheels, 0,
+                                            distanceMm);
+        });
+        epochs += rateHz;
+    }
+
+    LocVehicleInjector::Stats stats;
+    vehicleDrain(api, stats);
+    vehicleCounters(state, stats);
+    state.counters["push_ns"] = epochs ? (double)pushNs / epochs : 0;
+    state.counters["dropped"] = stats.samplesDropped;
+}
+BENCHMARK(BM_VehicleStream)
+    ->ArgName("hz")
+    ->Arg(100)->Arg(200)->Arg(500)->Arg(1000)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,234 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <location_service_v02.h>
+#include "ind_corpus.h"
+
+template <typename T>
+static LocIndSample sample(const char* name, uint32_t msgId, const T& ind)
+{
+    LocIndSample s;
+    s.name = name;
+    s.msgId = msgId;
+    s.payload.assign(reinterpret_cast<const uint8_t*>(&ind),
+                     reinterpret_cast<const uint8_t*>(&ind) + sizeof(ind));
+    return s;
+}
+
+static LocIndSample positionReport()
+{
+    qmiLocEventPositionReportIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    ind.sessionStatus = eQMI_LOC_SESS_STATUS_SUCCESS_V02;
+    ind.latitude_valid = 1;
+    ind.latitude = 37.4219999;
+    ind.longitude_valid = 1;
+    ind.longitude = -122.0840575;
+    ind.horUncCircular_valid = 1;
+    ind.horUncCircular = 3.9f;
+    ind.horUncEllipseSemiMinor_valid = 1;
+    ind.horUncEllipseSemiMinor = 2.5f;
+    ind.horUncEllipseSemiMajor_valid = 1;
+    ind.horUncEllipseSemiMajor = 4.1f;
+    ind.horUncEllipseOrientAzimuth_valid = 1;
+    ind.horUncEllipseOrientAzimuth = 37.0f;
+    ind.horConfidence_valid = 1;
+    ind.horConfidence = 68;
+    ind.speedHorizontal_valid = 1;
+    ind.speedHorizontal = 13.4f;
+    ind.speedUnc_valid = 1;
+    ind.speedUnc = 0.3f;
+    ind.altitudeWrtEllipsoid_valid = 1;
+    ind.altitudeWrtEllipsoid = 5.2f;
+    ind.altitudeWrtMeanSeaLevel_valid = 1;
+    ind.altitudeWrtMeanSeaLevel = 37.3f;
+    ind.vertUnc_valid = 1;
+    ind.vertUnc = 6.0f;
+    ind.speedVertical_valid = 1;
+    ind.speedVertical = 0.1f;
+    ind.heading_valid = 1;
+    ind.heading = 271.5f;
+    ind.headingUnc_valid = 1;
+    ind.headingUnc = 4.0f;
+    ind.magneticDeviation_valid = 1;
+    ind.magneticDeviation = 13.2f;
+    ind.technologyMask_valid = 1;
+    ind.technologyMask = QMI_LOC_POS_TECH_MASK_SATELLITE_V02;
+    ind.DOP_valid = 1;
+    ind.DOP.PDOP = 1.4f;
+    ind.DOP.HDOP = 0.8f;
+    ind.DOP.VDOP = 1.1f;
+    ind.timestampUtc_valid = 1;
+    ind.timestampUtc = 1792310400000ULL;
+    ind.leapSeconds_valid = 1;
+    ind.leapSeconds = 18;
+    ind.timeUnc_valid = 1;
+    ind.timeUnc = 0.02f;
+    ind.fixId_valid = 1;
+    ind.fixId = 4711;
+    ind.gnssSvUsedList_valid = 1;
+    ind.gnssSvUsedList_len = 10;
+    for (uint32_t i = 0; i < ind.gnssSvUsedList_len; i++) {
+        ind.gnssSvUsedList[i] = (uint16_t)(i < 6 ? 2 + 3 * i : 65 + i);
+    }
+    return sample("position", QMI_LOC_EVENT_POSITION_REPORT_IND_V02, ind);
+}
+
+/* a sky with GPS, GLONASS, BeiDou and SBAS, up to 80 SVs */
+static LocIndSample svReport(const char* name, uint32_t count)
+{
+    static const struct {
+        qmiLocSvSystemEnumT_v02 system;
+        uint16_t firstId;
+    } systems[] = {
+        { eQMI_LOC_SV_SYSTEM_GPS_V02, 1 },
+        { eQMI_LOC_SV_SYSTEM_GLONASS_V02, 65 },
+        { eQMI_LOC_SV_SYSTEM_BDS_V02, 201 },
+        { eQMI_LOC_SV_SYSTEM_SBAS_V02, 120 },
+    };
+    const uint32_t numSystems = sizeof(systems) / sizeof(systems[0]);
+
+    qmiLocEventGnssSvInfoIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    ind.svList_valid = 1;
+    ind.svList_len = count;
+    for (uint32_t i = 0; i < count; i++) {
+        qmiLocSvInfoStructT_v02& sv = ind.svList[i];
+        sv.validMask = QMI_LOC_SV_INFO_MASK_VALID_SYSTEM_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_GNSS_SVID_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_HEALTH_STATUS_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_PROCESS_STATUS_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_SVINFO_MASK_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_ELEVATION_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_AZIMUTH_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_SNR_V02;
+        sv.system = systems[i % numSystems].system;
+        sv.gnssSvId = systems[i % numSystems].firstId + i / numSystems;
+        sv.healthStatus = 1;
+        sv.svStatus = i % 3 ? eQMI_LOC_SV_STATUS_TRACK_V02
+                            : eQMI_LOC_SV_STATUS_SEARCH_V02;
+        sv.svInfoMask = QMI_LOC_SVINFO_MASK_HAS_EPHEMERIS_V02 |
+                        QMI_LOC_SVINFO_MASK_HAS_ALMANAC_V02;
+        sv.elevation = 5.0f + (i * 7) % 85;
+        sv.azimuth = (float)((i * 37) % 360);
+        sv.snr = 18.0f + (i * 3) % 30;
+    }
+    return sample(name, QMI_LOC_EVENT_GNSS_SV_INFO_IND_V02, ind);
+}
+
+static LocIndSample nmeaReport(const char* name, const char* sentence)
+{
+    qmiLocEventNmeaIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    strncpy(ind.nmea, sentence, sizeof(ind.nmea) - 1);
+    return sample(name, QMI_LOC_EVENT_NMEA_IND_V02, ind);
+}
+
+static void formattedString(qmiLocNiSuplFormattedStringStructT_v02& out,
+                            const char* text)
+{
+    out.formatType = eQMI_LOC_NI_SUPL_FORMAT_LOGICAL_NAME_V02;
+    out.formattedString_len = strlen(text);
+    memcpy(out.formattedString, text, out.formattedString_len);
+}
+
+static LocIndSample niSuplRequest()
+{
+    qmiLocEventNiNotifyVerifyReqIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    ind.notificationType = eQMI_LOC_NI_USER_NOTIFY_VERIFY_ALLOW_NO_RESP_V02;
+    ind.NiSuplInd_valid = 1;
+    qmiLocNiSuplNotifyVerifyStructT_v02& supl = ind.NiSuplInd;
+    supl.valid_flags = QMI_LOC_SUPL_CLIENT_NAME_MASK_V02 |
+                       QMI_LOC_SUPL_REQUESTOR_ID_MASK_V02 |
+                       QMI_LOC_SUPL_DATA_CODING_SCHEME_MASK_V02;
+    supl.posMethod = eQMI_LOC_NI_SUPL_POSMETHOD_AGPS_SETASSISTED_PREF_V02;
+    supl.dataCodingScheme = eQMI_LOC_NI_SUPL_UTF8_V02;
+    formattedString(supl.requestorId, "+14085551234");
+    formattedString(supl.clientName, "Emergency Locator Service");
+    supl.userResponseTimer = 20;
+    return sample("ni_supl", QMI_LOC_EVENT_NI_NOTIFY_VERIFY_REQ_IND_V02, ind);
+}
+
+static LocIndSample engineState()
+{
+    qmiLocEventEngineStateIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    ind.engineState = eQMI_LOC_ENGINE_STATE_ON_V02;
+    return sample("engine_state", QMI_LOC_EVENT_ENGINE_STATE_IND_V02, ind);
+}
+
+static LocIndSample fixSessionState()
+{
+    qmiLocEventFixSessionStateIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    ind.sessionState = eQMI_LOC_FIX_SESSION_STARTED_V02;
+    ind.sessionId_valid = 1;
+    ind.sessionId = 1;
+    return sample("fix_session_state",
+                  QMI_LOC_EVENT_FIX_SESSION_STATE_IND_V02, ind);
+}
+
+static std::vector<LocIndSample> buildCorpus()
+{
+    std::vector<LocIndSample> corpus;
+    corpus.push_back(positionReport());
+    corpus.push_back(svReport("sv_12", 12));
+    corpus.push_back(svReport("sv_40", 40));
+    corpus.push_back(svReport("sv_80", QMI_LOC_SV_INFO_LIST_MAX_SIZE_V02));
+    corpus.push_back(nmeaReport("nmea_gga",
+        "$GPGGA,123519.00,3725.3200,N,12205.0435,W,1,10,0.8,37.3,M,-32.1,M,,*5C"));
+    corpus.push_back(nmeaReport("nmea_gsv",
+        "$GPGSV,3,1,12,02,71,264,44,05,32,051,41,07,13,318,36,08,45,102,43*7A"));
+    corpus.push_back(niSuplRequest());
+    corpus.push_back(engineState());
+    corpus.push_back(fixSessionState());
+    return corpus;
+}
+
+const std::vector<LocIndSample>& locIndCorpus()
+{
+    static const std::vector<LocIndSample> corpus = buildCorpus();
+    return corpus;
+}
+
+const LocIndSample& locIndSample(const char* name)
+{
+    const std::vector<LocIndSample>& corpus = locIndCorpus();
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (0 == strcmp(corpus[i].name, name)) {
+            return corpus[i];
+        }
+    }
+    fprintf(stderr, "no indication sample %s\n", name);
+    abort();
+}
@@ -0,0 +1,216 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOST_LOC_API_H
+#define HOST_LOC_API_H
+
+/* LocApiV02 and a bare loc client over the stub QMI transport, for the
+   host tests and benchmarks */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <LocApiV02.h>
+#include <loc_api_sync_req.h>
+
+extern "C" {
+#include <libloc_loader/libloc_loader.h>
+}
+#include <qmi_stub.h>
+
+/* answers the requests LocApiV02 waits on with their indication,
+   carrying the qmiLocStatusEnumT_v02 the context points to, as the
+   modem does; the other requests only get their response */
+inline int hostModemResponder(uint32_t req_id, const void* req,
+                              uint32_t req_len, void* resp,
+                              uint32_t resp_len, void* context)
+{
+    (void)req;
+    (void)req_len;
+    (void)resp;
+    (void)resp_len;
+
+    switch (req_id) {
+    case QMI_LOC_SET_OPERATION_MODE_REQ_V02:
+    case QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02:
+    case QMI_LOC_INJECT_SENSOR_DATA_REQ_V02:
+    case QMI_LOC_INJECT_VEHICLE_SENSOR_DATA_REQ_V02:
+    {
+        // these indications all lead with the status
+        qmiLocSetProtocolConfigParametersIndMsgT_v02 ind;
+        memset(&ind, 0, sizeof(ind));
+        ind.status = *(qmiLocStatusEnumT_v02*)context;
+        qmi_stub_indicate_async(req_id, &ind, sizeof(ind), 0);
+        break;
+    }
+    default:
+        break;
+    }
+    return QMI_NO_ERR;
+}
+
+class HostLocApi : public LocApiV02 {
+public:
+    static const LOC_API_ADAPTER_EVENT_MASK_T kMask =
+        LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+        LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+        LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+        LOC_API_ADAPTER_BIT_NI_NOTIFY_VERIFY_REQUEST;
+
+    inline HostLocApi(const loc_core::MsgTask* msgTask) :
+        LocApiV02(msgTask, 0) {}
+
+    /* open and close are for loc eng only */
+    using LocApiV02::open;
+    using LocApiV02::close;
+
+    /* position, SV and NMEA events are only registered in a session */
+    inline bool startSession() {
+        static qmiLocStatusEnumT_v02 success = eQMI_LOC_SUCCESS_V02;
+        qmi_stub_set_responder(hostModemResponder, &success);
+
+        loc_core::LocPosMode posMode;
+        memset(&posMode, 0, sizeof(posMode));
+        posMode.mode = LOC_POSITION_MODE_STANDALONE;
+        posMode.recurrence = GPS_POSITION_RECURRENCE_PERIODIC;
+        posMode.min_interval = 1000;
+        return loc_core::LOC_API_ADAPTER_ERR_SUCCESS == open(kMask) &&
+               loc_core::LOC_API_ADAPTER_ERR_SUCCESS == startFix(posMode);
+    }
+};
+
+/* a HostLocApi in a session, on its own MsgTask, for the length of one
+   test or benchmark */
+class HostSession {
+public:
+    inline HostSession() : mMsgTask("loc_host"), mApi(&mMsgTask) {
+        mStarted = mApi.startSession();
+    }
+    inline ~HostSession() {
+        mApi.close();
+        qmi_stub_reset();
+    }
+    inline bool started() const { return mStarted; }
+    inline HostLocApi& api() { return mApi; }
+    inline loc_core::MsgTask& msgTask() { return mMsgTask; }
+
+private:
+    loc_core::MsgTask mMsgTask;
+    HostLocApi mApi;
+    bool mStarted;
+};
+
+inline uint64_t hostNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* one second of a feed at rateHz: calls push(dueNs) at each due time,
+   as a sensor or CAN feed would. Returns the time spent in push */
+template <typename Push>
+inline uint64_t hostPacedStream(uint32_t rateHz, Push push)
+{
+    uint64_t startNs = hostNowNs();
+    uint64_t pushNs = 0;
+    for (uint32_t i = 0; i < rateHz; i++) {
+        uint64_t dueNs = startNs + (uint64_t)i * 1000000000ULL / rateHz;
+        uint64_t now = hostNowNs();
+        if (dueNs > now) {
+            usleep((dueNs - now) / 1000);
+        }
+        uint64_t pushStartNs = hostNowNs();
+        push(dueNs);
+        pushNs += hostNowNs() - pushStartNs;
+    }
+    return pushNs;
+}
+
+/* waits up to a second for an injector to send what was queued, or to
+   fail a message; getStats(stats) reads the injector Stats */
+template <typename Stats, typename GetStats>
+inline void hostWaitInjected(Stats& stats, GetStats getStats)
+{
+    uint64_t deadlineNs = hostNowNs() + 1000000000ULL;
+    do {
+        usleep(1000);
+        getStats(stats);
+    } while (stats.samplesInjected < stats.samplesQueued &&
+             0 == stats.messagesFailed && hostNowNs() < deadlineNs);
+}
+
+/* a loc client that hands its response indications to loc_sync_req,
+   as LocApiV02 does, and drops its events */
+inline void hostClientRespCb(locClientHandleType handle, uint32_t respId,
+                             const locClientRespIndUnionType respPayload,
+                             void* cookie)
+{
+    (void)cookie;
+    loc_sync_process_ind(handle, respId,
+                         (void*)respPayload.pDeleteAssistDataInd);
+}
+
+inline void hostClientEventCb(locClientHandleType handle, uint32_t eventId,
+                              const locClientEventIndUnionType eventPayload,
+                              void* cookie)
+{
+    (void)handle;
+    (void)eventId;
+    (void)eventPayload;
+    (void)cookie;
+}
+
+inline void hostClientErrorCb(locClientHandleType handle,
+                              locClientErrorEnumType errorId, void* cookie)
+{
+    (void)handle;
+    (void)errorId;
+    (void)cookie;
+}
+
+inline locClientStatusEnumType hostClientOpen(locClientEventMaskType mask,
+                                              locClientHandleType* handle)
+{
+    static const locClientCallbacksType callbacks =
+    {
+        sizeof(locClientCallbacksType),
+        hostClientEventCb,
+        hostClientRespCb,
+        hostClientErrorCb
+    };
+
+    // as LocApiV02::open does before its first locClientOpen
+    if (LOC_LOADER_BACKEND_AVAILABLE != load_proprietary_symbols()) {
+        return eLOC_CLIENT_FAILURE_SERVICE_NOT_PRESENT;
+    }
+    loc_sync_req_init();
+    return locClientOpen(mask, &callbacks, handle, NULL);
+}
+
+#endif //HOST_LOC_API_H
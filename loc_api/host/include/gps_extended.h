@@ -0,0 +1,225 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOST_GPS_EXTENDED_H
+#define HOST_GPS_EXTENDED_H
+
+/* Host stand-in for the loc_core types shared with libloc_api_v02 */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <hardware/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AGPS_TYPE_WWAN_ANY              3
+#define AGPS_TYPE_SUPL_ES               5
+#define GPS_NI_TYPE_EMERGENCY_SUPL      4
+#define AGPS_CERTIFICATE_MAX_SLOTS      10
+
+#define LOCATION_HAS_SOURCE_INFO        0x0020
+#define ULP_LOCATION_IS_FROM_HYBRID     0x0001
+#define ULP_LOCATION_IS_FROM_GNSS       0x0002
+
+#define GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL 0x0001
+#define GPS_LOCATION_EXTENDED_HAS_DOP                     0x0002
+#define GPS_LOCATION_EXTENDED_HAS_MAG_DEV                 0x0004
+#define GPS_LOCATION_EXTENDED_HAS_MODE_IND                0x0008
+#define GPS_LOCATION_EXTENDED_HAS_VERT_UNC                0x0010
+#define GPS_LOCATION_EXTENDED_HAS_SPEED_UNC               0x0020
+
+typedef uint16_t LocPosTechMask;
+#define LOC_POS_TECH_MASK_DEFAULT                   0x0000
+#define LOC_POS_TECH_MASK_SATELLITE                 0x0001
+#define LOC_POS_TECH_MASK_CELLID                    0x0002
+#define LOC_POS_TECH_MASK_WIFI                      0x0004
+#define LOC_POS_TECH_MASK_SENSORS                   0x0008
+#define LOC_POS_TECH_MASK_REFERENCE_LOCATION        0x0010
+#define LOC_POS_TECH_MASK_INJECTED_COARSE_POSITION  0x0020
+#define LOC_POS_TECH_MASK_AFLT                      0x0040
+#define LOC_POS_TECH_MASK_HYBRID                    0x0080
+
+typedef struct {
+    size_t size;
+    GpsLocation gpsLocation;
+    int position_source;
+    uint16_t is_indoor;
+    float floor_number;
+    char map_url[400];
+    unsigned char map_index[16];
+    uint16_t rawDataSize;
+    void* rawData;
+} UlpLocation;
+
+typedef struct {
+    size_t size;
+    uint16_t flags;
+    float altitudeMeanSeaLevel;
+    float pdop;
+    float hdop;
+    float vdop;
+    float magneticDeviation;
+    float vert_unc;
+    float speed_unc;
+} GpsLocationExtended;
+
+typedef enum {
+    LOC_AGPS_CDMA_PDE_SERVER,
+    LOC_AGPS_CUSTOM_PDE_SERVER,
+    LOC_AGPS_MPC_SERVER,
+    LOC_AGPS_SUPL_SERVER
+} LocServerType;
+
+typedef enum {
+    LOC_POSITION_MODE_INVALID = -1,
+    LOC_POSITION_MODE_STANDALONE = 0,
+    LOC_POSITION_MODE_MS_BASED,
+    LOC_POSITION_MODE_MS_ASSISTED,
+    LOC_POSITION_MODE_RESERVED_1,
+    LOC_POSITION_MODE_RESERVED_2,
+    LOC_POSITION_MODE_RESERVED_3,
+    LOC_POSITION_MODE_RESERVED_4,
+    LOC_POSITION_MODE_RESERVED_5
+} LocPositionMode;
+
+enum loc_sess_status {
+    LOC_SESS_SUCCESS,
+    LOC_SESS_INTERMEDIATE,
+    LOC_SESS_FAILURE
+};
+
+typedef enum {
+    LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC = 0
+} loc_if_req_sender_id_e_type;
+
+typedef int32_t LOC_GPS_LOCK_MASK;
+#define isGpsLockNone(lock) ((lock) == 0)
+#define isGpsLockMO(lock)   ((lock) & 1)
+#define isGpsLockMT(lock)   ((lock) & 2)
+#define isGpsLockAll(lock)  (((lock) & 3) == 3)
+
+enum xtra_version_check {
+    DISABLED,
+    AUTO,
+    XTRA2,
+    XTRA3
+};
+
+typedef uint32_t LOC_API_ADAPTER_EVENT_MASK_T;
+
+enum loc_api_adapter_event_index {
+    LOC_API_ADAPTER_REPORT_POSITION = 0,
+    LOC_API_ADAPTER_REPORT_SATELLITE,
+    LOC_API_ADAPTER_REPORT_NMEA_1HZ,
+    LOC_API_ADAPTER_REPORT_NMEA_POSITION,
+    LOC_API_ADAPTER_REQUEST_NI_NOTIFY_VERIFY,
+    LOC_API_ADAPTER_REQUEST_ASSISTANCE_DATA,
+    LOC_API_ADAPTER_REQUEST_LOCATION_SERVER,
+    LOC_API_ADAPTER_REPORT_IOCTL,
+    LOC_API_ADAPTER_REPORT_STATUS,
+    LOC_API_ADAPTER_REQUEST_WIFI,
+    LOC_API_ADAPTER_SENSOR_STATUS,
+    LOC_API_ADAPTER_REQUEST_TIME_SYNC,
+    LOC_API_ADAPTER_REPORT_SPI,
+    LOC_API_ADAPTER_REPORT_NI_GEOFENCE,
+    LOC_API_ADAPTER_GEOFENCE_GEN_ALERT,
+    LOC_API_ADAPTER_REPORT_GENFENCE_BREACH,
+    LOC_API_ADAPTER_PEDOMETER_CTRL,
+    LOC_API_ADAPTER_MOTION_CTRL,
+    LOC_API_ADAPTER_REQUEST_WIFI_AP_DATA,
+    LOC_API_ADAPTER_BATCH_FULL,
+    LOC_API_ADAPTER_BATCHED_POSITION_REPORT,
+    LOC_API_ADAPTER_BATCHED_GENFENCE_BREACH_REPORT,
+
+    LOC_API_ADAPTER_EVENT_MAX
+};
+
+#define LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT   (1<<LOC_API_ADAPTER_REPORT_POSITION)
+#define LOC_API_ADAPTER_BIT_SATELLITE_REPORT         (1<<LOC_API_ADAPTER_REPORT_SATELLITE)
+#define LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT          (1<<LOC_API_ADAPTER_REPORT_NMEA_1HZ)
+#define LOC_API_ADAPTER_BIT_NMEA_POSITION_REPORT     (1<<LOC_API_ADAPTER_REPORT_NMEA_POSITION)
+#define LOC_API_ADAPTER_BIT_NI_NOTIFY_VERIFY_REQUEST (1<<LOC_API_ADAPTER_REQUEST_NI_NOTIFY_VERIFY)
+#define LOC_API_ADAPTER_BIT_ASSISTANCE_DATA_REQUEST  (1<<LOC_API_ADAPTER_REQUEST_ASSISTANCE_DATA)
+#define LOC_API_ADAPTER_BIT_LOCATION_SERVER_REQUEST  (1<<LOC_API_ADAPTER_REQUEST_LOCATION_SERVER)
+#define LOC_API_ADAPTER_BIT_IOCTL_REPORT             (1<<LOC_API_ADAPTER_REPORT_IOCTL)
+#define LOC_API_ADAPTER_BIT_STATUS_REPORT            (1<<LOC_API_ADAPTER_REPORT_STATUS)
+#define LOC_API_ADAPTER_BIT_REQUEST_WIFI             (1<<LOC_API_ADAPTER_REQUEST_WIFI)
+#define LOC_API_ADAPTER_BIT_SENSOR_STATUS            (1<<LOC_API_ADAPTER_SENSOR_STATUS)
+#define LOC_API_ADAPTER_BIT_REQUEST_TIME_SYNC        (1<<LOC_API_ADAPTER_REQUEST_TIME_SYNC)
+#define LOC_API_ADAPTER_BIT_REPORT_SPI               (1<<LOC_API_ADAPTER_REPORT_SPI)
+#define LOC_API_ADAPTER_BIT_REPORT_NI_GEOFENCE       (1<<LOC_API_ADAPTER_REPORT_NI_GEOFENCE)
+#define LOC_API_ADAPTER_BIT_GEOFENCE_GEN_ALERT       (1<<LOC_API_ADAPTER_GEOFENCE_GEN_ALERT)
+#define LOC_API_ADAPTER_BIT_REPORT_GENFENCE_BREACH   (1<<LOC_API_ADAPTER_REPORT_GENFENCE_BREACH)
+#define LOC_API_ADAPTER_BIT_BATCHED_GENFENCE_BREACH_REPORT (1<<LOC_API_ADAPTER_BATCHED_GENFENCE_BREACH_REPORT)
+#define LOC_API_ADAPTER_BIT_PEDOMETER_CTRL           (1<<LOC_API_ADAPTER_PEDOMETER_CTRL)
+#define LOC_API_ADAPTER_BIT_MOTION_CTRL              (1<<LOC_API_ADAPTER_MOTION_CTRL)
+#define LOC_API_ADAPTER_BIT_REQUEST_WIFI_AP_DATA     (1<<LOC_API_ADAPTER_REQUEST_WIFI_AP_DATA)
+#define LOC_API_ADAPTER_BIT_BATCH_FULL               (1<<LOC_API_ADAPTER_BATCH_FULL)
+#define LOC_API_ADAPTER_BIT_BATCHED_POSITION_REPORT  (1<<LOC_API_ADAPTER_BATCHED_POSITION_REPORT)
+
+typedef enum loc_api_adapter_msg_to_check_supported {
+    LOC_API_ADAPTER_MESSAGE_LOCATION_BATCHING,
+    LOC_API_ADAPTER_MESSAGE_BATCHED_GENFENCE_BREACH,
+
+    LOC_API_ADAPTER_MESSAGE_MAX
+} LocCheckingMessagesID;
+
+#define GPS_DELETE_TIME_GPS         0x00010000
+#define GPS_DELETE_ALMANAC_CORR     0x00020000
+#define GPS_DELETE_FREQ_BIAS_EST    0x00040000
+
+#define GLO_DELETE_EPHEMERIS        0x00000001
+#define GLO_DELETE_ALMANAC          0x00000002
+#define GLO_DELETE_SVDIR            0x00000004
+#define GLO_DELETE_SVSTEER          0x00000008
+#define GLO_DELETE_ALMANAC_CORR     0x00000010
+#define GLO_DELETE_TIME             0x00000020
+
+#define BDS_DELETE_EPHEMERIS        0x00000001
+#define BDS_DELETE_ALMANAC          0x00000002
+#define BDS_DELETE_SVDIR            0x00000004
+#define BDS_DELETE_SVSTEER          0x00000008
+#define BDS_DELETE_ALMANAC_CORR     0x00000010
+#define BDS_DELETE_TIME             0x00000020
+
+/* from gps.utils */
+size_t strlcpy(char* dst, const char* src, size_t size);
+size_t strlcat(char* dst, const char* src, size_t size);
+int hexcode(char* hexstring, int string_size, const char* data, int data_size);
+int decodeAddress(char* addr_string, int string_size,
+                  const char* data, int data_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HOST_GPS_EXTENDED_H
@@ -0,0 +1,159 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOST_HARDWARE_GPS_H
+#define HOST_HARDWARE_GPS_H
+
+/* Host stand-in for the parts of the Android GPS HAL header used by
+   libloc_api_v02 */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef int64_t GpsUtcTime;
+
+typedef uint16_t GpsLocationFlags;
+#define GPS_LOCATION_HAS_LAT_LONG   0x0001
+#define GPS_LOCATION_HAS_ALTITUDE   0x0002
+#define GPS_LOCATION_HAS_SPEED      0x0004
+#define GPS_LOCATION_HAS_BEARING    0x0008
+#define GPS_LOCATION_HAS_ACCURACY   0x0010
+
+#define GPS_MAX_SVS 32
+
+typedef struct {
+    size_t size;
+    uint16_t flags;
+    double latitude;
+    double longitude;
+    double altitude;
+    float speed;
+    float bearing;
+    float accuracy;
+    GpsUtcTime timestamp;
+} GpsLocation;
+
+typedef uint16_t GpsStatusValue;
+#define GPS_STATUS_NONE             0
+#define GPS_STATUS_SESSION_BEGIN    1
+#define GPS_STATUS_SESSION_END      2
+#define GPS_STATUS_ENGINE_ON        3
+#define GPS_STATUS_ENGINE_OFF       4
+
+typedef struct {
+    size_t size;
+    int prn;
+    float snr;
+    float elevation;
+    float azimuth;
+} GpsSvInfo;
+
+typedef struct {
+    size_t size;
+    int num_svs;
+    GpsSvInfo sv_list[GPS_MAX_SVS];
+    uint32_t ephemeris_mask;
+    uint32_t almanac_mask;
+    uint32_t used_in_fix_mask;
+} GpsSvStatus;
+
+typedef uint16_t GpsAidingData;
+#define GPS_DELETE_EPHEMERIS        0x0001
+#define GPS_DELETE_ALMANAC          0x0002
+#define GPS_DELETE_POSITION         0x0004
+#define GPS_DELETE_TIME             0x0008
+#define GPS_DELETE_IONO             0x0010
+#define GPS_DELETE_UTC              0x0020
+#define GPS_DELETE_HEALTH           0x0040
+#define GPS_DELETE_SVDIR            0x0080
+#define GPS_DELETE_SVSTEER          0x0100
+#define GPS_DELETE_SADATA           0x0200
+#define GPS_DELETE_RTI              0x0400
+#define GPS_DELETE_CELLDB_INFO      0x8000
+#define GPS_DELETE_ALL              0xFFFF
+
+typedef int GpsNiType;
+#define GPS_NI_TYPE_VOICE              1
+#define GPS_NI_TYPE_UMTS_SUPL          2
+#define GPS_NI_TYPE_UMTS_CTRL_PLANE    3
+
+typedef uint32_t GpsNiNotifyFlags;
+#define GPS_NI_NEED_NOTIFY          0x0001
+#define GPS_NI_NEED_VERIFY          0x0002
+#define GPS_NI_PRIVACY_OVERRIDE     0x0004
+
+typedef int GpsUserResponseType;
+#define GPS_NI_RESPONSE_ACCEPT         1
+#define GPS_NI_RESPONSE_DENY           2
+#define GPS_NI_RESPONSE_NORESP         3
+
+typedef int GpsNiEncodingType;
+#define GPS_ENC_NONE                   0
+#define GPS_ENC_SUPL_GSM_DEFAULT       1
+#define GPS_ENC_SUPL_UTF8              2
+#define GPS_ENC_SUPL_UCS2              3
+#define GPS_ENC_UNKNOWN                -1
+
+#define GPS_NI_SHORT_STRING_MAXLEN      256
+#define GPS_NI_LONG_STRING_MAXLEN       2048
+
+typedef struct {
+    size_t size;
+    int notification_id;
+    GpsNiType ni_type;
+    GpsNiNotifyFlags notify_flags;
+    int timeout;
+    GpsUserResponseType default_response;
+    char requestor_id[GPS_NI_SHORT_STRING_MAXLEN];
+    char text[GPS_NI_LONG_STRING_MAXLEN];
+    GpsNiEncodingType requestor_id_encoding;
+    GpsNiEncodingType text_encoding;
+    char extras[GPS_NI_LONG_STRING_MAXLEN];
+} GpsNiNotification;
+
+typedef uint16_t AGpsType;
+#define AGPS_TYPE_SUPL          1
+#define AGPS_TYPE_C2K           2
+
+typedef uint16_t AGpsBearerType;
+#define AGPS_APN_BEARER_INVALID    -1
+#define AGPS_APN_BEARER_IPV4        0
+#define AGPS_APN_BEARER_IPV6        1
+#define AGPS_APN_BEARER_IPV4V6      2
+
+typedef uint32_t GpsPositionRecurrence;
+#define GPS_POSITION_RECURRENCE_PERIODIC    0
+#define GPS_POSITION_RECURRENCE_SINGLE      1
+
+typedef struct {
+    size_t length;
+    unsigned char* data;
+} DerEncodedCertificate;
+
+#endif //HOST_HARDWARE_GPS_H
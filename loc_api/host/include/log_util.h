@@ -0,0 +1,82 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOST_LOG_UTIL_H
+#define HOST_LOG_UTIL_H
+
+/* Host stand-in for the gps.utils logging macros. Messages below the
+   host log level are skipped before they are formatted; the level is
+   taken from LOC_HOST_LOG_LEVEL, 0 (none) to 5 (verbose), errors only
+   if it is unset. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOC_HOST_LOG_NONE     0
+#define LOC_HOST_LOG_ERROR    1
+#define LOC_HOST_LOG_WARNING  2
+#define LOC_HOST_LOG_INFO     3
+#define LOC_HOST_LOG_DEBUG    4
+#define LOC_HOST_LOG_VERBOSE  5
+
+extern int loc_host_log_level;
+
+void loc_host_log(int level, const char* fmt, ...);
+void loc_host_set_log_level(int level);
+/* where messages go, stderr by default */
+void loc_host_set_log_file(FILE* file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define LOC_HOST_LOG(level, ...) \
+    do { \
+        if (loc_host_log_level >= (level)) { \
+            loc_host_log((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOC_LOGE(...) LOC_HOST_LOG(LOC_HOST_LOG_ERROR, __VA_ARGS__)
+#define LOC_LOGW(...) LOC_HOST_LOG(LOC_HOST_LOG_WARNING, __VA_ARGS__)
+#define LOC_LOGI(...) LOC_HOST_LOG(LOC_HOST_LOG_INFO, __VA_ARGS__)
+#define LOC_LOGD(...) LOC_HOST_LOG(LOC_HOST_LOG_DEBUG, __VA_ARGS__)
+#define LOC_LOGV(...) LOC_HOST_LOG(LOC_HOST_LOG_VERBOSE, __VA_ARGS__)
+
+#define ENTRY_LOG()
+#define EXIT_LOG(SPEC, VAL)
+#define ENTRY_LOG_CALLFLOW()
+#define EXIT_LOG_CALLFLOW(SPEC, VAL)
+#define MODEM_LOG_CALLFLOW(SPEC, VAL)
+
+#endif //HOST_LOG_UTIL_H
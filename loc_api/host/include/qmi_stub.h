@@ -0,0 +1,80 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HOST_QMI_STUB_H
+#define HOST_QMI_STUB_H
+
+/* Stub QMI transport for the host build. It stands in for the QMI CCI,
+   DSI and WDS libraries the loader resolves on target; the host loader
+   binds their function pointers to it. There is no modem behind it:
+   requests go to a responder the test sets, and indications are
+   delivered when the test asks for them. A message travels as its C
+   structure, so encoding and decoding are plain copies. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* answers a request; resp is zeroed beforehand, which reads as success
+   for every QMI LOC response. Returns a qmi_client_error_type. */
+typedef int (*qmi_stub_responder_type)(uint32_t req_id,
+                                       const void* req, uint32_t req_len,
+                                       void* resp, uint32_t resp_len,
+                                       void* context);
+
+/* NULL restores the default, which succeeds every request */
+void qmi_stub_set_responder(qmi_stub_responder_type responder, void* context);
+
+/* hand an indication to the client on the calling thread, as the QMI
+   callback thread would; false if no client is open */
+int qmi_stub_indicate(uint32_t msg_id, const void* ind, uint32_t ind_len);
+
+/* queue an indication for the stub modem thread, which hands them to
+   the client in order after delay_us; false if no client is open */
+int qmi_stub_indicate_async(uint32_t msg_id, const void* ind,
+                            uint32_t ind_len, uint32_t delay_us);
+
+/* wait until the stub modem thread delivered everything queued */
+void qmi_stub_flush(void);
+
+/* report a transport error, e.g. a modem restart, to the client */
+void qmi_stub_error(int error);
+
+/* requests sent since the stub was reset */
+uint64_t qmi_stub_request_count(void);
+
+/* deliver what is queued, then drop the responder and the counters */
+void qmi_stub_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HOST_QMI_STUB_H
@@ -0,0 +1,477 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <LocApiBase.h>
+
+namespace loc_core {
+
+void LocPosMode::logv() const
+{
+    LOC_LOGV("Position mode: %d\n  Position recurrence: %d\n"
+             "  Min interval: %u\n  Preferred accuracy: %u\n"
+             "  Preferred time: %u\n  Credentials: %.14s\n  Provider: %.8s",
+             mode, recurrence, min_interval, preferred_accuracy,
+             preferred_time, credentials, provider);
+}
+
+LocApiBase::LocApiBase(const MsgTask* msgTask,
+                       LOC_API_ADAPTER_EVENT_MASK_T excludedMask,
+                       ContextBase* context) :
+    mExcludedMask(excludedMask), mMask(0), mContext(context),
+    mMsgTask(msgTask), mHostInSession(false)
+{
+    mHostCounts.positions = 0;
+    mHostCounts.svs = 0;
+    mHostCounts.nmeas = 0;
+    mHostCounts.statuses = 0;
+    mHostCounts.niNotifies = 0;
+    mHostCounts.xtraRequests = 0;
+    mHostCounts.atlRequests = 0;
+    mHostCounts.engineUps = 0;
+    mHostCounts.engineDowns = 0;
+    memset(&mHostLast, 0, sizeof(mHostLast));
+    pthread_mutex_init(&mHostMutex, NULL);
+}
+
+bool LocApiBase::isInSession()
+{
+    return mHostInSession;
+}
+
+enum loc_api_adapter_err LocApiBase::open(LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    mMask = mask;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::close()
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+void LocApiBase::addAdapter(LocAdapterBase* adapter)
+{
+    (void)adapter;
+}
+
+void LocApiBase::handleEngineUpEvent()
+{
+    mHostCounts.engineUps++;
+}
+
+void LocApiBase::handleEngineDownEvent()
+{
+    mHostCounts.engineDowns++;
+}
+
+void LocApiBase::reportPosition(UlpLocation &location,
+                                GpsLocationExtended &locationExtended,
+                                void* locationExt,
+                                enum loc_sess_status status,
+                                LocPosTechMask loc_technology_mask)
+{
+    (void)locationExt;
+    pthread_mutex_lock(&mHostMutex);
+    mHostLast.location = location;
+    mHostLast.locationExtended = locationExtended;
+    mHostLast.sessionStatus = status;
+    mHostLast.techMask = loc_technology_mask;
+    pthread_mutex_unlock(&mHostMutex);
+    mHostCounts.positions++;
+}
+
+void LocApiBase::reportSv(GpsSvStatus &svStatus,
+                          GpsLocationExtended &locationExtended,
+                          void* svExt)
+{
+    (void)locationExtended;
+    (void)svExt;
+    pthread_mutex_lock(&mHostMutex);
+    mHostLast.svStatus = svStatus;
+    pthread_mutex_unlock(&mHostMutex);
+    mHostCounts.svs++;
+}
+
+void LocApiBase::reportStatus(GpsStatusValue status)
+{
+    (void)status;
+    mHostCounts.statuses++;
+}
+
+void LocApiBase::reportNmea(const char* nmea, int length)
+{
+    pthread_mutex_lock(&mHostMutex);
+    if (length < 0) {
+        length = 0;
+    } else if (length > (int)sizeof(mHostLast.nmea) - 1) {
+        length = sizeof(mHostLast.nmea) - 1;
+    }
+    memcpy(mHostLast.nmea, nmea, length);
+    mHostLast.nmea[length] = '\0';
+    mHostLast.nmeaLength = length;
+    pthread_mutex_unlock(&mHostMutex);
+    mHostCounts.nmeas++;
+}
+
+void LocApiBase::reportXtraServer(const char* url1, const char* url2,
+                                  const char* url3, const int maxlength)
+{
+    (void)url1;
+    (void)url2;
+    (void)url3;
+    (void)maxlength;
+}
+
+void LocApiBase::requestXtraData()
+{
+    mHostCounts.xtraRequests++;
+}
+
+void LocApiBase::requestTime()
+{
+}
+
+void LocApiBase::requestLocation()
+{
+}
+
+void LocApiBase::requestATL(int connHandle, AGpsType agps_type)
+{
+    (void)connHandle;
+    (void)agps_type;
+    mHostCounts.atlRequests++;
+}
+
+void LocApiBase::releaseATL(int connHandle)
+{
+    (void)connHandle;
+}
+
+void LocApiBase::requestSuplES(int connHandle)
+{
+    (void)connHandle;
+    mHostCounts.atlRequests++;
+}
+
+void LocApiBase::reportDataCallOpened()
+{
+}
+
+void LocApiBase::reportDataCallClosed()
+{
+}
+
+void LocApiBase::requestNiNotify(GpsNiNotification &notify, const void* data)
+{
+    pthread_mutex_lock(&mHostMutex);
+    mHostLast.niNotify = notify;
+    pthread_mutex_unlock(&mHostMutex);
+    mHostCounts.niNotifies++;
+    // no user answers on the host; loc eng frees the copy after the answer
+    free((void*)data);
+}
+
+void LocApiBase::saveSupportedMsgList(uint64_t supportedMsgList)
+{
+    (void)supportedMsgList;
+}
+
+void LocApiBase::hostLast(HostLast& last) const
+{
+    pthread_mutex_lock(&mHostMutex);
+    last = mHostLast;
+    pthread_mutex_unlock(&mHostMutex);
+}
+
+void* LocApiBase::getSibling()
+{
+    return NULL;
+}
+
+enum loc_api_adapter_err LocApiBase::startFix(const LocPosMode& posMode)
+{
+    (void)posMode;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::stopFix()
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::deleteAidingData(GpsAidingData f)
+{
+    (void)f;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::enableData(int enable)
+{
+    (void)enable;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setAPN(char* apn, int len)
+{
+    (void)apn;
+    (void)len;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::injectPosition(double latitude, double longitude, float accuracy)
+{
+    (void)latitude;
+    (void)longitude;
+    (void)accuracy;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setTime(GpsUtcTime time, int64_t timeReference, int uncertainty)
+{
+    (void)time;
+    (void)timeReference;
+    (void)uncertainty;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setXtraData(char* data, int length)
+{
+    (void)data;
+    (void)length;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::requestXtraServer()
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::atlOpenStatus(int handle, int is_succ, char* apn,
+                          AGpsBearerType bear, AGpsType agpsType)
+{
+    (void)handle;
+    (void)is_succ;
+    (void)apn;
+    (void)bear;
+    (void)agpsType;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::atlCloseStatus(int handle, int is_succ)
+{
+    (void)handle;
+    (void)is_succ;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setPositionMode(const LocPosMode& posMode)
+{
+    (void)posMode;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setServer(const char* url, int len)
+{
+    (void)url;
+    (void)len;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setServer(unsigned int ip, int port, LocServerType type)
+{
+    (void)ip;
+    (void)port;
+    (void)type;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::informNiResponse(GpsUserResponseType userResponse,
+                             const void* passThroughData)
+{
+    (void)userResponse;
+    (void)passThroughData;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setSUPLVersion(uint32_t version)
+{
+    (void)version;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setLPPConfig(uint32_t profile)
+{
+    (void)profile;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setSensorControlConfig(int sensorUsage, int sensorProvider)
+{
+    (void)sensorUsage;
+    (void)sensorProvider;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setSensorProperties(bool gyroBiasVarianceRandomWalk_valid,
+                                float gyroBiasVarianceRandomWalk,
+                                bool accelBiasVarianceRandomWalk_valid,
+                                float accelBiasVarianceRandomWalk,
+                                bool angleBiasVarianceRandomWalk_valid,
+                                float angleBiasVarianceRandomWalk,
+                                bool rateBiasVarianceRandomWalk_valid,
+                                float rateBiasVarianceRandomWalk,
+                                bool velocityBiasVarianceRandomWalk_valid,
+                                float velocityBiasVarianceRandomWalk)
+{
+    (void)gyroBiasVarianceRandomWalk_valid;
+    (void)gyroBiasVarianceRandomWalk;
+    (void)accelBiasVarianceRandomWalk_valid;
+    (void)accelBiasVarianceRandomWalk;
+    (void)angleBiasVarianceRandomWalk_valid;
+    (void)angleBiasVarianceRandomWalk;
+    (void)rateBiasVarianceRandomWalk_valid;
+    (void)rateBiasVarianceRandomWalk;
+    (void)velocityBiasVarianceRandomWalk_valid;
+    (void)velocityBiasVarianceRandomWalk;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setSensorPerfControlConfig(int controlMode,
+                                       int accelSamplesPerBatch,
+                                       int accelBatchesPerSec,
+                                       int gyroSamplesPerBatch,
+                                       int gyroBatchesPerSec,
+                                       int accelSamplesPerBatchHigh,
+                                       int accelBatchesPerSecHigh,
+                                       int gyroSamplesPerBatchHigh,
+                                       int gyroBatchesPerSecHigh,
+                                       int algorithmConfig)
+{
+    (void)controlMode;
+    (void)accelSamplesPerBatch;
+    (void)accelBatchesPerSec;
+    (void)gyroSamplesPerBatch;
+    (void)gyroBatchesPerSec;
+    (void)accelSamplesPerBatchHigh;
+    (void)accelBatchesPerSecHigh;
+    (void)gyroSamplesPerBatchHigh;
+    (void)gyroBatchesPerSecHigh;
+    (void)algorithmConfig;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::setExtPowerConfig(int isBatteryCharging)
+{
+    (void)isBatteryCharging;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setAGLONASSProtocol(unsigned long aGlonassProtocol)
+{
+    (void)aGlonassProtocol;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::getWwanZppFix(GpsLocation& zppLoc)
+{
+    (void)zppLoc;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiBase::getBestAvailableZppFix(GpsLocation& zppLoc)
+{
+    (void)zppLoc;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err
+LocApiBase::getBestAvailableZppFix(GpsLocation& zppLoc,
+                                   LocPosTechMask& tech_mask)
+{
+    (void)zppLoc;
+    (void)tech_mask;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+int LocApiBase::initDataServiceClient()
+{
+    return 0;
+}
+
+int LocApiBase::openAndStartDataCall()
+{
+    return 0;
+}
+
+void LocApiBase::stopDataCall()
+{
+}
+
+void LocApiBase::closeDataCall()
+{
+}
+
+int LocApiBase::setGpsLock(LOC_GPS_LOCK_MASK lock)
+{
+    (void)lock;
+    return 0;
+}
+
+int LocApiBase::getGpsLock()
+{
+    return 0;
+}
+
+enum loc_api_adapter_err
+LocApiBase::setXtraVersionCheck(enum xtra_version_check check)
+{
+    (void)check;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+void LocApiBase::installAGpsCert(const DerEncodedCertificate* pData,
+                                 size_t length,
+                                 uint32_t slotBitMask)
+{
+    (void)pData;
+    (void)length;
+    (void)slotBitMask;
+}
+
+} // namespace loc_core
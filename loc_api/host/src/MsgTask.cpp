@@ -0,0 +1,113 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <MsgTask.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+MsgTask::MsgTask(const char* threadName) :
+    mBusy(false), mStop(false)
+{
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+    if (0 != pthread_create(&mThread, NULL, threadMain, this)) {
+        LOC_LOGE("%s: could not start %s", __func__, threadName);
+        mStop = true;
+        return;
+    }
+    pthread_setname_np(mThread, threadName);
+}
+
+MsgTask::~MsgTask()
+{
+    pthread_mutex_lock(&mMutex);
+    bool started = !mStop;
+    mStop = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (started) {
+        pthread_join(mThread, NULL);
+    }
+    while (!mQueue.empty()) {
+        delete mQueue.front();
+        mQueue.pop_front();
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void MsgTask::sendMsg(const LocMsg* msg) const
+{
+    pthread_mutex_lock(&mMutex);
+    mQueue.push_back(msg);
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void MsgTask::flush() const
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop && (!mQueue.empty() || mBusy)) {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void* MsgTask::threadMain(void* arg)
+{
+    static_cast<MsgTask*>(arg)->run();
+    return NULL;
+}
+
+void MsgTask::run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        if (mQueue.empty()) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+        const LocMsg* msg = mQueue.front();
+        mQueue.pop_front();
+        mBusy = true;
+        pthread_mutex_unlock(&mMutex);
+
+        msg->log();
+        msg->proc();
+        delete msg;
+
+        pthread_mutex_lock(&mMutex);
+        mBusy = false;
+        pthread_cond_broadcast(&mCond);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+} // namespace loc_core
@@ -0,0 +1,84 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <log_util.h>
+
+int loc_host_log_level = LOC_HOST_LOG_ERROR;
+
+static FILE *loc_host_log_file;
+
+static const char loc_host_log_tags[] = "-EWIDV";
+
+static void loc_host_log_init(void) __attribute__((constructor));
+
+static void loc_host_log_init(void)
+{
+    const char *level = getenv("LOC_HOST_LOG_LEVEL");
+
+    if (NULL != level && '\0' != level[0]) {
+        loc_host_set_log_level(atoi(level));
+    }
+}
+
+void loc_host_set_log_level(int level)
+{
+    if (level < LOC_HOST_LOG_NONE) {
+        level = LOC_HOST_LOG_NONE;
+    } else if (level > LOC_HOST_LOG_VERBOSE) {
+        level = LOC_HOST_LOG_VERBOSE;
+    }
+    loc_host_log_level = level;
+}
+
+void loc_host_set_log_file(FILE *file)
+{
+    loc_host_log_file = file;
+}
+
+void loc_host_log(int level, const char *fmt, ...)
+{
+    FILE *file = NULL != loc_host_log_file ? loc_host_log_file : stderr;
+    size_t length = strlen(fmt);
+    va_list args;
+
+    if (level < LOC_HOST_LOG_ERROR || level > LOC_HOST_LOG_VERBOSE) {
+        level = LOC_HOST_LOG_VERBOSE;
+    }
+    fprintf(file, "%c/LocSvc: ", loc_host_log_tags[level]);
+    va_start(args, fmt);
+    vfprintf(file, fmt, args);
+    va_end(args);
+    if (0 == length || '\n' != fmt[length - 1]) {
+        fputc('\n', file);
+    }
+}
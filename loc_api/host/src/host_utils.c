@@ -0,0 +1,142 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Host stand-ins for the gps.utils helpers the loc api calls */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gps_extended.h>
+#include <loc_cfg.h>
+#include <loc_log.h>
+#include <loc_target.h>
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t length = strlen(src);
+
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copied);
+        dst[copied] = '\0';
+    }
+    return length;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+    size_t used = strnlen(dst, size);
+
+    if (used == size) {
+        return size + strlen(src);
+    }
+    return used + strlcpy(dst + used, src, size - used);
+}
+
+int hexcode(char *hexstring, int string_size, const char *data, int data_size)
+{
+    int i;
+
+    for (i = 0; i < data_size; i++) {
+        if (2 * i + 2 >= string_size) {
+            break;
+        }
+        snprintf(hexstring + 2 * i, 3, "%02X", (unsigned char)data[i]);
+    }
+    if (string_size > 0) {
+        hexstring[2 * i < string_size ? 2 * i : string_size - 1] = '\0';
+    }
+    return i;
+}
+
+/* a leading 0x91 marks an international number in BCD, anything else
+   is shown as hex */
+int decodeAddress(char *addr_string, int string_size,
+                  const char *data, int data_size)
+{
+    const char digits[] = "0123456789*#ABC";
+    int idx = 0;
+    int i;
+
+    if (string_size <= 0) {
+        return 0;
+    }
+    if (data_size <= 0 || (unsigned char)data[0] != 0x91) {
+        return hexcode(addr_string, string_size, data, data_size);
+    }
+
+    for (i = 1; i < data_size && idx < string_size - 1; i++) {
+        unsigned char lo = (unsigned char)data[i] & 0x0F;
+        unsigned char hi = (unsigned char)data[i] >> 4;
+
+        if (lo < sizeof(digits) - 1) {
+            addr_string[idx++] = digits[lo];
+        }
+        if (idx < string_size - 1 && hi < sizeof(digits) - 1) {
+            addr_string[idx++] = digits[hi];
+        }
+    }
+    addr_string[idx] = '\0';
+    return idx;
+}
+
+const char *loc_get_name_from_val(loc_name_val_s_type table[],
+                                  int table_size, long value)
+{
+    int i;
+
+    for (i = 0; i < table_size; i++) {
+        if (table[i].val == value) {
+            return table[i].name;
+        }
+    }
+    return UNKNOWN_STR;
+}
+
+const char *log_succ_fail_string(int is_succ)
+{
+    return is_succ ? "successful" : "failed";
+}
+
+void loc_read_conf(const char *conf_file_name,
+                   loc_param_s_type *config_table, uint32_t table_length)
+{
+    (void)conf_file_name;
+    (void)config_table;
+    (void)table_length;
+}
+
+unsigned int loc_get_target(void)
+{
+    return GNSS_MSM;
+}
+
+int getTargetGnssType(unsigned int target)
+{
+    return (int)target;
+}
@@ -0,0 +1,503 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "qmi_client.h"
+#include "qmi_idl_lib.h"
+#include "dsi_netctrl.h"
+#include <libloc_loader/libloc_loader.h>
+#include <qmi_stub.h>
+
+#define QMI_STUB_MAX_CLIENTS 4
+
+typedef struct {
+    int in_use;
+    qmi_idl_service_object_type service_object;
+    locClientIndCbType ind_cb;
+    void *ind_cb_data;
+    qmi_client_error_cb_type error_cb;
+    void *error_cb_data;
+} qmi_stub_client_type;
+
+typedef struct qmi_stub_ind_s {
+    uint32_t msg_id;
+    void *buf;
+    uint32_t len;
+    uint64_t due_us;
+    struct qmi_stub_ind_s *next;
+} qmi_stub_ind_type;
+
+static pthread_mutex_t qmi_stub_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qmi_stub_cond = PTHREAD_COND_INITIALIZER;
+static qmi_stub_client_type qmi_stub_clients[QMI_STUB_MAX_CLIENTS];
+static qmi_stub_responder_type qmi_stub_responder;
+static void *qmi_stub_responder_context;
+static uint64_t qmi_stub_requests;
+
+/* indications queued for the stub modem thread, oldest first */
+static qmi_stub_ind_type *qmi_stub_ind_head;
+static qmi_stub_ind_type *qmi_stub_ind_tail;
+/* the client the modem thread is calling back, if any */
+static qmi_stub_client_type *qmi_stub_delivering;
+static int qmi_stub_thread_started;
+static pthread_t qmi_stub_thread;
+
+static uint64_t qmi_stub_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* the client indications go to; the WDS client registers none.
+   Called with qmi_stub_mutex held. */
+static qmi_stub_client_type *qmi_stub_ind_client()
+{
+    int i;
+
+    for (i = 0; i < QMI_STUB_MAX_CLIENTS; i++) {
+        if (qmi_stub_clients[i].in_use && NULL != qmi_stub_clients[i].ind_cb) {
+            return &qmi_stub_clients[i];
+        }
+    }
+    return NULL;
+}
+
+static qmi_client_type qmi_stub_handle(qmi_stub_client_type *client)
+{
+    return (qmi_client_type)client;
+}
+
+/*----------------------------- QMI CCI ------------------------------------*/
+
+static qmi_client_error_type stub_qmi_client_message_decode(
+    qmi_client_type user_handle, qmi_idl_message_type message_type,
+    unsigned int msg_id, void *ind_buf, unsigned int ind_buf_len,
+    void *indBuffer, size_t indSize)
+{
+    (void)user_handle;
+    (void)message_type;
+    (void)msg_id;
+
+    // shorter than the structure is fine, the rest reads as not valid
+    memset(indBuffer, 0, indSize);
+    memcpy(indBuffer, ind_buf, ind_buf_len < indSize ? ind_buf_len : indSize);
+    return QMI_NO_ERR;
+}
+
+static qmi_client_error_type stub_qmi_client_get_service_instance(
+    qmi_idl_service_object_type service_object, int instanceId,
+    qmi_service_info *serviceInfo)
+{
+    (void)service_object;
+    memset(serviceInfo, 0, sizeof(*serviceInfo));
+    serviceInfo->info[0] = (unsigned int)instanceId;
+    return QMI_NO_ERR;
+}
+
+static qmi_client_error_type stub_qmi_client_get_any_service(
+    qmi_idl_service_object_type service_object,
+    qmi_service_info *serviceInfo)
+{
+    (void)service_object;
+    memset(serviceInfo, 0, sizeof(*serviceInfo));
+    return QMI_NO_ERR;
+}
+
+static qmi_client_error_type stub_qmi_client_init(
+    qmi_service_info *serviceInfo, qmi_idl_service_object_type service_object,
+    locClientIndCbType init_callback, void *cb_data, void *unknown,
+    qmi_client_type *client)
+{
+    int i;
+
+    (void)serviceInfo;
+    (void)unknown;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    for (i = 0; i < QMI_STUB_MAX_CLIENTS; i++) {
+        if (!qmi_stub_clients[i].in_use) {
+            memset(&qmi_stub_clients[i], 0, sizeof(qmi_stub_clients[i]));
+            qmi_stub_clients[i].in_use = 1;
+            qmi_stub_clients[i].service_object = service_object;
+            qmi_stub_clients[i].ind_cb = init_callback;
+            qmi_stub_clients[i].ind_cb_data = cb_data;
+            *client = qmi_stub_handle(&qmi_stub_clients[i]);
+            pthread_mutex_unlock(&qmi_stub_mutex);
+            return QMI_NO_ERR;
+        }
+    }
+    pthread_mutex_unlock(&qmi_stub_mutex);
+    return QMI_SERVICE_ERR;
+}
+
+static qmi_client_error_type stub_qmi_client_register_error_cb(
+    qmi_client_type user_handle, qmi_client_error_cb_type error_cb,
+    void *cb_data)
+{
+    qmi_stub_client_type *client = (qmi_stub_client_type *)user_handle;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    client->error_cb = error_cb;
+    client->error_cb_data = cb_data;
+    pthread_mutex_unlock(&qmi_stub_mutex);
+    return QMI_NO_ERR;
+}
+
+static qmi_client_error_type stub_qmi_client_get_service_list(
+    qmi_idl_service_object_type service_object, qmi_service_info *service_info,
+    uint32_t *num_entries, uint32_t *num_services)
+{
+    (void)service_object;
+
+    if (NULL != service_info && NULL != num_entries && *num_entries > 0) {
+        memset(service_info, 0, sizeof(*service_info));
+        *num_entries = 1;
+    }
+    *num_services = 1;
+    return QMI_NO_ERR;
+}
+
+static qmi_client_error_type stub_qmi_client_send_msg_sync(
+    qmi_client_type client_handle, uint32_t req_id, void *list_req,
+    uint32_t req_len, void *list_resp, uint32_t resp_len, uint32_t timeout)
+{
+    qmi_stub_responder_type responder;
+    void *context;
+
+    (void)client_handle;
+    (void)timeout;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    responder = qmi_stub_responder;
+    context = qmi_stub_responder_context;
+    qmi_stub_requests++;
+    pthread_mutex_unlock(&qmi_stub_mutex);
+
+    memset(list_resp, 0, resp_len);
+    if (NULL == responder) {
+        return QMI_NO_ERR;
+    }
+    return responder(req_id, list_req, req_len, list_resp, resp_len, context);
+}
+
+static int stub_qmi_client_release(qmi_client_type user_handle)
+{
+    qmi_stub_client_type *client = (qmi_stub_client_type *)user_handle;
+
+    // as in QCCI, a callback in progress completes before the release
+    // returns; the client frees its callback data after it
+    pthread_mutex_lock(&qmi_stub_mutex);
+    client->in_use = 0;
+    while (client == qmi_stub_delivering) {
+        pthread_cond_wait(&qmi_stub_cond, &qmi_stub_mutex);
+    }
+    pthread_mutex_unlock(&qmi_stub_mutex);
+    return QMI_NO_ERR;
+}
+
+/*----------------------------- DSI and WDS --------------------------------*/
+
+static int stub_dsi_init(int mode)
+{
+    (void)mode;
+    return DSI_SUCCESS;
+}
+
+static int stub_dsi_start_data_call(dsi_hndl_t handle)
+{
+    (void)handle;
+    return DSI_SUCCESS;
+}
+
+static int stub_dsi_stop_data_call(dsi_hndl_t handle)
+{
+    (void)handle;
+    return DSI_SUCCESS;
+}
+
+static int stub_dsi_set_data_call_param(dsi_hndl_t handle, uint8_t call_info,
+                                        dsi_call_param_value_t *param_info)
+{
+    (void)handle;
+    (void)call_info;
+    (void)param_info;
+    return DSI_SUCCESS;
+}
+
+static int stub_dsi_rel_data_srvc_hndl(dsi_hndl_t handle)
+{
+    (void)handle;
+    return DSI_SUCCESS;
+}
+
+static dsi_hndl_t stub_dsi_get_data_srvc_hndl(net_ev_cb_type callback,
+                                              void *cb_data)
+{
+    static int handle;
+
+    (void)callback;
+    (void)cb_data;
+    return &handle;
+}
+
+static qmi_idl_service_object_type stub_wds_get_service_object_internal_v01(
+    int32_t idl_maj_version, int32_t idl_min_version, int32_t library_version)
+{
+    static qmi_idl_service_object wds_service_object;
+
+    (void)idl_maj_version;
+    (void)idl_min_version;
+    (void)library_version;
+    return &wds_service_object;
+}
+
+/*----------------------------- stub modem ---------------------------------*/
+
+static void *qmi_stub_thread_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    while (1) {
+        qmi_stub_ind_type *ind = qmi_stub_ind_head;
+        qmi_stub_client_type *client;
+        uint64_t now_us;
+
+        if (NULL == ind) {
+            pthread_cond_wait(&qmi_stub_cond, &qmi_stub_mutex);
+            continue;
+        }
+        now_us = qmi_stub_now_us();
+        if (now_us < ind->due_us) {
+            pthread_mutex_unlock(&qmi_stub_mutex);
+            usleep((useconds_t)(ind->due_us - now_us));
+            pthread_mutex_lock(&qmi_stub_mutex);
+            continue;
+        }
+
+        qmi_stub_ind_head = ind->next;
+        if (NULL == qmi_stub_ind_head) {
+            qmi_stub_ind_tail = NULL;
+        }
+        client = qmi_stub_ind_client();
+        qmi_stub_delivering = client;
+        pthread_mutex_unlock(&qmi_stub_mutex);
+
+        if (NULL != client) {
+            client->ind_cb(qmi_stub_handle(client), ind->msg_id, ind->buf,
+                           ind->len, client->ind_cb_data);
+        }
+        free(ind->buf);
+        free(ind);
+
+        pthread_mutex_lock(&qmi_stub_mutex);
+        qmi_stub_delivering = NULL;
+        pthread_cond_broadcast(&qmi_stub_cond);
+    }
+    return NULL;
+}
+
+int qmi_stub_indicate(uint32_t msg_id, const void *ind, uint32_t ind_len)
+{
+    qmi_stub_client_type *client;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    client = qmi_stub_ind_client();
+    pthread_mutex_unlock(&qmi_stub_mutex);
+
+    if (NULL == client) {
+        return 0;
+    }
+    client->ind_cb(qmi_stub_handle(client), msg_id, (void *)ind, ind_len,
+                   client->ind_cb_data);
+    return 1;
+}
+
+int qmi_stub_indicate_async(uint32_t msg_id, const void *ind,
+                            uint32_t ind_len, uint32_t delay_us)
+{
+    qmi_stub_ind_type *entry;
+
+    entry = (qmi_stub_ind_type *)calloc(1, sizeof(*entry));
+    if (NULL == entry) {
+        return 0;
+    }
+    entry->buf = malloc(ind_len > 0 ? ind_len : 1);
+    if (NULL == entry->buf) {
+        free(entry);
+        return 0;
+    }
+    memcpy(entry->buf, ind, ind_len);
+    entry->msg_id = msg_id;
+    entry->len = ind_len;
+    entry->due_us = qmi_stub_now_us() + delay_us;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    if (NULL == qmi_stub_ind_client()) {
+        pthread_mutex_unlock(&qmi_stub_mutex);
+        free(entry->buf);
+        free(entry);
+        return 0;
+    }
+    if (!qmi_stub_thread_started) {
+        qmi_stub_thread_started =
+            (0 == pthread_create(&qmi_stub_thread, NULL,
+                                 qmi_stub_thread_main, NULL));
+    }
+    if (NULL != qmi_stub_ind_tail) {
+        qmi_stub_ind_tail->next = entry;
+    } else {
+        qmi_stub_ind_head = entry;
+    }
+    qmi_stub_ind_tail = entry;
+    pthread_cond_broadcast(&qmi_stub_cond);
+    pthread_mutex_unlock(&qmi_stub_mutex);
+    return 1;
+}
+
+void qmi_stub_flush(void)
+{
+    pthread_mutex_lock(&qmi_stub_mutex);
+    while (qmi_stub_thread_started &&
+           (NULL != qmi_stub_ind_head || NULL != qmi_stub_delivering)) {
+        pthread_cond_wait(&qmi_stub_cond, &qmi_stub_mutex);
+    }
+    pthread_mutex_unlock(&qmi_stub_mutex);
+}
+
+void qmi_stub_error(int error)
+{
+    qmi_stub_client_type clients[QMI_STUB_MAX_CLIENTS];
+    int i;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    memcpy(clients, qmi_stub_clients, sizeof(clients));
+    pthread_mutex_unlock(&qmi_stub_mutex);
+
+    for (i = 0; i < QMI_STUB_MAX_CLIENTS; i++) {
+        if (clients[i].in_use && NULL != clients[i].error_cb) {
+            clients[i].error_cb(qmi_stub_handle(&qmi_stub_clients[i]), error,
+                                clients[i].error_cb_data);
+        }
+    }
+}
+
+void qmi_stub_set_responder(qmi_stub_responder_type responder, void *context)
+{
+    pthread_mutex_lock(&qmi_stub_mutex);
+    qmi_stub_responder = responder;
+    qmi_stub_responder_context = context;
+    pthread_mutex_unlock(&qmi_stub_mutex);
+}
+
+uint64_t qmi_stub_request_count(void)
+{
+    uint64_t requests;
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    requests = qmi_stub_requests;
+    pthread_mutex_unlock(&qmi_stub_mutex);
+    return requests;
+}
+
+void qmi_stub_reset(void)
+{
+    qmi_stub_flush();
+
+    pthread_mutex_lock(&qmi_stub_mutex);
+    qmi_stub_responder = NULL;
+    qmi_stub_responder_context = NULL;
+    qmi_stub_requests = 0;
+    pthread_mutex_unlock(&qmi_stub_mutex);
+}
+
+/*----------------------------- loader -------------------------------------*/
+
+/* the host loader binds the proprietary symbols to the stubs above
+   instead of opening the libraries */
+
+static pthread_once_t qmi_stub_bind_once = PTHREAD_ONCE_INIT;
+static uint64_t qmi_stub_bind_time_us;
+
+static void qmi_stub_bind()
+{
+    uint64_t start_us = qmi_stub_now_us();
+
+    qmi_client_message_decode = stub_qmi_client_message_decode;
+    qmi_client_get_service_instance = stub_qmi_client_get_service_instance;
+    qmi_client_get_any_service = stub_qmi_client_get_any_service;
+    qmi_client_init = stub_qmi_client_init;
+    qmi_client_register_error_cb = stub_qmi_client_register_error_cb;
+    qmi_client_get_service_list = stub_qmi_client_get_service_list;
+    qmi_client_send_msg_sync = stub_qmi_client_send_msg_sync;
+    qmi_client_release = (int (*)())stub_qmi_client_release;
+
+    dsi_init = (int (*)())stub_dsi_init;
+    dsi_start_data_call = stub_dsi_start_data_call;
+    dsi_stop_data_call = stub_dsi_stop_data_call;
+    dsi_set_data_call_param = stub_dsi_set_data_call_param;
+    dsi_rel_data_srvc_hndl = stub_dsi_rel_data_srvc_hndl;
+    dsi_get_data_srvc_hndl = stub_dsi_get_data_srvc_hndl;
+    wds_get_service_object_internal_v01 = stub_wds_get_service_object_internal_v01;
+
+    qmi_stub_bind_time_us = qmi_stub_now_us() - start_us;
+}
+
+loc_loader_status_type load_proprietary_symbols()
+{
+    pthread_once(&qmi_stub_bind_once, qmi_stub_bind);
+    return LOC_LOADER_BACKEND_AVAILABLE;
+}
+
+loc_loader_status_type loc_loader_get_lib_status(loc_loader_lib_type lib)
+{
+    pthread_once(&qmi_stub_bind_once, qmi_stub_bind);
+    if (lib < 0 || lib >= LOC_LOADER_LIB_MAX) {
+        return LOC_LOADER_BACKEND_UNAVAILABLE;
+    }
+    return LOC_LOADER_BACKEND_AVAILABLE;
+}
+
+int loc_loader_symbol_resolved(const char *name)
+{
+    (void)name;
+    pthread_once(&qmi_stub_bind_once, qmi_stub_bind);
+    return 1;
+}
+
+uint64_t loc_loader_get_resolve_time_us()
+{
+    pthread_once(&qmi_stub_bind_once, qmi_stub_bind);
+    return qmi_stub_bind_time_us;
+}
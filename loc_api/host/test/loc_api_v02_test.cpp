@@ -0,0 +1,708 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Host tests of the loc api over the stub QMI transport. Each test
+   opens its own client; a failed CHECK fails the test and the run. */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <HostLocApi.h>
+#include <LocAtlBroker.h>
+#include <LocGeofenceStore.h>
+#include <LocNmeaGenerator.h>
+
+using namespace loc_core;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", \
+                    __FILE__, __LINE__, __func__, #cond); \
+            failures++; \
+            return; \
+        } \
+    } while (0)
+
+static void testOpenClose()
+{
+    MsgTask msgTask("loc_test");
+    HostLocApi api(&msgTask);
+
+    CHECK(LOC_API_ADAPTER_ERR_SUCCESS == api.open(HostLocApi::kMask));
+    CHECK(qmi_stub_request_count() > 0);
+    CHECK(LOC_API_ADAPTER_ERR_SUCCESS == api.close());
+    qmi_stub_reset();
+}
+
+static void testPositionReport()
+{
+    MsgTask msgTask("loc_test");
+    HostLocApi api(&msgTask);
+    CHECK(api.startSession());
+
+    qmiLocEventPositionReportIndMsgT_v02 report;
+    memset(&report, 0, sizeof(report));
+    report.sessionStatus = eQMI_LOC_SESS_STATUS_SUCCESS_V02;
+    report.latitude_valid = 1;
+    report.latitude = 37.422;
+    report.longitude_valid = 1;
+    report.longitude = -122.084;
+    report.horUncCircular_valid = 1;
+    report.horUncCircular = 5.0f;
+    CHECK(qmi_stub_indicate(QMI_LOC_EVENT_POSITION_REPORT_IND_V02,
+                            &report, sizeof(report)));
+
+    LocApiBase::HostLast last;
+    api.hostLast(last);
+    CHECK(1 == api.hostCounts().positions);
+    CHECK(last.location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG);
+    CHECK(fabs(last.location.gpsLocation.latitude - 37.422) < 1e-9);
+    CHECK(fabs(last.location.gpsLocation.longitude + 122.084) < 1e-9);
+    CHECK(5.0f == last.location.gpsLocation.accuracy);
+    api.close();
+    qmi_stub_reset();
+}
+
+static void testSvReport()
+{
+    MsgTask msgTask("loc_test");
+    HostLocApi api(&msgTask);
+    CHECK(api.startSession());
+
+    qmiLocEventGnssSvInfoIndMsgT_v02 report;
+    memset(&report, 0, sizeof(report));
+    report.svList_valid = 1;
+    report.svList_len = 12;
+    for (uint32_t i = 0; i < report.svList_len; i++) {
+        qmiLocSvInfoStructT_v02& sv = report.svList[i];
+        sv.validMask = QMI_LOC_SV_INFO_MASK_VALID_SYSTEM_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_GNSS_SVID_V02 |
+                       QMI_LOC_SV_INFO_MASK_VALID_SNR_V02;
+        sv.system = eQMI_LOC_SV_SYSTEM_GPS_V02;
+        sv.gnssSvId = i + 1;
+        sv.snr = 30.0f + i;
+    }
+    CHECK(qmi_stub_indicate(QMI_LOC_EVENT_GNSS_SV_INFO_IND_V02,
+                            &report, sizeof(report)));
+
+    LocApiBase::HostLast last;
+    api.hostLast(last);
+    CHECK(1 == api.hostCounts().svs);
+    CHECK(12 == last.svStatus.num_svs);
+    CHECK(1 == last.svStatus.sv_list[0].prn);
+    CHECK(41.0f == last.svStatus.sv_list[11].snr);
+    api.close();
+    qmi_stub_reset();
+}
+
+static void testNmeaReport()
+{
+    MsgTask msgTask("loc_test");
+    HostLocApi api(&msgTask);
+    CHECK(api.startSession());
+
+    static const char kGga[] =
+        "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47";
+    qmiLocEventNmeaIndMsgT_v02 report;
+    memset(&report, 0, sizeof(report));
+    strlcpy(report.nmea, kGga, sizeof(report.nmea));
+    CHECK(qmi_stub_indicate(QMI_LOC_EVENT_NMEA_IND_V02,
+                            &report, sizeof(report)));
+
+    LocApiBase::HostLast last;
+    api.hostLast(last);
+    CHECK(1 == api.hostCounts().nmeas);
+    CHECK(0 == strncmp(last.nmea, kGga, sizeof(kGga) - 1));
+    api.close();
+    qmi_stub_reset();
+}
+
+static void testSyncRequest()
+{
+    locClientHandleType handle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+    CHECK(eLOC_CLIENT_SUCCESS == hostClientOpen(0, &handle));
+
+    qmiLocStatusEnumT_v02 status = eQMI_LOC_CONFIG_NOT_SUPPORTED_V02;
+    qmi_stub_set_responder(hostModemResponder, &status);
+
+    qmiLocSetProtocolConfigParametersReqMsgT_v02 req;
+    memset(&req, 0, sizeof(req));
+    req.suplVersion_valid = 1;
+    req.suplVersion = eQMI_LOC_SUPL_VERSION_2_0_V02;
+    qmiLocSetProtocolConfigParametersIndMsgT_v02 ind;
+    memset(&ind, 0, sizeof(ind));
+    locClientReqUnionType reqUnion;
+    reqUnion.pSetProtocolConfigParametersReq = &req;
+
+    CHECK(eLOC_CLIENT_SUCCESS ==
+          loc_sync_send_req(handle,
+                            QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02,
+                            reqUnion, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                            QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02,
+                            &ind));
+    CHECK(eQMI_LOC_CONFIG_NOT_SUPPORTED_V02 == ind.status);
+
+    locClientClose(&handle);
+    qmi_stub_reset();
+}
+
+static void testSyncBatch()
+{
+    locClientHandleType handle = LOC_CLIENT_INVALID_HANDLE_VALUE;
+    CHECK(eLOC_CLIENT_SUCCESS == hostClientOpen(0, &handle));
+
+    qmiLocStatusEnumT_v02 status = eQMI_LOC_SUCCESS_V02;
+    qmi_stub_set_responder(hostModemResponder, &status);
+
+    // more than two windows of requests in flight
+    const size_t count = 9;
+    qmiLocSetProtocolConfigParametersReqMsgT_v02 req;
+    memset(&req, 0, sizeof(req));
+    qmiLocSetProtocolConfigParametersIndMsgT_v02 inds[count];
+    loc_sync_batch_req_s_type reqs[count];
+    for (size_t i = 0; i < count; i++) {
+        memset(&inds[i], 0xff, sizeof(inds[i]));
+        reqs[i].req_id = QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_REQ_V02;
+        reqs[i].req_payload.pSetProtocolConfigParametersReq = &req;
+        reqs[i].ind_id = QMI_LOC_SET_PROTOCOL_CONFIG_PARAMETERS_IND_V02;
+        reqs[i].ind_payload_ptr = &inds[i];
+        reqs[i].status = eLOC_CLIENT_FAILURE_GENERAL;
+    }
+    uint64_t requests = qmi_stub_request_count();
+    loc_sync_send_batch(handle, reqs, count, LOC_ENGINE_SYNC_REQUEST_TIMEOUT);
+
+    for (size_t i = 0; i < count; i++) {
+        CHECK(eLOC_CLIENT_SUCCESS == reqs[i].status);
+        CHECK(eQMI_LOC_SUCCESS_V02 == inds[i].status);
+    }
+    CHECK(requests + count == qmi_stub_request_count());
+
+    locClientClose(&handle);
+    qmi_stub_reset();
+}
+
+/* all sentences of the generator, back to back */
+static std::string nmeaText(const LocNmeaGenerator& generator)
+{
+    std::string text;
+    for (size_t i = 0; i < generator.count(); i++) {
+        size_t length;
+        const char* sentence = generator.sentence(i, length);
+        text.append(sentence, length);
+    }
+    return text;
+}
+
+static void testNmeaGenerator()
+{
+    LocNmeaGenerator generator;
+
+    // a fix in the southern and western hemispheres, heading just
+    // short of north, as reportSv and reportPosition build it
+    GpsSvStatus svStatus;
+    memset(&svStatus, 0, sizeof(svStatus));
+    svStatus.num_svs = 3;
+    svStatus.sv_list[0].prn = 2;
+    svStatus.sv_list[0].elevation = 5.4f;
+    svStatus.sv_list[0].azimuth = 7.6f;
+    svStatus.sv_list[0].snr = 8.2f;
+    svStatus.sv_list[1].prn = 5;
+    svStatus.sv_list[1].elevation = 45.0f;
+    svStatus.sv_list[1].azimuth = 359.7f;
+    svStatus.sv_list[1].snr = 35.0f;
+    svStatus.sv_list[2].prn = 70;
+    svStatus.sv_list[2].elevation = 89.6f;
+    svStatus.sv_list[2].azimuth = 180.2f;
+    svStatus.used_in_fix_mask = (1U << (2 - 1)) | (1U << (5 - 1));
+
+    GpsLocation location;
+    memset(&location, 0, sizeof(location));
+    location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+                     GPS_LOCATION_HAS_SPEED | GPS_LOCATION_HAS_BEARING;
+    location.latitude = -33.856784;
+    location.longitude = -70.648269;
+    location.altitude = 100.0;
+    location.speed = 10.0f;
+    location.bearing = 359.99f;
+    // 2014-10-18 12:34:56.78 UTC
+    location.timestamp = 1413635696780LL;
+
+    GpsLocationExtended ext;
+    memset(&ext, 0, sizeof(ext));
+    ext.flags = GPS_LOCATION_EXTENDED_HAS_DOP |
+                GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL |
+                GPS_LOCATION_EXTENDED_HAS_MAG_DEV;
+    ext.altitudeMeanSeaLevel = 80.0f;
+    ext.pdop = 1.6f;
+    ext.hdop = 0.9f;
+    ext.vdop = 1.3f;
+    ext.magneticDeviation = -2.5f;
+
+    generator.reset();
+    generator.appendGsv(svStatus);
+    CHECK(nmeaText(generator) ==
+          "$GPGSV,1,1,02,02,05,008,08,05,45,000,35*7E\r\n"
+          "$GLGSV,1,1,01,70,90,180,*53\r\n");
+    generator.reset();
+    generator.appendGga(location, ext);
+    generator.appendRmc(location, ext);
+    generator.appendGsa(location, ext);
+    CHECK(nmeaText(generator) ==
+          "$GPGGA,123456.78,3351.40704,S,07038.89614,W,1,02,0.9,80.0,M,"
+          "20.0,M,,*57\r\n"
+          "$GPRMC,123456.78,A,3351.40704,S,07038.89614,W,19.4,0.0,181014,"
+          "2.5,W,A*1B\r\n"
+          "$GPGSA,A,3,02,05,,,,,,,,,,,1.6,0.9,1.3*39\r\n");
+
+    // a bearing that rounds below 360 stays as it is
+    location.bearing = 359.94f;
+    generator.reset();
+    generator.appendRmc(location, ext);
+    CHECK(std::string::npos != nmeaText(generator).find(",19.4,359.9,"));
+
+    // no fix, no satellites
+    memset(&svStatus, 0, sizeof(svStatus));
+    location.flags = 0;
+    ext.flags = 0;
+    generator.reset();
+    generator.appendGsv(svStatus);
+    generator.appendGga(location, ext);
+    generator.appendRmc(location, ext);
+    generator.appendGsa(location, ext);
+    CHECK(nmeaText(generator) ==
+          "$GPGSV,1,1,00*79\r\n"
+          "$GPGGA,123456.78,,,,,0,00,,,M,,M,,*40\r\n"
+          "$GPRMC,123456.78,V,,,,,,,181014,,,N*78\r\n"
+          "$GPGSA,A,1,,,,,,,,,,,,,,,*1E\r\n");
+}
+
+/* stands in for loc eng releasing a broker connection */
+struct AtlReleases {
+    std::atomic<int> count;
+    std::atomic<int> lastId;
+};
+
+static void atlRelease(int id, void* context)
+{
+    AtlReleases* releases = (AtlReleases*)context;
+    releases->lastId = id;
+    releases->count++;
+}
+
+/* wait for the linger thread to release count connections */
+static bool atlWaitReleases(const AtlReleases& releases, int count)
+{
+    for (int i = 0; i < 1000 && releases.count < count; i++) {
+        usleep(1000);
+    }
+    return releases.count >= count;
+}
+
+#define ATL_LINGER_MS 20
+
+static void testAtlReuse()
+{
+    AtlReleases releases = { {0}, {-1} };
+    LocAtlBroker broker(atlRelease, &releases);
+    broker.setLinger(ATL_LINGER_MS);
+    LocAtlBroker::Answer answer;
+    std::vector<int> handles;
+
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(1, AGPS_TYPE_SUPL, answer));
+    int id = answer.id;
+    CHECK(broker.opened(id, true, "supl.apn", AGPS_APN_BEARER_IPV4, handles));
+    CHECK(1 == handles.size() && 1 == handles[0]);
+
+    // a second open of the type is answered with the open connection
+    memset(&answer, 0, sizeof(answer));
+    CHECK(LocAtlBroker::OPEN_ANSWER ==
+          broker.open(2, AGPS_TYPE_SUPL, answer));
+    CHECK(id == answer.id);
+    CHECK(0 == strcmp("supl.apn", answer.apn));
+    CHECK(AGPS_APN_BEARER_IPV4 == answer.bearer);
+    // another type gets its own
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(3, AGPS_TYPE_C2K, answer));
+    CHECK(id != answer.id);
+
+    // closes short of the last keep it up
+    int closeId = -1;
+    CHECK(LocAtlBroker::CLOSE_ANSWER == broker.close(1, closeId));
+    CHECK(id == closeId);
+
+    LocAtlBroker::Stats stats;
+    broker.getStats(stats);
+    CHECK(3 == stats.opens);
+    CHECK(1 == stats.bringUps);
+    CHECK(1 == stats.reused);
+    CHECK(0 == releases.count);
+}
+
+static void testAtlJoin()
+{
+    AtlReleases releases = { {0}, {-1} };
+    LocAtlBroker broker(atlRelease, &releases);
+    broker.setLinger(ATL_LINGER_MS);
+    LocAtlBroker::Answer answer;
+    std::vector<int> handles;
+
+    // joins a connection still being brought up, answered together
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(1, AGPS_TYPE_SUPL, answer));
+    int id = answer.id;
+    CHECK(LocAtlBroker::OPEN_WAIT == broker.open(2, AGPS_TYPE_SUPL, answer));
+    CHECK(id == answer.id);
+    CHECK(broker.opened(id, true, "supl.apn", AGPS_APN_BEARER_IPV4V6,
+                        handles));
+    CHECK(2 == handles.size() && 1 == handles[0] && 2 == handles[1]);
+
+    LocAtlBroker::Stats stats;
+    broker.getStats(stats);
+    CHECK(1 == stats.joined);
+
+    // a failed bring-up fails every handle waiting for it
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(3, AGPS_TYPE_C2K, answer));
+    id = answer.id;
+    CHECK(LocAtlBroker::OPEN_WAIT == broker.open(4, AGPS_TYPE_C2K, answer));
+    CHECK(LocAtlBroker::OPEN_WAIT == broker.open(5, AGPS_TYPE_C2K, answer));
+    handles.clear();
+    CHECK(broker.opened(id, false, NULL, AGPS_APN_BEARER_INVALID, handles));
+    CHECK(3 == handles.size());
+    CHECK(3 == handles[0] && 4 == handles[1] && 5 == handles[2]);
+
+    // the failed handles and connection are gone
+    int closeId = -1;
+    CHECK(LocAtlBroker::CLOSE_PASS == broker.close(4, closeId));
+    CHECK(!broker.opened(id, true, "late", AGPS_APN_BEARER_IPV4, handles));
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(6, AGPS_TYPE_C2K, answer));
+    CHECK(id != answer.id);
+    CHECK(0 == releases.count);
+}
+
+static void testAtlCloseWhileOpening()
+{
+    AtlReleases releases = { {0}, {-1} };
+    LocAtlBroker broker(atlRelease, &releases);
+    broker.setLinger(ATL_LINGER_MS);
+    LocAtlBroker::Answer answer;
+    std::vector<int> handles;
+
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(1, AGPS_TYPE_SUPL, answer));
+    int id = answer.id;
+
+    // the last close of a connection being brought up releases it at
+    // once, there is nothing to linger with
+    int closeId = -1;
+    CHECK(LocAtlBroker::CLOSE_RELEASE == broker.close(1, closeId));
+    CHECK(id == closeId);
+
+    // the late open answer goes to nobody
+    CHECK(broker.opened(id, true, "supl.apn", AGPS_APN_BEARER_IPV4, handles));
+    CHECK(handles.empty());
+    // the release answer goes to the closing handle
+    int handle = -1;
+    CHECK(broker.closed(id, handle));
+    CHECK(1 == handle);
+
+    usleep(3 * ATL_LINGER_MS * 1000);
+    CHECK(0 == releases.count);
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(2, AGPS_TYPE_SUPL, answer));
+    CHECK(id != answer.id);
+}
+
+static void testAtlLingerExpiry()
+{
+    AtlReleases releases = { {0}, {-1} };
+    LocAtlBroker broker(atlRelease, &releases);
+    broker.setLinger(ATL_LINGER_MS);
+    LocAtlBroker::Answer answer;
+    std::vector<int> handles;
+
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(1, AGPS_TYPE_SUPL, answer));
+    int id = answer.id;
+    CHECK(broker.opened(id, true, "supl.apn", AGPS_APN_BEARER_IPV4, handles));
+    int closeId = -1;
+    CHECK(LocAtlBroker::CLOSE_ANSWER == broker.close(1, closeId));
+
+    // released once when the linger runs out, and only once
+    CHECK(atlWaitReleases(releases, 1));
+    CHECK(id == releases.lastId);
+    usleep(3 * ATL_LINGER_MS * 1000);
+    CHECK(1 == releases.count);
+
+    LocAtlBroker::Stats stats;
+    broker.getStats(stats);
+    CHECK(1 == stats.lingerExpired);
+
+    // loc eng's release answer is for no modem handle
+    int handle = 0;
+    CHECK(broker.closed(id, handle));
+    CHECK(-1 == handle);
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(2, AGPS_TYPE_SUPL, answer));
+    CHECK(id != answer.id);
+}
+
+static void testAtlResetWhileLingering()
+{
+    AtlReleases releases = { {0}, {-1} };
+    LocAtlBroker broker(atlRelease, &releases);
+    broker.setLinger(ATL_LINGER_MS);
+    LocAtlBroker::Answer answer;
+    std::vector<int> handles;
+
+    CHECK(LocAtlBroker::OPEN_REQUEST ==
+          broker.open(1, AGPS_TYPE_SUPL, answer));
+    int id = answer.id;
+    CHECK(broker.opened(id, true, "supl.apn", AGPS_APN_BEARER_IPV4, handles));
+    int closeId = -1;
+    CHECK(LocAtlBroker::CLOSE_ANSWER == broker.close(1, closeId));
+
+    // the reset releases the lingering connection, the linger thread
+    // must not release it again
+    broker.reset();
+    CHECK(1 == releases.count);
+    CHECK(id == releases.lastId);
+    usleep(3 * ATL_LINGER_MS * 1000);
+    CHECK(1 == releases.count);
+
+    LocAtlBroker::Stats stats;
+    broker.getStats(stats);
+    CHECK(0 == stats.lingerExpired);
+
+    int handle = 0;
+    CHECK(broker.closed(id, handle));
+    CHECK(-1 == handle);
+}
+
+/* distance from a position to a fence edge, the way the store ranks
+   fences, computed over all fences */
+static double geofenceEdgeDistance(const LocGeofenceStore::Fence& fence,
+                                   double latitude, double longitude)
+{
+    double dLon = fence.longitude - longitude;
+    if (dLon > 180.0) {
+        dLon -= 360.0;
+    } else if (dLon < -180.0) {
+        dLon += 360.0;
+    }
+    double x = dLon * M_PI / 180.0 *
+        cos((fence.latitude + latitude) / 2 * M_PI / 180.0);
+    double y = (fence.latitude - latitude) * M_PI / 180.0;
+    return sqrt(x * x + y * y) * 6371000.0 - fence.radius;
+}
+
+static double wrapLongitude(double longitude)
+{
+    if (longitude >= 180.0) {
+        return longitude - 360.0;
+    }
+    return longitude < -180.0 ? longitude + 360.0 : longitude;
+}
+
+/* fences around a center, with radii from 50 m to 20 km */
+static std::vector<LocGeofenceStore::Fence> makeGeofences(
+    std::mt19937& rng, size_t count, double latitude, double longitude,
+    double span)
+{
+    std::uniform_real_distribution<double> offset(-span / 2, span / 2);
+    std::uniform_int_distribution<int> radiusClass(0, 9);
+    std::vector<LocGeofenceStore::Fence> fences(count);
+
+    for (size_t i = 0; i < count; i++) {
+        LocGeofenceStore::Fence& fence = fences[i];
+        memset(&fence, 0, sizeof(fence));
+        fence.clientId = i + 1;
+        fence.latitude = latitude + offset(rng);
+        fence.longitude = wrapLongitude(longitude + offset(rng));
+        int radius = radiusClass(rng);
+        fence.radius = radius < 7 ? 50 + 50 * radius :
+                       radius < 9 ? 2000 : 20000;
+    }
+    return fences;
+}
+
+/* nearest() against a sort of all fences, by distance, since fences
+   at the same distance may come in either order */
+static bool geofenceNearestMatches(const LocGeofenceStore& store,
+    const std::vector<LocGeofenceStore::Fence>& fences,
+    double latitude, double longitude, size_t maxCount)
+{
+    std::vector<double> all;
+    std::map<uint32_t, double> byId;
+    for (size_t i = 0; i < fences.size(); i++) {
+        double d = geofenceEdgeDistance(fences[i], latitude, longitude);
+        all.push_back(d);
+        byId[fences[i].clientId] = d;
+    }
+    std::sort(all.begin(), all.end());
+
+    std::vector<uint32_t> ids;
+    store.nearest(latitude, longitude, maxCount, ids);
+    if (ids.size() != std::min(maxCount, fences.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+        std::map<uint32_t, double>::const_iterator it = byId.find(ids[i]);
+        if (it == byId.end() || fabs(it->second - all[i]) > 1e-6) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testGeofenceNearest()
+{
+    static const struct {
+        double latitude;
+        double longitude;
+        double span;
+    } areas[] = {
+        // across the antimeridian
+        { 0.0, 180.0, 1.0 },
+        { -45.0, -179.9, 0.5 },
+        // high latitude, where longitude cells are narrow
+        { 80.0, 10.0, 2.0 },
+        { -79.5, 179.5, 2.0 },
+        // a city
+        { 37.4, -122.1, 0.5 }
+    };
+    static const size_t counts[] = { 1, 10, 100 };
+    std::mt19937 rng(27);
+
+    for (size_t a = 0; a < sizeof(areas) / sizeof(areas[0]); a++) {
+        std::vector<LocGeofenceStore::Fence> fences = makeGeofences(
+            rng, 2000, areas[a].latitude, areas[a].longitude, areas[a].span);
+        LocGeofenceStore store;
+        for (size_t i = 0; i < fences.size(); i++) {
+            store.add(fences[i]);
+        }
+        CHECK(fences.size() == store.size());
+
+        // positions inside the area and somewhat outside it
+        std::uniform_real_distribution<double> offset(-areas[a].span,
+                                                      areas[a].span);
+        for (int q = 0; q < 50; q++) {
+            double latitude = areas[a].latitude + offset(rng);
+            double longitude = wrapLongitude(areas[a].longitude + offset(rng));
+            for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+                CHECK(geofenceNearestMatches(store, fences, latitude,
+                                             longitude, counts[c]));
+            }
+        }
+    }
+}
+
+static void testGeofenceRemove()
+{
+    std::mt19937 rng(28);
+    std::vector<LocGeofenceStore::Fence> fences =
+        makeGeofences(rng, 500, 51.5, -0.1, 0.2);
+    LocGeofenceStore store;
+    for (size_t i = 0; i < fences.size(); i++) {
+        store.add(fences[i]);
+    }
+
+    // drop every other fence, move some of the rest to another cell
+    std::vector<LocGeofenceStore::Fence> kept;
+    for (size_t i = 0; i < fences.size(); i++) {
+        if (i % 2) {
+            CHECK(store.remove(fences[i].clientId));
+            CHECK(!store.remove(fences[i].clientId));
+            CHECK(NULL == store.find(fences[i].clientId));
+            continue;
+        }
+        if (i % 3 == 0) {
+            fences[i].latitude += 0.05;
+            fences[i].longitude -= 0.05;
+            store.add(fences[i]);
+        }
+        kept.push_back(fences[i]);
+    }
+    CHECK(kept.size() == store.size());
+
+    // every fence left is found exactly once, where it is now
+    std::vector<uint32_t> ids;
+    store.nearest(51.5, -0.1, kept.size() + 10, ids);
+    CHECK(kept.size() == ids.size());
+    std::sort(ids.begin(), ids.end());
+    for (size_t i = 0; i < kept.size(); i++) {
+        CHECK(kept[i].clientId == ids[i]);
+    }
+    CHECK(geofenceNearestMatches(store, kept, 51.55, -0.15, 20));
+    CHECK(geofenceNearestMatches(store, kept, 51.5, -0.1, 100));
+
+    for (size_t i = 0; i < kept.size(); i++) {
+        CHECK(store.remove(kept[i].clientId));
+    }
+    CHECK(0 == store.size());
+    store.nearest(51.5, -0.1, 10, ids);
+    CHECK(ids.empty());
+}
+
+int main()
+{
+    testOpenClose();
+    testPositionReport();
+    testSvReport();
+    testNmeaReport();
+    testSyncRequest();
+    testSyncBatch();
+    testNmeaGenerator();
+    testAtlReuse();
+    testAtlJoin();
+    testAtlCloseWhileOpening();
+    testAtlLingerExpiry();
+    testAtlResetWhileLingering();
+    testGeofenceNearest();
+    testGeofenceRemove();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
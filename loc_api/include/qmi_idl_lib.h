@@ -2,6 +2,8 @@
 #define QMI_IDL_LIB_H
 
 #include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
 
 enum qmi_result_type_v01 {
         /* To force a 32 bit signed enum. Do not change or use*/
@@ -135,7 +137,12 @@ typedef struct qmi_idl_type_table_object {
 // Opague pointer allocated and used by external library
 typedef void* qmi_client_type;
 
-// Provided by qcom library
+// Provided by qcom library; only C units hold a (common) definition,
+// one in every C++ unit would clash at link time
+#ifdef __cplusplus
+extern "C" qmi_idl_type_table_object common_qmi_idl_type_table_object_v01;
+#else
 qmi_idl_type_table_object common_qmi_idl_type_table_object_v01;
+#endif
 
 #endif /* QMI_IDL_LIB_H */
@@ -1,4 +1,7 @@
 #include <dlfcn.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
 #include <cutils/log.h>
 
 #include "../include/qmi_client.h"
@@ -8,59 +11,133 @@
 
 #define LOG_TAG "LIBLOC_LOADER"
 
-void *lib_handle = NULL;
-
-void load_from_libdsi_netctrl() {
-    lib_handle = dlopen(LIBDSI_NETCTRL, RTLD_NOW);
-    if (!lib_handle) {
-        ALOGE("%s: DLOPEN failed for %s", __func__, LIBDSI_NETCTRL);
-    } else {
-        dsi_init = dlsym(lib_handle, "dsi_init");
-        dsi_start_data_call = dlsym(lib_handle, "dsi_start_data_call");
-        dsi_stop_data_call = dlsym(lib_handle, "dsi_stop_data_call");
-        dsi_set_data_call_param = dlsym(lib_handle, "dsi_set_data_call_param");
-        dsi_rel_data_srvc_hndl = dlsym(lib_handle, "dsi_rel_data_srvc_hndl");
-        dsi_get_data_srvc_hndl = dlsym(lib_handle, "dsi_get_data_srvc_hndl");
-    }
+/*A symbol to resolve and where its address goes. An object symbol
+  is copied, size bytes, instead*/
+typedef struct {
+    loc_loader_lib_type lib;
+    const char *name;
+    void *dest;
+    size_t size;
+    int resolved;
+} loc_loader_symbol_type;
+
+#define LOC_LOADER_FUNCTION(lib, sym) { lib, #sym, (void *)&sym, 0, 0 }
+#define LOC_LOADER_OBJECT(lib, sym) { lib, #sym, (void *)&sym, sizeof(sym), 0 }
+
+static const char *loc_loader_lib_names[LOC_LOADER_LIB_MAX] = {
+    LIBDSI_NETCTRL,
+    LIBQMI_CCI,
+    LIBQMI_COMMON_SO,
+    LIBQMISERVICES
+};
+
+static loc_loader_symbol_type loc_loader_symbols[] = {
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_DSI_NETCTRL, dsi_init),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_DSI_NETCTRL, dsi_start_data_call),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_DSI_NETCTRL, dsi_stop_data_call),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_DSI_NETCTRL, dsi_set_data_call_param),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_DSI_NETCTRL, dsi_rel_data_srvc_hndl),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_DSI_NETCTRL, dsi_get_data_srvc_hndl),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_message_decode),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_get_service_instance),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_get_any_service),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_init),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_register_error_cb),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_get_service_list),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_send_msg_sync),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMI_CCI, qmi_client_release),
+    LOC_LOADER_OBJECT(LOC_LOADER_LIB_QMI_COMMON_SO, common_qmi_idl_type_table_object_v01),
+    LOC_LOADER_FUNCTION(LOC_LOADER_LIB_QMISERVICES, wds_get_service_object_internal_v01)
+};
+
+#define LOC_LOADER_SYMBOL_COUNT \
+    (sizeof(loc_loader_symbols) / sizeof(loc_loader_symbols[0]))
+
+static pthread_once_t loc_loader_once = PTHREAD_ONCE_INIT;
+static void *loc_loader_handles[LOC_LOADER_LIB_MAX];
+static loc_loader_status_type loc_loader_lib_status[LOC_LOADER_LIB_MAX];
+static loc_loader_status_type loc_loader_status = LOC_LOADER_BACKEND_UNAVAILABLE;
+static uint64_t loc_loader_resolve_time_us;
+
+static uint64_t loc_loader_monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-void load_from_libqmi_cci() {
-    lib_handle = dlopen(LIBQMI_CCI, RTLD_NOW);
-    if (!lib_handle) {
-        ALOGE("%s: DLOPEN failed for %s", __func__, LIBQMI_CCI);
-    } else {
-        qmi_client_message_decode = dlsym(lib_handle, "qmi_client_message_decode");
-        qmi_client_get_service_instance = dlsym(lib_handle, "qmi_client_get_service_instance");
-        qmi_client_get_any_service = dlsym(lib_handle, "qmi_client_get_any_service");
-        qmi_client_init = dlsym(lib_handle, "qmi_client_init");
-        qmi_client_register_error_cb = dlsym(lib_handle, "qmi_client_register_error_cb");
-        qmi_client_get_service_list = dlsym(lib_handle, "qmi_client_get_service_list");
-        qmi_client_send_msg_sync = dlsym(lib_handle, "qmi_client_send_msg_sync");
-        qmi_client_release = dlsym(lib_handle, "qmi_client_release");
+static void loc_loader_resolve() {
+    uint64_t start_us = loc_loader_monotonic_us();
+    size_t i;
+    int lib;
+
+    loc_loader_status = LOC_LOADER_BACKEND_AVAILABLE;
+    for (lib = 0; lib < LOC_LOADER_LIB_MAX; lib++) {
+        loc_loader_handles[lib] = dlopen(loc_loader_lib_names[lib], RTLD_NOW);
+        if (!loc_loader_handles[lib]) {
+            ALOGE("%s: DLOPEN failed for %s", __func__, loc_loader_lib_names[lib]);
+            loc_loader_lib_status[lib] = LOC_LOADER_BACKEND_UNAVAILABLE;
+            loc_loader_status = LOC_LOADER_BACKEND_UNAVAILABLE;
+        } else {
+            loc_loader_lib_status[lib] = LOC_LOADER_BACKEND_AVAILABLE;
+        }
     }
+
+    for (i = 0; i < LOC_LOADER_SYMBOL_COUNT; i++) {
+        loc_loader_symbol_type *sym = &loc_loader_symbols[i];
+        void *addr;
+
+        if (!loc_loader_handles[sym->lib]) {
+            continue;
+        }
+        addr = dlsym(loc_loader_handles[sym->lib], sym->name);
+        if (!addr) {
+            ALOGE("%s: DLSYM failed for %s in %s", __func__, sym->name,
+                  loc_loader_lib_names[sym->lib]);
+            loc_loader_lib_status[sym->lib] = LOC_LOADER_BACKEND_UNAVAILABLE;
+            loc_loader_status = LOC_LOADER_BACKEND_UNAVAILABLE;
+            continue;
+        }
+        if (sym->size) {
+            memcpy(sym->dest, addr, sym->size);
+        } else {
+            *(void **)sym->dest = addr;
+        }
+        sym->resolved = 1;
+    }
+
+    loc_loader_resolve_time_us = loc_loader_monotonic_us() - start_us;
+    ALOGD("%s: symbols resolved in %llu us, backend %s", __func__,
+          (unsigned long long)loc_loader_resolve_time_us,
+          loc_loader_status == LOC_LOADER_BACKEND_AVAILABLE ?
+          "available" : "unavailable");
 }
 
-void load_from_libqmi_common_so() {
-    lib_handle = dlopen(LIBQMI_COMMON_SO, RTLD_NOW);
-    if (!lib_handle) {
-        ALOGE("%s: DLOPEN failed for %s", __func__, LIBQMI_COMMON_SO);
-    } else {
-        common_qmi_idl_type_table_object_v01 = *(qmi_idl_type_table_object*) dlsym(lib_handle, "common_qmi_idl_type_table_object_v01");
+loc_loader_status_type load_proprietary_symbols() {
+    pthread_once(&loc_loader_once, loc_loader_resolve);
+    return loc_loader_status;
+}
+
+loc_loader_status_type loc_loader_get_lib_status(loc_loader_lib_type lib) {
+    pthread_once(&loc_loader_once, loc_loader_resolve);
+    if (lib < 0 || lib >= LOC_LOADER_LIB_MAX) {
+        return LOC_LOADER_BACKEND_UNAVAILABLE;
     }
+    return loc_loader_lib_status[lib];
 }
 
-void load_from_libqmiservices() {
-    lib_handle = dlopen(LIBQMISERVICES, RTLD_NOW);
-    if (!lib_handle) {
-        ALOGE("%s: DLOPEN failed for %s", __func__, LIBQMISERVICES);
-    } else {
-        wds_get_service_object_internal_v01 = dlsym(lib_handle, "wds_get_service_object_internal_v01");
+int loc_loader_symbol_resolved(const char *name) {
+    size_t i;
+
+    pthread_once(&loc_loader_once, loc_loader_resolve);
+    for (i = 0; i < LOC_LOADER_SYMBOL_COUNT; i++) {
+        if (strcmp(loc_loader_symbols[i].name, name) == 0) {
+            return loc_loader_symbols[i].resolved;
+        }
     }
+    return 0;
 }
 
-void load_proprietary_symbols() {
-   load_from_libdsi_netctrl();
-   load_from_libqmi_cci();
-   load_from_libqmi_common_so();
-   load_from_libqmiservices();
+uint64_t loc_loader_get_resolve_time_us() {
+    pthread_once(&loc_loader_once, loc_loader_resolve);
+    return loc_loader_resolve_time_us;
 }
@@ -1,11 +1,42 @@
 #ifndef LIBLOC_LOADER_H
 #define LIBLOC_LOADER_H
 
+#include <stdint.h>
+
 #define LIBDSI_NETCTRL "libdsi_netctrl.so"
 #define LIBQMI_CCI "libqmi_cci.so"
 #define LIBQMI_COMMON_SO "libqmi_common_so.so"
 #define LIBQMISERVICES "libqmiservices.so"
 
-void load_proprietary_symbols();
+typedef enum {
+    LOC_LOADER_LIB_DSI_NETCTRL = 0,
+    LOC_LOADER_LIB_QMI_CCI,
+    LOC_LOADER_LIB_QMI_COMMON_SO,
+    LOC_LOADER_LIB_QMISERVICES,
+    LOC_LOADER_LIB_MAX
+} loc_loader_lib_type;
+
+typedef enum {
+    LOC_LOADER_BACKEND_AVAILABLE = 0,
+    /* the library could not be opened, or lacks a symbol; its
+       function pointers must not be called */
+    LOC_LOADER_BACKEND_UNAVAILABLE
+} loc_loader_status_type;
+
+/*
+  Resolves the symbols of the proprietary libraries. Only the first
+  call does the work, from any thread; later calls return the same
+  result. Returns unavailable if any library is.
+*/
+loc_loader_status_type load_proprietary_symbols();
+
+/* Status of one library, resolving the symbols if not done yet */
+loc_loader_status_type loc_loader_get_lib_status(loc_loader_lib_type lib);
+
+/* Whether the named symbol was resolved */
+int loc_loader_symbol_resolved(const char *name);
+
+/* Time taken by the one-time symbol resolution */
+uint64_t loc_loader_get_resolve_time_us();
 
 #endif
@@ -28,9 +28,22 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES = \
     LocApiV02.cpp \
+    LocGeofenceStore.cpp \
+    LocSensorInjector.cpp \
+    LocVehicleInjector.cpp \
+    LocTimeSyncResponder.cpp \
+    LocWifiInjector.cpp \
+    LocCellInjector.cpp \
+    LocZppCache.cpp \
+    LocXtraManager.cpp \
+    LocAtlBroker.cpp \
+    LocNmeaGenerator.cpp \
+    LocEpochAssembler.cpp \
     loc_api_v02_log.c \
     loc_api_v02_client.c \
     loc_api_sync_req.c \
+    loc_trace.c \
+    loc_metrics.c \
     location_service_v02.c
 
 LOCAL_CFLAGS += \
@@ -44,7 +57,21 @@ LOCAL_COPY_HEADERS:= \
     loc_api_v02_log.h \
     loc_api_v02_client.h \
     loc_api_sync_req.h \
+    loc_trace.h \
+    loc_metrics.h \
     LocApiV02.h \
+    LocGeofenceStore.h \
+    LocSensorInjector.h \
+    LocVehicleInjector.h \
+    LocTimeSyncResponder.h \
+    LocWifiInjector.h \
+    LocCellInjector.h \
+    LocZppCache.h \
+    LocXtraManager.h \
+    LocAtlBroker.h \
+    LocNmeaGenerator.h \
+    LocEpochAssembler.h \
+    LocRingBuffer.h \
     loc_util_log.h
 
 
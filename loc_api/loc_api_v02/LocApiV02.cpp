@@ -33,6 +33,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <algorithm>
+#include <unordered_set>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <hardware/gps.h>
 
@@ -43,6 +51,8 @@
 #include <loc_api_v02_log.h>
 #include <loc_api_sync_req.h>
 #include <loc_util_log.h>
+#include <loc_trace.h>
+#include <loc_metrics.h>
 #include <gps_extended.h>
 #include "platform_lib_includes.h"
 
@@ -73,6 +83,9 @@ using namespace loc_core;
 /* BeiDou SV ID RANGE*/
 #define BDS_SV_ID_RANGE          QMI_LOC_DELETE_MAX_BDS_SV_INFO_LENGTH_V02
 
+/* time a pre-warmed emergency data call waits for its ATL request */
+#define DATA_CALL_PREWARM_GRACE_MS (10000)
+
 /* static event callbacks that call the LocApiV02 callbacks*/
 
 /* global event callback, call the eventCb function in loc api adapter v02
@@ -82,10 +95,23 @@ static void globalEventCb(locClientHandleType clientHandle,
                           const locClientEventIndUnionType eventPayload,
                           void*  pClientCookie)
 {
-  MODEM_LOG_CALLFLOW(%s, loc_get_v02_event_name(eventId));
   LocApiV02 *locApiV02Instance =
       (LocApiV02 *)pClientCookie;
 
+  // time sync requests are timestamped and handed off before anything
+  // else, the modem measures the round trip
+  if (QMI_LOC_EVENT_TIME_SYNC_REQ_IND_V02 == eventId &&
+      NULL != locApiV02Instance)
+  {
+    uint64_t rxNs = LocTimeSyncResponder::sensorTimeNs();
+    locApiV02Instance->timeSyncRequest(
+        eventPayload.pTimeSyncReqEvent->refCounter, rxNs);
+    MODEM_LOG_CALLFLOW(%s, loc_get_v02_event_name(eventId));
+    return;
+  }
+
+  MODEM_LOG_CALLFLOW(%s, loc_get_v02_event_name(eventId));
+
   LOC_LOGV ("%s:%d] client = %p, event id = %d, client cookie ptr = %p\n",
                   __func__,  __LINE__,  clientHandle, eventId, pClientCookie);
 
@@ -162,7 +188,20 @@ LocApiV02 :: LocApiV02(const MsgTask* msgTask,
                        ContextBase* context):
     LocApiBase(msgTask, exMask, context),
   clientHandle(LOC_CLIENT_INVALID_HANDLE_VALUE),
-  dsClientHandle(NULL)
+  dsClientHandle(NULL),
+  mDataCallPrewarm(false),
+  mDataCallPrewarmGraceMs(DATA_CALL_PREWARM_GRACE_MS),
+  mSensorInjector(clientHandle),
+  mVehicleInjector(clientHandle),
+  mTimeSyncResponder(clientHandle),
+  mWifiInjector(clientHandle),
+  mCellInjector(clientHandle),
+  mZppCache(zppFetch, this),
+  mXtraManager(clientHandle, xtraRefreshCb, this),
+  mAtlBroker(atlReleaseCb, this),
+  mNmeaSynthesis(false),
+  mEpochAssembly(false),
+  mEpochAssembler(epochCb, this)
 {
   // initialize loc_sync_req interface
   loc_sync_req_init();
@@ -193,8 +232,15 @@ LocApiV02 :: open(LOC_API_ADAPTER_EVENT_MASK_T mask)
   LOC_LOGD("%s:%d]: Enter mMask: %x; mask: %x; newMask: %x mQmiMask: %lu qmiMask: %lu",
            __func__, __LINE__, mMask, mask, newMask, mQmiMask, qmiMask);
 
-  // load proprietary symbols from their respective libs
-  load_proprietary_symbols();
+  // load proprietary symbols from their respective libs, once
+  if (LOC_LOADER_BACKEND_AVAILABLE !=
+        loc_loader_get_lib_status(LOC_LOADER_LIB_QMI_CCI) ||
+      LOC_LOADER_BACKEND_AVAILABLE !=
+        loc_loader_get_lib_status(LOC_LOADER_LIB_QMI_COMMON_SO))
+  {
+    LOC_LOGE("%s:%d]: QMI backend unavailable", __func__, __LINE__);
+    return LOC_API_ADAPTER_ERR_FAILURE;
+  }
 
   /* If the client is already open close it first */
   if(LOC_CLIENT_INVALID_HANDLE_VALUE == clientHandle)
@@ -209,7 +255,8 @@ LocApiV02 :: open(LOC_API_ADAPTER_EVENT_MASK_T mask)
 
     // it is important to cap the mask here, because not all LocApi's
     // can enable the same bits, e.g. foreground and bckground.
-    status = locClientOpen(adjustMaskForNoSession(qmiMask), &globalCallbacks,
+    status = locClientOpen(adjustMaskForNoSession(adjustMaskForNmea(qmiMask)),
+                           &globalCallbacks,
                            &clientHandle, (void *)this);
     mMask = newMask;
     mQmiMask = qmiMask;
@@ -250,6 +297,12 @@ LocApiV02 :: open(LOC_API_ADAPTER_EVENT_MASK_T mask)
         saveSupportedMsgList(supportedMsgList);
 #endif
     }
+
+    if (LOC_CLIENT_INVALID_HANDLE_VALUE != clientHandle) {
+      // a new client; the modem NMEA types are unknown again
+      mModemNmeaTypesValid = false;
+      applyNmeaSubscriptions();
+    }
   } else if (newMask != mMask) {
     // it is important to cap the mask here, because not all LocApi's
     // can enable the same bits, e.g. foreground and bckground.
@@ -271,6 +324,7 @@ LocApiV02 :: open(LOC_API_ADAPTER_EVENT_MASK_T mask)
 
 bool LocApiV02 :: registerEventMask(locClientEventMaskType qmiMask)
 {
+    qmiMask = adjustMaskForNmea(qmiMask);
     if (!mInSession) {
         qmiMask = adjustMaskForNoSession(qmiMask);
     }
@@ -300,6 +354,16 @@ locClientEventMaskType LocApiV02 :: adjustMaskForNoSession(locClientEventMaskTyp
     return qmiMask;
 }
 
+/* the NMEA event is dropped while NMEA subscriptions are managed and
+   no consumer is subscribed, or while NMEA is synthesized on the host */
+locClientEventMaskType LocApiV02 :: adjustMaskForNmea(locClientEventMaskType qmiMask)
+{
+    if (mNmeaEventOff || mNmeaSynthesis) {
+        qmiMask &= ~QMI_LOC_EVENT_MASK_NMEA_V02;
+    }
+    return qmiMask;
+}
+
 enum loc_api_adapter_err LocApiV02 :: close()
 {
   enum loc_api_adapter_err rtv =
@@ -335,6 +399,7 @@ enum loc_api_adapter_err LocApiV02 :: startFix(const LocPosMode& fixCriteria)
   fixCriteria.logv();
 
   mInSession = true;
+  mXtraManager.setInSession(true);
   registerEventMask(mQmiMask);
 
   // fill in the start request
@@ -468,6 +533,7 @@ enum loc_api_adapter_err LocApiV02 :: stopFix()
                             req_union);
 
   mInSession = false;
+  mXtraManager.setInSession(false);
   // if engine on never happend, deregister events
   // without waiting for Engine Off
   if (!mEngineOn) {
@@ -1087,15 +1153,65 @@ enum loc_api_adapter_err LocApiV02 ::
   return convertErr(status);
 }
 
-/* Inject XTRA data, this module breaks down the XTRA
-   file into "chunks" and injects them one at a time */
 enum loc_api_adapter_err LocApiV02 :: setXtraData(
   char* data, int length)
+{
+  return injectXtraData(data, length);
+}
+
+enum loc_api_adapter_err LocApiV02 :: setXtraDataFile(int fd)
+{
+  struct stat st;
+
+  if (0 != fstat(fd, &st) || st.st_size <= 0 || st.st_size > INT_MAX)
+  {
+    LOC_LOGE("%s:%d]: bad xtra file, fd = %d, errno = %d\n",
+             __func__, __LINE__, fd, errno);
+    return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+  }
+
+  /* parts are copied from the page cache, the file is never read into
+     a heap buffer of its own */
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == map)
+  {
+    LOC_LOGE("%s:%d]: mmap failed, errno = %d\n", __func__, __LINE__, errno);
+    return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+  enum loc_api_adapter_err ret = injectXtraData((const char*)map, (int)st.st_size);
+
+  munmap(map, st.st_size);
+  return ret;
+}
+
+enum loc_api_adapter_err LocApiV02 :: setXtraDataFile(const char* path)
+{
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0)
+  {
+    LOC_LOGE("%s:%d]: cannot open %s, errno = %d\n",
+             __func__, __LINE__, path, errno);
+    return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+  }
+
+  enum loc_api_adapter_err ret = setXtraDataFile(fd);
+
+  ::close(fd);
+  return ret;
+}
+
+/* Inject XTRA data, this module breaks down the XTRA
+   file into "chunks" and injects them one at a time */
+enum loc_api_adapter_err LocApiV02 :: injectXtraData(
+  const char* data, int length)
 {
   locClientStatusEnumType status = eLOC_CLIENT_SUCCESS;
   int     total_parts;
-  uint8_t   part;
-  uint16_t  len_injected;
+  uint16_t  part;
+  int       len_injected;
 
   locClientReqUnionType req_union;
   qmiLocInjectPredictedOrbitsDataReqMsgT_v02 inject_xtra;
@@ -1105,6 +1221,12 @@ enum loc_api_adapter_err LocApiV02 :: setXtraData(
 
   LOC_LOGD("%s:%d]: xtra size = %d\n", __func__, __LINE__, length);
 
+  if (!mXtraManager.shouldInject(data, length))
+  {
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+  }
+  bool injected = true;
+
   inject_xtra.formatType_valid = 1;
   inject_xtra.formatType = eQMI_LOC_PREDICTED_ORBITS_XTRA_V02;
   inject_xtra.totalSize = length;
@@ -1152,6 +1274,7 @@ enum loc_api_adapter_err LocApiV02 :: setXtraData(
                 loc_get_v02_client_status_name(status),
                 loc_get_v02_qmi_status_name(inject_xtra_ind.status),
                 inject_xtra.partNum, inject_xtra_ind.partNum);
+      injected = false;
     } else {
       len_injected += inject_xtra.partData_len;
       LOC_LOGD("%s:%d]: XTRA injected length: %d\n", __func__, __LINE__,
@@ -1159,6 +1282,8 @@ enum loc_api_adapter_err LocApiV02 :: setXtraData(
     }
   }
 
+  mXtraManager.injected(data, length, injected);
+
   return convertErr(status);
 }
 
@@ -1207,9 +1332,31 @@ enum loc_api_adapter_err LocApiV02 :: requestXtraServer()
   return convertErr(status);
 }
 
+/* answer of loc eng to an ATL open, for the modem handles of the
+   connection */
 enum loc_api_adapter_err LocApiV02 :: atlOpenStatus(
   int handle, int is_succ, char* apn, AGpsBearerType bear,
   AGpsType agpsType)
+{
+  std::vector<int> handles;
+  enum loc_api_adapter_err err = LOC_API_ADAPTER_ERR_SUCCESS;
+
+  (void)agpsType;
+  if (!mAtlBroker.opened(handle, is_succ, apn, bear, handles)) {
+    return informAtlOpenStatus(handle, is_succ, apn, bear);
+  }
+  for (size_t i = 0; i < handles.size(); i++) {
+    enum loc_api_adapter_err result =
+      informAtlOpenStatus(handles[i], is_succ, apn, bear);
+    if (LOC_API_ADAPTER_ERR_SUCCESS != result) {
+      err = result;
+    }
+  }
+  return err;
+}
+
+enum loc_api_adapter_err LocApiV02 :: informAtlOpenStatus(
+  int handle, int is_succ, const char* apn, AGpsBearerType bear)
 {
   locClientStatusEnumType result = eLOC_CLIENT_SUCCESS;
   locClientReqUnionType req_union;
@@ -1298,6 +1445,18 @@ enum loc_api_adapter_err LocApiV02 :: atlOpenStatus(
 /* close atl connection */
 enum loc_api_adapter_err LocApiV02 :: atlCloseStatus(
   int handle, int is_succ)
+{
+  int connHandle = handle;
+
+  if (mAtlBroker.closed(handle, connHandle) && connHandle < 0) {
+    // released by the broker, the modem is not waiting for it
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+  }
+  return informAtlCloseStatus(connHandle, is_succ);
+}
+
+enum loc_api_adapter_err LocApiV02 :: informAtlCloseStatus(
+  int handle, int is_succ)
 {
   locClientStatusEnumType result = eLOC_CLIENT_SUCCESS;
   locClientReqUnionType req_union;
@@ -1592,6 +1751,14 @@ enum loc_api_adapter_err LocApiV02 :: setSensorPerfControlConfig(int controlMode
               loc_get_v02_client_status_name(result),
               loc_get_v02_qmi_status_name(sensor_perf_config_ind.status));
   }
+  else
+  {
+    // batching used until the modem streaming ready status says otherwise
+    mSensorInjector.setDefaultBatchSpec(LocSensorInjector::SENSOR_ACCEL,
+                                        accelSamplesPerBatch, accelBatchesPerSec);
+    mSensorInjector.setDefaultBatchSpec(LocSensorInjector::SENSOR_GYRO,
+                                        gyroSamplesPerBatch, gyroBatchesPerSec);
+  }
 
   return convertErr(result);
 }
@@ -1637,6 +1804,9 @@ enum loc_api_adapter_err LocApiV02 :: setExtPowerConfig(int isBatteryCharging)
 
   req_union.pSetExternalPowerConfigReq = &ext_pwr_req;
 
+  /* a good moment for an XTRA refresh, whatever the modem says */
+  mXtraManager.setCharging(1 == isBatteryCharging);
+
   result = loc_sync_send_req(clientHandle,
                              QMI_LOC_SET_EXTERNAL_POWER_CONFIG_REQ_V02,
                              req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
@@ -1731,7 +1901,10 @@ locClientEventMaskType LocApiV02 :: convertMask(
       eventMask |= QMI_LOC_EVENT_MASK_WIFI_REQ_V02;
 
   if (mask & LOC_API_ADAPTER_SENSOR_STATUS)
+  {
       eventMask |= QMI_LOC_EVENT_MASK_SENSOR_STREAMING_READY_STATUS_V02;
+      eventMask |= QMI_LOC_EVENT_MASK_VEHICLE_DATA_READY_STATUS_V02;
+  }
 
   if (mask & LOC_API_ADAPTER_REQUEST_TIME_SYNC)
       eventMask |= QMI_LOC_EVENT_MASK_TIME_SYNC_REQ_V02;
@@ -1927,21 +2100,53 @@ void LocApiV02 :: reportPosition (
                locationExtended.speed_unc = location_report_ptr->speedUnc;
             }
 
-            LocApiBase::reportPosition( location,
-                            locationExtended,
-                            (void*)location_report_ptr,
-                            (location_report_ptr->sessionStatus
-                             == eQMI_LOC_SESS_STATUS_IN_PROGRESS_V02 ?
-                             LOC_SESS_INTERMEDIATE : LOC_SESS_SUCCESS),
-                            tech_Mask);
+            enum loc_sess_status sessStatus =
+                (location_report_ptr->sessionStatus
+                 == eQMI_LOC_SESS_STATUS_IN_PROGRESS_V02 ?
+                 LOC_SESS_INTERMEDIATE : LOC_SESS_SUCCESS);
+
+            if (!mEpochAssembly ||
+                !mEpochAssembler.addPosition(location, locationExtended,
+                                             location_report_ptr,
+                                             sessStatus, tech_Mask))
+            {
+                LocTraceSpan span(LOC_TRACE_REPORT_POSITION);
+                LocApiBase::reportPosition( location,
+                                locationExtended,
+                                (void*)location_report_ptr,
+                                sessStatus,
+                                tech_Mask);
+            }
+
+            if (mNmeaSynthesis)
+            {
+                mNmeaGenerator.reset();
+                mNmeaGenerator.appendGga(location.gpsLocation, locationExtended);
+                mNmeaGenerator.appendRmc(location.gpsLocation, locationExtended);
+                mNmeaGenerator.appendGsa(location.gpsLocation, locationExtended);
+                reportSynthesizedNmea();
+            }
+
+            if (location_report_ptr->sessionStatus == eQMI_LOC_SESS_STATUS_SUCCESS_V02)
+            {
+                updateGeofencePosition(location_report_ptr->latitude,
+                                       location_report_ptr->longitude);
+            }
         }
     }
     else
     {
-        LocApiBase::reportPosition(location,
-                                   locationExtended,
-                                   NULL,
-                                   LOC_SESS_FAILURE);
+        if (!mEpochAssembly ||
+            !mEpochAssembler.addPosition(location, locationExtended, NULL,
+                                         LOC_SESS_FAILURE,
+                                         LOC_POS_TECH_MASK_DEFAULT))
+        {
+            LocTraceSpan span(LOC_TRACE_REPORT_POSITION);
+            LocApiBase::reportPosition(location,
+                                       locationExtended,
+                                       NULL,
+                                       LOC_SESS_FAILURE);
+        }
 
         LOC_LOGD("%s:%d]: Ignoring position report with sess status = %d, "
                       "fix id = %u\n", __func__, __LINE__,
@@ -2066,9 +2271,21 @@ void  LocApiV02 :: reportSv (
   if (SvStatus.num_svs >= 0)
   {
     LOC_LOGV ("%s:%d]: firing SV callback\n", __func__, __LINE__);
-    LocApiBase::reportSv(SvStatus,
-                         locationExtended,
-                         (void*)gnss_report_ptr);
+    if (!mEpochAssembly ||
+        !mEpochAssembler.addSv(SvStatus, locationExtended, gnss_report_ptr))
+    {
+      LocTraceSpan span(LOC_TRACE_REPORT_SV);
+      LocApiBase::reportSv(SvStatus,
+                           locationExtended,
+                           (void*)gnss_report_ptr);
+    }
+
+    if (mNmeaSynthesis)
+    {
+      mNmeaGenerator.reset();
+      mNmeaGenerator.appendGsv(SvStatus);
+      reportSynthesizedNmea();
+    }
   }
 }
 
@@ -2143,10 +2360,36 @@ void LocApiV02 :: reportNmea (
   const qmiLocEventNmeaIndMsgT_v02 *nmea_report_ptr)
 {
 
-  LocApiBase::reportNmea(nmea_report_ptr->nmea,
-                         strlen(nmea_report_ptr->nmea));
+  size_t length = strlen(nmea_report_ptr->nmea);
+
+  if (!mEpochAssembly ||
+      !mEpochAssembler.addNmea(nmea_report_ptr->nmea, length))
+  {
+    LocTraceSpan span(LOC_TRACE_REPORT_NMEA);
+    LocApiBase::reportNmea(nmea_report_ptr->nmea, length);
+  }
+
+  /* the talker and sentence type, e.g. "GPGG", as the second arg */
+  const unsigned char* type = (const unsigned char*)nmea_report_ptr->nmea + 1;
+  LOC_TRACE_OR_LOG(LOC_TRACE_NMEA, length,
+                   length > 4 ? ((uint32_t)type[0] << 24 | (uint32_t)type[1] << 16 |
+                                 (uint32_t)type[2] << 8 | type[3]) : 0,
+                   0, 0, LOC_LOGD, "NMEA <%s", nmea_report_ptr->nmea);
+}
 
-  LOC_LOGD("NMEA <%s", nmea_report_ptr->nmea);
+/* send the sentences built by the NMEA generator to loc eng */
+void LocApiV02 :: reportSynthesizedNmea()
+{
+  for (size_t i = 0; i < mNmeaGenerator.count(); i++)
+  {
+    size_t length;
+    const char* nmea = mNmeaGenerator.sentence(i, length);
+    if (!mEpochAssembly || !mEpochAssembler.addNmea(nmea, length))
+    {
+      LocTraceSpan span(LOC_TRACE_REPORT_NMEA);
+      LocApiBase::reportNmea(nmea, (int)length);
+    }
+  }
 }
 
 /* convert and report an ATL request to loc engine */
@@ -2154,6 +2397,28 @@ void LocApiV02 :: reportAtlRequest(
   const qmiLocEventLocationServerConnectionReqIndMsgT_v02 * server_request_ptr)
 {
   uint32_t connHandle = server_request_ptr->connHandle;
+
+  /* the connection status is sent with a sync request, which cannot
+     wait on this thread */
+  struct MsgAnswerAtl : public LocMsg {
+    LocApiV02* mpLocApiV02;
+    int mHandle;
+    bool mOpen;
+    LocAtlBroker::Answer mAnswer;
+    inline MsgAnswerAtl(LocApiV02* pLocApiV02, int handle, bool open,
+                        const LocAtlBroker::Answer& answer) :
+               LocMsg(), mpLocApiV02(pLocApiV02), mHandle(handle),
+               mOpen(open), mAnswer(answer) {}
+    inline virtual void proc() const {
+      if (mOpen) {
+        mpLocApiV02->informAtlOpenStatus(mHandle, 1, mAnswer.apn,
+                                         mAnswer.bearer);
+      } else {
+        mpLocApiV02->informAtlCloseStatus(mHandle, 1);
+      }
+    }
+  };
+
   // service ATL open request; copy the WWAN type
   if(server_request_ptr->requestType == eQMI_LOC_SERVER_REQUEST_OPEN_V02 )
   {
@@ -2162,25 +2427,47 @@ void LocApiV02 :: reportAtlRequest(
     {
     case eQMI_LOC_WWAN_TYPE_INTERNET_V02:
       agpsType = AGPS_TYPE_WWAN_ANY;
-      requestATL(connHandle, agpsType);
       break;
     case eQMI_LOC_WWAN_TYPE_AGNSS_V02:
       agpsType = AGPS_TYPE_SUPL;
-      requestATL(connHandle, agpsType);
       break;
     case eQMI_LOC_WWAN_TYPE_AGNSS_EMERGENCY_V02:
       requestSuplES(connHandle);
-      break;
+      return;
     default:
       agpsType = AGPS_TYPE_WWAN_ANY;
-      requestATL(connHandle, agpsType);
+      break;
+    }
+
+    LocAtlBroker::Answer answer;
+    switch (mAtlBroker.open(connHandle, agpsType, answer))
+    {
+    case LocAtlBroker::OPEN_REQUEST:
+      requestATL(answer.id, agpsType);
+      break;
+    case LocAtlBroker::OPEN_ANSWER:
+      sendMsg(new MsgAnswerAtl(this, connHandle, true, answer));
+      break;
+    default:
       break;
     }
   }
   // service the ATL close request
   else if (server_request_ptr->requestType == eQMI_LOC_SERVER_REQUEST_CLOSE_V02)
   {
-    releaseATL(connHandle);
+    int id = connHandle;
+    LocAtlBroker::Answer answer;
+
+    switch (mAtlBroker.close(connHandle, id))
+    {
+    case LocAtlBroker::CLOSE_ANSWER:
+      memset(&answer, 0, sizeof(answer));
+      sendMsg(new MsgAnswerAtl(this, connHandle, false, answer));
+      break;
+    default:
+      releaseATL(id);
+      break;
+    }
   }
 }
 
@@ -2323,6 +2610,11 @@ void LocApiV02 :: reportNiRequest(
         &ni_req_ptr->suplEmergencyNotification;
 
         notif.ni_type = GPS_NI_TYPE_EMERGENCY_SUPL;
+
+        /* the ATL request for the session follows shortly */
+        if (mDataCallPrewarm) {
+          prewarmDataCall();
+        }
     }
 
   } //ni_req_ptr->NiSuplInd_valid == 1
@@ -2450,6 +2742,7 @@ void LocApiV02 :: eventCb(locClientHandleType clientHandle,
 {
   LOC_LOGD("%s:%d]: event id = %d\n", __func__, __LINE__,
                 eventId);
+  LocTraceSpan span(LOC_TRACE_EVENT_CB, eventId);
 
   switch(eventId)
   {
@@ -2482,6 +2775,7 @@ void LocApiV02 :: eventCb(locClientHandleType clientHandle,
       LOC_LOGD("%s:%d]: XTRA download request\n", __func__,
                     __LINE__);
       reportXtraServerUrl(eventPayload.pInjectPredictedOrbitsReqEvent);
+      mXtraManager.requested();
       requestXtraData();
       break;
 
@@ -2508,6 +2802,41 @@ void LocApiV02 :: eventCb(locClientHandleType clientHandle,
     case QMI_LOC_EVENT_LOCATION_SERVER_CONNECTION_REQ_IND_V02:
       reportAtlRequest(eventPayload.pLocationServerConnReqEvent);
       break;
+
+    // Geofence breach
+    case QMI_LOC_EVENT_GEOFENCE_BREACH_NOTIFICATION_IND_V02:
+      reportGeofenceBreach(eventPayload.pGeofenceBreachEvent);
+      break;
+
+    case QMI_LOC_EVENT_GEOFENCE_BATCHED_BREACH_NOTIFICATION_IND_V02:
+      reportGeofenceBatchedBreach(eventPayload.pGeofenceBatchedBreachEvent);
+      break;
+
+    // Geofence general alert
+    case QMI_LOC_EVENT_GEOFENCE_GEN_ALERT_IND_V02:
+      geofenceAlertEvent(eventPayload.pGeofenceGenAlertEvent->geofenceAlert);
+      break;
+
+    // Sensor streaming ready status
+    case QMI_LOC_EVENT_SENSOR_STREAMING_READY_STATUS_IND_V02:
+      mSensorInjector.readyStatus(eventPayload.pSensorStreamingReadyStatusEvent);
+      break;
+
+    // Vehicle data ready status
+    case QMI_LOC_EVENT_VEHICLE_DATA_READY_STATUS_IND_V02:
+      mVehicleInjector.readyStatus(eventPayload.pVehicleDataReadyEvent);
+      break;
+
+    // Wi-Fi fix request
+    case QMI_LOC_EVENT_WIFI_REQ_IND_V02:
+      wifiRequestEvent(eventPayload.pWifiReqEvent);
+      break;
+
+    // Wi-Fi AP data request, the next scan is sent even if unchanged
+    case QMI_LOC_EVENT_INJECT_WIFI_AP_DATA_REQ_IND_V02:
+      mWifiInjector.invalidate();
+      wifiApDataRequestEvent();
+      break;
   }
 }
 
@@ -2519,6 +2848,36 @@ void LocApiV02 :: errorCb(locClientHandleType handle,
   {
     LOC_LOGE("%s:%d]: Service unavailable error\n",
                   __func__, __LINE__);
+    loc_metrics_inc(LOC_METRICS_ENGINE_RESTART);
+
+    // geofences do not survive a modem service restart; the host store
+    // keeps them, and they are programmed again with the next position.
+    // The modem NMEA types are read again before they are next set.
+    struct MsgClearModemState : public LocMsg {
+        LocApiV02* mpLocApiV02;
+        inline MsgClearModemState(LocApiV02* pLocApiV02) :
+                   LocMsg(), mpLocApiV02(pLocApiV02) {}
+        inline virtual void proc() const {
+            mpLocApiV02->mGeofenceClientIds.clear();
+            mpLocApiV02->mGeofenceModemIds.clear();
+            mpLocApiV02->updateGeofencesOnHost();
+            mpLocApiV02->mGeofenceCell = UINT64_MAX;
+            mpLocApiV02->mGeofenceCapacity = SIZE_MAX;
+            mpLocApiV02->mModemNmeaTypesValid = false;
+            mpLocApiV02->mCertSlotsKnown = 0;
+        }
+    };
+    sendMsg(new MsgClearModemState(this));
+
+    mSensorInjector.resetReadyStatus();
+    mVehicleInjector.resetReadyStatus();
+    mWifiInjector.invalidate();
+    mCellInjector.invalidate();
+    mZppCache.invalidate();
+    mXtraManager.reset();
+    mAtlBroker.reset();
+    /* the modem may come back with other profiles */
+    ds_client_invalidate_profile_cache();
 
     handleEngineDownEvent();
 
@@ -2602,6 +2961,37 @@ int LocApiV02 :: openAndStartDataCall()
     return (int)ret;
 }
 
+void LocApiV02 :: prewarmDataCall()
+{
+    ds_client_status_enum_type result =
+        ds_client_prewarm_call(&ds_client_cb, (void *)this, mDataCallPrewarmGraceMs);
+    if (result != E_DS_CLIENT_SUCCESS) {
+        LOC_LOGE("%s:%d]: Could not pre-warm emergency call. result = %d",
+                 __func__, __LINE__, (int)result);
+    }
+}
+
+void LocApiV02 :: setDataCallPrewarm(bool enabled, uint32_t graceMs)
+{
+    mDataCallPrewarmGraceMs = graceMs;
+    mDataCallPrewarm = enabled;
+}
+
+void LocApiV02 :: atlReleaseCb(int id, void* context)
+{
+    ((LocApiV02*)context)->releaseATL(id);
+}
+
+void LocApiV02 :: setAtlLinger(uint32_t lingerMs)
+{
+    mAtlBroker.setLinger(lingerMs);
+}
+
+void LocApiV02 :: getAtlBrokerStats(LocAtlBroker::Stats &stats) const
+{
+    mAtlBroker.getStats(stats);
+}
+
 void LocApiV02 :: stopDataCall()
 {
     ds_client_status_enum_type ret =
@@ -2629,6 +3019,69 @@ void LocApiV02 :: closeDataCall()
 
 enum loc_api_adapter_err LocApiV02 ::
 getWwanZppFix(GpsLocation &zppLoc)
+{
+    LocPosTechMask tech_mask;
+    return mZppCache.get(LocZppCache::SOURCE_WWAN, zppLoc, tech_mask);
+}
+
+enum loc_api_adapter_err LocApiV02 :: getBestAvailableZppFix(GpsLocation & zppLoc)
+{
+    LocPosTechMask tech_mask;
+    return getBestAvailableZppFix(zppLoc, tech_mask);
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+getBestAvailableZppFix(GpsLocation &zppLoc, LocPosTechMask &tech_mask)
+{
+    return mZppCache.get(LocZppCache::SOURCE_BEST_AVAILABLE, zppLoc, tech_mask);
+}
+
+void LocApiV02 :: setZppCacheTtl(LocPosTechMask techMask, uint32_t ttlMs)
+{
+    mZppCache.setTtl(techMask, ttlMs);
+}
+
+void LocApiV02 :: setZppCacheMaxStale(uint32_t maxStaleMs)
+{
+    mZppCache.setMaxStale(maxStaleMs);
+}
+
+void LocApiV02 :: getZppCacheStats(LocZppCache::Stats &stats) const
+{
+    mZppCache.getStats(stats);
+}
+
+void LocApiV02 :: setXtraHorizon(uint32_t horizonHours)
+{
+    mXtraManager.setHorizon(horizonHours);
+}
+
+void LocApiV02 :: getXtraStats(LocXtraManager::Stats &stats) const
+{
+    mXtraManager.getStats(stats);
+}
+
+/* proactive XTRA refresh, from the XTRA manager thread */
+void LocApiV02 :: xtraRefreshCb(void* context)
+{
+    ((LocApiV02*)context)->requestXtraData();
+}
+
+/* ZPP cache misses and refreshes, from the caller or the cache thread */
+enum loc_api_adapter_err LocApiV02 ::
+zppFetch(void* context, LocZppCache::Source source,
+         GpsLocation &zppLoc, LocPosTechMask &tech_mask)
+{
+    LocApiV02* pLocApiV02 = (LocApiV02*)context;
+
+    if (LocZppCache::SOURCE_WWAN == source) {
+        return pLocApiV02->fetchWwanZppFix(zppLoc, tech_mask);
+    }
+    return pLocApiV02->fetchBestAvailableZppFix(zppLoc, tech_mask);
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+fetchWwanZppFix(GpsLocation &zppLoc, LocPosTechMask &tech_mask)
 {
     locClientReqUnionType req_union;
     qmiLocGetAvailWwanPositionReqMsgT_v02 zpp_req;
@@ -2657,9 +3110,8 @@ getWwanZppFix(GpsLocation &zppLoc)
                   loc_get_v02_client_status_name(status),
                   loc_get_v02_qmi_status_name(zpp_ind.status));
 
-        LocPosTechMask tech_mask;
         loc_api_adapter_err ret;
-        ret = getBestAvailableZppFix(zppLoc, tech_mask);
+        ret = fetchBestAvailableZppFix(zppLoc, tech_mask);
         if (ret == LOC_API_ADAPTER_ERR_SUCCESS &&
             tech_mask != LOC_POS_TECH_MASK_DEFAULT &&
             tech_mask & LOC_POS_TECH_MASK_CELLID) {
@@ -2716,17 +3168,14 @@ getWwanZppFix(GpsLocation &zppLoc)
         zppLoc.altitude = zpp_ind.altitudeWrtEllipsoid;
     }
 
-    return LOC_API_ADAPTER_ERR_SUCCESS;
-}
+    /* the available WWAN position is always cell based */
+    tech_mask = LOC_POS_TECH_MASK_CELLID;
 
-enum loc_api_adapter_err LocApiV02 :: getBestAvailableZppFix(GpsLocation & zppLoc)
-{
-    LocPosTechMask tech_mask;
-    return getBestAvailableZppFix(zppLoc, tech_mask);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
 }
 
 enum loc_api_adapter_err LocApiV02 ::
-getBestAvailableZppFix(GpsLocation &zppLoc, LocPosTechMask &tech_mask)
+fetchBestAvailableZppFix(GpsLocation &zppLoc, LocPosTechMask &tech_mask)
 {
     locClientReqUnionType req_union;
 
@@ -2943,6 +3392,17 @@ enum loc_api_adapter_err LocApiV02:: setXtraVersionCheck(enum xtra_version_check
 }
 #endif
 
+/* 64 bit FNV-1a, identifies the content of a certificate slot */
+static uint64_t certDigest(const unsigned char* data, size_t length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 void LocApiV02 :: installAGpsCert(const DerEncodedCertificate* pData,
                                   size_t numberOfCerts,
                                   uint32_t slotBitMask)
@@ -2950,105 +3410,79 @@ void LocApiV02 :: installAGpsCert(const DerEncodedCertificate* pData,
     LOC_LOGD("%s:%d]:, slot mask=%u number of certs=%lu",
             __func__, __LINE__, slotBitMask, numberOfCerts);
 
+    /* the slot contents are only known once we wrote them; the first
+       install after boot syncs every writable slot */
+    if (0 == mCertSlotsKnown) {
+        mCertInstallStats.fullSyncs++;
+    }
+
+    uint32_t applied = 0;
+    uint32_t skipped = 0;
     uint8_t certIndex = 0;
     for (uint8_t slot = 0; slot <= AGPS_CERTIFICATE_MAX_SLOTS-1; slot++, slotBitMask >>= 1)
     {
+        uint32_t slotBit = 1 << slot;
+
         if (slotBitMask & 1) //slot is writable
         {
             if (certIndex < numberOfCerts && pData[certIndex].data && pData[certIndex].length > 0)
             {
-                LOC_LOGD("%s:%d]:, Inject cert#%u slot=%u length=%lu",
-                         __func__, __LINE__, certIndex, slot, pData[certIndex].length);
-
-                locClientReqUnionType req_union;
-                locClientStatusEnumType status;
-                qmiLocInjectSuplCertificateReqMsgT_v02 injectCertReq;
-                qmiLocInjectSuplCertificateIndMsgT_v02 injectCertInd;
-
-                memset(&injectCertReq, 0, sizeof(injectCertReq));
-                injectCertReq.suplCertId = slot;
-                injectCertReq.suplCertData_len = pData[certIndex].length;
-                memcpy(injectCertReq.suplCertData, pData[certIndex].data, pData[certIndex].length);
-
-                req_union.pInjectSuplCertificateReq = &injectCertReq;
-
-                status = loc_sync_send_req(clientHandle,
-                                           QMI_LOC_INJECT_SUPL_CERTIFICATE_REQ_V02,
-                                           req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
-                                           QMI_LOC_INJECT_SUPL_CERTIFICATE_IND_V02,
-                                           &injectCertInd);
+                const DerEncodedCertificate& cert = pData[certIndex];
+                uint64_t digest = certDigest(cert.data, cert.length);
+                certIndex++; //move to next cert
 
-                if (status != eLOC_CLIENT_SUCCESS ||
-                    eQMI_LOC_SUCCESS_V02 != injectCertInd.status)
+                if ((mCertSlotsKnown & slotBit) &&
+                    !(mCertSlotsEmpty & slotBit) &&
+                    mCertSlotLengths[slot] == cert.length &&
+                    mCertSlotDigests[slot] == digest)
                 {
-                    LOC_LOGE ("%s:%d]: inject-error status = %s, set_server_ind.status = %s",
-                              __func__,__LINE__,
-                              loc_get_v02_client_status_name(status),
-                              loc_get_v02_qmi_status_name(injectCertInd.status));
+                    LOC_LOGV("%s:%d]:, Unchanged cert slot=%u",
+                             __func__, __LINE__, slot);
+                    skipped++;
+                    continue;
                 }
 
-                certIndex++; //move to next cert
+                LOC_LOGD("%s:%d]:, Inject cert#%u slot=%u length=%lu",
+                         __func__, __LINE__, certIndex - 1, slot, cert.length);
+
+                applied++;
+                if (injectSuplCert(slot, cert.data, cert.length)) {
+                    mCertSlotsKnown |= slotBit;
+                    mCertSlotsEmpty &= ~slotBit;
+                    mCertSlotLengths[slot] = cert.length;
+                    mCertSlotDigests[slot] = digest;
+                    mCertInstallStats.injected++;
+                } else {
+                    mCertSlotsKnown &= ~slotBit;
+                    mCertInstallStats.failed++;
+                }
 
             } else {
 
+                if ((mCertSlotsKnown & slotBit) && (mCertSlotsEmpty & slotBit))
+                {
+                    LOC_LOGV("%s:%d]:, Already empty slot=%u",
+                             __func__, __LINE__, slot);
+                    skipped++;
+                    continue;
+                }
+
                 LOC_LOGD("%s:%d]:, Delete slot=%u",
                          __func__, __LINE__, slot);
 
                 // A fake cert is injected first before delete is called to workaround
                 // an issue that is seen with trying to delete an empty slot.
-                {
-                    locClientReqUnionType req_union;
-                    locClientStatusEnumType status;
-                    qmiLocInjectSuplCertificateReqMsgT_v02 injectFakeCertReq;
-                    qmiLocInjectSuplCertificateIndMsgT_v02 injectFakeCertInd;
-
-                    memset(&injectFakeCertReq, 0, sizeof(injectFakeCertReq));
-                    injectFakeCertReq.suplCertId = slot;
-                    injectFakeCertReq.suplCertData_len = 1;
-                    injectFakeCertReq.suplCertData[0] = 1;
-
-                    req_union.pInjectSuplCertificateReq = &injectFakeCertReq;
-
-                    status = loc_sync_send_req(clientHandle,
-                                       QMI_LOC_INJECT_SUPL_CERTIFICATE_REQ_V02,
-                                       req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
-                                       QMI_LOC_INJECT_SUPL_CERTIFICATE_IND_V02,
-                                       &injectFakeCertInd);
-
-                    if (status != eLOC_CLIENT_SUCCESS ||
-                        eQMI_LOC_SUCCESS_V02 != injectFakeCertInd.status)
-                    {
-                        LOC_LOGE ("%s:%d]: inject-fake-error status = %s, set_server_ind.status = %s",
-                                  __func__,__LINE__,
-                                  loc_get_v02_client_status_name(status),
-                                  loc_get_v02_qmi_status_name(injectFakeCertInd.status));
-                    }
-                }
-
-                locClientReqUnionType req_union;
-                locClientStatusEnumType status;
-                qmiLocDeleteSuplCertificateReqMsgT_v02 deleteCertReq;
-                qmiLocDeleteSuplCertificateIndMsgT_v02 deleteCertInd;
-
-                memset(&deleteCertReq, 0, sizeof(deleteCertReq));
-                deleteCertReq.suplCertId = slot;
-                deleteCertReq.suplCertId_valid = 1;
-
-                req_union.pDeleteSuplCertificateReq = &deleteCertReq;
-
-                status = loc_sync_send_req(clientHandle,
-                                           QMI_LOC_DELETE_SUPL_CERTIFICATE_REQ_V02,
-                                           req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
-                                           QMI_LOC_DELETE_SUPL_CERTIFICATE_IND_V02,
-                                           &deleteCertInd);
-
-                if (status != eLOC_CLIENT_SUCCESS ||
-                    eQMI_LOC_SUCCESS_V02 != deleteCertInd.status)
-                {
-                    LOC_LOGE("%s:%d]: delete-error status = %s, set_server_ind.status = %s",
-                              __func__,__LINE__,
-                              loc_get_v02_client_status_name(status),
-                              loc_get_v02_qmi_status_name(deleteCertInd.status));
+                const unsigned char fakeCert = 1;
+                injectSuplCert(slot, &fakeCert, 1);
+
+                applied++;
+                if (deleteSuplCert(slot)) {
+                    mCertSlotsKnown |= slotBit;
+                    mCertSlotsEmpty |= slotBit;
+                    mCertInstallStats.deleted++;
+                } else {
+                    mCertSlotsKnown &= ~slotBit;
+                    mCertInstallStats.failed++;
                 }
             }
         } else {
@@ -3056,4 +3490,1159 @@ void LocApiV02 :: installAGpsCert(const DerEncodedCertificate* pData,
                      __func__, __LINE__, slot);
         }
     }
+
+    mCertInstallStats.skipped += skipped;
+    LOC_LOGD("%s:%d]:, %u slot(s) applied, %u unchanged slot(s) skipped",
+             __func__, __LINE__, applied, skipped);
+}
+
+bool LocApiV02 :: injectSuplCert(uint8_t slot, const unsigned char* data,
+                                 size_t length)
+{
+    locClientReqUnionType req_union;
+    locClientStatusEnumType status;
+    qmiLocInjectSuplCertificateReqMsgT_v02 injectCertReq;
+    qmiLocInjectSuplCertificateIndMsgT_v02 injectCertInd;
+
+    if (length > QMI_LOC_MAX_SUPL_CERT_LENGTH_V02) {
+        LOC_LOGE("%s:%d]: cert too long, slot=%u length=%zu",
+                 __func__, __LINE__, slot, length);
+        return false;
+    }
+
+    memset(&injectCertReq, 0, sizeof(injectCertReq));
+    memset(&injectCertInd, 0, sizeof(injectCertInd));
+    injectCertReq.suplCertId = slot;
+    injectCertReq.suplCertData_len = length;
+    memcpy(injectCertReq.suplCertData, data, length);
+
+    req_union.pInjectSuplCertificateReq = &injectCertReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_INJECT_SUPL_CERTIFICATE_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_INJECT_SUPL_CERTIFICATE_IND_V02,
+                               &injectCertInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != injectCertInd.status)
+    {
+        LOC_LOGE ("%s:%d]: inject-error status = %s, set_server_ind.status = %s",
+                  __func__,__LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(injectCertInd.status));
+        return false;
+    }
+    return true;
+}
+
+bool LocApiV02 :: deleteSuplCert(uint8_t slot)
+{
+    locClientReqUnionType req_union;
+    locClientStatusEnumType status;
+    qmiLocDeleteSuplCertificateReqMsgT_v02 deleteCertReq;
+    qmiLocDeleteSuplCertificateIndMsgT_v02 deleteCertInd;
+
+    memset(&deleteCertReq, 0, sizeof(deleteCertReq));
+    memset(&deleteCertInd, 0, sizeof(deleteCertInd));
+    deleteCertReq.suplCertId = slot;
+    deleteCertReq.suplCertId_valid = 1;
+
+    req_union.pDeleteSuplCertificateReq = &deleteCertReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_DELETE_SUPL_CERTIFICATE_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_DELETE_SUPL_CERTIFICATE_IND_V02,
+                               &deleteCertInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != deleteCertInd.status)
+    {
+        LOC_LOGE("%s:%d]: delete-error status = %s, set_server_ind.status = %s",
+                  __func__,__LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(deleteCertInd.status));
+        return false;
+    }
+    return true;
+}
+
+void LocApiV02 :: getCertInstallStats(CertInstallStats &stats) const
+{
+    stats = mCertInstallStats;
+}
+
+void LocApiV02 :: mapGeofence(uint32_t modemId, uint32_t clientId)
+{
+    // the modem may reuse an id that we still hold for a stale fence
+    std::unordered_map<uint32_t, uint32_t>::iterator it =
+        mGeofenceClientIds.find(modemId);
+    if (it != mGeofenceClientIds.end()) {
+        mGeofenceModemIds.erase(it->second);
+    }
+    unmapGeofence(clientId);
+    mGeofenceClientIds[modemId] = clientId;
+    mGeofenceModemIds[clientId] = modemId;
+    updateGeofencesOnHost();
+}
+
+void LocApiV02 :: unmapGeofence(uint32_t clientId)
+{
+    std::unordered_map<uint32_t, uint32_t>::iterator it =
+        mGeofenceModemIds.find(clientId);
+    if (it != mGeofenceModemIds.end()) {
+        mGeofenceClientIds.erase(it->second);
+        mGeofenceModemIds.erase(it);
+    }
+    updateGeofencesOnHost();
+}
+
+void LocApiV02 :: updateGeofencesOnHost()
+{
+    mGeofencesOnHost = mGeofenceStore.size() > mGeofenceModemIds.size();
+}
+
+bool LocApiV02 :: getModemGeofenceId(uint32_t clientId, uint32_t &modemId)
+{
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it =
+        mGeofenceModemIds.find(clientId);
+    if (it == mGeofenceModemIds.end()) {
+        LOC_LOGE("%s:%d]: unknown geofence id %u", __func__, __LINE__, clientId);
+        return false;
+    }
+    modemId = it->second;
+    return true;
+}
+
+void LocApiV02 :: fillGeofenceAddReq(const LocGeofenceStore::Fence& fence,
+                                     qmiLocAddCircularGeofenceReqMsgT_v02 &addReq)
+{
+    memset(&addReq, 0, sizeof(addReq));
+    addReq.transactionId = ++mGeofenceTransactionId;
+    addReq.circularGeofenceArgs.latitude = fence.latitude;
+    addReq.circularGeofenceArgs.longitude = fence.longitude;
+    addReq.circularGeofenceArgs.radius = fence.radius;
+    addReq.breachMask = fence.breachMask;
+    addReq.includePosition = 1;
+    if (fence.responsiveness != 0) {
+        addReq.responsiveness_valid = 1;
+        addReq.responsiveness = fence.responsiveness;
+    }
+}
+
+/* map an added fence; modemFull is set when the modem has no free
+   geofence slot left */
+enum loc_api_adapter_err LocApiV02 ::
+geofenceAdded(const LocGeofenceStore::Fence& fence,
+              locClientStatusEnumType status,
+              const qmiLocAddCircularGeofenceIndMsgT_v02 &addInd,
+              bool &modemFull)
+{
+    modemFull = false;
+
+    if (status == eLOC_CLIENT_SUCCESS &&
+        eQMI_LOC_MAX_GEOFENCE_PROGRAMMED_V02 == addInd.status)
+    {
+        modemFull = true;
+        return LOC_API_ADAPTER_ERR_ENGINE_BUSY;
+    }
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != addInd.status ||
+        !addInd.geofenceId_valid)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, addInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(addInd.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+
+    mapGeofence(addInd.geofenceId, fence.clientId);
+
+    // the fence may have been paused while it was only kept on the host
+    if (eQMI_LOC_GEOFENCE_STATE_SUSPEND_V02 == fence.state) {
+        editGeofence(fence.clientId, 0, (qmiLocGeofenceResponsivenessEnumT_v02)0,
+                     fence.state);
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+/* add a fence to the modem; modemFull is set when the modem has no
+   free geofence slot left */
+enum loc_api_adapter_err LocApiV02 ::
+modemAddGeofence(const LocGeofenceStore::Fence& fence, bool &modemFull)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocAddCircularGeofenceReqMsgT_v02 addReq;
+    qmiLocAddCircularGeofenceIndMsgT_v02 addInd;
+
+    fillGeofenceAddReq(fence, addReq);
+    memset(&addInd, 0, sizeof(addInd));
+
+    req_union.pAddCircularGeofenceReq = &addReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_ADD_CIRCULAR_GEOFENCE_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_ADD_CIRCULAR_GEOFENCE_IND_V02,
+                               &addInd);
+
+    return geofenceAdded(fence, status, addInd, modemFull);
+}
+
+bool LocApiV02 :: fillGeofenceDeleteReq(uint32_t clientId,
+                                        qmiLocDeleteGeofenceReqMsgT_v02 &deleteReq)
+{
+    uint32_t modemId;
+
+    if (!getModemGeofenceId(clientId, modemId)) {
+        return false;
+    }
+    memset(&deleteReq, 0, sizeof(deleteReq));
+    deleteReq.geofenceId = modemId;
+    deleteReq.transactionId = ++mGeofenceTransactionId;
+    return true;
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+geofenceDeleted(uint32_t clientId, locClientStatusEnumType status,
+                const qmiLocDeleteGeofenceIndMsgT_v02 &deleteInd)
+{
+    // a fence the modem does not know is gone; any other failure leaves
+    // it armed, so it stays mapped and its breaches are still reported
+    if (eLOC_CLIENT_SUCCESS == status &&
+        (eQMI_LOC_SUCCESS_V02 == deleteInd.status ||
+         eQMI_LOC_INVALID_PARAMETER_V02 == deleteInd.status)) {
+        unmapGeofence(clientId);
+    }
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != deleteInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, deleteInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(deleteInd.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiV02 :: modemDeleteGeofence(uint32_t clientId)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocDeleteGeofenceReqMsgT_v02 deleteReq;
+    qmiLocDeleteGeofenceIndMsgT_v02 deleteInd;
+
+    if (!fillGeofenceDeleteReq(clientId, deleteReq)) {
+        return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+    }
+    memset(&deleteInd, 0, sizeof(deleteInd));
+
+    req_union.pDeleteGeofenceReq = &deleteReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_DELETE_GEOFENCE_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_DELETE_GEOFENCE_IND_V02,
+                               &deleteInd);
+
+    return geofenceDeleted(clientId, status, deleteInd);
+}
+
+/* every fence is kept in the host store; it is programmed into the modem
+   right away while the modem has room, otherwise it waits there until
+   rotateGeofences() finds it among the fences nearest to the device */
+enum loc_api_adapter_err LocApiV02 ::
+addGeofence(uint32_t clientId, double latitude, double longitude,
+            uint32_t radius, qmiLocGeofenceBreachMaskT_v02 breachMask,
+            qmiLocGeofenceResponsivenessEnumT_v02 responsiveness)
+{
+    enum loc_api_adapter_err rtv = LOC_API_ADAPTER_ERR_SUCCESS;
+    LocGeofenceStore::Fence fence;
+    bool modemFull = false;
+
+    LOC_LOGD("%s:%d]: id = %u, lat = %f, lon = %f, radius = %u, mask = %u",
+             __func__, __LINE__, clientId, latitude, longitude, radius,
+             breachMask);
+
+    fence.clientId = clientId;
+    fence.latitude = latitude;
+    fence.longitude = longitude;
+    fence.radius = radius;
+    fence.breachMask = breachMask;
+    fence.responsiveness = responsiveness;
+    fence.state = eQMI_LOC_GEOFENCE_STATE_ACTIVE_V02;
+
+    // the fence being replaced must leave the modem first
+    if (mGeofenceModemIds.count(clientId)) {
+        rtv = modemDeleteGeofence(clientId);
+        if (mGeofenceModemIds.count(clientId)) {
+            return rtv;
+        }
+        rtv = LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    mGeofenceStore.add(fence);
+    updateGeofencesOnHost();
+
+    if (mGeofenceModemIds.size() < mGeofenceCapacity) {
+        rtv = modemAddGeofence(fence, modemFull);
+        if (modemFull) {
+            mGeofenceCapacity = mGeofenceModemIds.size();
+            LOC_LOGI("%s:%d]: modem holds at most %zu geofences, "
+                     "keeping the rest on the host",
+                     __func__, __LINE__, mGeofenceCapacity);
+            rtv = LOC_API_ADAPTER_ERR_SUCCESS;
+        } else if (LOC_API_ADAPTER_ERR_SUCCESS != rtv) {
+            mGeofenceStore.remove(clientId);
+            updateGeofencesOnHost();
+        }
+    }
+
+    return rtv;
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+editGeofence(uint32_t clientId, qmiLocGeofenceBreachMaskT_v02 breachMask,
+             qmiLocGeofenceResponsivenessEnumT_v02 responsiveness,
+             qmiLocGeofenceStateEnumT_v02 state)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocEditGeofenceReqMsgT_v02 editReq;
+    qmiLocEditGeofenceIndMsgT_v02 editInd;
+    LocGeofenceStore::Fence* fence = mGeofenceStore.find(clientId);
+    uint32_t modemId;
+
+    if (NULL == fence) {
+        LOC_LOGE("%s:%d]: unknown geofence id %u", __func__, __LINE__, clientId);
+        return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+    }
+
+    memset(&editReq, 0, sizeof(editReq));
+    memset(&editInd, 0, sizeof(editInd));
+
+    if (breachMask != 0) {
+        fence->breachMask = breachMask;
+        editReq.breachMask_valid = 1;
+        editReq.breachMask = breachMask;
+    }
+    if (responsiveness != 0) {
+        fence->responsiveness = responsiveness;
+        editReq.responsiveness_valid = 1;
+        editReq.responsiveness = responsiveness;
+    }
+    if (state != 0) {
+        fence->state = state;
+        editReq.geofenceState_valid = 1;
+        editReq.geofenceState = state;
+    }
+
+    // a fence only kept on the host picks the change up when it is added
+    if (0 == mGeofenceModemIds.count(clientId)) {
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    getModemGeofenceId(clientId, modemId);
+
+    editReq.geofenceId = modemId;
+    editReq.transactionId = ++mGeofenceTransactionId;
+
+    req_union.pEditGeofenceReq = &editReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_EDIT_GEOFENCE_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_EDIT_GEOFENCE_IND_V02,
+                               &editInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != editInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, editInd.status = %s, "
+                  "failedParams = %u\n", __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(editInd.status),
+                  editInd.failedParams_valid ? editInd.failedParams : 0);
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiV02 :: deleteGeofence(uint32_t clientId)
+{
+    enum loc_api_adapter_err rtv;
+
+    if (NULL == mGeofenceStore.find(clientId)) {
+        LOC_LOGE("%s:%d]: unknown geofence id %u", __func__, __LINE__, clientId);
+        return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+    }
+
+    // a fence still armed in the modem is kept, so it can be deleted again
+    if (mGeofenceModemIds.count(clientId)) {
+        rtv = modemDeleteGeofence(clientId);
+        if (mGeofenceModemIds.count(clientId)) {
+            return rtv;
+        }
+    }
+    mGeofenceStore.remove(clientId);
+    updateGeofencesOnHost();
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+queryGeofence(uint32_t clientId, qmiLocQueryGeofenceIndMsgT_v02 &queryInd)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocQueryGeofenceReqMsgT_v02 queryReq;
+    const LocGeofenceStore::Fence* fence = mGeofenceStore.find(clientId);
+    uint32_t modemId;
+
+    if (NULL == fence) {
+        LOC_LOGE("%s:%d]: unknown geofence id %u", __func__, __LINE__, clientId);
+        return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+    }
+
+    memset(&queryReq, 0, sizeof(queryReq));
+    memset(&queryInd, 0, sizeof(queryInd));
+
+    // a fence only kept on the host is answered from the host store
+    if (0 == mGeofenceModemIds.count(clientId)) {
+        queryInd.status = eQMI_LOC_SUCCESS_V02;
+        queryInd.geofenceId_valid = 1;
+        queryInd.geofenceId = clientId;
+        queryInd.circularGeofenceArgs_valid = 1;
+        queryInd.circularGeofenceArgs.latitude = fence->latitude;
+        queryInd.circularGeofenceArgs.longitude = fence->longitude;
+        queryInd.circularGeofenceArgs.radius = fence->radius;
+        queryInd.geofenceState_valid = 1;
+        queryInd.geofenceState = fence->state;
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    getModemGeofenceId(clientId, modemId);
+
+    queryReq.geofenceId = modemId;
+    queryReq.transactionId = ++mGeofenceTransactionId;
+
+    req_union.pQueryGeofenceReq = &queryReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_QUERY_GEOFENCE_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_QUERY_GEOFENCE_IND_V02,
+                               &queryInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != queryInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, queryInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(queryInd.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+
+    // hand the client its own id back
+    queryInd.geofenceId = clientId;
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+/* a batch pairs indications with requests in arrival order, so one lost
+   indication shifts every later one onto the wrong request; put each
+   back with the request of its transaction id */
+template <typename IndT>
+static void matchGeofenceInds(std::vector<loc_sync_batch_req_s_type> &batch,
+                              std::vector<IndT> &inds,
+                              const std::vector<uint32_t> &transactionIds)
+{
+    std::unordered_map<uint32_t, IndT> received;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (eLOC_CLIENT_SUCCESS != batch[i].status) {
+            continue;
+        }
+        if (!inds[i].transactionId_valid) {
+            // modem did not echo the transaction, keep arrival order
+            return;
+        }
+        received[inds[i].transactionId] = inds[i];
+    }
+    if (received.size() == batch.size()) {
+        return;
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+        typename std::unordered_map<uint32_t, IndT>::const_iterator it =
+            received.find(transactionIds[i]);
+        if (it != received.end()) {
+            inds[i] = it->second;
+            batch[i].status = eLOC_CLIENT_SUCCESS;
+        } else if (eLOC_CLIENT_SUCCESS == batch[i].status) {
+            // it took the indication of a request whose own was lost
+            memset(&inds[i], 0, sizeof(inds[i]));
+            batch[i].status = eLOC_CLIENT_FAILURE_TIMEOUT;
+        }
+    }
+}
+
+/* swap the fences programmed into the modem for the ones nearest to the
+   device. Runs on the MsgTask thread; cheap unless the device moved to
+   another grid cell or the modem lost fences, e.g. on a service restart. */
+void LocApiV02 :: rotateGeofences(double latitude, double longitude)
+{
+    uint64_t cell = mGeofenceStore.cellOf(latitude, longitude);
+    bool moved = (cell != mGeofenceCell);
+    size_t capacity = mGeofenceCapacity;
+
+    // moving to another cell also tries one fence beyond the learned
+    // capacity, so slots lost to a transient rejection are regained
+    if (moved && capacity < mGeofenceStore.size()) {
+        capacity++;
+    }
+    size_t target = std::min(capacity, mGeofenceStore.size());
+
+    if (mGeofenceModemIds.size() >= mGeofenceStore.size() ||
+        (!moved && mGeofenceModemIds.size() >= target)) {
+        return;
+    }
+    mGeofenceCell = cell;
+
+    std::vector<uint32_t> nearest;
+    mGeofenceStore.nearest(latitude, longitude, target, nearest);
+    std::unordered_set<uint32_t> wanted(nearest.begin(), nearest.end());
+
+    // evict first, so that the adds below find free modem slots
+    std::vector<uint32_t> evict;
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it;
+    for (it = mGeofenceModemIds.begin(); it != mGeofenceModemIds.end(); ++it) {
+        if (0 == wanted.count(it->first)) {
+            evict.push_back(it->first);
+        }
+    }
+
+    // both steps go out pipelined, not one sync request after another
+    std::vector<loc_sync_batch_req_s_type> batch;
+    std::vector<uint32_t> transactionIds;
+    std::vector<qmiLocDeleteGeofenceReqMsgT_v02> deleteReqs(evict.size());
+    std::vector<qmiLocDeleteGeofenceIndMsgT_v02> deleteInds(evict.size());
+    for (size_t i = 0; i < evict.size(); i++) {
+        loc_sync_batch_req_s_type req;
+        memset(&req, 0, sizeof(req));
+        fillGeofenceDeleteReq(evict[i], deleteReqs[i]);
+        transactionIds.push_back(deleteReqs[i].transactionId);
+        memset(&deleteInds[i], 0, sizeof(deleteInds[i]));
+        req.req_id = QMI_LOC_DELETE_GEOFENCE_REQ_V02;
+        req.req_payload.pDeleteGeofenceReq = &deleteReqs[i];
+        req.ind_id = QMI_LOC_DELETE_GEOFENCE_IND_V02;
+        req.ind_payload_ptr = &deleteInds[i];
+        batch.push_back(req);
+    }
+    if (!batch.empty()) {
+        loc_sync_send_batch(clientHandle, &batch[0], batch.size(),
+                            LOC_ENGINE_SYNC_REQUEST_TIMEOUT);
+        matchGeofenceInds(batch, deleteInds, transactionIds);
+    }
+    size_t evicted = 0;
+    for (size_t i = 0; i < evict.size(); i++) {
+        if (LOC_API_ADAPTER_ERR_SUCCESS ==
+            geofenceDeleted(evict[i], batch[i].status, deleteInds[i])) {
+            evicted++;
+        }
+    }
+
+    std::vector<const LocGeofenceStore::Fence*> adding;
+    for (size_t i = 0; i < nearest.size() &&
+             mGeofenceModemIds.size() + adding.size() < target; i++) {
+        if (0 == mGeofenceModemIds.count(nearest[i])) {
+            adding.push_back(mGeofenceStore.find(nearest[i]));
+        }
+    }
+    std::vector<qmiLocAddCircularGeofenceReqMsgT_v02> addReqs(adding.size());
+    std::vector<qmiLocAddCircularGeofenceIndMsgT_v02> addInds(adding.size());
+    batch.clear();
+    transactionIds.clear();
+    for (size_t i = 0; i < adding.size(); i++) {
+        loc_sync_batch_req_s_type req;
+        memset(&req, 0, sizeof(req));
+        fillGeofenceAddReq(*adding[i], addReqs[i]);
+        transactionIds.push_back(addReqs[i].transactionId);
+        memset(&addInds[i], 0, sizeof(addInds[i]));
+        req.req_id = QMI_LOC_ADD_CIRCULAR_GEOFENCE_REQ_V02;
+        req.req_payload.pAddCircularGeofenceReq = &addReqs[i];
+        req.ind_id = QMI_LOC_ADD_CIRCULAR_GEOFENCE_IND_V02;
+        req.ind_payload_ptr = &addInds[i];
+        batch.push_back(req);
+    }
+    if (!batch.empty()) {
+        loc_sync_send_batch(clientHandle, &batch[0], batch.size(),
+                            LOC_ENGINE_SYNC_REQUEST_TIMEOUT);
+        matchGeofenceInds(batch, addInds, transactionIds);
+    }
+
+    size_t added = 0;
+    bool full = false;
+    for (size_t i = 0; i < adding.size(); i++) {
+        bool modemFull = false;
+        if (LOC_API_ADAPTER_ERR_SUCCESS ==
+            geofenceAdded(*adding[i], batch[i].status, addInds[i], modemFull)) {
+            added++;
+        }
+        full |= modemFull;
+    }
+    if (full) {
+        mGeofenceCapacity = mGeofenceModemIds.size();
+    }
+    if (mGeofenceCapacity < mGeofenceModemIds.size()) {
+        mGeofenceCapacity = mGeofenceModemIds.size();
+        LOC_LOGI("%s:%d]: modem holds at least %zu geofences",
+                 __func__, __LINE__, mGeofenceCapacity);
+    }
+
+    LOC_LOGD("%s:%d]: evicted %zu, added %zu, modem holds %zu of %zu",
+             __func__, __LINE__, evicted, added,
+             mGeofenceModemIds.size(), mGeofenceStore.size());
+}
+
+/* called from the QMI callback thread with every position fix; the
+   rotation itself runs on the MsgTask thread, and is only posted while
+   some fence is kept on the host alone */
+void LocApiV02 :: updateGeofencePosition(double latitude, double longitude)
+{
+    struct MsgRotateGeofences : public LocMsg {
+        LocApiV02* mpLocApiV02;
+        double mLatitude;
+        double mLongitude;
+        inline MsgRotateGeofences(LocApiV02* pLocApiV02,
+                                  double latitude, double longitude) :
+                   LocMsg(), mpLocApiV02(pLocApiV02),
+                   mLatitude(latitude), mLongitude(longitude) {}
+        inline virtual void proc() const {
+            mpLocApiV02->rotateGeofences(mLatitude, mLongitude);
+        }
+    };
+
+    if (mGeofencesOnHost) {
+        sendMsg(new MsgRotateGeofences(this, latitude, longitude));
+    }
+}
+
+/* convert a single geofence breach to client ids; the lookup runs on
+   the MsgTask thread, which owns the geofence id maps */
+void LocApiV02 :: reportGeofenceBreach(
+    const qmiLocEventGeofenceBreachIndMsgT_v02 *breach_ptr)
+{
+    struct MsgReportGeofenceBreach : public LocMsg {
+        LocApiV02* mpLocApiV02;
+        qmiLocEventGeofenceBreachIndMsgT_v02 mBreach;
+        inline MsgReportGeofenceBreach(LocApiV02* pLocApiV02,
+            const qmiLocEventGeofenceBreachIndMsgT_v02* pBreach) :
+                   LocMsg(), mpLocApiV02(pLocApiV02), mBreach(*pBreach) {}
+        inline virtual void proc() const {
+            std::unordered_map<uint32_t, uint32_t>::const_iterator it =
+                mpLocApiV02->mGeofenceClientIds.find(mBreach.geofenceId);
+            if (it == mpLocApiV02->mGeofenceClientIds.end()) {
+                LOC_LOGW("%s:%d]: breach for unknown geofence %u",
+                         __func__, __LINE__, mBreach.geofenceId);
+                return;
+            }
+            uint32_t clientId = it->second;
+            if (mBreach.geofencePosition_valid) {
+                mpLocApiV02->rotateGeofences(mBreach.geofencePosition.latitude,
+                                             mBreach.geofencePosition.longitude);
+            }
+            mpLocApiV02->geofenceBreachEvent(&clientId, 1, mBreach.breachType,
+                mBreach.geofencePosition_valid ?
+                    &mBreach.geofencePosition : NULL);
+        }
+    };
+
+    sendMsg(new MsgReportGeofenceBreach(this, breach_ptr));
+}
+
+/* convert a batched geofence breach to client ids and report the whole
+   batch as one breach event */
+void LocApiV02 :: reportGeofenceBatchedBreach(
+    const qmiLocEventGeofenceBatchedBreachIndMsgT_v02 *batched_breach_ptr)
+{
+    struct MsgReportGeofenceBatchedBreach : public LocMsg {
+        LocApiV02* mpLocApiV02;
+        qmiLocEventGeofenceBatchedBreachIndMsgT_v02 mBreach;
+        inline MsgReportGeofenceBatchedBreach(LocApiV02* pLocApiV02,
+            const qmiLocEventGeofenceBatchedBreachIndMsgT_v02* pBreach) :
+                   LocMsg(), mpLocApiV02(pLocApiV02), mBreach(*pBreach) {}
+        inline virtual void proc() const {
+            const std::unordered_map<uint32_t, uint32_t>& ids =
+                mpLocApiV02->mGeofenceClientIds;
+            std::unordered_map<uint32_t, uint32_t>::const_iterator it;
+            uint32_t* clientIds = new uint32_t[ids.size() + 1];
+            size_t count = 0;
+
+            if (mBreach.geofenceIdContinuousList_valid) {
+                for (uint32_t i = 0; i < mBreach.geofenceIdContinuousList_len &&
+                         i < QMI_LOC_MAX_GEOFENCE_ID_CONTINUOUS_LIST_LENGTH_V02; i++) {
+                    uint32_t low = mBreach.geofenceIdContinuousList[i].idLow;
+                    uint32_t high = mBreach.geofenceIdContinuousList[i].idHigh;
+                    if (low > high) {
+                        continue;
+                    }
+                    // a range may span up to 2^32 ids; look up each id
+                    // only when that is fewer than the fences we hold
+                    if ((uint64_t)high - low < ids.size()) {
+                        for (uint64_t id = low; id <= high && count < ids.size(); id++) {
+                            it = ids.find((uint32_t)id);
+                            if (it != ids.end()) {
+                                clientIds[count++] = it->second;
+                            }
+                        }
+                    } else {
+                        for (it = ids.begin(); it != ids.end() && count < ids.size(); ++it) {
+                            if (it->first >= low && it->first <= high) {
+                                clientIds[count++] = it->second;
+                            }
+                        }
+                    }
+                }
+            }
+            if (mBreach.geofenceIdDiscreteList_valid) {
+                for (uint32_t i = 0; i < mBreach.geofenceIdDiscreteList_len &&
+                         i < QMI_LOC_MAX_GEOFENCE_ID_DISCRETE_LIST_LENGTH_V02 &&
+                         count < ids.size(); i++) {
+                    it = ids.find(mBreach.geofenceIdDiscreteList[i]);
+                    if (it != ids.end()) {
+                        clientIds[count++] = it->second;
+                    }
+                }
+            }
+
+            if (mBreach.geofencePosition_valid) {
+                mpLocApiV02->rotateGeofences(mBreach.geofencePosition.latitude,
+                                             mBreach.geofencePosition.longitude);
+            }
+            if (count > 0) {
+                mpLocApiV02->geofenceBreachEvent(clientIds, count,
+                    mBreach.breachType,
+                    mBreach.geofencePosition_valid ?
+                        &mBreach.geofencePosition : NULL);
+            } else {
+                LOC_LOGW("%s:%d]: batched breach for no known geofence",
+                         __func__, __LINE__);
+            }
+            delete[] clientIds;
+        }
+    };
+
+    sendMsg(new MsgReportGeofenceBatchedBreach(this, batched_breach_ptr));
+}
+
+void LocApiV02 :: geofenceBreachEvent(const uint32_t* clientIds, size_t count,
+    qmiLocGeofenceBreachTypeEnumT_v02 breachType,
+    const qmiLocGeofencePositionStructT_v02* position)
+{
+    LOC_LOGD("%s:%d]: %zu geofence(s) breached, type = %d, first id = %u, "
+             "position %s", __func__, __LINE__, count, breachType,
+             count > 0 ? clientIds[0] : 0, position ? "valid" : "invalid");
+}
+
+void LocApiV02 :: geofenceAlertEvent(qmiLocGeofenceGenAlertEnumT_v02 alert)
+{
+    LOC_LOGD("%s:%d]: geofence alert = %d", __func__, __LINE__, alert);
+}
+
+bool LocApiV02 :: injectSensorSample(LocSensorInjector::SensorType type,
+                                     uint32_t timestampMs,
+                                     float x, float y, float z)
+{
+    return mSensorInjector.pushSample(type, timestampMs, x, y, z);
+}
+
+void LocApiV02 :: getSensorInjectionStats(LocSensorInjector::Stats &stats) const
+{
+    mSensorInjector.getStats(stats);
+}
+
+bool LocApiV02 :: injectVehicleSensorSample(LocVehicleInjector::DataType type,
+                                            uint64_t timestampUs,
+                                            qmiLocAxesMaskT_v02 axes,
+                                            const float* values)
+{
+    return mVehicleInjector.pushSensorSample(type, timestampUs, axes, values);
+}
+
+bool LocApiV02 :: injectVehicleOdometrySample(uint64_t timestampUs,
+    qmiLocVehicleOdometryWheelFlagsMaskT_v02 wheels,
+    qmiLocVehicleOdometryMeasDeviationMaskType_v02 flags,
+    const uint64_t* distanceMm)
+{
+    return mVehicleInjector.pushOdometrySample(timestampUs, wheels, flags,
+                                               distanceMm);
+}
+
+void LocApiV02 :: getVehicleInjectionStats(LocVehicleInjector::Stats &stats) const
+{
+    mVehicleInjector.getStats(stats);
+}
+
+void LocApiV02 :: timeSyncRequest(uint32_t refCounter, uint64_t rxNs)
+{
+    mTimeSyncResponder.request(refCounter, rxNs);
+}
+
+void LocApiV02 :: getTimeSyncStats(LocTimeSyncResponder::Stats &stats) const
+{
+    mTimeSyncResponder.getStats(stats);
+}
+
+void LocApiV02 :: wifiRequestEvent(const qmiLocEventWifiReqIndMsgT_v02* request)
+{
+    LOC_LOGD("%s:%d]: wifi request = %d, tbf %s %u ms", __func__, __LINE__,
+             request->requestType, request->tbfInMs_valid ? "=" : "unset",
+             request->tbfInMs);
+}
+
+void LocApiV02 :: wifiApDataRequestEvent()
+{
+    LOC_LOGD("%s:%d]: wifi AP data requested", __func__, __LINE__);
+}
+
+void LocApiV02 :: epochCb(const LocEpochAssembler::Epoch& epoch, void* context)
+{
+    ((LocApiV02*)context)->reportEpoch(epoch);
+}
+
+void LocApiV02 :: reportEpoch(const LocEpochAssembler::Epoch& epoch)
+{
+    if (epoch.hasSv) {
+        GpsSvStatus svStatus = epoch.svStatus;
+        GpsLocationExtended svExtended = epoch.svExtended;
+        LocTraceSpan span(LOC_TRACE_REPORT_SV);
+        LocApiBase::reportSv(svStatus, svExtended, (void*)epoch.svReport);
+    }
+    for (size_t i = 0; i < epoch.nmeaCount; i++) {
+        size_t length;
+        const char* nmea = epoch.nmea(i, length);
+        LocTraceSpan span(LOC_TRACE_REPORT_NMEA);
+        LocApiBase::reportNmea(nmea, (int)length);
+    }
+    if (epoch.hasPosition) {
+        UlpLocation location = epoch.location;
+        GpsLocationExtended locationExtended = epoch.locationExtended;
+        LocTraceSpan span(LOC_TRACE_REPORT_POSITION);
+        LocApiBase::reportPosition(location, locationExtended,
+                                   (void*)epoch.positionReport,
+                                   epoch.status, epoch.techMask);
+    }
+}
+
+void LocApiV02 :: setEpochAssembly(bool enabled, uint32_t timeoutMs)
+{
+    mEpochAssembler.setTimeout(timeoutMs);
+    mEpochAssembly = enabled;
+    if (!enabled) {
+        mEpochAssembler.flush();
+    }
+}
+
+void LocApiV02 :: getEpochAssemblyStats(LocEpochAssembler::Stats &stats) const
+{
+    mEpochAssembler.getStats(stats);
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+injectWifiApData(const qmiLocWifiApDataStructT_v02* aps, size_t count)
+{
+    bool skipped;
+
+    if (NULL == aps && count > 0) {
+        return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+    }
+    return convertErr(mWifiInjector.inject(aps, count, skipped));
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+notifyWifiStatus(qmiLocWifiStatusEnumT_v02 wifiStatus)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocNotifyWifiStatusReqMsgT_v02 statusReq;
+    qmiLocNotifyWifiStatusIndMsgT_v02 statusInd;
+
+    memset(&statusReq, 0, sizeof(statusReq));
+    memset(&statusInd, 0, sizeof(statusInd));
+
+    statusReq.wifiStatus = wifiStatus;
+    req_union.pNotifyWifiStatusReq = &statusReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_NOTIFY_WIFI_STATUS_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_NOTIFY_WIFI_STATUS_IND_V02,
+                               &statusInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != statusInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, statusInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(statusInd.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiV02 ::
+notifyWifiAttachmentStatus(qmiLocWifiAccessPointAttachStatesEnumT_v02 attachState,
+                           const uint8_t* mac, const char* ssid)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocNotifyWifiAttachmentStatusReqMsgT_v02 attachReq;
+    qmiLocNotifyWifiAttachmentStatusIndMsgT_v02 attachInd;
+
+    if (eQMI_LOC_WIFI_ACCESS_POINT_HANDOVER_V02 == attachState && NULL == mac) {
+        LOC_LOGE("%s:%d]: handover without AP address", __func__, __LINE__);
+        return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+    }
+
+    memset(&attachReq, 0, sizeof(attachReq));
+    memset(&attachInd, 0, sizeof(attachInd));
+
+    attachReq.attachState = attachState;
+    if (NULL != mac) {
+        attachReq.accessPointMacAddress_valid = 1;
+        memcpy(attachReq.accessPointMacAddress, mac,
+               QMI_LOC_WIFI_MAC_ADDR_LENGTH_V02);
+    }
+    if (NULL != ssid) {
+        attachReq.wifiApSsid_valid = 1;
+        strlcpy(attachReq.wifiApSsid, ssid, sizeof(attachReq.wifiApSsid));
+    }
+    req_union.pNotifyWifiAttachmentStatusReq = &attachReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_NOTIFY_WIFI_ATTACHMENT_STATUS_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_NOTIFY_WIFI_ATTACHMENT_STATUS_IND_V02,
+                               &attachInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != attachInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, attachInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(attachInd.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiV02 :: notifyWifiEnabledStatus(bool enabled)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocNotifyWifiEnabledStatusReqMsgT_v02 enabledReq;
+    qmiLocNotifyWifiEnabledStatusIndMsgT_v02 enabledInd;
+
+    // the first scan after Wi-Fi comes back is always sent
+    mWifiInjector.invalidate();
+
+    memset(&enabledReq, 0, sizeof(enabledReq));
+    memset(&enabledInd, 0, sizeof(enabledInd));
+
+    enabledReq.enabledStatus = enabled ?
+        eQMI_LOC_WIFI_ENABLED_TRUE_V02 : eQMI_LOC_WIFI_ENABLED_FALSE_V02;
+    req_union.pNotifyWifiEnabledStatusReq = &enabledReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_NOTIFY_WIFI_ENABLED_STATUS_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_NOTIFY_WIFI_ENABLED_STATUS_IND_V02,
+                               &enabledInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != enabledInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, enabledInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(enabledInd.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            convertErr(status) : LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+void LocApiV02 :: getWifiInjectionStats(LocWifiInjector::Stats &stats) const
+{
+    mWifiInjector.getStats(stats);
+}
+
+void LocApiV02 :: injectServingCell(const LocCellInjector::Cell &cell)
+{
+    mCellInjector.update(cell);
+}
+
+void LocApiV02 :: notifyWwanOutOfService()
+{
+    LocCellInjector::Cell cell;
+
+    memset(&cell, 0, sizeof(cell));
+    cell.type = LocCellInjector::CELL_OUT_OF_SERVICE;
+    mCellInjector.update(cell);
+}
+
+void LocApiV02 :: getCellInjectionStats(LocCellInjector::Stats &stats) const
+{
+    mCellInjector.getStats(stats);
+}
+
+void LocApiV02 :: subscribeNmea(uint32_t consumerId,
+                                qmiLocNmeaSentenceMaskT_v02 types)
+{
+    struct MsgSubscribeNmea : public LocMsg {
+        LocApiV02* mpLocApiV02;
+        uint32_t mConsumerId;
+        qmiLocNmeaSentenceMaskT_v02 mTypes;
+        inline MsgSubscribeNmea(LocApiV02* pLocApiV02, uint32_t consumerId,
+                                qmiLocNmeaSentenceMaskT_v02 types) :
+                   LocMsg(), mpLocApiV02(pLocApiV02),
+                   mConsumerId(consumerId), mTypes(types) {}
+        inline virtual void proc() const {
+            if (0 == mTypes) {
+                mpLocApiV02->mNmeaSubscriptions.erase(mConsumerId);
+            } else {
+                mpLocApiV02->mNmeaSubscriptions[mConsumerId] = mTypes;
+            }
+            mpLocApiV02->mNmeaManaged = true;
+            mpLocApiV02->applyNmeaSubscriptions();
+        }
+    };
+    sendMsg(new MsgSubscribeNmea(this, consumerId, types));
+}
+
+void LocApiV02 :: unsubscribeNmea(uint32_t consumerId)
+{
+    subscribeNmea(consumerId, 0);
+}
+
+void LocApiV02 :: setNmeaSynthesis(bool enabled)
+{
+    struct MsgSetNmeaSynthesis : public LocMsg {
+        LocApiV02* mpLocApiV02;
+        bool mEnabled;
+        inline MsgSetNmeaSynthesis(LocApiV02* pLocApiV02, bool enabled) :
+                   LocMsg(), mpLocApiV02(pLocApiV02), mEnabled(enabled) {}
+        inline virtual void proc() const {
+            if (mEnabled != mpLocApiV02->mNmeaSynthesis) {
+                mpLocApiV02->mNmeaSynthesis = mEnabled;
+                mpLocApiV02->registerEventMask(mpLocApiV02->mQmiMask);
+            }
+        }
+    };
+    sendMsg(new MsgSetNmeaSynthesis(this, enabled));
+}
+
+/* push the union of the subscribed NMEA types to the modem, unless the
+   modem already has them, and switch the NMEA event on or off */
+void LocApiV02 :: applyNmeaSubscriptions()
+{
+    qmiLocNmeaSentenceMaskT_v02 types = 0;
+    std::unordered_map<uint32_t, qmiLocNmeaSentenceMaskT_v02>::const_iterator it;
+
+    if (!mNmeaManaged || LOC_CLIENT_INVALID_HANDLE_VALUE == clientHandle) {
+        return;
+    }
+
+    for (it = mNmeaSubscriptions.begin(); it != mNmeaSubscriptions.end(); ++it) {
+        types |= it->second;
+    }
+    LOC_LOGD("%s:%d]: %zu subscriber(s), types = 0x%x",
+             __func__, __LINE__, mNmeaSubscriptions.size(), types);
+
+    if (0 != types) {
+        if (!mModemNmeaTypesValid) {
+            mModemNmeaTypesValid = getModemNmeaTypes(mModemNmeaTypes);
+        }
+        if (!mModemNmeaTypesValid || mModemNmeaTypes != types) {
+            mModemNmeaTypesValid = setModemNmeaTypes(types);
+            mModemNmeaTypes = types;
+        }
+    }
+
+    bool eventOff = (0 == types);
+    if (eventOff != mNmeaEventOff) {
+        mNmeaEventOff = eventOff;
+        registerEventMask(mQmiMask);
+    }
+}
+
+bool LocApiV02 :: getModemNmeaTypes(qmiLocNmeaSentenceMaskT_v02 &types)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocGetNmeaTypesIndMsgT_v02 getNmeaInd;
+
+    memset(&getNmeaInd, 0, sizeof(getNmeaInd));
+
+    // no payload, req_union is only passed along
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_GET_NMEA_TYPES_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_GET_NMEA_TYPES_IND_V02,
+                               &getNmeaInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != getNmeaInd.status ||
+        !getNmeaInd.nmeaSentenceType_valid)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, getNmeaInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(getNmeaInd.status));
+        return false;
+    }
+    types = getNmeaInd.nmeaSentenceType;
+    return true;
+}
+
+bool LocApiV02 :: setModemNmeaTypes(qmiLocNmeaSentenceMaskT_v02 types)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocSetNmeaTypesReqMsgT_v02 setNmeaReq;
+    qmiLocSetNmeaTypesIndMsgT_v02 setNmeaInd;
+
+    memset(&setNmeaReq, 0, sizeof(setNmeaReq));
+    memset(&setNmeaInd, 0, sizeof(setNmeaInd));
+
+    setNmeaReq.nmeaSentenceType = types;
+    req_union.pSetNmeaTypesReq = &setNmeaReq;
+
+    status = loc_sync_send_req(clientHandle,
+                               QMI_LOC_SET_NMEA_TYPES_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_SET_NMEA_TYPES_IND_V02,
+                               &setNmeaInd);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != setNmeaInd.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, setNmeaInd.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(setNmeaInd.status));
+        return false;
+    }
+    return true;
 }
@@ -31,7 +31,20 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <atomic>
+#include <unordered_map>
 #include "ds_client.h"
+#include "LocGeofenceStore.h"
+#include "LocSensorInjector.h"
+#include "LocVehicleInjector.h"
+#include "LocTimeSyncResponder.h"
+#include "LocWifiInjector.h"
+#include "LocCellInjector.h"
+#include "LocZppCache.h"
+#include "LocXtraManager.h"
+#include "LocNmeaGenerator.h"
+#include "LocEpochAssembler.h"
+#include "LocAtlBroker.h"
 #include <LocApiBase.h>
 #include <loc_api_v02_client.h>
 
@@ -50,6 +63,10 @@ protected:
 private:
   /*ds client handle*/
   dsClientHandleType dsClientHandle;
+  /* bring the SUPL ES data call up on the emergency NI notification,
+     see setDataCallPrewarm */
+  std::atomic<bool> mDataCallPrewarm;
+  std::atomic<uint32_t> mDataCallPrewarmGraceMs;
 
   /* Convert event mask from loc eng to loc_api_v02 format */
   static locClientEventMaskType convertMask(LOC_API_ADAPTER_EVENT_MASK_T mask);
@@ -104,12 +121,38 @@ private:
   void reportXtraServerUrl(
     const qmiLocEventInjectPredictedOrbitsReqIndMsgT_v02* server_request_ptr);
 
+  /* convert geofence breach report, single or batched, to client
+     geofence ids and report it */
+  void reportGeofenceBreach(
+    const qmiLocEventGeofenceBreachIndMsgT_v02 *breach_ptr);
+  void reportGeofenceBatchedBreach(
+    const qmiLocEventGeofenceBatchedBreachIndMsgT_v02 *batched_breach_ptr);
+
 protected:
   virtual enum loc_api_adapter_err
     open(LOC_API_ADAPTER_EVENT_MASK_T mask);
   virtual enum loc_api_adapter_err
     close();
 
+  /* geofence breach with the modem geofence ids already resolved to
+     client ids. A batched breach from the modem is delivered as one
+     call. Derived classes override this to forward the breach. */
+  virtual void geofenceBreachEvent(const uint32_t* clientIds, size_t count,
+    qmiLocGeofenceBreachTypeEnumT_v02 breachType,
+    const qmiLocGeofencePositionStructT_v02* position);
+
+  /* geofence general alert, e.g. GNSS unavailable */
+  virtual void geofenceAlertEvent(qmiLocGeofenceGenAlertEnumT_v02 alert);
+
+  /* modem requests for Wi-Fi fixes and for Wi-Fi AP scan data; derived
+     classes override these to start or stop scanning */
+  virtual void wifiRequestEvent(const qmiLocEventWifiReqIndMsgT_v02* request);
+  virtual void wifiApDataRequestEvent();
+
+  /* an assembled GNSS epoch, from the assembler thread. The default
+     reports the SV, NMEA and position reports it holds to loc eng. */
+  virtual void reportEpoch(const LocEpochAssembler::Epoch& epoch);
+
 public:
   LocApiV02(const MsgTask* msgTask,
             LOC_API_ADAPTER_EVENT_MASK_T exMask,
@@ -154,6 +197,9 @@ public:
     setServer(unsigned int ip, int port, LocServerType type);
   virtual enum loc_api_adapter_err
     setXtraData(char* data, int length);
+  /* inject an XTRA file straight from a read-only mapping of it */
+  enum loc_api_adapter_err setXtraDataFile(int fd);
+  enum loc_api_adapter_err setXtraDataFile(const char* path);
   virtual enum loc_api_adapter_err
     requestXtraServer();
   virtual enum loc_api_adapter_err
@@ -188,6 +234,7 @@ public:
       getBestAvailableZppFix(GpsLocation & zppLoc, LocPosTechMask & tech_mask);
   virtual int initDataServiceClient();
   virtual int openAndStartDataCall();
+  void prewarmDataCall();
   virtual void stopDataCall();
   virtual void closeDataCall();
   virtual int setGpsLock(LOC_GPS_LOCK_MASK lock);
@@ -205,11 +252,213 @@ public:
                                size_t length,
                                uint32_t slotBitMask);
 
+  /* certificate slot operations of installAGpsCert; slots whose
+     content is unchanged since we last wrote them are skipped */
+  struct CertInstallStats {
+    uint64_t fullSyncs;
+    uint64_t injected;
+    uint64_t deleted;
+    uint64_t skipped;
+    uint64_t failed;
+  };
+  void getCertInstallStats(CertInstallStats &stats) const;
+
+  /* circular geofences, identified by the client assigned id;
+     a zero breachMask, responsiveness or state on edit leaves
+     that parameter unchanged. Fences beyond the modem capacity are
+     kept on the host and rotated into the modem as the device moves. */
+  virtual enum loc_api_adapter_err
+    addGeofence(uint32_t clientId, double latitude, double longitude,
+                uint32_t radius, qmiLocGeofenceBreachMaskT_v02 breachMask,
+                qmiLocGeofenceResponsivenessEnumT_v02 responsiveness);
+  virtual enum loc_api_adapter_err
+    editGeofence(uint32_t clientId, qmiLocGeofenceBreachMaskT_v02 breachMask,
+                 qmiLocGeofenceResponsivenessEnumT_v02 responsiveness,
+                 qmiLocGeofenceStateEnumT_v02 state);
+  virtual enum loc_api_adapter_err deleteGeofence(uint32_t clientId);
+  virtual enum loc_api_adapter_err
+    queryGeofence(uint32_t clientId, qmiLocQueryGeofenceIndMsgT_v02 &queryInd);
+
+  /* queue one accelerometer, gyroscope or magnetometer sample for
+     injection; callable from any thread, never blocks */
+  bool injectSensorSample(LocSensorInjector::SensorType type,
+                          uint32_t timestampMs, float x, float y, float z);
+  void getSensorInjectionStats(LocSensorInjector::Stats &stats) const;
+
+  /* queue vehicle acceleration, angular rate or odometry samples for
+     injection; see LocVehicleInjector for the sample layout */
+  bool injectVehicleSensorSample(LocVehicleInjector::DataType type,
+                                 uint64_t timestampUs,
+                                 qmiLocAxesMaskT_v02 axes,
+                                 const float* values);
+  bool injectVehicleOdometrySample(uint64_t timestampUs,
+    qmiLocVehicleOdometryWheelFlagsMaskT_v02 wheels,
+    qmiLocVehicleOdometryMeasDeviationMaskType_v02 flags,
+    const uint64_t* distanceMm);
+  void getVehicleInjectionStats(LocVehicleInjector::Stats &stats) const;
+
+  /* modem time sync request received at rxNs sensor time; called from
+     the QMI callback thread, bypassing eventCb and the MsgTask queue */
+  void timeSyncRequest(uint32_t refCounter, uint64_t rxNs);
+  void getTimeSyncStats(LocTimeSyncResponder::Stats &stats) const;
+
+  /* Wi-Fi AP scan injection, split into messages of up to 50 APs; a
+     scan unchanged since the last one is not sent again */
+  virtual enum loc_api_adapter_err
+    injectWifiApData(const qmiLocWifiApDataStructT_v02* aps, size_t count);
+  virtual enum loc_api_adapter_err
+    notifyWifiStatus(qmiLocWifiStatusEnumT_v02 wifiStatus);
+  /* mac and ssid are optional, NULL if not known */
+  virtual enum loc_api_adapter_err
+    notifyWifiAttachmentStatus(qmiLocWifiAccessPointAttachStatesEnumT_v02 attachState,
+                               const uint8_t* mac, const char* ssid);
+  virtual enum loc_api_adapter_err notifyWifiEnabledStatus(bool enabled);
+  void getWifiInjectionStats(LocWifiInjector::Stats &stats) const;
+
+  /* serving cell updates from the platform; only changes, or a repeat
+     of a stale cell, are injected, at most once per second */
+  void injectServingCell(const LocCellInjector::Cell &cell);
+  void notifyWwanOutOfService();
+  void getCellInjectionStats(LocCellInjector::Stats &stats) const;
+
+  /* ZPP fixes are served from a cache, see LocZppCache */
+  void setZppCacheTtl(LocPosTechMask techMask, uint32_t ttlMs);
+  void setZppCacheMaxStale(uint32_t maxStaleMs);
+  void getZppCacheStats(LocZppCache::Stats &stats) const;
+
+  /* XTRA data is only injected when the modem needs it, and refreshed
+     before less than horizonHours of validity is left */
+  void setXtraHorizon(uint32_t horizonHours);
+  void getXtraStats(LocXtraManager::Stats &stats) const;
+
+  /* NMEA sentence subscriptions, per consumer id. The modem is set to
+     emit the union of the subscribed types, and the NMEA event is off
+     while no consumer is subscribed. Until the first subscription the
+     modem default types are left alone. */
+  void subscribeNmea(uint32_t consumerId, qmiLocNmeaSentenceMaskT_v02 types);
+  void unsubscribeNmea(uint32_t consumerId);
+
+  /* build NMEA on the host from the position and SV reports instead of
+     receiving the modem NMEA event, which is then deregistered */
+  void setNmeaSynthesis(bool enabled);
+
+  /* deliver the position, SV and NMEA reports of a GNSS epoch together
+     through reportEpoch(), instead of one by one as they arrive */
+  void setEpochAssembly(bool enabled, uint32_t timeoutMs);
+  void getEpochAssemblyStats(LocEpochAssembler::Stats &stats) const;
+
+  /* start the emergency data call when an emergency NI notification
+     arrives, ahead of the ATL request. It is handed to that request, or
+     torn down if none comes within graceMs. Timing is kept by
+     ds_client_get_prewarm_stats. */
+  void setDataCallPrewarm(bool enabled, uint32_t graceMs);
+
+  /* ATL connections are shared between the modem server connection
+     requests, and kept for lingerMs after their last close for the
+     next request, see LocAtlBroker */
+  void setAtlLinger(uint32_t lingerMs);
+  void getAtlBrokerStats(LocAtlBroker::Stats &stats) const;
+
 private:
   locClientEventMaskType mQmiMask = 0;
   bool mInSession = false;
   bool mEngineOn = false;
 
+  /* all client geofences, and the id maps, modem id to client id and
+     client id to modem id, of the subset programmed into the modem.
+     Only accessed from the MsgTask thread. */
+  LocGeofenceStore mGeofenceStore;
+  std::unordered_map<uint32_t, uint32_t> mGeofenceClientIds;
+  std::unordered_map<uint32_t, uint32_t> mGeofenceModemIds;
+  uint32_t mGeofenceTransactionId = 0;
+  /* modem geofence capacity, learned when an add is rejected */
+  size_t mGeofenceCapacity = SIZE_MAX;
+  /* store grid cell of the last rotation */
+  uint64_t mGeofenceCell = UINT64_MAX;
+  /* the store holds fences the modem does not; read on the QMI callback
+     thread so fixes do not post a rotation that has nothing to do */
+  std::atomic<bool> mGeofencesOnHost{false};
+
+  /* NMEA subscriptions, and the sentence types last read from or set
+     in the modem. Only accessed from the MsgTask thread. */
+  std::unordered_map<uint32_t, qmiLocNmeaSentenceMaskT_v02> mNmeaSubscriptions;
+  bool mNmeaManaged = false;
+  bool mNmeaEventOff = false;
+  bool mModemNmeaTypesValid = false;
+  qmiLocNmeaSentenceMaskT_v02 mModemNmeaTypes = 0;
+
+  /* SUPL certificate slots as last written by installAGpsCert, slots
+     not in mCertSlotsKnown are synced on the next install. Only
+     accessed from the MsgTask thread. */
+  uint32_t mCertSlotsKnown = 0;
+  uint32_t mCertSlotsEmpty = 0;
+  size_t mCertSlotLengths[AGPS_CERTIFICATE_MAX_SLOTS];
+  uint64_t mCertSlotDigests[AGPS_CERTIFICATE_MAX_SLOTS];
+  CertInstallStats mCertInstallStats = CertInstallStats();
+
+  LocSensorInjector mSensorInjector;
+  LocVehicleInjector mVehicleInjector;
+  LocTimeSyncResponder mTimeSyncResponder;
+  LocWifiInjector mWifiInjector;
+  LocCellInjector mCellInjector;
+  LocZppCache mZppCache;
+  LocXtraManager mXtraManager;
+  LocAtlBroker mAtlBroker;
+  /* set on the MsgTask thread, read on the QMI callback thread, where
+     the generator is used */
+  std::atomic<bool> mNmeaSynthesis;
+  LocNmeaGenerator mNmeaGenerator;
+  std::atomic<bool> mEpochAssembly;
+  /* last, so no epoch is delivered while the other members go away */
+  LocEpochAssembler mEpochAssembler;
+
+  void mapGeofence(uint32_t modemId, uint32_t clientId);
+  void unmapGeofence(uint32_t clientId);
+  bool getModemGeofenceId(uint32_t clientId, uint32_t &modemId);
+  void updateGeofencesOnHost();
+  void fillGeofenceAddReq(const LocGeofenceStore::Fence& fence,
+                          qmiLocAddCircularGeofenceReqMsgT_v02 &addReq);
+  enum loc_api_adapter_err
+    geofenceAdded(const LocGeofenceStore::Fence& fence,
+                  locClientStatusEnumType status,
+                  const qmiLocAddCircularGeofenceIndMsgT_v02 &addInd,
+                  bool &modemFull);
+  bool fillGeofenceDeleteReq(uint32_t clientId,
+                             qmiLocDeleteGeofenceReqMsgT_v02 &deleteReq);
+  enum loc_api_adapter_err
+    geofenceDeleted(uint32_t clientId, locClientStatusEnumType status,
+                    const qmiLocDeleteGeofenceIndMsgT_v02 &deleteInd);
+  enum loc_api_adapter_err
+    modemAddGeofence(const LocGeofenceStore::Fence& fence, bool &modemFull);
+  enum loc_api_adapter_err modemDeleteGeofence(uint32_t clientId);
+  void rotateGeofences(double latitude, double longitude);
+  void updateGeofencePosition(double latitude, double longitude);
+
+  static enum loc_api_adapter_err
+    zppFetch(void* context, LocZppCache::Source source,
+             GpsLocation &zppLoc, LocPosTechMask &tech_mask);
+  static void xtraRefreshCb(void* context);
+  static void atlReleaseCb(int id, void* context);
+  enum loc_api_adapter_err
+    informAtlOpenStatus(int handle, int is_succ, const char* apn,
+                        AGpsBearerType bear);
+  enum loc_api_adapter_err informAtlCloseStatus(int handle, int is_succ);
+  enum loc_api_adapter_err injectXtraData(const char* data, int length);
+  enum loc_api_adapter_err fetchWwanZppFix(GpsLocation &zppLoc,
+                                           LocPosTechMask &tech_mask);
+  enum loc_api_adapter_err fetchBestAvailableZppFix(GpsLocation &zppLoc,
+                                                    LocPosTechMask &tech_mask);
+
+  bool injectSuplCert(uint8_t slot, const unsigned char* data, size_t length);
+  bool deleteSuplCert(uint8_t slot);
+
+  void applyNmeaSubscriptions();
+  void reportSynthesizedNmea();
+  static void epochCb(const LocEpochAssembler::Epoch& epoch, void* context);
+  bool getModemNmeaTypes(qmiLocNmeaSentenceMaskT_v02 &types);
+  bool setModemNmeaTypes(qmiLocNmeaSentenceMaskT_v02 types);
+  locClientEventMaskType adjustMaskForNmea(locClientEventMaskType qmiMask);
+
   bool registerEventMask(locClientEventMaskType qmiMask);
   locClientEventMaskType adjustMaskForNoSession(locClientEventMaskType qmiMask);
 };
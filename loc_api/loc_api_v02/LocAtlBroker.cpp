@@ -0,0 +1,385 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_AtlBroker"
+
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <LocAtlBroker.h>
+#include <loc_api_v02_log.h>
+#include <loc_util_log.h>
+
+using namespace loc_core;
+
+/* ids handed to loc eng, apart from the modem handles */
+#define FIRST_CONNECTION_ID 0x10000
+#define US_PER_MS 1000ULL
+
+static uint64_t monotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void removeHandle(std::vector<int>& handles, int handle)
+{
+    handles.erase(std::remove(handles.begin(), handles.end(), handle),
+                  handles.end());
+}
+
+LocAtlBroker :: LocAtlBroker(ReleaseFn release, void* context) :
+    mRelease(release),
+    mContext(context),
+    mThreadStarted(false),
+    mStop(false),
+    mNextId(FIRST_CONNECTION_ID),
+    mLingerMs(0),
+    mOpens(0),
+    mBringUps(0),
+    mBringUpTotalUs(0),
+    mBringUpMaxUs(0),
+    mReused(0),
+    mJoined(0),
+    mSavedTotalUs(0),
+    mLingerExpired(0)
+{
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    mThreadStarted = (0 == pthread_create(&mThread, NULL, threadMain, this));
+    if (!mThreadStarted) {
+        LOC_LOGE("%s:%d]: failed to start linger thread",
+                 __func__, __LINE__);
+    }
+}
+
+LocAtlBroker :: ~LocAtlBroker()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocAtlBroker :: setLinger(uint32_t lingerMs)
+{
+    pthread_mutex_lock(&mMutex);
+    // without the linger thread, connections are released at once
+    mLingerMs = mThreadStarted ? lingerMs : 0;
+    pthread_mutex_unlock(&mMutex);
+}
+
+/* called with mMutex held. Takes handle off its connection; a
+   connection left without handles lingers. */
+void LocAtlBroker :: detach(int handle)
+{
+    std::unordered_map<int, int>::iterator it = mHandles.find(handle);
+    if (it == mHandles.end()) {
+        return;
+    }
+    std::unordered_map<int, Connection>::iterator conn =
+        mConnections.find(it->second);
+    mHandles.erase(it);
+    if (conn == mConnections.end()) {
+        return;
+    }
+    Connection& c = conn->second;
+    removeHandle(c.handles, handle);
+    removeHandle(c.waiting, handle);
+    if (STATE_OPEN == c.state && c.handles.empty()) {
+        c.state = STATE_LINGERING;
+        c.lingerUntilUs = monotonicUs() + mLingerMs * US_PER_MS;
+        pthread_cond_broadcast(&mCond);
+    }
+}
+
+LocAtlBroker::OpenAction
+LocAtlBroker :: open(int handle, AGpsType type, Answer& answer)
+{
+    OpenAction action = OPEN_REQUEST;
+
+    mOpens++;
+    pthread_mutex_lock(&mMutex);
+    if (mHandles.count(handle) > 0) {
+        LOC_LOGE("%s:%d]: handle %d opened again without a close",
+                 __func__, __LINE__, handle);
+        detach(handle);
+    }
+
+    std::unordered_map<int, Connection>::iterator it;
+    for (it = mConnections.begin(); it != mConnections.end(); ++it) {
+        Connection& c = it->second;
+        if (c.type != type) {
+            continue;
+        }
+        if (STATE_OPEN == c.state || STATE_LINGERING == c.state) {
+            c.state = STATE_OPEN;
+            c.handles.push_back(handle);
+            answer.id = it->first;
+            strlcpy(answer.apn, c.apn, sizeof(answer.apn));
+            answer.bearer = c.bearer;
+            mReused++;
+            mSavedTotalUs += c.bringUpUs;
+            action = OPEN_ANSWER;
+            break;
+        }
+        if (STATE_OPENING == c.state) {
+            c.waiting.push_back(handle);
+            answer.id = it->first;
+            mJoined++;
+            action = OPEN_WAIT;
+            break;
+        }
+    }
+
+    if (OPEN_REQUEST == action) {
+        int id = mNextId;
+        mNextId = (mNextId == INT32_MAX) ? FIRST_CONNECTION_ID : mNextId + 1;
+
+        Connection& c = mConnections[id];
+        c.type = type;
+        c.state = STATE_OPENING;
+        c.apn[0] = '\0';
+        c.bearer = AGPS_APN_BEARER_INVALID;
+        c.waiting.push_back(handle);
+        c.requestUs = monotonicUs();
+        c.bringUpUs = 0;
+        c.lingerUntilUs = 0;
+        c.closeHandle = -1;
+        answer.id = id;
+    }
+    mHandles[handle] = answer.id;
+    pthread_mutex_unlock(&mMutex);
+
+    LOC_LOGD("%s:%d]: handle %d, type %d, connection %d, action %d",
+             __func__, __LINE__, handle, type, answer.id, action);
+    return action;
+}
+
+bool LocAtlBroker :: opened(int id, bool success, const char* apn,
+                            AGpsBearerType bearer, std::vector<int>& handles)
+{
+    pthread_mutex_lock(&mMutex);
+    std::unordered_map<int, Connection>::iterator it = mConnections.find(id);
+    if (it == mConnections.end()) {
+        pthread_mutex_unlock(&mMutex);
+        return false;
+    }
+    Connection& c = it->second;
+    if (STATE_OPENING != c.state) {
+        // released meanwhile, nobody is waiting for it
+        pthread_mutex_unlock(&mMutex);
+        return true;
+    }
+
+    handles.swap(c.waiting);
+    c.waiting.clear();
+    if (success) {
+        uint64_t bringUpUs = monotonicUs() - c.requestUs;
+        uint64_t maxUs = mBringUpMaxUs;
+        while (bringUpUs > maxUs &&
+               !mBringUpMaxUs.compare_exchange_weak(maxUs, bringUpUs)) {
+        }
+        mBringUpTotalUs += bringUpUs;
+        mBringUps++;
+
+        c.bringUpUs = bringUpUs;
+        strlcpy(c.apn, (NULL != apn) ? apn : "", sizeof(c.apn));
+        c.bearer = bearer;
+        c.handles = handles;
+        if (c.handles.empty()) {
+            c.state = STATE_LINGERING;
+            c.lingerUntilUs = monotonicUs() + mLingerMs * US_PER_MS;
+            pthread_cond_broadcast(&mCond);
+        } else {
+            c.state = STATE_OPEN;
+        }
+    } else {
+        for (size_t i = 0; i < handles.size(); i++) {
+            mHandles.erase(handles[i]);
+        }
+        mConnections.erase(it);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+LocAtlBroker::CloseAction LocAtlBroker :: close(int handle, int& id)
+{
+    CloseAction action = CLOSE_ANSWER;
+
+    pthread_mutex_lock(&mMutex);
+    std::unordered_map<int, int>::iterator it = mHandles.find(handle);
+    if (it == mHandles.end()) {
+        pthread_mutex_unlock(&mMutex);
+        return CLOSE_PASS;
+    }
+    id = it->second;
+    std::unordered_map<int, Connection>::iterator conn = mConnections.find(id);
+    if (conn != mConnections.end()) {
+        Connection& c = conn->second;
+        bool last = (1 == c.handles.size() + c.waiting.size());
+        if (last && STATE_CLOSING != c.state &&
+            (0 == mLingerMs || STATE_OPENING == c.state)) {
+            // nothing to keep, release it like loc eng always did
+            mHandles.erase(it);
+            c.handles.clear();
+            c.waiting.clear();
+            c.state = STATE_CLOSING;
+            c.closeHandle = handle;
+            action = CLOSE_RELEASE;
+        } else {
+            detach(handle);
+        }
+    } else {
+        mHandles.erase(it);
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOC_LOGD("%s:%d]: handle %d, connection %d, action %d",
+             __func__, __LINE__, handle, id, action);
+    return action;
+}
+
+bool LocAtlBroker :: closed(int id, int& handle)
+{
+    pthread_mutex_lock(&mMutex);
+    std::unordered_map<int, Connection>::iterator it = mConnections.find(id);
+    if (it == mConnections.end()) {
+        pthread_mutex_unlock(&mMutex);
+        return false;
+    }
+    handle = it->second.closeHandle;
+    mConnections.erase(it);
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+void LocAtlBroker :: reset()
+{
+    std::vector<int> ids;
+
+    pthread_mutex_lock(&mMutex);
+    mHandles.clear();
+    std::unordered_map<int, Connection>::iterator it;
+    for (it = mConnections.begin(); it != mConnections.end(); ++it) {
+        Connection& c = it->second;
+        c.handles.clear();
+        c.waiting.clear();
+        c.closeHandle = -1;
+        if (STATE_CLOSING != c.state) {
+            c.state = STATE_CLOSING;
+            ids.push_back(it->first);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        mRelease(ids[i], mContext);
+    }
+}
+
+void LocAtlBroker :: getStats(Stats& stats) const
+{
+    stats.opens = mOpens;
+    stats.bringUps = mBringUps;
+    stats.bringUpTotalUs = mBringUpTotalUs;
+    stats.bringUpMaxUs = mBringUpMaxUs;
+    stats.reused = mReused;
+    stats.joined = mJoined;
+    stats.savedTotalUs = mSavedTotalUs;
+    stats.lingerExpired = mLingerExpired;
+}
+
+void* LocAtlBroker :: threadMain(void* arg)
+{
+    ((LocAtlBroker*)arg)->run();
+    return NULL;
+}
+
+void LocAtlBroker :: run()
+{
+    std::vector<int> ids;
+
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        uint64_t nowUs = monotonicUs();
+        uint64_t nextUs = UINT64_MAX;
+
+        std::unordered_map<int, Connection>::iterator it;
+        for (it = mConnections.begin(); it != mConnections.end(); ++it) {
+            Connection& c = it->second;
+            if (STATE_LINGERING != c.state) {
+                continue;
+            }
+            if (c.lingerUntilUs <= nowUs) {
+                c.state = STATE_CLOSING;
+                c.closeHandle = -1;
+                ids.push_back(it->first);
+            } else if (c.lingerUntilUs < nextUs) {
+                nextUs = c.lingerUntilUs;
+            }
+        }
+
+        if (!ids.empty()) {
+            pthread_mutex_unlock(&mMutex);
+            for (size_t i = 0; i < ids.size(); i++) {
+                LOC_LOGD("%s:%d]: connection %d not used again, released",
+                         __func__, __LINE__, ids[i]);
+                mLingerExpired++;
+                mRelease(ids[i], mContext);
+            }
+            ids.clear();
+            pthread_mutex_lock(&mMutex);
+            continue;
+        }
+
+        if (UINT64_MAX == nextUs) {
+            pthread_cond_wait(&mCond, &mMutex);
+        } else {
+            struct timespec ts;
+            ts.tv_sec = nextUs / 1000000ULL;
+            ts.tv_nsec = (nextUs % 1000000ULL) * 1000;
+            pthread_cond_timedwait(&mCond, &mMutex, &ts);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
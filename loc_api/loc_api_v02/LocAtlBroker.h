@@ -0,0 +1,169 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_ATL_BROKER_H
+#define LOC_ATL_BROKER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <LocApiBase.h>
+
+/* Shares the ATL connections loc eng brings up between the modem
+   server connection requests. Loc eng sees connection ids of the
+   broker, not modem handles. An open of the same AGPS type as an open
+   connection, or one still lingering after its last close, is answered
+   with it right away; an open of a type being brought up waits for it.
+   After the last close a connection is kept for the linger time, and
+   only then released in loc eng. Opens and closes of handles the
+   broker did not see, e.g. SUPL ES, pass through unchanged. */
+class LocAtlBroker {
+public:
+  enum OpenAction {
+    /* request the connection from loc eng with the returned id */
+    OPEN_REQUEST = 0,
+    /* answer the modem now with the returned APN and bearer */
+    OPEN_ANSWER,
+    /* answered when the connection being brought up is */
+    OPEN_WAIT
+  };
+
+  enum CloseAction {
+    /* answer the modem now */
+    CLOSE_ANSWER = 0,
+    /* release the returned id in loc eng, the modem is answered with
+       its close status */
+    CLOSE_RELEASE,
+    /* not a brokered handle, release it in loc eng as it is */
+    CLOSE_PASS
+  };
+
+  struct Answer {
+    int id;
+    char apn[101];
+    AGpsBearerType bearer;
+  };
+
+  struct Stats {
+    uint64_t opens;
+    /* connections brought up by loc eng */
+    uint64_t bringUps;
+    uint64_t bringUpTotalUs;
+    uint64_t bringUpMaxUs;
+    /* opens answered with an open or lingering connection */
+    uint64_t reused;
+    /* opens that waited for a connection being brought up */
+    uint64_t joined;
+    /* bring-up time of the connections reused */
+    uint64_t savedTotalUs;
+    uint64_t lingerExpired;
+  };
+
+  /* releases connection id in loc eng */
+  typedef void (*ReleaseFn)(int id, void* context);
+
+  LocAtlBroker(ReleaseFn release, void* context);
+  ~LocAtlBroker();
+
+  /* 0 releases a connection at its last close */
+  void setLinger(uint32_t lingerMs);
+
+  /* the modem asked for a connection for handle */
+  OpenAction open(int handle, AGpsType type, Answer& answer);
+  /* loc eng answered the open of id; handles gets the modem handles to
+     answer. false if id is not a broker connection. */
+  bool opened(int id, bool success, const char* apn, AGpsBearerType bearer,
+              std::vector<int>& handles);
+  /* the modem closed handle; id is set for CLOSE_RELEASE */
+  CloseAction close(int handle, int& id);
+  /* loc eng answered the release of id; handle is the modem handle to
+     answer, or -1 when the broker released it. false if id is not a
+     broker connection. */
+  bool closed(int id, int& handle);
+
+  /* the modem is gone along with its handles; all connections are
+     released */
+  void reset();
+
+  void getStats(Stats& stats) const;
+
+private:
+  enum State {
+    STATE_OPENING = 0,
+    STATE_OPEN,
+    STATE_LINGERING,
+    STATE_CLOSING
+  };
+
+  struct Connection {
+    AGpsType type;
+    State state;
+    char apn[101];
+    AGpsBearerType bearer;
+    /* modem handles using the connection, and waiting for it */
+    std::vector<int> handles;
+    std::vector<int> waiting;
+    uint64_t requestUs;
+    uint64_t bringUpUs;
+    uint64_t lingerUntilUs;
+    /* modem handle waiting for the close status, -1 if none */
+    int closeHandle;
+  };
+
+  ReleaseFn mRelease;
+  void* mContext;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+
+  /* guarded by mMutex */
+  std::unordered_map<int, Connection> mConnections;
+  /* modem handle to connection id */
+  std::unordered_map<int, int> mHandles;
+  int mNextId;
+  uint32_t mLingerMs;
+
+  std::atomic<uint64_t> mOpens;
+  std::atomic<uint64_t> mBringUps;
+  std::atomic<uint64_t> mBringUpTotalUs;
+  std::atomic<uint64_t> mBringUpMaxUs;
+  std::atomic<uint64_t> mReused;
+  std::atomic<uint64_t> mJoined;
+  std::atomic<uint64_t> mSavedTotalUs;
+  std::atomic<uint64_t> mLingerExpired;
+
+  void detach(int handle);
+  static void* threadMain(void* arg);
+  void run();
+};
+
+#endif //LOC_ATL_BROKER_H
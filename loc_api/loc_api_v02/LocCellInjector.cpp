@@ -0,0 +1,293 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_CellInjector"
+
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <LocCellInjector.h>
+#include <loc_api_v02_log.h>
+#include <loc_api_sync_req.h>
+#include <loc_util_log.h>
+
+#define CELL_DEFAULT_MIN_INTERVAL_MS 1000
+#define CELL_DEFAULT_STALE_TIMEOUT_MS 60000
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+LocCellInjector :: LocCellInjector(const locClientHandleType& clientHandle) :
+    mClientHandle(clientHandle),
+    mThreadStarted(false),
+    mStop(false),
+    mPending(false),
+    mLastValid(false),
+    mLastNs(0),
+    mMinIntervalNs(CELL_DEFAULT_MIN_INTERVAL_MS * 1000000ULL),
+    mStaleTimeoutNs(CELL_DEFAULT_STALE_TIMEOUT_MS * 1000000ULL)
+{
+    pthread_condattr_t condAttr;
+
+    memset(&mPendingCell, 0, sizeof(mPendingCell));
+    memset(&mLastCell, 0, sizeof(mLastCell));
+    memset(&mStats, 0, sizeof(mStats));
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+}
+
+LocCellInjector :: ~LocCellInjector()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocCellInjector :: update(const Cell& cell)
+{
+    pthread_mutex_lock(&mMutex);
+    mStats.updates++;
+    if (mPending) {
+        mStats.coalesced++;
+    }
+    mPending = true;
+    mPendingCell = cell;
+
+    if (!mThreadStarted) {
+        mThreadStarted =
+            (0 == pthread_create(&mThread, NULL, threadMain, this));
+        if (!mThreadStarted) {
+            LOC_LOGE("%s:%d]: failed to start injection thread",
+                     __func__, __LINE__);
+        }
+    }
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocCellInjector :: invalidate()
+{
+    pthread_mutex_lock(&mMutex);
+    mLastValid = false;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocCellInjector :: setMinInterval(uint32_t intervalMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mMinIntervalNs = (uint64_t)intervalMs * 1000000ULL;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocCellInjector :: setStaleTimeout(uint32_t timeoutMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mStaleTimeoutNs = (uint64_t)timeoutMs * 1000000ULL;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocCellInjector :: getStats(Stats& stats) const
+{
+    pthread_mutex_lock(&mMutex);
+    stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+/* compares only the fields that are sent for the cell type */
+bool LocCellInjector :: sameCell(const Cell& a, const Cell& b)
+{
+    if (a.type != b.type) {
+        return false;
+    }
+    if (CELL_OUT_OF_SERVICE == a.type) {
+        return true;
+    }
+    return a.mcc == b.mcc && a.mnc == b.mnc && a.cid == b.cid &&
+        (CELL_WCDMA == a.type || a.lac == b.lac) &&
+        a.roaming == b.roaming &&
+        a.timingAdvanceValid == b.timingAdvanceValid &&
+        (!a.timingAdvanceValid || a.timingAdvance == b.timingAdvance) &&
+        a.freqValid == b.freqValid && (!a.freqValid || a.freq == b.freq) &&
+        a.pscValid == b.pscValid && (!a.pscValid || a.psc == b.psc);
+}
+
+void* LocCellInjector :: threadMain(void* arg)
+{
+    ((LocCellInjector*)arg)->run();
+    return NULL;
+}
+
+void LocCellInjector :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        if (!mPending) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+
+        uint64_t nowNs = monotonicNs();
+        if (mLastValid && sameCell(mPendingCell, mLastCell) &&
+            nowNs - mLastNs < mStaleTimeoutNs) {
+            mPending = false;
+            mStats.unchanged++;
+            continue;
+        }
+
+        // rate limit; whatever is pending when the interval is over is sent
+        uint64_t dueNs = mLastNs + mMinIntervalNs;
+        if (0 != mLastNs && nowNs < dueNs) {
+            struct timespec ts;
+            ts.tv_sec = dueNs / 1000000000ULL;
+            ts.tv_nsec = dueNs % 1000000000ULL;
+            pthread_cond_timedwait(&mCond, &mMutex, &ts);
+            continue;
+        }
+
+        Cell cell = mPendingCell;
+        mPending = false;
+        pthread_mutex_unlock(&mMutex);
+        locClientStatusEnumType status = send(cell);
+        pthread_mutex_lock(&mMutex);
+
+        mLastNs = monotonicNs();
+        if (eLOC_CLIENT_SUCCESS == status) {
+            mLastValid = true;
+            mLastCell = cell;
+            mStats.injected++;
+        } else {
+            mLastValid = false;
+            mStats.failures++;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+locClientStatusEnumType LocCellInjector :: send(const Cell& cell)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    uint32_t reqId;
+    uint32_t indId;
+    qmiLocInjectGSMCellInfoReqMsgT_v02 gsmReq;
+    qmiLocInjectWCDMACellInfoReqMsgT_v02 wcdmaReq;
+    qmiLocInjectTDSCDMACellInfoReqMsgT_v02 tdscdmaReq;
+    // all cell info indications carry only a status
+    qmiLocInjectGSMCellInfoIndMsgT_v02 ind;
+    qmiLocRoamingStatusEnumT_v02 roaming = cell.roaming ?
+        eQMI_LOC_PHONE_ROAMING_V02 : eQMI_LOC_PHONE_NOT_ROAMING_V02;
+
+    memset(&ind, 0, sizeof(ind));
+
+    switch (cell.type) {
+    case CELL_GSM:
+        memset(&gsmReq, 0, sizeof(gsmReq));
+        gsmReq.gsmCellId.MCC = cell.mcc;
+        gsmReq.gsmCellId.MNC = cell.mnc;
+        gsmReq.gsmCellId.LAC = cell.lac;
+        gsmReq.gsmCellId.CID = cell.cid;
+        gsmReq.roamingStatus = cell.roaming;
+        gsmReq.timingAdvance_valid = cell.timingAdvanceValid;
+        gsmReq.timingAdvance = cell.timingAdvance;
+        req_union.pInjectGSMCellInfoReq = &gsmReq;
+        reqId = QMI_LOC_INJECT_GSM_CELL_INFO_REQ_V02;
+        indId = QMI_LOC_INJECT_GSM_CELL_INFO_IND_V02;
+        break;
+
+    case CELL_WCDMA:
+        memset(&wcdmaReq, 0, sizeof(wcdmaReq));
+        wcdmaReq.wcdmaCellId.mcc = cell.mcc;
+        wcdmaReq.wcdmaCellId.mnc = cell.mnc;
+        wcdmaReq.wcdmaCellId.cid = cell.cid;
+        wcdmaReq.roamingStatus = roaming;
+        wcdmaReq.freq_valid = cell.freqValid;
+        wcdmaReq.freq = cell.freq;
+        wcdmaReq.psc_valid = cell.pscValid;
+        wcdmaReq.psc = cell.psc;
+        req_union.pInjectWCDMACellInfoReq = &wcdmaReq;
+        reqId = QMI_LOC_INJECT_WCDMA_CELL_INFO_REQ_V02;
+        indId = QMI_LOC_INJECT_WCDMA_CELL_INFO_IND_V02;
+        break;
+
+    case CELL_TDSCDMA:
+        memset(&tdscdmaReq, 0, sizeof(tdscdmaReq));
+        tdscdmaReq.tdscdmaCellId.mcc = cell.mcc;
+        tdscdmaReq.tdscdmaCellId.mnc = cell.mnc;
+        tdscdmaReq.tdscdmaCellId.cid = cell.cid;
+        tdscdmaReq.tdscdmaCellId.lac = cell.lac;
+        tdscdmaReq.roamingStatus = roaming;
+        tdscdmaReq.freq_valid = cell.freqValid;
+        tdscdmaReq.freq = cell.freq;
+        req_union.pInjectTDSCDMACellInfoReq = &tdscdmaReq;
+        reqId = QMI_LOC_INJECT_TDSCDMA_CELL_INFO_REQ_V02;
+        indId = QMI_LOC_INJECT_TDSCDMA_CELL_INFO_IND_V02;
+        break;
+
+    default:
+        req_union.pWWANOutOfServiceNotificationReq = NULL;
+        reqId = QMI_LOC_WWAN_OUT_OF_SERVICE_NOTIFICATION_REQ_V02;
+        indId = QMI_LOC_WWAN_OUT_OF_SERVICE_NOTIFICATION_IND_V02;
+        break;
+    }
+
+    status = loc_sync_send_req(mClientHandle, reqId, req_union,
+                               LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               indId, &ind);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != ind.status)
+    {
+        LOC_LOGE ("%s:%d]: error! cell type = %d, status = %s, ind.status = %s\n",
+                  __func__, __LINE__, cell.type,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(ind.status));
+        return (status != eLOC_CLIENT_SUCCESS) ?
+            status : eLOC_CLIENT_FAILURE_GENERAL;
+    }
+
+    LOC_LOGV("%s:%d]: cell type = %d, mcc = %u, mnc = %u, cid = %u injected",
+             __func__, __LINE__, cell.type, cell.mcc, cell.mnc, cell.cid);
+    return eLOC_CLIENT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_CELL_INJECTOR_H
+#define LOC_CELL_INJECTOR_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <loc_api_v02_client.h>
+
+/* Injects the serving cell, or WWAN out of service, as coarse position
+   aiding. Updates from the platform are compared with the last injected
+   state and only a change, or a repeat of a stale state, is sent. At
+   most one injection is made per min interval; updates arriving faster,
+   e.g. in a handover storm, are coalesced and the latest one wins. */
+class LocCellInjector {
+public:
+  enum CellType {
+    CELL_OUT_OF_SERVICE = 0,
+    CELL_GSM,
+    CELL_WCDMA,
+    CELL_TDSCDMA
+  };
+
+  /* lac is not used for WCDMA; timingAdvance is GSM only, freq is
+     WCDMA and TDSCDMA, psc WCDMA only */
+  struct Cell {
+    CellType type;
+    uint32_t mcc;
+    uint32_t mnc;
+    uint32_t lac;
+    uint32_t cid;
+    bool roaming;
+    bool timingAdvanceValid;
+    uint32_t timingAdvance;
+    bool freqValid;
+    uint32_t freq;
+    bool pscValid;
+    uint32_t psc;
+  };
+
+  struct Stats {
+    uint64_t updates;
+    uint64_t injected;
+    /* same as the last injected state and not stale */
+    uint64_t unchanged;
+    /* replaced by a newer update before they could be sent */
+    uint64_t coalesced;
+    uint64_t failures;
+  };
+
+  LocCellInjector(const locClientHandleType& clientHandle);
+  ~LocCellInjector();
+
+  /* new serving cell, or CELL_OUT_OF_SERVICE; never blocks on the modem */
+  void update(const Cell& cell);
+
+  /* the modem lost its state, the next update is sent even if unchanged */
+  void invalidate();
+
+  void setMinInterval(uint32_t intervalMs);
+  void setStaleTimeout(uint32_t timeoutMs);
+
+  void getStats(Stats& stats) const;
+
+private:
+  const locClientHandleType& mClientHandle;
+  mutable pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+  /* guarded by mMutex */
+  bool mPending;
+  Cell mPendingCell;
+  bool mLastValid;
+  Cell mLastCell;
+  uint64_t mLastNs;
+  uint64_t mMinIntervalNs;
+  uint64_t mStaleTimeoutNs;
+  Stats mStats;
+
+  static void* threadMain(void* arg);
+  void run();
+  static bool sameCell(const Cell& a, const Cell& b);
+  locClientStatusEnumType send(const Cell& cell);
+};
+
+#endif //LOC_CELL_INJECTOR_H
@@ -0,0 +1,382 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_EpochAssembler"
+
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <LocEpochAssembler.h>
+#include <loc_api_v02_log.h>
+#include <loc_util_log.h>
+
+#define DEFAULT_TIMEOUT_MS 200
+/* NMEA this soon after a position completed its epoch belongs to it */
+#define TRAILING_NMEA_NS (20 * 1000000ULL)
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+LocEpochAssembler :: LocEpochAssembler(EpochCb epochCb, void* context) :
+    mEpochCb(epochCb),
+    mContext(context),
+    mTimeoutNs(DEFAULT_TIMEOUT_MS * 1000000ULL),
+    mThreadStarted(false),
+    mStop(false),
+    mFreeCount(0),
+    mOpen(NULL),
+    mDueNs(0),
+    mSvExpected(false),
+    mCompleteOnPosition(true),
+    mOnPositionNs(0),
+    mDoneHead(0),
+    mDoneCount(0),
+    mEpochs(0),
+    mReports(0),
+    mOnPosition(0),
+    mSplit(0),
+    mTimedOut(0),
+    mOverflows(0),
+    mLatencyTotalUs(0),
+    mLatencyMaxUs(0)
+{
+    pthread_condattr_t condAttr;
+
+    for (int i = 0; i < LOC_EPOCH_POOL_SIZE; i++) {
+        mFree[mFreeCount++] = &mPool[i];
+    }
+    pthread_mutex_init(&mMutex, NULL);
+    // timeouts on the monotonic clock, wall clock changes must not stall us
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &condAttr);
+    pthread_cond_init(&mFreeCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    mThreadStarted = (0 == pthread_create(&mThread, NULL, threadMain, this));
+    if (!mThreadStarted) {
+        LOC_LOGE("%s:%d]: failed to start assembler thread",
+                 __func__, __LINE__);
+    }
+}
+
+LocEpochAssembler :: ~LocEpochAssembler()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_cond_broadcast(&mFreeCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mFreeCond);
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocEpochAssembler :: setTimeout(uint32_t timeoutMs)
+{
+    mTimeoutNs = timeoutMs * 1000000ULL;
+}
+
+/* the open epoch, a new one if none is open; NULL if the pool stayed
+   exhausted for the completion timeout. Called with mMutex held. */
+LocEpochAssembler::Epoch* LocEpochAssembler :: open(uint64_t nowNs)
+{
+    if (NULL == mOpen) {
+        // a report passed through now would overtake the queued epochs,
+        // wait for them to be called back instead
+        if (0 == mFreeCount && mThreadStarted) {
+            uint64_t deadlineNs = nowNs + mTimeoutNs;
+            struct timespec ts;
+            ts.tv_sec = deadlineNs / 1000000000ULL;
+            ts.tv_nsec = deadlineNs % 1000000000ULL;
+            while (0 == mFreeCount && NULL == mOpen && !mStop &&
+                   0 == pthread_cond_timedwait(&mFreeCond, &mMutex, &ts)) {
+            }
+        }
+        if (NULL != mOpen) {
+            return mOpen;
+        }
+        if (0 == mFreeCount) {
+            return NULL;
+        }
+        mOpen = mFree[--mFreeCount];
+        mOpen->hasGpsTime = false;
+        mOpen->hasFixId = false;
+        mOpen->hasPosition = false;
+        mOpen->positionReport = NULL;
+        mOpen->hasSv = false;
+        mOpen->svReport = NULL;
+        mOpen->nmeaCount = 0;
+        mOpen->nmeaUsed = 0;
+        mOpen->openedNs = nowNs;
+    }
+    return mOpen;
+}
+
+/* queue the open epoch for its callback. Called with mMutex held. */
+void LocEpochAssembler :: complete()
+{
+    if (NULL != mOpen) {
+        mSvExpected = mOpen->hasSv;
+        mOnPositionNs = 0;
+        mDone[(mDoneHead + mDoneCount) % LOC_EPOCH_POOL_SIZE] = mOpen;
+        mDoneCount++;
+        mOpen = NULL;
+        pthread_cond_signal(&mCond);
+    }
+}
+
+/* a report was added, restart the timeout. Called with mMutex held. */
+void LocEpochAssembler :: added(uint64_t nowNs)
+{
+    mReports++;
+    mDueNs = nowNs + mTimeoutNs;
+    pthread_cond_signal(&mCond);
+}
+
+/* complete the open epoch if it has all the reports its position
+   needs. Called with mMutex held. */
+void LocEpochAssembler :: completeOnPosition(uint64_t nowNs)
+{
+    if (mCompleteOnPosition && NULL != mOpen && mOpen->hasPosition &&
+        LOC_SESS_INTERMEDIATE != mOpen->status &&
+        (mOpen->hasSv || !mSvExpected)) {
+        mOnPosition++;
+        complete();
+        mOnPositionNs = nowNs;
+    }
+}
+
+bool LocEpochAssembler :: addPosition(const UlpLocation& location,
+                                      const GpsLocationExtended& locationExtended,
+                                      const qmiLocEventPositionReportIndMsgT_v02* positionReport,
+                                      enum loc_sess_status status,
+                                      LocPosTechMask techMask)
+{
+    uint64_t nowNs = monotonicNs();
+    bool hasGpsTime = (NULL != positionReport && positionReport->gpsTime_valid);
+    bool hasFixId = (NULL != positionReport && positionReport->fixId_valid);
+
+    pthread_mutex_lock(&mMutex);
+    if (NULL != mOpen && mOpen->hasPosition) {
+        // a repeated report of the same epoch replaces the earlier one
+        bool sameEpoch;
+        if (hasGpsTime && mOpen->hasGpsTime) {
+            sameEpoch = (positionReport->gpsTime.gpsWeek == mOpen->gpsWeek &&
+                         positionReport->gpsTime.gpsTimeOfWeekMs == mOpen->gpsTimeOfWeekMs);
+        } else if (hasFixId && mOpen->hasFixId) {
+            sameEpoch = (positionReport->fixId == mOpen->fixId);
+        } else {
+            sameEpoch = false;
+        }
+        if (!sameEpoch) {
+            mSplit++;
+            complete();
+        }
+    }
+
+    Epoch* epoch = open(nowNs);
+    if (NULL == epoch) {
+        pthread_mutex_unlock(&mMutex);
+        mOverflows++;
+        return false;
+    }
+    epoch->hasGpsTime = hasGpsTime;
+    if (hasGpsTime) {
+        epoch->gpsWeek = positionReport->gpsTime.gpsWeek;
+        epoch->gpsTimeOfWeekMs = positionReport->gpsTime.gpsTimeOfWeekMs;
+    }
+    epoch->hasFixId = hasFixId;
+    if (hasFixId) {
+        epoch->fixId = positionReport->fixId;
+    }
+    epoch->hasPosition = true;
+    epoch->location = location;
+    epoch->locationExtended = locationExtended;
+    epoch->status = status;
+    epoch->techMask = techMask;
+    if (NULL != positionReport) {
+        epoch->positionReportCopy = *positionReport;
+        epoch->positionReport = &epoch->positionReportCopy;
+    } else {
+        epoch->positionReport = NULL;
+    }
+    added(nowNs);
+    completeOnPosition(nowNs);
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+bool LocEpochAssembler :: addSv(const GpsSvStatus& svStatus,
+                                const GpsLocationExtended& svExtended,
+                                const qmiLocEventGnssSvInfoIndMsgT_v02* svReport)
+{
+    uint64_t nowNs = monotonicNs();
+
+    pthread_mutex_lock(&mMutex);
+    if (NULL != mOpen && mOpen->hasSv) {
+        // one SV report per epoch, this one starts the next
+        mSplit++;
+        complete();
+    }
+
+    Epoch* epoch = open(nowNs);
+    if (NULL == epoch) {
+        pthread_mutex_unlock(&mMutex);
+        mOverflows++;
+        return false;
+    }
+    epoch->hasSv = true;
+    epoch->svStatus = svStatus;
+    epoch->svExtended = svExtended;
+    epoch->svReportCopy = *svReport;
+    epoch->svReport = &epoch->svReportCopy;
+    added(nowNs);
+    completeOnPosition(nowNs);
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+bool LocEpochAssembler :: addNmea(const char* nmea, size_t length)
+{
+    uint64_t nowNs = monotonicNs();
+
+    // kept NUL terminated in the arena
+    if (length + 1 > LOC_EPOCH_NMEA_ARENA) {
+        mOverflows++;
+        return false;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    if (NULL == mOpen && 0 != mOnPositionNs &&
+        nowNs - mOnPositionNs < TRAILING_NMEA_NS) {
+        // this modem sends NMEA after the position, which then cannot
+        // complete the epoch
+        LOC_LOGD("%s:%d]: NMEA follows the position report",
+                 __func__, __LINE__);
+        mCompleteOnPosition = false;
+    }
+    if (NULL != mOpen &&
+        (LOC_EPOCH_MAX_NMEA == mOpen->nmeaCount ||
+         LOC_EPOCH_NMEA_ARENA - mOpen->nmeaUsed < length + 1)) {
+        mSplit++;
+        complete();
+    }
+
+    Epoch* epoch = open(nowNs);
+    if (NULL == epoch) {
+        pthread_mutex_unlock(&mMutex);
+        mOverflows++;
+        return false;
+    }
+    memcpy(epoch->nmeaArena + epoch->nmeaUsed, nmea, length);
+    epoch->nmeaArena[epoch->nmeaUsed + length] = '\0';
+    epoch->nmeaStarts[epoch->nmeaCount] = (uint16_t)epoch->nmeaUsed;
+    epoch->nmeaLengths[epoch->nmeaCount] = (uint16_t)length;
+    epoch->nmeaCount++;
+    epoch->nmeaUsed += length + 1;
+    added(nowNs);
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+void LocEpochAssembler :: flush()
+{
+    pthread_mutex_lock(&mMutex);
+    complete();
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocEpochAssembler :: getStats(Stats& stats) const
+{
+    stats.epochs = mEpochs;
+    stats.reports = mReports;
+    stats.onPosition = mOnPosition;
+    stats.split = mSplit;
+    stats.timedOut = mTimedOut;
+    stats.overflows = mOverflows;
+    stats.latencyTotalUs = mLatencyTotalUs;
+    stats.latencyMaxUs = mLatencyMaxUs;
+}
+
+void* LocEpochAssembler :: threadMain(void* arg)
+{
+    ((LocEpochAssembler*)arg)->run();
+    return NULL;
+}
+
+void LocEpochAssembler :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        if (0 == mDoneCount) {
+            if (NULL == mOpen) {
+                pthread_cond_wait(&mCond, &mMutex);
+            } else if (monotonicNs() < mDueNs) {
+                struct timespec ts;
+                ts.tv_sec = mDueNs / 1000000000ULL;
+                ts.tv_nsec = mDueNs % 1000000000ULL;
+                pthread_cond_timedwait(&mCond, &mMutex, &ts);
+            } else {
+                mTimedOut++;
+                complete();
+            }
+            continue;
+        }
+
+        Epoch* epoch = mDone[mDoneHead];
+        mDoneHead = (mDoneHead + 1) % LOC_EPOCH_POOL_SIZE;
+        mDoneCount--;
+
+        // the epoch stays ours until it goes back to the free list
+        pthread_mutex_unlock(&mMutex);
+        mEpochCb(*epoch, mContext);
+
+        uint64_t latencyUs = (monotonicNs() - epoch->openedNs) / 1000;
+        uint64_t maxUs = mLatencyMaxUs;
+        while (latencyUs > maxUs &&
+               !mLatencyMaxUs.compare_exchange_weak(maxUs, latencyUs)) {
+        }
+        mLatencyTotalUs += latencyUs;
+        mEpochs++;
+
+        pthread_mutex_lock(&mMutex);
+        mFree[mFreeCount++] = epoch;
+        pthread_cond_signal(&mFreeCond);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
@@ -0,0 +1,178 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_EPOCH_ASSEMBLER_H
+#define LOC_EPOCH_ASSEMBLER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <gps_extended.h>
+#include <loc_api_v02_client.h>
+
+#define LOC_EPOCH_POOL_SIZE 4
+#define LOC_EPOCH_MAX_NMEA 32
+#define LOC_EPOCH_NMEA_ARENA 4096
+
+/* Groups the position, SV and NMEA reports of one GNSS epoch and hands
+   them over in a single callback. Only the position report carries the
+   epoch, its GPS week and time of week or else its fix id; SV and NMEA
+   reports join the open epoch. An epoch is complete once it holds a
+   final position, along with an SV report while the modem sends those.
+   A modem whose NMEA follows the position report instead has its epochs
+   completed by a report of the next epoch, or when no report was added
+   for the completion timeout. Epochs come from a fixed pool and NMEA
+   sentences are copied into an arena inside the epoch, so nothing is
+   allocated per report. Callbacks are made in order from the assembler
+   thread; a report that finds the pool exhausted waits for the queued
+   epochs to be called back first. */
+class LocEpochAssembler {
+public:
+  struct Epoch {
+    bool hasGpsTime;
+    uint16_t gpsWeek;
+    uint32_t gpsTimeOfWeekMs;
+    bool hasFixId;
+    uint32_t fixId;
+
+    bool hasPosition;
+    UlpLocation location;
+    GpsLocationExtended locationExtended;
+    enum loc_sess_status status;
+    LocPosTechMask techMask;
+    /* copy of the QMI report, the extension passed along with the
+       position; NULL for failed sessions */
+    const qmiLocEventPositionReportIndMsgT_v02* positionReport;
+
+    bool hasSv;
+    GpsSvStatus svStatus;
+    GpsLocationExtended svExtended;
+    const qmiLocEventGnssSvInfoIndMsgT_v02* svReport;
+
+    size_t nmeaCount;
+    inline const char* nmea(size_t i, size_t& length) const {
+      length = nmeaLengths[i];
+      return nmeaArena + nmeaStarts[i];
+    }
+
+  private:
+    friend class LocEpochAssembler;
+    qmiLocEventPositionReportIndMsgT_v02 positionReportCopy;
+    qmiLocEventGnssSvInfoIndMsgT_v02 svReportCopy;
+    uint16_t nmeaStarts[LOC_EPOCH_MAX_NMEA];
+    uint16_t nmeaLengths[LOC_EPOCH_MAX_NMEA];
+    size_t nmeaUsed;
+    char nmeaArena[LOC_EPOCH_NMEA_ARENA];
+    uint64_t openedNs;
+  };
+
+  typedef void (*EpochCb)(const Epoch& epoch, void* context);
+
+  struct Stats {
+    uint64_t epochs;
+    uint64_t reports;
+    /* epochs completed by their final position report */
+    uint64_t onPosition;
+    /* epochs completed by a report of the next epoch */
+    uint64_t split;
+    uint64_t timedOut;
+    /* reports passed through unassembled, the pool stayed exhausted */
+    uint64_t overflows;
+    /* from the first report of an epoch until its callback */
+    uint64_t latencyTotalUs;
+    uint64_t latencyMaxUs;
+  };
+
+  LocEpochAssembler(EpochCb epochCb, void* context);
+  ~LocEpochAssembler();
+
+  void setTimeout(uint32_t timeoutMs);
+
+  /* add a report to the open epoch; false if it could not be taken and
+     the caller has to report it on its own */
+  bool addPosition(const UlpLocation& location,
+                   const GpsLocationExtended& locationExtended,
+                   const qmiLocEventPositionReportIndMsgT_v02* positionReport,
+                   enum loc_sess_status status, LocPosTechMask techMask);
+  bool addSv(const GpsSvStatus& svStatus,
+             const GpsLocationExtended& svExtended,
+             const qmiLocEventGnssSvInfoIndMsgT_v02* svReport);
+  bool addNmea(const char* nmea, size_t length);
+
+  /* complete the open epoch now */
+  void flush();
+
+  void getStats(Stats& stats) const;
+
+private:
+  EpochCb mEpochCb;
+  void* mContext;
+  std::atomic<uint64_t> mTimeoutNs;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  /* an epoch went back to the free list */
+  pthread_cond_t mFreeCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+
+  /* guarded by mMutex */
+  Epoch mPool[LOC_EPOCH_POOL_SIZE];
+  Epoch* mFree[LOC_EPOCH_POOL_SIZE];
+  size_t mFreeCount;
+  Epoch* mOpen;
+  uint64_t mDueNs;
+  /* whether the last epoch had an SV report */
+  bool mSvExpected;
+  /* cleared once NMEA is seen to follow the position report */
+  bool mCompleteOnPosition;
+  /* when an epoch was last completed by its position, 0 if it was not */
+  uint64_t mOnPositionNs;
+  /* completed epochs, in order */
+  Epoch* mDone[LOC_EPOCH_POOL_SIZE];
+  size_t mDoneHead;
+  size_t mDoneCount;
+
+  std::atomic<uint64_t> mEpochs;
+  std::atomic<uint64_t> mReports;
+  std::atomic<uint64_t> mOnPosition;
+  std::atomic<uint64_t> mSplit;
+  std::atomic<uint64_t> mTimedOut;
+  std::atomic<uint64_t> mOverflows;
+  std::atomic<uint64_t> mLatencyTotalUs;
+  std::atomic<uint64_t> mLatencyMaxUs;
+
+  Epoch* open(uint64_t nowNs);
+  void complete();
+  void added(uint64_t nowNs);
+  void completeOnPosition(uint64_t nowNs);
+  static void* threadMain(void* arg);
+  void run();
+};
+
+#endif //LOC_EPOCH_ASSEMBLER_H
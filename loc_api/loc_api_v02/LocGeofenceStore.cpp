@@ -0,0 +1,191 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <LocGeofenceStore.h>
+
+/* mean earth radius in meters */
+#define EARTH_RADIUS_METERS     (6371000.0)
+#define DEG_TO_RAD(x)           ((x) * M_PI / 180.0)
+
+LocGeofenceStore :: LocGeofenceStore(double cellDegrees) :
+    mCellDegrees(cellDegrees),
+    mRows((int32_t)ceil(180.0 / cellDegrees)),
+    mCols((int32_t)ceil(360.0 / cellDegrees)),
+    mMaxRadius(0)
+{
+}
+
+int32_t LocGeofenceStore :: rowOf(double latitude) const
+{
+    int32_t row = (int32_t)floor((latitude + 90.0) / mCellDegrees);
+    return std::min(std::max(row, 0), mRows - 1);
+}
+
+int32_t LocGeofenceStore :: colOf(double longitude) const
+{
+    int32_t col = (int32_t)floor((longitude + 180.0) / mCellDegrees);
+    // wrap around the antimeridian
+    col %= mCols;
+    return col < 0 ? col + mCols : col;
+}
+
+uint64_t LocGeofenceStore :: cellOf(double latitude, double longitude) const
+{
+    return key(rowOf(latitude), colOf(longitude));
+}
+
+void LocGeofenceStore :: add(const Fence& fence)
+{
+    remove(fence.clientId);
+    mFences[fence.clientId] = fence;
+    mCells[cellOf(fence.latitude, fence.longitude)].push_back(fence.clientId);
+    mMaxRadius = std::max(mMaxRadius, fence.radius);
+}
+
+bool LocGeofenceStore :: remove(uint32_t clientId)
+{
+    std::unordered_map<uint32_t, Fence>::iterator it = mFences.find(clientId);
+    if (it == mFences.end()) {
+        return false;
+    }
+
+    uint64_t cellKey = cellOf(it->second.latitude, it->second.longitude);
+    std::vector<uint32_t>& ids = mCells[cellKey];
+    std::vector<uint32_t>::iterator id = std::find(ids.begin(), ids.end(), clientId);
+    if (id != ids.end()) {
+        *id = ids.back();
+        ids.pop_back();
+    }
+    if (ids.empty()) {
+        mCells.erase(cellKey);
+    }
+    mFences.erase(it);
+    return true;
+}
+
+LocGeofenceStore::Fence* LocGeofenceStore :: find(uint32_t clientId)
+{
+    std::unordered_map<uint32_t, Fence>::iterator it = mFences.find(clientId);
+    return it == mFences.end() ? NULL : &it->second;
+}
+
+/* equirectangular approximation, good enough to rank fences that are
+   close to the position */
+double LocGeofenceStore :: edgeDistance(const Fence& fence,
+                                        double latitude, double longitude)
+{
+    double dLon = fence.longitude - longitude;
+    if (dLon > 180.0) {
+        dLon -= 360.0;
+    } else if (dLon < -180.0) {
+        dLon += 360.0;
+    }
+    double x = DEG_TO_RAD(dLon) * cos(DEG_TO_RAD((fence.latitude + latitude) / 2));
+    double y = DEG_TO_RAD(fence.latitude - latitude);
+    return sqrt(x * x + y * y) * EARTH_RADIUS_METERS - fence.radius;
+}
+
+void LocGeofenceStore :: addCandidates(uint64_t cellKey,
+                                       double latitude, double longitude,
+                                       std::vector<Candidate>& candidates) const
+{
+    std::unordered_map<uint64_t, std::vector<uint32_t> >::const_iterator cell =
+        mCells.find(cellKey);
+    if (cell == mCells.end()) {
+        return;
+    }
+    for (size_t i = 0; i < cell->second.size(); i++) {
+        const Fence& fence = mFences.find(cell->second[i])->second;
+        candidates.push_back(Candidate(edgeDistance(fence, latitude, longitude),
+                                       fence.clientId));
+    }
+}
+
+void LocGeofenceStore :: nearest(double latitude, double longitude,
+                                 size_t maxCount,
+                                 std::vector<uint32_t>& clientIds) const
+{
+    std::vector<Candidate> candidates;
+    int32_t row = rowOf(latitude);
+    int32_t col = colOf(longitude);
+
+    clientIds.clear();
+    maxCount = std::min(maxCount, mFences.size());
+    if (0 == maxCount) {
+        return;
+    }
+
+    // smallest distance across one cell at this latitude; longitude cells
+    // shrink towards the poles
+    double cellMeters = DEG_TO_RAD(mCellDegrees) * EARTH_RADIUS_METERS *
+        std::max(cos(DEG_TO_RAD(fabs(latitude) + mCellDegrees)), 0.01);
+
+    for (int32_t ring = 0; ; ring++) {
+        // a ring has more cells than the store has occupied cells, a
+        // linear pass over the occupied cells is cheaper from here on
+        if (8 * (size_t)ring > mCells.size() || ring > mRows) {
+            candidates.clear();
+            std::unordered_map<uint64_t, std::vector<uint32_t> >::const_iterator it;
+            for (it = mCells.begin(); it != mCells.end(); ++it) {
+                addCandidates(it->first, latitude, longitude, candidates);
+            }
+            break;
+        }
+
+        for (int32_t r = row - ring; r <= row + ring; r++) {
+            if (r < 0 || r >= mRows) {
+                continue;
+            }
+            // only the perimeter of the ring, inner cells are done already
+            int32_t step = (r == row - ring || r == row + ring) ? 1 : 2 * ring;
+            for (int32_t c = col - ring; c <= col + ring; c += std::max(step, 1)) {
+                addCandidates(key(r, (c % mCols + mCols) % mCols),
+                              latitude, longitude, candidates);
+            }
+        }
+
+        // every fence in rings further out has its edge at least this far
+        double bound = ring * cellMeters - mMaxRadius;
+        if (candidates.size() >= maxCount) {
+            std::nth_element(candidates.begin(),
+                             candidates.begin() + (maxCount - 1),
+                             candidates.end());
+            if (candidates[maxCount - 1].first <= bound) {
+                break;
+            }
+        }
+    }
+
+    std::partial_sort(candidates.begin(), candidates.begin() + maxCount,
+                      candidates.end());
+    for (size_t i = 0; i < maxCount; i++) {
+        clientIds.push_back(candidates[i].second);
+    }
+}
@@ -0,0 +1,95 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_GEOFENCE_STORE_H
+#define LOC_GEOFENCE_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+#include <location_service_v02.h>
+
+/* Host side store of circular geofences. Fences are bucketed on a fixed
+   latitude / longitude grid, so the fences nearest to a position can be
+   found by searching outward from the position's cell instead of
+   scanning every fence. Not thread safe; the owner serializes access. */
+class LocGeofenceStore {
+public:
+  struct Fence {
+    uint32_t clientId;
+    double latitude;
+    double longitude;
+    uint32_t radius;
+    qmiLocGeofenceBreachMaskT_v02 breachMask;
+    qmiLocGeofenceResponsivenessEnumT_v02 responsiveness;
+    qmiLocGeofenceStateEnumT_v02 state;
+  };
+
+  /* cellDegrees is the grid cell edge, in degrees of latitude and
+     longitude */
+  LocGeofenceStore(double cellDegrees = 0.01);
+
+  /* adds the fence, replacing any fence with the same client id */
+  void add(const Fence& fence);
+  bool remove(uint32_t clientId);
+  Fence* find(uint32_t clientId);
+  inline size_t size() const { return mFences.size(); }
+
+  /* grid cell of a position, usable as a coarse "has moved" trigger */
+  uint64_t cellOf(double latitude, double longitude) const;
+
+  /* client ids of the maxCount fences whose edge is nearest to the
+     position, nearest first */
+  void nearest(double latitude, double longitude, size_t maxCount,
+               std::vector<uint32_t>& clientIds) const;
+
+private:
+  typedef std::pair<double, uint32_t> Candidate;
+
+  const double mCellDegrees;
+  const int32_t mRows;
+  const int32_t mCols;
+  /* largest radius ever stored; bounds how far outside its cell
+     a fence edge may reach */
+  uint32_t mMaxRadius;
+  std::unordered_map<uint32_t, Fence> mFences;
+  std::unordered_map<uint64_t, std::vector<uint32_t> > mCells;
+
+  int32_t rowOf(double latitude) const;
+  int32_t colOf(double longitude) const;
+  inline uint64_t key(int32_t row, int32_t col) const {
+      return ((uint64_t)(uint32_t)row << 32) | (uint32_t)col;
+  }
+  void addCandidates(uint64_t cellKey, double latitude, double longitude,
+                     std::vector<Candidate>& candidates) const;
+  static double edgeDistance(const Fence& fence,
+                             double latitude, double longitude);
+};
+
+#endif //LOC_GEOFENCE_STORE_H
@@ -0,0 +1,409 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_NmeaGenerator"
+
+#include <string.h>
+#include <math.h>
+#include <LocNmeaGenerator.h>
+
+/* the longest sentence is 82 characters; numbers are clamped so no
+   sentence written here can exceed this */
+#define NMEA_SENTENCE_MAX 128
+#define MS_PER_DAY 86400000LL
+#define MPS_TO_KNOTS 1.94384449
+
+static const char sHex[] = "0123456789ABCDEF";
+
+static char* putUInt(char* p, uint64_t value, int minDigits)
+{
+    char digits[20];
+    int n = 0;
+
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (n < minDigits) {
+        digits[n++] = '0';
+    }
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+/* value with a fixed number of decimals, rounded; clamped to max */
+static char* putFixed(char* p, double value, int decimals, double max)
+{
+    static const uint32_t scales[] = { 1, 10, 100, 1000, 10000, 100000 };
+    uint32_t scale = scales[decimals];
+
+    if (value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (value > max) {
+        value = max;
+    }
+    uint64_t scaled = (uint64_t)(value * scale + 0.5);
+    p = putUInt(p, scaled / scale, 1);
+    if (decimals > 0) {
+        *p++ = '.';
+        p = putUInt(p, scaled % scale, decimals);
+    }
+    return p;
+}
+
+/* an angle in [0, 360) rounded to the given decimals; rounding up to
+   360 wraps to 0, which is the same direction */
+static uint64_t roundDirection(double value, uint32_t scale)
+{
+    uint64_t full = 360ULL * scale;
+    double wrapped = fmod(value, 360.0);
+
+    if (wrapped < 0) {
+        wrapped += 360.0;
+    }
+    uint64_t scaled = (uint64_t)(wrapped * scale + 0.5);
+    return scaled >= full ? scaled - full : scaled;
+}
+
+/* ddmm.mmmmm or dddmm.mmmmm, then the hemisphere */
+static char* putAngle(char* p, double value, int degreeDigits,
+                      char positive, char negative)
+{
+    char hemisphere = value < 0 ? negative : positive;
+    double absValue = fabs(value);
+    uint32_t degrees = (uint32_t)absValue;
+    uint64_t minutes = (uint64_t)((absValue - degrees) * 60 * 100000 + 0.5);
+
+    if (minutes >= 60 * 100000ULL) {
+        degrees++;
+        minutes -= 60 * 100000ULL;
+    }
+    p = putUInt(p, degrees, degreeDigits);
+    p = putUInt(p, minutes / 100000, 2);
+    *p++ = '.';
+    p = putUInt(p, minutes % 100000, 5);
+    *p++ = ',';
+    *p++ = hemisphere;
+    return p;
+}
+
+/* hhmmss.ss of a UTC time in ms */
+static char* putTime(char* p, int64_t utcMs)
+{
+    int64_t msOfDay = utcMs % MS_PER_DAY;
+    if (msOfDay < 0) {
+        msOfDay += MS_PER_DAY;
+    }
+    uint32_t seconds = (uint32_t)(msOfDay / 1000);
+    p = putUInt(p, seconds / 3600, 2);
+    p = putUInt(p, seconds / 60 % 60, 2);
+    p = putUInt(p, seconds % 60, 2);
+    *p++ = '.';
+    return putUInt(p, msOfDay % 1000 / 10, 2);
+}
+
+/* ddmmyy of a UTC time in ms */
+static char* putDate(char* p, int64_t utcMs)
+{
+    int64_t days = utcMs / MS_PER_DAY;
+    if (utcMs % MS_PER_DAY < 0) {
+        days--;
+    }
+    // civil date from days since 1970-01-01, proleptic Gregorian
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t doe = (uint32_t)(days - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = (int64_t)yoe + era * 400 + (month <= 2);
+
+    p = putUInt(p, day, 2);
+    p = putUInt(p, month, 2);
+    return putUInt(p, (uint64_t)(year % 100), 2);
+}
+
+static int countBits(uint32_t mask)
+{
+    int n = 0;
+    for (; mask; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+}
+
+LocNmeaGenerator :: LocNmeaGenerator() :
+    mCount(0),
+    mUsed(0),
+    mUsedInFixMask(0)
+{
+}
+
+void LocNmeaGenerator :: reset()
+{
+    mCount = 0;
+    mUsed = 0;
+}
+
+/* start a sentence, NULL if the buffer is full */
+char* LocNmeaGenerator :: begin(const char* header)
+{
+    if (mCount >= LOC_NMEA_MAX_SENTENCES ||
+        LOC_NMEA_BUFFER_SIZE - mUsed < NMEA_SENTENCE_MAX) {
+        return NULL;
+    }
+    char* p = mBuffer + mUsed;
+    size_t len = strlen(header);
+    memcpy(p, header, len);
+    return p + len;
+}
+
+/* append the checksum and commit the sentence */
+void LocNmeaGenerator :: end(char* p)
+{
+    char* start = mBuffer + mUsed;
+    uint8_t checksum = 0;
+
+    for (char* c = start + 1; c < p; c++) {
+        checksum ^= (uint8_t)*c;
+    }
+    *p++ = '*';
+    *p++ = sHex[checksum >> 4];
+    *p++ = sHex[checksum & 0xF];
+    *p++ = '\r';
+    *p++ = '\n';
+
+    mStarts[mCount] = (uint16_t)mUsed;
+    mLengths[mCount] = (uint16_t)(p - start);
+    mUsed += p - start;
+    mCount++;
+}
+
+void LocNmeaGenerator :: appendGga(const GpsLocation& location,
+                                   const GpsLocationExtended& ext)
+{
+    char* p = begin("$GPGGA,");
+    bool hasFix = location.flags & GPS_LOCATION_HAS_LAT_LONG;
+
+    if (NULL == p) {
+        return;
+    }
+    p = putTime(p, location.timestamp);
+    *p++ = ',';
+    if (hasFix) {
+        p = putAngle(p, location.latitude, 2, 'N', 'S');
+        *p++ = ',';
+        p = putAngle(p, location.longitude, 3, 'E', 'W');
+        *p++ = ',';
+        *p++ = '1';
+    } else {
+        memcpy(p, ",,,,0", 5);
+        p += 5;
+    }
+    *p++ = ',';
+    p = putUInt(p, countBits(mUsedInFixMask), 2);
+    *p++ = ',';
+    if (ext.flags & GPS_LOCATION_EXTENDED_HAS_DOP) {
+        p = putFixed(p, ext.hdop, 1, 99.9);
+    }
+    *p++ = ',';
+    if (ext.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL) {
+        p = putFixed(p, ext.altitudeMeanSeaLevel, 1, 99999.9);
+    }
+    *p++ = ',';
+    *p++ = 'M';
+    *p++ = ',';
+    // geoid separation, ellipsoid above mean sea level
+    if ((ext.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL) &&
+        (location.flags & GPS_LOCATION_HAS_ALTITUDE)) {
+        p = putFixed(p, location.altitude - ext.altitudeMeanSeaLevel, 1, 999.9);
+    }
+    memcpy(p, ",M,,", 4);
+    p += 4;
+    end(p);
+}
+
+void LocNmeaGenerator :: appendRmc(const GpsLocation& location,
+                                   const GpsLocationExtended& ext)
+{
+    char* p = begin("$GPRMC,");
+    bool hasFix = location.flags & GPS_LOCATION_HAS_LAT_LONG;
+
+    if (NULL == p) {
+        return;
+    }
+    p = putTime(p, location.timestamp);
+    *p++ = ',';
+    *p++ = hasFix ? 'A' : 'V';
+    *p++ = ',';
+    if (hasFix) {
+        p = putAngle(p, location.latitude, 2, 'N', 'S');
+        *p++ = ',';
+        p = putAngle(p, location.longitude, 3, 'E', 'W');
+    } else {
+        memcpy(p, ",,,", 3);
+        p += 3;
+    }
+    *p++ = ',';
+    if (location.flags & GPS_LOCATION_HAS_SPEED) {
+        p = putFixed(p, location.speed * MPS_TO_KNOTS, 1, 9999.9);
+    }
+    *p++ = ',';
+    if (location.flags & GPS_LOCATION_HAS_BEARING) {
+        uint64_t course = roundDirection(location.bearing, 10);
+        p = putUInt(p, course / 10, 1);
+        *p++ = '.';
+        p = putUInt(p, course % 10, 1);
+    }
+    *p++ = ',';
+    p = putDate(p, location.timestamp);
+    *p++ = ',';
+    if (ext.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV) {
+        p = putFixed(p, fabs(ext.magneticDeviation), 1, 180.0);
+        *p++ = ',';
+        *p++ = ext.magneticDeviation < 0 ? 'W' : 'E';
+    } else {
+        *p++ = ',';
+    }
+    *p++ = ',';
+    *p++ = hasFix ? 'A' : 'N';
+    end(p);
+}
+
+void LocNmeaGenerator :: appendGsa(const GpsLocation& location,
+                                   const GpsLocationExtended& ext)
+{
+    char* p = begin("$GPGSA,A,");
+    int used = 0;
+
+    if (NULL == p) {
+        return;
+    }
+    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG)) {
+        *p++ = '1';
+    } else {
+        *p++ = (location.flags & GPS_LOCATION_HAS_ALTITUDE) ? '3' : '2';
+    }
+    *p++ = ',';
+    for (int prn = 1; prn <= 32; prn++) {
+        if (used < 12 && (mUsedInFixMask & (1U << (prn - 1)))) {
+            p = putUInt(p, prn, 2);
+            *p++ = ',';
+            used++;
+        }
+    }
+    for (; used < 12; used++) {
+        *p++ = ',';
+    }
+    if (ext.flags & GPS_LOCATION_EXTENDED_HAS_DOP) {
+        p = putFixed(p, ext.pdop, 1, 99.9);
+        *p++ = ',';
+        p = putFixed(p, ext.hdop, 1, 99.9);
+        *p++ = ',';
+        p = putFixed(p, ext.vdop, 1, 99.9);
+    } else {
+        *p++ = ',';
+        *p++ = ',';
+    }
+    end(p);
+}
+
+/* the GSV sentences of one talker, four satellites each */
+void LocNmeaGenerator :: appendGsvGroup(const char* header,
+                                        const GpsSvInfo* const* svs, int count)
+{
+    int total = (count + 3) / 4;
+
+    if (0 == total) {
+        total = 1;
+    }
+    for (int i = 0; i < total; i++) {
+        char* p = begin(header);
+        if (NULL == p) {
+            return;
+        }
+        p = putUInt(p, total, 1);
+        *p++ = ',';
+        p = putUInt(p, i + 1, 1);
+        *p++ = ',';
+        p = putUInt(p, count, 2);
+        for (int j = i * 4; j < count && j < i * 4 + 4; j++) {
+            const GpsSvInfo* sv = svs[j];
+            *p++ = ',';
+            p = putUInt(p, sv->prn, 2);
+            *p++ = ',';
+            // elevation 00-90, azimuth 000-359, SNR 00-99
+            if (sv->elevation >= 0) {
+                p = putUInt(p, sv->elevation < 89.5f ?
+                               (uint32_t)(sv->elevation + 0.5f) : 90, 2);
+            }
+            *p++ = ',';
+            if (sv->azimuth >= 0) {
+                p = putUInt(p, roundDirection(sv->azimuth, 1), 3);
+            }
+            *p++ = ',';
+            if (sv->snr > 0) {
+                p = putUInt(p, sv->snr < 98.5f ?
+                               (uint32_t)(sv->snr + 0.5f) : 99, 2);
+            }
+        }
+        end(p);
+    }
+}
+
+void LocNmeaGenerator :: appendGsv(const GpsSvStatus& svStatus)
+{
+    const GpsSvInfo* gps[GPS_MAX_SVS];
+    const GpsSvInfo* glonass[GPS_MAX_SVS];
+    int gpsCount = 0;
+    int glonassCount = 0;
+
+    mUsedInFixMask = svStatus.used_in_fix_mask;
+
+    // NMEA numbering: GPS 1-32 and SBAS 33-64 are GP, GLONASS 65-96 GL
+    for (int i = 0; i < svStatus.num_svs && i < GPS_MAX_SVS; i++) {
+        const GpsSvInfo* sv = &svStatus.sv_list[i];
+        if (sv->prn >= 1 && sv->prn <= 64) {
+            gps[gpsCount++] = sv;
+        } else if (sv->prn >= 65 && sv->prn <= 96) {
+            glonass[glonassCount++] = sv;
+        }
+    }
+
+    appendGsvGroup("$GPGSV,", gps, gpsCount);
+    if (glonassCount > 0) {
+        appendGsvGroup("$GLGSV,", glonass, glonassCount);
+    }
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_NMEA_GENERATOR_H
+#define LOC_NMEA_GENERATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <gps_extended.h>
+
+#define LOC_NMEA_BUFFER_SIZE 4096
+#define LOC_NMEA_MAX_SENTENCES 32
+
+/* Builds GGA, RMC, GSA and GSV sentences from converted position and SV
+   reports. Sentences are appended to a buffer owned by the generator
+   and reused for every report, numbers are formatted with integer
+   arithmetic, no allocation or printf is involved. Not thread safe;
+   LocApiV02 uses it from the QMI callback thread only. */
+class LocNmeaGenerator {
+public:
+  LocNmeaGenerator();
+
+  /* drop the sentences of the previous report */
+  void reset();
+
+  void appendGga(const GpsLocation& location, const GpsLocationExtended& ext);
+  void appendRmc(const GpsLocation& location, const GpsLocationExtended& ext);
+  void appendGsa(const GpsLocation& location, const GpsLocationExtended& ext);
+  /* also remembers the satellites used in the fix, for GGA and GSA */
+  void appendGsv(const GpsSvStatus& svStatus);
+
+  inline size_t count() const { return mCount; }
+  /* sentence i, including the trailing \r\n, not NUL terminated */
+  inline const char* sentence(size_t i, size_t& length) const {
+    length = mLengths[i];
+    return mBuffer + mStarts[i];
+  }
+
+private:
+  char mBuffer[LOC_NMEA_BUFFER_SIZE];
+  uint16_t mStarts[LOC_NMEA_MAX_SENTENCES];
+  uint16_t mLengths[LOC_NMEA_MAX_SENTENCES];
+  size_t mCount;
+  size_t mUsed;
+  uint32_t mUsedInFixMask;
+
+  char* begin(const char* header);
+  void end(char* p);
+  void appendGsvGroup(const char* header, const GpsSvInfo* const* svs,
+                      int count);
+};
+
+#endif //LOC_NMEA_GENERATOR_H
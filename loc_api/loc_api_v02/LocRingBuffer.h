@@ -0,0 +1,110 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_RING_BUFFER_H
+#define LOC_RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/* Bounded lock free ring, any number of producers and one consumer.
+   Each cell carries a sequence number telling whether it is free for
+   the producer at that position or filled for the consumer, so push()
+   and pop() never block and never take a lock. N must be a power of 2. */
+template <typename T, size_t N>
+class LocRingBuffer {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of 2");
+
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  /* padding keeps the producer and consumer positions off each other's
+     cache line without over aligning the owner, which is heap allocated */
+  Cell mCells[N];
+  char mPad0[64];
+  std::atomic<size_t> mEnqueuePos;
+  char mPad1[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> mDequeuePos;
+
+public:
+  inline LocRingBuffer() : mEnqueuePos(0), mDequeuePos(0) {
+    for (size_t i = 0; i < N; i++) {
+      mCells[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /* producer side, any thread; false if the ring is full */
+  inline bool push(const T& item) {
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &mCells[pos & (N - 1)];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (0 == diff) {
+        if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = mEnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /* consumer side, one thread only; false if the ring is empty */
+  inline bool pop(T& item) {
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    Cell* cell = &mCells[pos & (N - 1)];
+    size_t seq = cell->seq.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+      return false;
+    }
+    item = cell->data;
+    cell->seq.store(pos + N, std::memory_order_release);
+    mDequeuePos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /* approximate number of queued items */
+  inline size_t size() const {
+    size_t enq = mEnqueuePos.load(std::memory_order_relaxed);
+    size_t deq = mDequeuePos.load(std::memory_order_relaxed);
+    return enq > deq ? enq - deq : 0;
+  }
+};
+
+#endif //LOC_RING_BUFFER_H
@@ -0,0 +1,384 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_SensorInjector"
+
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <LocSensorInjector.h>
+#include <loc_api_v02_log.h>
+#include <loc_api_sync_req.h>
+#include <loc_util_log.h>
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+LocSensorInjector :: LocSensorInjector(const locClientHandleType& clientHandle) :
+    mClientHandle(clientHandle),
+    mThreadStarted(false),
+    mStop(false),
+    mOpaqueId(0),
+    mSamplesQueued(0),
+    mSamplesDropped(0),
+    mSamplesDiscarded(0),
+    mSamplesInjected(0),
+    mMessagesSent(0),
+    mMessagesFailed(0),
+    mLatencyTotalUs(0),
+    mLatencyMaxUs(0)
+{
+    pthread_condattr_t condAttr;
+
+    for (int i = 0; i < SENSOR_TYPE_MAX; i++) {
+        mReady[i] = false;
+        mBatchSpecs[i].samplesPerBatch = 0;
+        mBatchSpecs[i].batchesPerSecond = 0;
+        mCarryValid[i] = false;
+    }
+
+    pthread_mutex_init(&mMutex, NULL);
+    // pace on the monotonic clock, wall clock changes must not stall us
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+}
+
+LocSensorInjector :: ~LocSensorInjector()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool LocSensorInjector :: pushSample(SensorType type, uint32_t timestampMs,
+                                     float x, float y, float z)
+{
+    if (type >= SENSOR_TYPE_MAX) {
+        return false;
+    }
+    if (!mReady[type].load(std::memory_order_relaxed)) {
+        mSamplesDiscarded++;
+        return false;
+    }
+
+    Sample sample;
+    sample.queuedNs = monotonicNs();
+    sample.timestampMs = timestampMs;
+    sample.x = x;
+    sample.y = y;
+    sample.z = z;
+
+    if (!mRings[type].push(sample)) {
+        mSamplesDropped++;
+        return false;
+    }
+    mSamplesQueued++;
+    return true;
+}
+
+void LocSensorInjector :: readyStatus(
+    const qmiLocEventSensorStreamingReadyStatusIndMsgT_v02* status)
+{
+    struct {
+        uint8_t valid;
+        const qmiLocSensorReadyStatusStructT_v02* ready;
+    } sensors[SENSOR_TYPE_MAX] = {
+        { status->accelReady_valid, &status->accelReady },
+        { status->gyroReady_valid, &status->gyroReady },
+        { status->calibratedMagReady_valid, &status->calibratedMagReady }
+    };
+    bool anyReady = false;
+
+    pthread_mutex_lock(&mMutex);
+    for (int i = 0; i < SENSOR_TYPE_MAX; i++) {
+        if (sensors[i].valid) {
+            mReady[i] = sensors[i].ready->injectEnable != 0;
+            if (sensors[i].ready->dataFrequency.batchesPerSecond != 0) {
+                mBatchSpecs[i].samplesPerBatch =
+                    sensors[i].ready->dataFrequency.samplesPerBatch;
+                mBatchSpecs[i].batchesPerSecond =
+                    sensors[i].ready->dataFrequency.batchesPerSecond;
+            }
+            LOC_LOGD("%s:%d]: sensor %d ready = %d, %u samples x %u batches/s",
+                     __func__, __LINE__, i, (int)mReady[i].load(),
+                     mBatchSpecs[i].samplesPerBatch,
+                     mBatchSpecs[i].batchesPerSecond);
+        }
+        anyReady = anyReady || mReady[i];
+    }
+
+    if (anyReady && !mThreadStarted) {
+        mThreadStarted =
+            (0 == pthread_create(&mThread, NULL, threadMain, this));
+        if (!mThreadStarted) {
+            LOC_LOGE("%s:%d]: failed to start injection thread",
+                     __func__, __LINE__);
+        }
+    }
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocSensorInjector :: resetReadyStatus()
+{
+    for (int i = 0; i < SENSOR_TYPE_MAX; i++) {
+        mReady[i] = false;
+    }
+}
+
+void LocSensorInjector :: setDefaultBatchSpec(SensorType type,
+                                              uint16_t samplesPerBatch,
+                                              uint16_t batchesPerSecond)
+{
+    if (type >= SENSOR_TYPE_MAX) {
+        return;
+    }
+    pthread_mutex_lock(&mMutex);
+    mBatchSpecs[type].samplesPerBatch = samplesPerBatch;
+    mBatchSpecs[type].batchesPerSecond = batchesPerSecond;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocSensorInjector :: getStats(Stats& stats) const
+{
+    stats.samplesQueued = mSamplesQueued;
+    stats.samplesDropped = mSamplesDropped;
+    stats.samplesDiscarded = mSamplesDiscarded;
+    stats.samplesInjected = mSamplesInjected;
+    stats.messagesSent = mMessagesSent;
+    stats.messagesFailed = mMessagesFailed;
+    stats.latencyTotalUs = mLatencyTotalUs;
+    stats.latencyMaxUs = mLatencyMaxUs;
+}
+
+void* LocSensorInjector :: threadMain(void* arg)
+{
+    ((LocSensorInjector*)arg)->run();
+    return NULL;
+}
+
+/* injection thread; wakes up at the fastest batch rate of the sensors
+   the modem is ready for, and sleeps while it is ready for none */
+void LocSensorInjector :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        uint16_t batchesPerSecond = 0;
+        for (int i = 0; i < SENSOR_TYPE_MAX; i++) {
+            if (mReady[i] && mBatchSpecs[i].batchesPerSecond > batchesPerSecond) {
+                batchesPerSecond = mBatchSpecs[i].batchesPerSecond;
+            }
+        }
+
+        if (0 == batchesPerSecond) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&mMutex);
+        // a batch or backlog beyond one message goes out right behind it
+        while (inject()) {
+        }
+        pthread_mutex_lock(&mMutex);
+
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t wakeNs = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec +
+            1000000000ULL / batchesPerSecond;
+        ts.tv_sec = wakeNs / 1000000000ULL;
+        ts.tv_nsec = wakeNs % 1000000000ULL;
+        while (!mStop && ETIMEDOUT != pthread_cond_timedwait(&mCond, &mMutex, &ts)) {
+            // a ready status change only matters if it disables everything,
+            // which the outer loop handles on the next round
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+/* move the queued samples of one sensor into a message list. Normally a
+   batch is samplesPerBatch samples, but a backlog is drained in full up
+   to the message capacity, so a late batch catches up at once. */
+uint32_t LocSensorInjector :: fill(SensorType type, const BatchSpec& spec,
+                                   qmiLoc3AxisSensorSampleListStructT_v02& list,
+                                   uint64_t& oldestNs)
+{
+    uint32_t n = 0;
+    uint32_t want = spec.samplesPerBatch;
+    size_t backlog = mRings[type].size() + (mCarryValid[type] ? 1 : 0);
+    Sample sample;
+
+    if (0 == want || backlog > want) {
+        want = backlog;
+    }
+    if (want > QMI_LOC_SENSOR_DATA_MAX_SAMPLES_V02) {
+        want = QMI_LOC_SENSOR_DATA_MAX_SAMPLES_V02;
+    }
+
+    while (n < want) {
+        if (mCarryValid[type]) {
+            sample = mCarry[type];
+            mCarryValid[type] = false;
+        } else if (!mRings[type].pop(sample)) {
+            break;
+        }
+
+        uint32_t offset = 0;
+        if (0 == n) {
+            list.timeOfFirstSample = sample.timestampMs;
+        } else {
+            // offsets are 16 bit; a sample too far from the first one, or
+            // one that went back in time, starts the next message
+            offset = sample.timestampMs - list.timeOfFirstSample;
+            if (offset > UINT16_MAX) {
+                mCarry[type] = sample;
+                mCarryValid[type] = true;
+                break;
+            }
+        }
+        if (sample.queuedNs < oldestNs) {
+            oldestNs = sample.queuedNs;
+        }
+
+        list.sensorData[n].timeOffset = (uint16_t)offset;
+        list.sensorData[n].xAxis = sample.x;
+        list.sensorData[n].yAxis = sample.y;
+        list.sensorData[n].zAxis = sample.z;
+        n++;
+    }
+
+    list.sensorData_len = n;
+    return n;
+}
+
+/* send one message; true if it went out with some sensor at its
+   message capacity, so more may be queued */
+bool LocSensorInjector :: inject()
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocInjectSensorDataReqMsgT_v02 req;
+    qmiLocInjectSensorDataIndMsgT_v02 ind;
+    BatchSpec specs[SENSOR_TYPE_MAX];
+    uint64_t oldestNs = UINT64_MAX;
+    uint32_t total = 0;
+    bool full = false;
+
+    pthread_mutex_lock(&mMutex);
+    memcpy(specs, mBatchSpecs, sizeof(specs));
+    pthread_mutex_unlock(&mMutex);
+
+    memset(&req, 0, sizeof(req));
+    memset(&ind, 0, sizeof(ind));
+
+    for (int i = 0; i < SENSOR_TYPE_MAX; i++) {
+        if (!mReady[i]) {
+            // drain what was queued before the modem said stop
+            Sample sample;
+            while (mRings[i].pop(sample)) {
+                mSamplesDiscarded++;
+            }
+            mCarryValid[i] = false;
+        }
+    }
+
+    if (mReady[SENSOR_ACCEL]) {
+        req.threeAxisAccelData_valid =
+            fill(SENSOR_ACCEL, specs[SENSOR_ACCEL], req.threeAxisAccelData, oldestNs) > 0;
+        total += req.threeAxisAccelData.sensorData_len;
+        full = full ||
+            QMI_LOC_SENSOR_DATA_MAX_SAMPLES_V02 == req.threeAxisAccelData.sensorData_len;
+    }
+    if (mReady[SENSOR_GYRO]) {
+        req.threeAxisGyroData_valid =
+            fill(SENSOR_GYRO, specs[SENSOR_GYRO], req.threeAxisGyroData, oldestNs) > 0;
+        total += req.threeAxisGyroData.sensorData_len;
+        full = full ||
+            QMI_LOC_SENSOR_DATA_MAX_SAMPLES_V02 == req.threeAxisGyroData.sensorData_len;
+    }
+    if (mReady[SENSOR_MAG]) {
+        req.threeAxisMagData_valid =
+            fill(SENSOR_MAG, specs[SENSOR_MAG], req.threeAxisMagData, oldestNs) > 0;
+        req.threeAxisMagData.flags = QMI_LOC_SENSOR_DATA_FLAG_CALIBRATED_DATA_V02;
+        total += req.threeAxisMagData.sensorData_len;
+        full = full ||
+            QMI_LOC_SENSOR_DATA_MAX_SAMPLES_V02 == req.threeAxisMagData.sensorData_len;
+    }
+
+    if (0 == total) {
+        return false;
+    }
+
+    req.opaqueIdentifier_valid = 1;
+    req.opaqueIdentifier = ++mOpaqueId;
+    req_union.pInjectSensorDataReq = &req;
+
+    status = loc_sync_send_req(mClientHandle,
+                               QMI_LOC_INJECT_SENSOR_DATA_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_INJECT_SENSOR_DATA_IND_V02,
+                               &ind);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != ind.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, ind.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(ind.status));
+        mMessagesFailed++;
+        return false;
+    }
+
+    uint64_t latencyUs = (monotonicNs() - oldestNs) / 1000;
+    uint64_t maxUs = mLatencyMaxUs;
+    while (latencyUs > maxUs &&
+           !mLatencyMaxUs.compare_exchange_weak(maxUs, latencyUs)) {
+    }
+    mLatencyTotalUs += latencyUs;
+    mSamplesInjected += total;
+    mMessagesSent++;
+
+    LOC_LOGV("%s:%d]: id = %u, %u samples, latency = %llu us",
+             __func__, __LINE__, req.opaqueIdentifier, total,
+             (unsigned long long)latencyUs);
+    return full;
+}
@@ -0,0 +1,138 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_SENSOR_INJECTOR_H
+#define LOC_SENSOR_INJECTOR_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <loc_api_v02_client.h>
+#include "LocRingBuffer.h"
+
+/* Streams accelerometer, gyroscope and magnetometer samples to the modem
+   with QMI_LOC_INJECT_SENSOR_DATA_REQ_V02. Producers queue samples from
+   any thread without blocking; an injection thread packs them into
+   messages of up to QMI_LOC_SENSOR_DATA_MAX_SAMPLES_V02 samples per
+   sensor, at the batch rate the modem asks for in its streaming ready
+   status. Samples of a sensor the modem is not ready for are discarded. */
+class LocSensorInjector {
+public:
+  enum SensorType {
+    SENSOR_ACCEL = 0,
+    SENSOR_GYRO,
+    SENSOR_MAG,
+    SENSOR_TYPE_MAX
+  };
+
+  struct Stats {
+    uint64_t samplesQueued;
+    /* ring full */
+    uint64_t samplesDropped;
+    /* modem not ready for the sensor */
+    uint64_t samplesDiscarded;
+    uint64_t samplesInjected;
+    uint64_t messagesSent;
+    uint64_t messagesFailed;
+    /* from queueing of the oldest sample in a message until the
+       modem acknowledged the message */
+    uint64_t latencyTotalUs;
+    uint64_t latencyMaxUs;
+  };
+
+  LocSensorInjector(const locClientHandleType& clientHandle);
+  ~LocSensorInjector();
+
+  /* queue one sample; timestampMs is the sensor sample time in
+     milliseconds, on the time base answered to modem time sync requests
+     (LocTimeSyncResponder). Never blocks, returns false if dropped. */
+  bool pushSample(SensorType type, uint32_t timestampMs,
+                  float x, float y, float z);
+
+  /* modem streaming ready status, from the QMI callback thread */
+  void readyStatus(const qmiLocEventSensorStreamingReadyStatusIndMsgT_v02* status);
+
+  /* the modem is gone; nothing is injected until it reports ready again */
+  void resetReadyStatus();
+
+  /* batch spec used for a sensor until the modem reports its own */
+  void setDefaultBatchSpec(SensorType type, uint16_t samplesPerBatch,
+                           uint16_t batchesPerSecond);
+
+  void getStats(Stats& stats) const;
+
+private:
+  struct Sample {
+    uint64_t queuedNs;
+    uint32_t timestampMs;
+    float x;
+    float y;
+    float z;
+  };
+
+  struct BatchSpec {
+    uint16_t samplesPerBatch;
+    uint16_t batchesPerSecond;
+  };
+
+  /* about 2.5 seconds of 200 Hz samples per sensor */
+  LocRingBuffer<Sample, 512> mRings[SENSOR_TYPE_MAX];
+  std::atomic<bool> mReady[SENSOR_TYPE_MAX];
+  /* guarded by mMutex */
+  BatchSpec mBatchSpecs[SENSOR_TYPE_MAX];
+  /* injection thread only; a sample popped from the ring that did not
+     fit the time offset range of the last message */
+  bool mCarryValid[SENSOR_TYPE_MAX];
+  Sample mCarry[SENSOR_TYPE_MAX];
+
+  const locClientHandleType& mClientHandle;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+  uint32_t mOpaqueId;
+
+  std::atomic<uint64_t> mSamplesQueued;
+  std::atomic<uint64_t> mSamplesDropped;
+  std::atomic<uint64_t> mSamplesDiscarded;
+  std::atomic<uint64_t> mSamplesInjected;
+  std::atomic<uint64_t> mMessagesSent;
+  std::atomic<uint64_t> mMessagesFailed;
+  std::atomic<uint64_t> mLatencyTotalUs;
+  std::atomic<uint64_t> mLatencyMaxUs;
+
+  static void* threadMain(void* arg);
+  void run();
+  uint32_t fill(SensorType type, const BatchSpec& spec,
+                qmiLoc3AxisSensorSampleListStructT_v02& list,
+                uint64_t& oldestNs);
+  bool inject();
+};
+
+#endif //LOC_SENSOR_INJECTOR_H
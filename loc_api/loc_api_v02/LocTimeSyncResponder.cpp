@@ -0,0 +1,190 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_TimeSyncResponder"
+
+#include <string.h>
+#include <time.h>
+#include <LocTimeSyncResponder.h>
+#include <loc_api_v02_log.h>
+#include <loc_api_sync_req.h>
+#include <loc_util_log.h>
+
+LocTimeSyncResponder :: LocTimeSyncResponder(const locClientHandleType& clientHandle) :
+    mClientHandle(clientHandle),
+    mThreadStarted(false),
+    mStop(false),
+    mPending(false),
+    mRefCounter(0),
+    mRxNs(0),
+    mRequests(0),
+    mResponses(0),
+    mFailures(0),
+    mSuperseded(0),
+    mLatencyTotalUs(0),
+    mLatencyMaxUs(0)
+{
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        mLatencyBuckets[i] = 0;
+    }
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+
+    // started up front, so no request pays for the thread creation
+    mThreadStarted = (0 == pthread_create(&mThread, NULL, threadMain, this));
+    if (!mThreadStarted) {
+        LOC_LOGE("%s:%d]: failed to start responder thread",
+                 __func__, __LINE__);
+    }
+}
+
+LocTimeSyncResponder :: ~LocTimeSyncResponder()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t LocTimeSyncResponder :: sensorTimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void LocTimeSyncResponder :: request(uint32_t refCounter, uint64_t rxNs)
+{
+    mRequests++;
+
+    pthread_mutex_lock(&mMutex);
+    if (mPending) {
+        // only the latest reference counter is worth answering
+        mSuperseded++;
+    }
+    mPending = true;
+    mRefCounter = refCounter;
+    mRxNs = rxNs;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocTimeSyncResponder :: getStats(Stats& stats) const
+{
+    stats.requests = mRequests;
+    stats.responses = mResponses;
+    stats.failures = mFailures;
+    stats.superseded = mSuperseded;
+    stats.latencyTotalUs = mLatencyTotalUs;
+    stats.latencyMaxUs = mLatencyMaxUs;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        stats.latencyBuckets[i] = mLatencyBuckets[i];
+    }
+}
+
+void* LocTimeSyncResponder :: threadMain(void* arg)
+{
+    ((LocTimeSyncResponder*)arg)->run();
+    return NULL;
+}
+
+void LocTimeSyncResponder :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        if (!mPending) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+        uint32_t refCounter = mRefCounter;
+        uint64_t rxNs = mRxNs;
+        mPending = false;
+
+        pthread_mutex_unlock(&mMutex);
+        respond(refCounter, rxNs);
+        pthread_mutex_lock(&mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocTimeSyncResponder :: respond(uint32_t refCounter, uint64_t rxNs)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocInjectTimeSyncDataReqMsgT_v02 req;
+    qmiLocInjectTimeSyncDataIndMsgT_v02 ind;
+
+    memset(&ind, 0, sizeof(ind));
+    req_union.pInjectTimeSyncReq = &req;
+
+    // the transmit time is taken last, right before the request goes out
+    uint64_t txNs = sensorTimeNs();
+    req.refCounter = refCounter;
+    req.sensorProcRxTime = (uint32_t)(rxNs / 1000000);
+    req.sensorProcTxTime = (uint32_t)(txNs / 1000000);
+
+    status = loc_sync_send_req(mClientHandle,
+                               QMI_LOC_INJECT_TIME_SYNC_DATA_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_INJECT_TIME_SYNC_DATA_IND_V02,
+                               &ind);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != ind.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, ind.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(ind.status));
+        mFailures++;
+        return;
+    }
+
+    uint64_t latencyUs = (txNs - rxNs) / 1000;
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (latencyUs >> bucket) > 0) {
+        bucket++;
+    }
+    mLatencyBuckets[bucket]++;
+    uint64_t maxUs = mLatencyMaxUs;
+    while (latencyUs > maxUs &&
+           !mLatencyMaxUs.compare_exchange_weak(maxUs, latencyUs)) {
+    }
+    mLatencyTotalUs += latencyUs;
+    mResponses++;
+
+    LOC_LOGV("%s:%d]: refCounter = %u, latency = %llu us", __func__, __LINE__,
+             refCounter, (unsigned long long)latencyUs);
+}
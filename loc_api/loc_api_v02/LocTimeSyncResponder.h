@@ -0,0 +1,97 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_TIME_SYNC_RESPONDER_H
+#define LOC_TIME_SYNC_RESPONDER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <loc_api_v02_client.h>
+
+/* Answers modem time sync requests with QMI_LOC_INJECT_TIME_SYNC_DATA_
+   REQ_V02. The receipt time is taken on the QMI callback thread when
+   the request arrives, and a dedicated thread sends the answer, so the
+   request never waits behind the engine message queue. Sensor time is
+   CLOCK_BOOTTIME, the time base of Android sensor event timestamps. */
+class LocTimeSyncResponder {
+public:
+  /* bucket i counts latencies below 2^i microseconds that did not fit
+     bucket i - 1; the last bucket takes everything longer */
+  enum { LATENCY_BUCKETS = 20 };
+
+  struct Stats {
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t failures;
+    /* requests replaced by a newer one before they were answered */
+    uint64_t superseded;
+    /* from receipt of the request until the answer is sent */
+    uint64_t latencyTotalUs;
+    uint64_t latencyMaxUs;
+    uint64_t latencyBuckets[LATENCY_BUCKETS];
+  };
+
+  LocTimeSyncResponder(const locClientHandleType& clientHandle);
+  ~LocTimeSyncResponder();
+
+  /* sensor time, as injected in time sync data */
+  static uint64_t sensorTimeNs();
+
+  /* time sync request received at rxNs sensor time; from the QMI
+     callback thread, never blocks on the modem */
+  void request(uint32_t refCounter, uint64_t rxNs);
+
+  void getStats(Stats& stats) const;
+
+private:
+  const locClientHandleType& mClientHandle;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+  /* guarded by mMutex */
+  bool mPending;
+  uint32_t mRefCounter;
+  uint64_t mRxNs;
+
+  std::atomic<uint64_t> mRequests;
+  std::atomic<uint64_t> mResponses;
+  std::atomic<uint64_t> mFailures;
+  std::atomic<uint64_t> mSuperseded;
+  std::atomic<uint64_t> mLatencyTotalUs;
+  std::atomic<uint64_t> mLatencyMaxUs;
+  std::atomic<uint64_t> mLatencyBuckets[LATENCY_BUCKETS];
+
+  static void* threadMain(void* arg);
+  void run();
+  void respond(uint32_t refCounter, uint64_t rxNs);
+};
+
+#endif //LOC_TIME_SYNC_RESPONDER_H
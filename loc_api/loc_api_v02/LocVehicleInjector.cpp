@@ -0,0 +1,442 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_VehicleInjector"
+
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <LocVehicleInjector.h>
+#include <loc_api_v02_log.h>
+#include <loc_api_sync_req.h>
+#include <loc_util_log.h>
+
+#define VEHICLE_DEFAULT_MAX_LATENCY_MS 100
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t countBits(uint32_t mask)
+{
+    uint32_t n = 0;
+    for (; mask; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+}
+
+static void clearMessage(qmiLocInjectVehicleSensorDataReqMsgT_v02& req)
+{
+    // the lists are (re)initialized when they become valid, so only
+    // the valid flags need resetting, not the whole message
+    req.accelData_valid = 0;
+    req.angRotationData_valid = 0;
+    req.odometryData_valid = 0;
+    req.changeInTimeScales_valid = 0;
+}
+
+LocVehicleInjector :: LocVehicleInjector(const locClientHandleType& clientHandle) :
+    mFilling(&mMessages[0]),
+    mSending(NULL),
+    mMaxLatencyNs(VEHICLE_DEFAULT_MAX_LATENCY_MS * 1000000ULL),
+    mClientHandle(clientHandle),
+    mThreadStarted(false),
+    mStop(false),
+    mSamplesQueued(0),
+    mSamplesDropped(0),
+    mSamplesDiscarded(0),
+    mSamplesInjected(0),
+    mMessagesSent(0),
+    mMessagesFailed(0),
+    mLatencyTotalUs(0),
+    mLatencyMaxUs(0)
+{
+    pthread_condattr_t condAttr;
+
+    memset(mMessages, 0, sizeof(mMessages));
+    for (int i = 0; i < VEHICLE_DATA_TYPE_MAX; i++) {
+        mReady[i] = false;
+    }
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+}
+
+LocVehicleInjector :: ~LocVehicleInjector()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool LocVehicleInjector :: pushSensorSample(DataType type, uint64_t timestampUs,
+                                            qmiLocAxesMaskT_v02 axes,
+                                            const float* values)
+{
+    if (type != VEHICLE_ACCEL && type != VEHICLE_ANGULAR_RATE) {
+        return false;
+    }
+    if (!mReady[type].load(std::memory_order_relaxed)) {
+        mSamplesDiscarded++;
+        return false;
+    }
+
+    axes &= QMI_LOC_MASK_X_AXIS_V02 | QMI_LOC_MASK_Y_AXIS_V02 |
+            QMI_LOC_MASK_Z_AXIS_V02;
+    uint32_t axisCount = countBits(axes);
+
+    pthread_mutex_lock(&mMutex);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        Message* m = mFilling;
+        uint8_t& valid = (VEHICLE_ACCEL == type) ?
+            m->req.accelData_valid : m->req.angRotationData_valid;
+        qmiLocVehicleSensorSampleListStructType_v02& list =
+            (VEHICLE_ACCEL == type) ? m->req.accelData : m->req.angRotationData;
+
+        if (valid &&
+            (list.sensorData_len >= QMI_LOC_VEHICLE_SENSOR_DATA_MAX_SAMPLES_V02 ||
+             list.axesValidity != axes ||
+             timestampUs < m->baseUs[type] ||
+             timestampUs - m->baseUs[type] > UINT32_MAX)) {
+            // does not fit this message, start the next one
+            if (0 == attempt && rotate()) {
+                continue;
+            }
+            break;
+        }
+
+        if (!valid) {
+            valid = 1;
+            m->baseUs[type] = timestampUs - timestampUs % 1000;
+            list.sampleTimeBase = (uint32_t)(timestampUs / 1000);
+            list.axesValidity = axes;
+            list.sensorData_len = 0;
+        }
+
+        qmiLocVehicleSensorSampleStructT_v02& sample =
+            list.sensorData[list.sensorData_len++];
+        sample.timeOffset = (uint32_t)(timestampUs - m->baseUs[type]);
+        sample.axisSample_len = axisCount;
+        memcpy(sample.axisSample, values, axisCount * sizeof(float));
+
+        queued(m);
+        if (list.sensorData_len >= QMI_LOC_VEHICLE_SENSOR_DATA_MAX_SAMPLES_V02) {
+            rotate();
+        }
+        pthread_mutex_unlock(&mMutex);
+        return true;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    mSamplesDropped++;
+    return false;
+}
+
+bool LocVehicleInjector :: pushOdometrySample(uint64_t timestampUs,
+    qmiLocVehicleOdometryWheelFlagsMaskT_v02 wheels,
+    qmiLocVehicleOdometryMeasDeviationMaskType_v02 flags,
+    const uint64_t* distanceMm)
+{
+    if (!mReady[VEHICLE_ODOMETRY].load(std::memory_order_relaxed)) {
+        mSamplesDiscarded++;
+        return false;
+    }
+
+    wheels &= QMI_LOC_MASK_VEHICLE_ODOMETRY_LEFT_AND_RIGHT_AVERAGE_V02 |
+              QMI_LOC_MASK_VEHICLE_ODOMETRY_LEFT_V02 |
+              QMI_LOC_MASK_VEHICLE_ODOMETRY_RIGHT_V02;
+    uint32_t wheelCount = countBits(wheels);
+    uint64_t minMm = UINT64_MAX;
+    uint64_t maxMm = 0;
+    for (uint32_t i = 0; i < wheelCount; i++) {
+        minMm = distanceMm[i] < minMm ? distanceMm[i] : minMm;
+        maxMm = distanceMm[i] > maxMm ? distanceMm[i] : maxMm;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        Message* m = mFilling;
+        qmiLocVehicleOdometrySampleListStructT_v02& list = m->req.odometryData;
+
+        if (m->req.odometryData_valid &&
+            (list.odometryData_len >= QMI_LOC_VEHICLE_SENSOR_DATA_MAX_SAMPLES_V02 ||
+             list.wheelFlags != wheels ||
+             timestampUs < m->baseUs[VEHICLE_ODOMETRY] ||
+             timestampUs - m->baseUs[VEHICLE_ODOMETRY] > UINT32_MAX ||
+             minMm < m->baseMm ||
+             maxMm - m->baseMm > UINT32_MAX)) {
+            if (0 == attempt && rotate()) {
+                continue;
+            }
+            break;
+        }
+
+        if (!m->req.odometryData_valid) {
+            m->req.odometryData_valid = 1;
+            m->baseUs[VEHICLE_ODOMETRY] = timestampUs - timestampUs % 1000;
+            // the base is in meters, the sample offsets in millimeters
+            m->baseMm = (0 == wheelCount) ? 0 : minMm - minMm % 1000;
+            list.sampleTimeBase = (uint32_t)(timestampUs / 1000);
+            list.flags = 0;
+            list.wheelFlags = wheels;
+            list.distanceTravelledBase = (uint32_t)(m->baseMm / 1000);
+            list.odometryData_len = 0;
+        }
+
+        qmiLocVehicleOdometrySampleStructT_v02& sample =
+            list.odometryData[list.odometryData_len++];
+        sample.timeOffset =
+            (uint32_t)(timestampUs - m->baseUs[VEHICLE_ODOMETRY]);
+        sample.distanceTravelled_len = wheelCount;
+        for (uint32_t i = 0; i < wheelCount; i++) {
+            sample.distanceTravelled[i] = (uint32_t)(distanceMm[i] - m->baseMm);
+        }
+        list.flags |= flags;
+
+        queued(m);
+        if (list.odometryData_len >= QMI_LOC_VEHICLE_SENSOR_DATA_MAX_SAMPLES_V02) {
+            rotate();
+        }
+        pthread_mutex_unlock(&mMutex);
+        return true;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    mSamplesDropped++;
+    return false;
+}
+
+void LocVehicleInjector :: readyStatus(
+    const qmiLocEventVehicleDataReadyIndMsgT_v02* status)
+{
+    struct {
+        uint8_t valid;
+        uint8_t ready;
+    } types[VEHICLE_DATA_TYPE_MAX] = {
+        { status->vehicleAccelReadyStatus_valid,
+          status->vehicleAccelReadyStatus },
+        { status->vehicleAngularRateReadyStatus_valid,
+          status->vehicleAngularRateReadyStatus },
+        { status->vehicleOdometryReadyStatus_valid,
+          status->vehicleOdometryReadyStatus }
+    };
+    bool anyReady = false;
+
+    pthread_mutex_lock(&mMutex);
+    for (int i = 0; i < VEHICLE_DATA_TYPE_MAX; i++) {
+        if (types[i].valid) {
+            mReady[i] = types[i].ready != 0;
+            LOC_LOGD("%s:%d]: vehicle data %d ready = %d",
+                     __func__, __LINE__, i, types[i].ready);
+        }
+        if (mReady[i]) {
+            anyReady = true;
+            continue;
+        }
+
+        // drop what was queued before the modem said stop
+        uint8_t* valid = NULL;
+        uint32_t len = 0;
+        switch (i) {
+        case VEHICLE_ACCEL:
+            valid = &mFilling->req.accelData_valid;
+            len = mFilling->req.accelData.sensorData_len;
+            break;
+        case VEHICLE_ANGULAR_RATE:
+            valid = &mFilling->req.angRotationData_valid;
+            len = mFilling->req.angRotationData.sensorData_len;
+            break;
+        default:
+            valid = &mFilling->req.odometryData_valid;
+            len = mFilling->req.odometryData.odometryData_len;
+            break;
+        }
+        if (*valid) {
+            *valid = 0;
+            mFilling->samples -= len;
+            mSamplesDiscarded += len;
+        }
+    }
+
+    if (anyReady && !mThreadStarted) {
+        mThreadStarted =
+            (0 == pthread_create(&mThread, NULL, threadMain, this));
+        if (!mThreadStarted) {
+            LOC_LOGE("%s:%d]: failed to start injection thread",
+                     __func__, __LINE__);
+        }
+    }
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocVehicleInjector :: resetReadyStatus()
+{
+    for (int i = 0; i < VEHICLE_DATA_TYPE_MAX; i++) {
+        mReady[i] = false;
+    }
+}
+
+void LocVehicleInjector :: setMaxLatency(uint32_t maxLatencyMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mMaxLatencyNs = (uint64_t)maxLatencyMs * 1000000ULL;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocVehicleInjector :: getStats(Stats& stats) const
+{
+    stats.samplesQueued = mSamplesQueued;
+    stats.samplesDropped = mSamplesDropped;
+    stats.samplesDiscarded = mSamplesDiscarded;
+    stats.samplesInjected = mSamplesInjected;
+    stats.messagesSent = mMessagesSent;
+    stats.messagesFailed = mMessagesFailed;
+    stats.latencyTotalUs = mLatencyTotalUs;
+    stats.latencyMaxUs = mLatencyMaxUs;
+}
+
+/* called with mMutex held after a sample was added to a message */
+void LocVehicleInjector :: queued(Message* message)
+{
+    if (0 == message->samples++) {
+        message->oldestNs = monotonicNs();
+        pthread_cond_signal(&mCond);
+    }
+    mSamplesQueued++;
+}
+
+/* called with mMutex held; hands the filling message to the injection
+   thread, false if that is still busy with the other one */
+bool LocVehicleInjector :: rotate()
+{
+    if (NULL != mSending || 0 == mFilling->samples) {
+        return false;
+    }
+    mSending = mFilling;
+    mFilling = (mFilling == &mMessages[0]) ? &mMessages[1] : &mMessages[0];
+    clearMessage(mFilling->req);
+    mFilling->samples = 0;
+    pthread_cond_signal(&mCond);
+    return true;
+}
+
+void* LocVehicleInjector :: threadMain(void* arg)
+{
+    ((LocVehicleInjector*)arg)->run();
+    return NULL;
+}
+
+/* injection thread; sends full messages as they come, and partial ones
+   once their oldest sample has waited for the max latency */
+void LocVehicleInjector :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        if (NULL != mSending) {
+            Message* message = mSending;
+            pthread_mutex_unlock(&mMutex);
+            send(message);
+            pthread_mutex_lock(&mMutex);
+            mSending = NULL;
+            continue;
+        }
+
+        if (0 == mFilling->samples) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+
+        uint64_t dueNs = mFilling->oldestNs + mMaxLatencyNs;
+        if (monotonicNs() >= dueNs) {
+            rotate();
+            continue;
+        }
+
+        struct timespec ts;
+        ts.tv_sec = dueNs / 1000000000ULL;
+        ts.tv_nsec = dueNs % 1000000000ULL;
+        pthread_cond_timedwait(&mCond, &mMutex, &ts);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocVehicleInjector :: send(Message* message)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocInjectVehicleSensorDataIndMsgT_v02 ind;
+
+    memset(&ind, 0, sizeof(ind));
+    req_union.pInjectVehicleSensorDataReq = &message->req;
+
+    status = loc_sync_send_req(mClientHandle,
+                               QMI_LOC_INJECT_VEHICLE_SENSOR_DATA_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_INJECT_VEHICLE_SENSOR_DATA_IND_V02,
+                               &ind);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != ind.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, ind.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(ind.status));
+        mMessagesFailed++;
+        return;
+    }
+
+    uint64_t latencyUs = (monotonicNs() - message->oldestNs) / 1000;
+    uint64_t maxUs = mLatencyMaxUs;
+    while (latencyUs > maxUs &&
+           !mLatencyMaxUs.compare_exchange_weak(maxUs, latencyUs)) {
+    }
+    mLatencyTotalUs += latencyUs;
+    mSamplesInjected += message->samples;
+    mMessagesSent++;
+
+    LOC_LOGV("%s:%d]: %u samples, latency = %llu us", __func__, __LINE__,
+             message->samples, (unsigned long long)latencyUs);
+}
@@ -0,0 +1,137 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_VEHICLE_INJECTOR_H
+#define LOC_VEHICLE_INJECTOR_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <loc_api_v02_client.h>
+
+/* Injects vehicle (CAN derived) acceleration, angular rate and odometry
+   samples with QMI_LOC_INJECT_VEHICLE_SENSOR_DATA_REQ_V02. Samples are
+   written straight into one of two preallocated request messages; when a
+   list reaches QMI_LOC_VEHICLE_SENSOR_DATA_MAX_SAMPLES_V02 samples, or
+   its oldest sample is older than the max latency, the message is handed
+   to the injection thread and producers carry on filling the other one.
+   Only data the modem reported ready for is accepted. */
+class LocVehicleInjector {
+public:
+  enum DataType {
+    VEHICLE_ACCEL = 0,
+    VEHICLE_ANGULAR_RATE,
+    VEHICLE_ODOMETRY,
+    VEHICLE_DATA_TYPE_MAX
+  };
+
+  struct Stats {
+    uint64_t samplesQueued;
+    /* both messages in use */
+    uint64_t samplesDropped;
+    /* modem not ready for the data type */
+    uint64_t samplesDiscarded;
+    uint64_t samplesInjected;
+    uint64_t messagesSent;
+    uint64_t messagesFailed;
+    /* from queueing of the oldest sample in a message until the
+       modem acknowledged the message */
+    uint64_t latencyTotalUs;
+    uint64_t latencyMaxUs;
+  };
+
+  LocVehicleInjector(const locClientHandleType& clientHandle);
+  ~LocVehicleInjector();
+
+  /* queue one acceleration or angular rate sample. timestampUs is the
+     vehicle sensor time in microseconds, values holds one value per
+     axis set in axes, in x, y, z order. Returns false if dropped. */
+  bool pushSensorSample(DataType type, uint64_t timestampUs,
+                        qmiLocAxesMaskT_v02 axes, const float* values);
+
+  /* queue one odometry sample. distanceMm holds the accumulated distance
+     for each wheel set in wheels, in average, left, right order; flags
+     are or'ed into the flags of the message. Returns false if dropped. */
+  bool pushOdometrySample(uint64_t timestampUs,
+                          qmiLocVehicleOdometryWheelFlagsMaskT_v02 wheels,
+                          qmiLocVehicleOdometryMeasDeviationMaskType_v02 flags,
+                          const uint64_t* distanceMm);
+
+  /* modem vehicle data ready status, from the QMI callback thread */
+  void readyStatus(const qmiLocEventVehicleDataReadyIndMsgT_v02* status);
+
+  /* the modem is gone; nothing is injected until it reports ready again */
+  void resetReadyStatus();
+
+  /* how long a partial message may wait for more samples */
+  void setMaxLatency(uint32_t maxLatencyMs);
+
+  void getStats(Stats& stats) const;
+
+private:
+  struct Message {
+    qmiLocInjectVehicleSensorDataReqMsgT_v02 req;
+    /* time base of each list, full range, to check sample offsets */
+    uint64_t baseUs[VEHICLE_DATA_TYPE_MAX];
+    uint64_t baseMm;
+    uint64_t oldestNs;
+    uint32_t samples;
+  };
+
+  /* guarded by mMutex; mFilling takes new samples, mSending is the
+     message being injected, or NULL if the injection thread is idle */
+  Message mMessages[2];
+  Message* mFilling;
+  Message* mSending;
+  uint64_t mMaxLatencyNs;
+  std::atomic<bool> mReady[VEHICLE_DATA_TYPE_MAX];
+
+  const locClientHandleType& mClientHandle;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+
+  std::atomic<uint64_t> mSamplesQueued;
+  std::atomic<uint64_t> mSamplesDropped;
+  std::atomic<uint64_t> mSamplesDiscarded;
+  std::atomic<uint64_t> mSamplesInjected;
+  std::atomic<uint64_t> mMessagesSent;
+  std::atomic<uint64_t> mMessagesFailed;
+  std::atomic<uint64_t> mLatencyTotalUs;
+  std::atomic<uint64_t> mLatencyMaxUs;
+
+  static void* threadMain(void* arg);
+  void run();
+  bool rotate();
+  void queued(Message* message);
+  void send(Message* message);
+};
+
+#endif //LOC_VEHICLE_INJECTOR_H
@@ -0,0 +1,215 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_WifiInjector"
+
+#include <string.h>
+#include <time.h>
+#include <LocWifiInjector.h>
+#include <loc_api_v02_log.h>
+#include <loc_api_sync_req.h>
+#include <loc_util_log.h>
+
+#define WIFI_DEFAULT_CACHE_TIMEOUT_MS 30000
+/* RSSI changes within the same step do not make a scan different */
+#define WIFI_RSSI_STEP_DBM 4
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+LocWifiInjector :: LocWifiInjector(const locClientHandleType& clientHandle) :
+    mClientHandle(clientHandle),
+    mDigestValid(false),
+    mInvalidations(0),
+    mDigest(0),
+    mDigestTimeNs(0),
+    mCacheTimeoutNs(WIFI_DEFAULT_CACHE_TIMEOUT_MS * 1000000ULL)
+{
+    memset(&mStats, 0, sizeof(mStats));
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_mutex_init(&mSendMutex, NULL);
+}
+
+LocWifiInjector :: ~LocWifiInjector()
+{
+    pthread_mutex_destroy(&mSendMutex);
+    pthread_mutex_destroy(&mMutex);
+}
+
+/* order independent digest of the BSSID and RSSI step of each AP, so
+   the same APs reported in another order still match */
+uint64_t LocWifiInjector :: digest(const qmiLocWifiApDataStructT_v02* aps,
+                                   size_t count)
+{
+    uint64_t sum = 0;
+    uint64_t xorSum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = 0;
+        for (int j = 0; j < QMI_LOC_WIFI_MAC_ADDR_LENGTH_V02; j++) {
+            key = (key << 8) | aps[i].macAddress[j];
+        }
+        if (aps[i].wifiApDataMask & QMI_LOC_WIFI_APDATA_MASK_AP_RSSI_V02) {
+            int32_t step = aps[i].apRssi / WIFI_RSSI_STEP_DBM;
+            key ^= (uint64_t)(uint16_t)step << 48 | 1ULL << 63;
+        }
+        uint64_t h = mix64(key);
+        sum += h;
+        xorSum ^= mix64(h);
+    }
+    return mix64(sum ^ mix64(xorSum + count));
+}
+
+locClientStatusEnumType LocWifiInjector :: inject(
+    const qmiLocWifiApDataStructT_v02* aps, size_t count, bool& skipped)
+{
+    locClientStatusEnumType status = eLOC_CLIENT_SUCCESS;
+    locClientReqUnionType req_union;
+    qmiLocInjectWifiApDataReqMsgT_v02 req;
+    qmiLocInjectWifiApDataIndMsgT_v02 ind;
+    uint64_t startNs = monotonicNs();
+    uint64_t scanDigest = digest(aps, count);
+    uint32_t invalidations = mInvalidations.load();
+    uint64_t messages = 0;
+
+    skipped = false;
+    pthread_mutex_lock(&mMutex);
+
+    if (mDigestValid && mDigest == scanDigest && mCacheTimeoutNs > 0 &&
+        startNs - mDigestTimeNs < mCacheTimeoutNs) {
+        skipped = true;
+        mStats.scansSkipped++;
+        mStats.bytesSaved += count * sizeof(qmiLocWifiApDataStructT_v02);
+        pthread_mutex_unlock(&mMutex);
+        LOC_LOGV("%s:%d]: scan of %zu APs unchanged", __func__, __LINE__, count);
+        return eLOC_CLIENT_SUCCESS;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    pthread_mutex_lock(&mSendMutex);
+
+    // an empty scan is still sent once, it tells the modem there are no APs
+    size_t offset = 0;
+    do {
+        size_t chunk = count - offset;
+        if (chunk > QMI_LOC_WIFI_MAX_REPORTED_APS_PER_MSG_V02) {
+            chunk = QMI_LOC_WIFI_MAX_REPORTED_APS_PER_MSG_V02;
+        }
+
+        req.wifiApInfo_len = chunk;
+        memcpy(req.wifiApInfo, aps + offset,
+               chunk * sizeof(qmiLocWifiApDataStructT_v02));
+        memset(&ind, 0, sizeof(ind));
+        req_union.pInjectWifiApDataReq = &req;
+
+        status = loc_sync_send_req(mClientHandle,
+                                   QMI_LOC_INJECT_WIFI_AP_DATA_REQ_V02,
+                                   req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                                   QMI_LOC_INJECT_WIFI_AP_DATA_IND_V02,
+                                   &ind);
+
+        if (status != eLOC_CLIENT_SUCCESS ||
+            eQMI_LOC_SUCCESS_V02 != ind.status)
+        {
+            LOC_LOGE ("%s:%d]: error! status = %s, ind.status = %s\n",
+                      __func__, __LINE__,
+                      loc_get_v02_client_status_name(status),
+                      loc_get_v02_qmi_status_name(ind.status));
+            if (eLOC_CLIENT_SUCCESS == status) {
+                status = eLOC_CLIENT_FAILURE_GENERAL;
+            }
+            pthread_mutex_unlock(&mSendMutex);
+
+            pthread_mutex_lock(&mMutex);
+            // a partly injected scan must not suppress the next one
+            mDigestValid = false;
+            mStats.messagesSent += messages;
+            mStats.scansFailed++;
+            pthread_mutex_unlock(&mMutex);
+            return status;
+        }
+
+        messages++;
+        offset += chunk;
+    } while (offset < count);
+    pthread_mutex_unlock(&mSendMutex);
+
+    uint64_t endNs = monotonicNs();
+    uint64_t latencyUs = (endNs - startNs) / 1000;
+    pthread_mutex_lock(&mMutex);
+    mDigest = scanDigest;
+    mDigestTimeNs = endNs;
+    // not cached if the modem asked for AP data while the scan was in flight
+    mDigestValid = (invalidations == mInvalidations.load());
+    mStats.messagesSent += messages;
+    mStats.scansInjected++;
+    mStats.latencyTotalUs += latencyUs;
+    if (latencyUs > mStats.latencyMaxUs) {
+        mStats.latencyMaxUs = latencyUs;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOC_LOGV("%s:%d]: %zu APs injected, latency = %llu us", __func__, __LINE__,
+             count, (unsigned long long)latencyUs);
+    return status;
+}
+
+void LocWifiInjector :: invalidate()
+{
+    mInvalidations++;
+    mDigestValid = false;
+}
+
+void LocWifiInjector :: setCacheTimeout(uint32_t timeoutMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mCacheTimeoutNs = (uint64_t)timeoutMs * 1000000ULL;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocWifiInjector :: getStats(Stats& stats) const
+{
+    pthread_mutex_lock(&mMutex);
+    stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
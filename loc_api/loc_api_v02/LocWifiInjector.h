@@ -0,0 +1,93 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_WIFI_INJECTOR_H
+#define LOC_WIFI_INJECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <atomic>
+#include <loc_api_v02_client.h>
+
+/* Injects Wi-Fi AP scans with QMI_LOC_INJECT_WIFI_AP_DATA_REQ_V02, split
+   into messages of QMI_LOC_WIFI_MAX_REPORTED_APS_PER_MSG_V02 APs. A scan
+   whose BSSID/RSSI set matches the last injected one is not sent again
+   until the cache expires or is invalidated, e.g. when the modem asks
+   for AP data. */
+class LocWifiInjector {
+public:
+  struct Stats {
+    uint64_t scansInjected;
+    /* unchanged scans that were not sent */
+    uint64_t scansSkipped;
+    uint64_t scansFailed;
+    uint64_t messagesSent;
+    /* AP records of skipped scans, in bytes of the request structure */
+    uint64_t bytesSaved;
+    /* from the inject call until the last message of the scan was
+       acknowledged */
+    uint64_t latencyTotalUs;
+    uint64_t latencyMaxUs;
+  };
+
+  LocWifiInjector(const locClientHandleType& clientHandle);
+  ~LocWifiInjector();
+
+  /* inject one scan; skipped is set if the scan was not sent because
+     it is unchanged */
+  locClientStatusEnumType inject(const qmiLocWifiApDataStructT_v02* aps,
+                                 size_t count, bool& skipped);
+
+  /* the next scan is sent even if unchanged; does not block, it is
+     called from the QMI callback thread while a scan may be in flight */
+  void invalidate();
+
+  /* how long an unchanged scan is suppressed, 0 to never suppress */
+  void setCacheTimeout(uint32_t timeoutMs);
+
+  void getStats(Stats& stats) const;
+
+private:
+  const locClientHandleType& mClientHandle;
+  /* guards the digest and stats, never held across a request */
+  mutable pthread_mutex_t mMutex;
+  /* serializes the messages of a scan */
+  pthread_mutex_t mSendMutex;
+  std::atomic<bool> mDigestValid;
+  /* bumped by invalidate, a scan in flight across it is not cached */
+  std::atomic<uint32_t> mInvalidations;
+  uint64_t mDigest;
+  uint64_t mDigestTimeNs;
+  uint64_t mCacheTimeoutNs;
+  Stats mStats;
+
+  static uint64_t digest(const qmiLocWifiApDataStructT_v02* aps, size_t count);
+};
+
+#endif //LOC_WIFI_INJECTOR_H
@@ -0,0 +1,309 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_XtraManager"
+
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <LocXtraManager.h>
+#include <loc_api_v02_log.h>
+#include <loc_api_sync_req.h>
+#include <loc_util_log.h>
+
+#define DEFAULT_HORIZON_HOURS 24
+#define SEC_PER_HOUR 3600ULL
+#define MIN_REFRESH_SEC SEC_PER_HOUR
+
+static uint64_t utcSec()
+{
+    return (uint64_t)time(NULL);
+}
+
+/* the horizon, capped at half the validity the data had when injected;
+   a horizon past that would ask for a download right after every
+   injection of data valid for less than the horizon */
+static uint64_t cappedHorizon(uint64_t horizonSec, uint64_t injectedSec,
+                              uint64_t expirySec)
+{
+    if (0 == injectedSec) {
+        return horizonSec;
+    }
+    uint64_t validitySec = expirySec > injectedSec ? expirySec - injectedSec : 0;
+    return std::min(horizonSec, validitySec / 2);
+}
+
+/* 64 bit FNV-1a of an XTRA file */
+static uint64_t xtraHash(const char* data, int length)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+LocXtraManager :: LocXtraManager(const locClientHandleType& clientHandle,
+                                 RefreshCb refreshCb, void* context) :
+    mClientHandle(clientHandle),
+    mRefreshCb(refreshCb),
+    mContext(context),
+    mThreadStarted(false),
+    mStop(false),
+    mHorizonSec(DEFAULT_HORIZON_HOURS * SEC_PER_HOUR),
+    mRequested(true),
+    mLastValid(false),
+    mLastHash(0),
+    mLastLength(0),
+    mExpirySec(0),
+    mInjectedSec(0),
+    mInSession(false),
+    mCharging(false),
+    mInjections(0),
+    mSkippedSame(0),
+    mSkippedValid(0),
+    mValidityQueries(0),
+    mRefreshes(0),
+    mBytesSaved(0)
+{
+    pthread_mutex_init(&mMutex, NULL);
+    // deadlines are in UTC, as is the validity reported by the modem
+    pthread_cond_init(&mCond, NULL);
+
+    mThreadStarted = (0 == pthread_create(&mThread, NULL, threadMain, this));
+    if (!mThreadStarted) {
+        LOC_LOGE("%s:%d]: failed to start refresh thread",
+                 __func__, __LINE__);
+    }
+}
+
+LocXtraManager :: ~LocXtraManager()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocXtraManager :: setHorizon(uint32_t horizonHours)
+{
+    pthread_mutex_lock(&mMutex);
+    mHorizonSec = horizonHours * SEC_PER_HOUR;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocXtraManager :: requested()
+{
+    pthread_mutex_lock(&mMutex);
+    mRequested = true;
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool LocXtraManager :: shouldInject(const char* data, int length)
+{
+    uint64_t hash = xtraHash(data, length);
+    uint64_t expirySec;
+
+    pthread_mutex_lock(&mMutex);
+    bool requested = mRequested;
+    bool same = (mLastValid && mLastLength == length && mLastHash == hash);
+    uint64_t horizonSec = mHorizonSec;
+    uint64_t injectedSec = mInjectedSec;
+    pthread_mutex_unlock(&mMutex);
+
+    if (requested) {
+        return true;
+    }
+    if (same) {
+        LOC_LOGD("%s:%d]: same XTRA file as last injected, skipped",
+                 __func__, __LINE__);
+        mSkippedSame++;
+        mBytesSaved += length;
+        return false;
+    }
+    if (queryExpiry(expirySec) &&
+        expirySec > utcSec() + cappedHorizon(horizonSec, injectedSec, expirySec)) {
+        LOC_LOGD("%s:%d]: modem XTRA data valid for %llu s, skipped",
+                 __func__, __LINE__,
+                 (unsigned long long)(expirySec - utcSec()));
+        mSkippedValid++;
+        mBytesSaved += length;
+        return false;
+    }
+    return true;
+}
+
+void LocXtraManager :: injected(const char* data, int length, bool success)
+{
+    uint64_t expirySec = 0;
+    bool known = false;
+
+    if (success) {
+        mInjections++;
+        known = queryExpiry(expirySec);
+    }
+
+    pthread_mutex_lock(&mMutex);
+    mLastValid = success;
+    if (success) {
+        mLastHash = xtraHash(data, length);
+        mLastLength = length;
+        mRequested = false;
+        mInjectedSec = utcSec();
+    }
+    if (known) {
+        mExpirySec = expirySec;
+        pthread_cond_signal(&mCond);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocXtraManager :: setInSession(bool inSession)
+{
+    pthread_mutex_lock(&mMutex);
+    mInSession = inSession;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocXtraManager :: setCharging(bool charging)
+{
+    pthread_mutex_lock(&mMutex);
+    mCharging = charging;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocXtraManager :: reset()
+{
+    pthread_mutex_lock(&mMutex);
+    mRequested = true;
+    mLastValid = false;
+    mExpirySec = 0;
+    mInjectedSec = 0;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocXtraManager :: getStats(Stats& stats) const
+{
+    stats.injections = mInjections;
+    stats.skippedSame = mSkippedSame;
+    stats.skippedValid = mSkippedValid;
+    stats.validityQueries = mValidityQueries;
+    stats.refreshes = mRefreshes;
+    stats.bytesSaved = mBytesSaved;
+}
+
+/* UTC time the XTRA data held by the modem expires at */
+bool LocXtraManager :: queryExpiry(uint64_t& expirySec)
+{
+    locClientStatusEnumType status;
+    locClientReqUnionType req_union;
+    qmiLocGetPredictedOrbitsDataValidityIndMsgT_v02 ind;
+
+    memset(&ind, 0, sizeof(ind));
+    mValidityQueries++;
+
+    // no payload, req_union is only passed along
+    status = loc_sync_send_req(mClientHandle,
+                               QMI_LOC_GET_PREDICTED_ORBITS_DATA_VALIDITY_REQ_V02,
+                               req_union, LOC_ENGINE_SYNC_REQUEST_TIMEOUT,
+                               QMI_LOC_GET_PREDICTED_ORBITS_DATA_VALIDITY_IND_V02,
+                               &ind);
+
+    if (status != eLOC_CLIENT_SUCCESS ||
+        eQMI_LOC_SUCCESS_V02 != ind.status)
+    {
+        LOC_LOGE ("%s:%d]: error! status = %s, ind.status = %s\n",
+                  __func__, __LINE__,
+                  loc_get_v02_client_status_name(status),
+                  loc_get_v02_qmi_status_name(ind.status));
+        return false;
+    }
+    if (!ind.validityInfo_valid || 0 == ind.validityInfo.durationHours) {
+        return false;
+    }
+    expirySec = ind.validityInfo.startTimeInUTC +
+                ind.validityInfo.durationHours * SEC_PER_HOUR;
+    return true;
+}
+
+void* LocXtraManager :: threadMain(void* arg)
+{
+    ((LocXtraManager*)arg)->run();
+    return NULL;
+}
+
+void LocXtraManager :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        if (0 == mExpirySec) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+
+        uint64_t nowSec = utcSec();
+        uint64_t horizonSec = cappedHorizon(mHorizonSec, mInjectedSec, mExpirySec);
+        uint64_t dueSec = mExpirySec > horizonSec ? mExpirySec - horizonSec : 0;
+        // data that expires right away must not loop on refreshes
+        dueSec = std::max(dueSec, mInjectedSec + (uint64_t)MIN_REFRESH_SEC);
+        // past this, refresh regardless of load
+        uint64_t deadlineSec = dueSec < mExpirySec ?
+            mExpirySec - (mExpirySec - dueSec) / 2 : dueSec;
+        bool idle = !mInSession || mCharging;
+
+        if (nowSec < dueSec || (nowSec < deadlineSec && !idle)) {
+            struct timespec ts;
+            ts.tv_sec = nowSec < dueSec ? dueSec : deadlineSec;
+            ts.tv_nsec = 0;
+            // a load change or a new expiry wakes us early
+            pthread_cond_timedwait(&mCond, &mMutex, &ts);
+            continue;
+        }
+
+        LOC_LOGD("%s:%d]: XTRA data expires in %lld s, refreshing",
+                 __func__, __LINE__, (long long)(mExpirySec - nowSec));
+        // the next injection tells the new expiry
+        mExpirySec = 0;
+        mRefreshes++;
+        pthread_mutex_unlock(&mMutex);
+        mRefreshCb(mContext);
+        pthread_mutex_lock(&mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
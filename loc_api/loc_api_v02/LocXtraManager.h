@@ -0,0 +1,122 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_XTRA_MANAGER_H
+#define LOC_XTRA_MANAGER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <loc_api_v02_client.h>
+
+/* Decides whether an XTRA file needs to be injected, and asks for a
+   download before the data held by the modem runs out.
+
+   A file is injected when the modem asked for XTRA data since the last
+   injection. Otherwise it is skipped when it is the file injected last,
+   or when the modem reports data that stays valid for the configured
+   horizon. Once the validity of the modem data is known, a refresh is
+   scheduled for when less than the horizon is left; it waits for a
+   moment without a fix session, or with external power, up to a
+   deadline half way to expiry. Data valid for less than twice the
+   horizon is refreshed half way through its validity instead, and
+   never sooner than an hour after it was injected. */
+class LocXtraManager {
+public:
+  struct Stats {
+    uint64_t injections;
+    /* identical to the file injected last */
+    uint64_t skippedSame;
+    /* the modem data was still valid for the horizon */
+    uint64_t skippedValid;
+    uint64_t validityQueries;
+    uint64_t refreshes;
+    uint64_t bytesSaved;
+  };
+
+  /* asks loc eng to download XTRA data */
+  typedef void (*RefreshCb)(void* context);
+
+  LocXtraManager(const locClientHandleType& clientHandle,
+                 RefreshCb refreshCb, void* context);
+  ~LocXtraManager();
+
+  void setHorizon(uint32_t horizonHours);
+
+  /* the modem asked for XTRA data */
+  void requested();
+  /* whether data should be injected; from the injecting thread */
+  bool shouldInject(const char* data, int length);
+  /* outcome of an injection shouldInject() allowed */
+  void injected(const char* data, int length, bool success);
+
+  /* load hints for the refresh */
+  void setInSession(bool inSession);
+  void setCharging(bool charging);
+
+  /* forget what the modem holds, e.g. after a modem restart */
+  void reset();
+
+  void getStats(Stats& stats) const;
+
+private:
+  const locClientHandleType& mClientHandle;
+  RefreshCb mRefreshCb;
+  void* mContext;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+
+  /* guarded by mMutex */
+  uint64_t mHorizonSec;
+  bool mRequested;
+  bool mLastValid;
+  uint64_t mLastHash;
+  int mLastLength;
+  /* UTC seconds the modem data expires at, 0 if unknown */
+  uint64_t mExpirySec;
+  /* UTC seconds of the last successful injection, 0 if none */
+  uint64_t mInjectedSec;
+  bool mInSession;
+  bool mCharging;
+
+  std::atomic<uint64_t> mInjections;
+  std::atomic<uint64_t> mSkippedSame;
+  std::atomic<uint64_t> mSkippedValid;
+  std::atomic<uint64_t> mValidityQueries;
+  std::atomic<uint64_t> mRefreshes;
+  std::atomic<uint64_t> mBytesSaved;
+
+  bool queryExpiry(uint64_t& expirySec);
+  static void* threadMain(void* arg);
+  void run();
+};
+
+#endif //LOC_XTRA_MANAGER_H
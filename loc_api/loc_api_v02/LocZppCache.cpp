@@ -0,0 +1,291 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_ZppCache"
+
+#include <string.h>
+#include <time.h>
+#include <LocZppCache.h>
+#include <loc_api_v02_log.h>
+#include <loc_util_log.h>
+
+using namespace loc_core;
+
+#define NS_PER_MS 1000000ULL
+/* a fix without technology bits, e.g. from an older modem */
+#define DEFAULT_TTL_MS 10000
+/* GNSS and sensor fixes age quickly, cell and Wi-Fi ones hardly move */
+#define SATELLITE_TTL_MS 5000
+#define WIFI_TTL_MS 30000
+#define CELLID_TTL_MS 60000
+#define DEFAULT_MAX_STALE_MS 300000
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+LocZppCache :: LocZppCache(FetchFn fetch, void* context) :
+    mFetch(fetch),
+    mContext(context),
+    mThreadStarted(false),
+    mStop(false),
+    mDefaultTtlMs(DEFAULT_TTL_MS),
+    mMaxStaleMs(DEFAULT_MAX_STALE_MS),
+    mGeneration(0),
+    mHits(0),
+    mStaleHits(0),
+    mMisses(0),
+    mJoined(0),
+    mRequests(0),
+    mFailures(0),
+    mStaleTotalMs(0),
+    mStaleMaxMs(0)
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    for (int i = 0; i < TECH_BITS; i++) {
+        mTtlMs[i] = DEFAULT_TTL_MS;
+    }
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+
+    setTtl(LOC_POS_TECH_MASK_SATELLITE | LOC_POS_TECH_MASK_SENSORS |
+           LOC_POS_TECH_MASK_HYBRID, SATELLITE_TTL_MS);
+    setTtl(LOC_POS_TECH_MASK_WIFI, WIFI_TTL_MS);
+    setTtl(LOC_POS_TECH_MASK_CELLID | LOC_POS_TECH_MASK_AFLT, CELLID_TTL_MS);
+
+    mThreadStarted = (0 == pthread_create(&mThread, NULL, threadMain, this));
+    if (!mThreadStarted) {
+        LOC_LOGE("%s:%d]: failed to start refresh thread",
+                 __func__, __LINE__);
+    }
+}
+
+LocZppCache :: ~LocZppCache()
+{
+    pthread_mutex_lock(&mMutex);
+    mStop = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocZppCache :: setTtl(LocPosTechMask techMask, uint32_t ttlMs)
+{
+    pthread_mutex_lock(&mMutex);
+    if (LOC_POS_TECH_MASK_DEFAULT == techMask) {
+        mDefaultTtlMs = ttlMs;
+    }
+    for (int i = 0; i < TECH_BITS; i++) {
+        if (techMask & (1 << i)) {
+            mTtlMs[i] = ttlMs;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocZppCache :: setMaxStale(uint32_t maxStaleMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mMaxStaleMs = maxStaleMs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+/* called with mMutex held */
+uint64_t LocZppCache :: ttlNs(LocPosTechMask techMask) const
+{
+    uint32_t ttlMs = UINT32_MAX;
+
+    for (int i = 0; i < TECH_BITS; i++) {
+        if ((techMask & (1 << i)) && mTtlMs[i] < ttlMs) {
+            ttlMs = mTtlMs[i];
+        }
+    }
+    if (UINT32_MAX == ttlMs) {
+        ttlMs = mDefaultTtlMs;
+    }
+    return ttlMs * NS_PER_MS;
+}
+
+enum loc_api_adapter_err
+LocZppCache :: get(Source source, GpsLocation& zppLoc, LocPosTechMask& techMask)
+{
+    Entry& entry = mEntries[source];
+    enum loc_api_adapter_err err;
+
+    pthread_mutex_lock(&mMutex);
+    if (entry.valid) {
+        uint64_t ageNs = monotonicNs() - entry.fetchedNs;
+        uint64_t ttl = ttlNs(entry.techMask);
+
+        if (ageNs <= ttl) {
+            mHits++;
+            zppLoc = entry.location;
+            techMask = entry.techMask;
+            pthread_mutex_unlock(&mMutex);
+            return LOC_API_ADAPTER_ERR_SUCCESS;
+        }
+        if (ageNs <= ttl + mMaxStaleMs * NS_PER_MS) {
+            uint64_t staleMs = (ageNs - ttl) / NS_PER_MS;
+            uint64_t maxMs = mStaleMaxMs;
+            while (staleMs > maxMs &&
+                   !mStaleMaxMs.compare_exchange_weak(maxMs, staleMs)) {
+            }
+            mStaleTotalMs += staleMs;
+            mStaleHits++;
+
+            if (!entry.inFlight && mThreadStarted) {
+                entry.inFlight = true;
+                entry.refresh = true;
+                pthread_cond_broadcast(&mCond);
+            }
+            zppLoc = entry.location;
+            techMask = entry.techMask;
+            pthread_mutex_unlock(&mMutex);
+            return LOC_API_ADAPTER_ERR_SUCCESS;
+        }
+    }
+
+    mMisses++;
+    if (entry.inFlight) {
+        // share the request already on its way
+        uint32_t round = entry.round;
+        mJoined++;
+        while (!mStop && entry.round == round) {
+            pthread_cond_wait(&mCond, &mMutex);
+        }
+    } else {
+        entry.inFlight = true;
+        pthread_mutex_unlock(&mMutex);
+        fetch(source);
+        pthread_mutex_lock(&mMutex);
+    }
+
+    err = entry.lastErr;
+    if (LOC_API_ADAPTER_ERR_SUCCESS == err) {
+        zppLoc = entry.location;
+        techMask = entry.techMask;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return err;
+}
+
+void LocZppCache :: invalidate()
+{
+    pthread_mutex_lock(&mMutex);
+    mGeneration++;
+    for (int i = 0; i < SOURCE_MAX; i++) {
+        mEntries[i].valid = false;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocZppCache :: getStats(Stats& stats) const
+{
+    stats.hits = mHits;
+    stats.staleHits = mStaleHits;
+    stats.misses = mMisses;
+    stats.joined = mJoined;
+    stats.requests = mRequests;
+    stats.failures = mFailures;
+    stats.staleTotalMs = mStaleTotalMs;
+    stats.staleMaxMs = mStaleMaxMs;
+}
+
+/* request a fix from the modem and complete the round; called without
+   mMutex held, with the entry marked in flight */
+void LocZppCache :: fetch(Source source)
+{
+    Entry& entry = mEntries[source];
+    GpsLocation location;
+    LocPosTechMask techMask = LOC_POS_TECH_MASK_DEFAULT;
+
+    pthread_mutex_lock(&mMutex);
+    uint32_t generation = mGeneration;
+    pthread_mutex_unlock(&mMutex);
+
+    mRequests++;
+    enum loc_api_adapter_err err = mFetch(mContext, source, location, techMask);
+    uint64_t nowNs = monotonicNs();
+
+    pthread_mutex_lock(&mMutex);
+    if (LOC_API_ADAPTER_ERR_SUCCESS == err) {
+        // handed to the callers of this round even if not cached, the
+        // modem may succeed without a position
+        entry.location = location;
+        entry.techMask = techMask;
+        entry.fetchedNs = nowNs;
+        entry.valid = (generation == mGeneration &&
+                       (location.flags & GPS_LOCATION_HAS_LAT_LONG));
+    } else {
+        // a stale fix stays until it is too old, the modem may be busy
+        mFailures++;
+        LOC_LOGD("%s:%d]: source %d, err = %d", __func__, __LINE__,
+                 source, err);
+    }
+    entry.lastErr = err;
+    entry.inFlight = false;
+    entry.round++;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void* LocZppCache :: threadMain(void* arg)
+{
+    ((LocZppCache*)arg)->run();
+    return NULL;
+}
+
+void LocZppCache :: run()
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mStop) {
+        int source = 0;
+        while (source < SOURCE_MAX && !mEntries[source].refresh) {
+            source++;
+        }
+        if (SOURCE_MAX == source) {
+            pthread_cond_wait(&mCond, &mMutex);
+            continue;
+        }
+        mEntries[source].refresh = false;
+
+        pthread_mutex_unlock(&mMutex);
+        fetch((Source)source);
+        pthread_mutex_lock(&mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
@@ -0,0 +1,133 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_ZPP_CACHE_H
+#define LOC_ZPP_CACHE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+#include <LocApiBase.h>
+
+/* Caches the ZPP fixes read from the modem. A fix is fresh for a TTL
+   that depends on the technologies it was computed from; the shortest
+   TTL of its technology bits applies. A stale fix is still returned
+   right away, up to the max staleness, and refreshed in the background.
+   Only without a usable fix does a caller wait for the modem, and
+   concurrent callers then share a single request. */
+class LocZppCache {
+public:
+  enum Source {
+    SOURCE_WWAN = 0,
+    SOURCE_BEST_AVAILABLE,
+    SOURCE_MAX
+  };
+
+  struct Stats {
+    uint64_t hits;
+    /* stale fixes returned while a refresh was started */
+    uint64_t staleHits;
+    /* callers that had to wait for the modem */
+    uint64_t misses;
+    /* misses that shared a request already in flight */
+    uint64_t joined;
+    uint64_t requests;
+    uint64_t failures;
+    /* age beyond the TTL of the stale fixes returned */
+    uint64_t staleTotalMs;
+    uint64_t staleMaxMs;
+  };
+
+  /* reads a fix from the modem */
+  typedef enum loc_core::loc_api_adapter_err
+    (*FetchFn)(void* context, Source source,
+               GpsLocation& zppLoc, LocPosTechMask& techMask);
+
+  LocZppCache(FetchFn fetch, void* context);
+  ~LocZppCache();
+
+  /* TTL of the fixes computed with the technologies in techMask;
+     LOC_POS_TECH_MASK_DEFAULT sets the TTL of fixes without any */
+  void setTtl(LocPosTechMask techMask, uint32_t ttlMs);
+  void setMaxStale(uint32_t maxStaleMs);
+
+  enum loc_core::loc_api_adapter_err
+    get(Source source, GpsLocation& zppLoc, LocPosTechMask& techMask);
+
+  /* drop the cached fixes, e.g. after a modem restart */
+  void invalidate();
+
+  void getStats(Stats& stats) const;
+
+private:
+  enum { TECH_BITS = 16 };
+
+  struct Entry {
+    bool valid;
+    GpsLocation location;
+    LocPosTechMask techMask;
+    uint64_t fetchedNs;
+    bool inFlight;
+    bool refresh;
+    /* outcome of the last request, for the callers that waited on it */
+    uint32_t round;
+    enum loc_core::loc_api_adapter_err lastErr;
+  };
+
+  FetchFn mFetch;
+  void* mContext;
+  pthread_mutex_t mMutex;
+  pthread_cond_t mCond;
+  pthread_t mThread;
+  bool mThreadStarted;
+  bool mStop;
+
+  /* guarded by mMutex */
+  Entry mEntries[SOURCE_MAX];
+  uint32_t mTtlMs[TECH_BITS];
+  uint32_t mDefaultTtlMs;
+  uint32_t mMaxStaleMs;
+  /* bumped on invalidate, results of older requests are dropped */
+  uint32_t mGeneration;
+
+  std::atomic<uint64_t> mHits;
+  std::atomic<uint64_t> mStaleHits;
+  std::atomic<uint64_t> mMisses;
+  std::atomic<uint64_t> mJoined;
+  std::atomic<uint64_t> mRequests;
+  std::atomic<uint64_t> mFailures;
+  std::atomic<uint64_t> mStaleTotalMs;
+  std::atomic<uint64_t> mStaleMaxMs;
+
+  uint64_t ttlNs(LocPosTechMask techMask) const;
+  void fetch(Source source);
+  static void* threadMain(void* arg);
+  void run();
+};
+
+#endif //LOC_ZPP_CACHE_H
@@ -45,8 +45,13 @@
 #define LOG_NDDEBUG 1
 #define LOG_TAG "LocSvc_api_v02"
 #include "loc_util_log.h"
+#include "loc_trace.h"
+#include "loc_metrics.h"
 
 #define LOC_SYNC_REQ_BUFFER_SIZE 8
+/* requests of a batch in flight at once, the other slots are left to
+   other threads */
+#define LOC_SYNC_BATCH_WINDOW (LOC_SYNC_REQ_BUFFER_SIZE / 2)
 #define GPS_CONF_FILE "/etc/gps.conf"
 pthread_mutex_t  loc_sync_call_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -68,6 +73,7 @@ typedef struct {
    uint32_t                req_id;                    /*  sync request */
    void                    *recv_ind_payload_ptr; /* received  payload */
    uint32_t                recv_ind_id;      /* received  ind   */
+   uint32_t                select_seq;       /* order of selection */
 
 } loc_sync_req_data_s_type;
 
@@ -81,6 +87,7 @@ typedef struct {
  *                 DATA FOR ASYNCHRONOUS RPC PROCESSING
  **************************************************************************/
 loc_sync_req_array_s_type loc_sync_array;
+static uint32_t loc_sync_select_seq = 0;
 
 /*===========================================================================
 
@@ -161,8 +168,9 @@ void loc_sync_process_ind(
 )
 {
 
-   LOC_LOGV("%s:%d]: received indication, handle = %p ind_id = %u \n",
-                 __func__,__LINE__, client_handle, ind_id);
+   LOC_TRACE_OR_LOG(LOC_TRACE_SYNC_IND, ind_id, 0, 0, 0, LOC_LOGV,
+                    "%s:%d]: received indication, handle = %p ind_id = %u \n",
+                    __func__,__LINE__, client_handle, ind_id);
 
    pthread_mutex_lock(&loc_sync_call_mutex);
 
@@ -174,52 +182,66 @@ void loc_sync_process_ind(
       return;
    }
 
-   bool in_use = false, consumed = false;
-   int i;
+   bool in_use = false;
+   int i, match = -1;
+   uint32_t match_seq = 0;
 
-   for (i = 0; i < LOC_SYNC_REQ_BUFFER_SIZE && !consumed; i++)
+   /* the oldest selection waiting for this ind gets it, so requests with
+      the same ind id in flight together are answered in send order */
+   for (i = 0; i < LOC_SYNC_REQ_BUFFER_SIZE; i++)
    {
       loc_sync_req_data_s_type *slot = &loc_sync_array.slots[i];
 
       in_use |= loc_sync_array.slot_in_use[i];
 
       pthread_mutex_lock(&slot->sync_req_lock);
-
       if ( (loc_sync_array.slot_in_use[i]) && (slot->client_handle == client_handle)
-            && (ind_id == slot->recv_ind_id) && (!slot->ind_has_arrived))
+            && (ind_id == slot->recv_ind_id) && (!slot->ind_has_arrived)
+            && (match < 0 || (int32_t)(slot->select_seq - match_seq) < 0))
       {
-         // copy the payload to the slot waiting for this ind
-         size_t payload_size = 0;
+         match = i;
+         match_seq = slot->select_seq;
+      }
+      pthread_mutex_unlock(&slot->sync_req_lock);
+   }
 
-         LOC_LOGV("%s:%d]: found slot %d selected for ind %u \n",
-                       __func__, __LINE__, i, ind_id);
+   if (match >= 0)
+   {
+      loc_sync_req_data_s_type *slot = &loc_sync_array.slots[match];
+      // copy the payload to the slot waiting for this ind
+      size_t payload_size = 0;
 
-         if(true == locClientGetSizeByRespIndId(ind_id, &payload_size) &&
-            NULL != slot->recv_ind_payload_ptr && NULL != ind_payload_ptr)
-         {
-            LOC_LOGV("%s:%d]: copying ind payload size = %lu \n",
-                          __func__, __LINE__, payload_size);
+      pthread_mutex_lock(&slot->sync_req_lock);
 
-            memcpy(slot->recv_ind_payload_ptr, ind_payload_ptr, payload_size);
+      LOC_TRACE_OR_LOG(LOC_TRACE_SYNC_MATCH, match, ind_id, 0, 0, LOC_LOGV,
+                       "%s:%d]: found slot %d selected for ind %u \n",
+                       __func__, __LINE__, match, ind_id);
 
-            consumed = true;
+      if(true == locClientGetSizeByRespIndId(ind_id, &payload_size) &&
+         NULL != slot->recv_ind_payload_ptr && NULL != ind_payload_ptr)
+      {
+         LOC_TRACE_OR_LOG(LOC_TRACE_SYNC_COPY, match, payload_size, 0, 0, LOC_LOGV,
+                          "%s:%d]: copying ind payload size = %lu \n",
+                          __func__, __LINE__, payload_size);
 
-         }
-         /* Received a callback while waiting, wake up thread to check it */
-         if (slot->ind_is_waiting)
-         {
-            slot->recv_ind_id = ind_id;
+         memcpy(slot->recv_ind_payload_ptr, ind_payload_ptr, payload_size);
+      }
+      /* taken, a later ind with the same id goes to the next slot */
+      slot->ind_has_arrived = true;
 
-            pthread_cond_signal(&slot->ind_arrived_cond);
-         }
-         else
-         {
-            /* If callback arrives before wait, remember it */
-            LOC_LOGV("%s:%d]: ind %u arrived before wait was called \n",
-                          __func__, __LINE__, ind_id);
+      /* Received a callback while waiting, wake up thread to check it */
+      if (slot->ind_is_waiting)
+      {
+         slot->recv_ind_id = ind_id;
 
-            slot->ind_has_arrived = true;
-         }
+         pthread_cond_signal(&slot->ind_arrived_cond);
+      }
+      else
+      {
+         /* If callback arrives before wait, remember it */
+         LOC_TRACE_OR_LOG(LOC_TRACE_SYNC_EARLY, match, ind_id, 0, 0, LOC_LOGV,
+                          "%s:%d]: ind %u arrived before wait was called \n",
+                          __func__, __LINE__, ind_id);
       }
       pthread_mutex_unlock(&slot->sync_req_lock);
    }
@@ -359,6 +381,7 @@ static int loc_sync_select_ind(
    {
       LOC_LOGE("%s:%d]: buffer full for this synchronous req %s \n",
                  __func__, __LINE__, loc_get_v02_event_name(req_id));
+      loc_metrics_inc(LOC_METRICS_SYNC_NO_SLOT);
       return -ENOMEM;
    }
 
@@ -374,6 +397,7 @@ static int loc_sync_select_ind(
    slot->recv_ind_id = ind_id;
    slot->req_id      = req_id;
    slot->recv_ind_payload_ptr = ind_payload_ptr; //store the payload ptr
+   slot->select_seq  = __sync_fetch_and_add(&loc_sync_select_seq, 1);
 
    pthread_mutex_unlock(&slot->sync_req_lock);
 
@@ -450,12 +474,15 @@ static int loc_sync_wait_for_ind(
       slot->ind_is_waiting = true;
 
       /* Waiting */
-      rc = pthread_cond_timedwait(&slot->ind_arrived_cond,
-            &slot->sync_req_lock, &expire_time);
+      do
+      {
+         rc = pthread_cond_timedwait(&slot->ind_arrived_cond,
+               &slot->sync_req_lock, &expire_time);
+      } while (!slot->ind_has_arrived && rc != ETIMEDOUT);
 
       slot->ind_is_waiting = false;
 
-      if(rc == ETIMEDOUT)
+      if(!slot->ind_has_arrived)
       {
          LOC_LOGE("%s:%d]: slot %d, timed out for ind_id %s\n",
                     __func__, __LINE__, select_id, loc_get_v02_event_name(ind_id));
@@ -500,6 +527,9 @@ locClientStatusEnumType loc_sync_send_req
    locClientStatusEnumType status = eLOC_CLIENT_SUCCESS ;
    int select_id;
    int rc = 0;
+   uint64_t start_us = loc_metrics_now_us();
+
+   LOC_TRACE_BEGIN(LOC_TRACE_SYNC_REQ, req_id, ind_id);
 
    // Select the callback we are waiting for
    select_id = loc_sync_select_ind(client_handle, ind_id, req_id,
@@ -518,12 +548,18 @@ locClientStatusEnumType loc_sync_send_req
       else
       {
          // Wait for the indication callback
-         if (( rc = loc_sync_wait_for_ind( select_id,
-                                           timeout_msec / 1000,
-                                           ind_id) ) < 0)
+         LOC_TRACE_BEGIN(LOC_TRACE_SYNC_WAIT, ind_id, select_id);
+         rc = loc_sync_wait_for_ind( select_id,
+                                     timeout_msec / 1000,
+                                     ind_id);
+         LOC_TRACE_END(LOC_TRACE_SYNC_WAIT, rc, 0);
+         if (rc < 0)
          {
             if ( rc == -ETIMEDOUT)
+            {
                status = eLOC_CLIENT_FAILURE_TIMEOUT;
+               loc_metrics_msg_timeout(req_id);
+            }
             else
                status = eLOC_CLIENT_FAILURE_INTERNAL;
 
@@ -535,13 +571,101 @@ locClientStatusEnumType loc_sync_send_req
          else
          {
             status =  eLOC_CLIENT_SUCCESS;
+            loc_metrics_record_latency(req_id, LOC_METRICS_LATENCY_SYNC,
+                                       loc_metrics_now_us() - start_us);
             LOC_LOGV("%s:%d]: success (select id %d)\n",
                           __func__, __LINE__, select_id);
          }
       }
    } /* select id */
 
+   LOC_TRACE_END(LOC_TRACE_SYNC_REQ, status, 0);
    return status;
 }
 
+/*===========================================================================
+
+FUNCTION    loc_sync_send_batch
+
+DESCRIPTION
+   Sends a batch of requests pipelined: up to LOC_SYNC_BATCH_WINDOW are in
+   flight, and each answered request makes room for the next. The status
+   of each request is set in the batch.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   none
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_sync_send_batch
+(
+      locClientHandleType         client_handle,
+      loc_sync_batch_req_s_type   *reqs,
+      size_t                      count,
+      uint32_t                    timeout_msec
+)
+{
+   int select_ids[LOC_SYNC_BATCH_WINDOW];
+   uint64_t start_us[LOC_SYNC_BATCH_WINDOW];
+   size_t next = 0, done = 0;
+   int rc;
+
+   while (done < count)
+   {
+      // keep the window full
+      while (next < count && next - done < LOC_SYNC_BATCH_WINDOW)
+      {
+         loc_sync_batch_req_s_type *req = &reqs[next];
+         int select_id = loc_sync_select_ind(client_handle, req->ind_id,
+                                             req->req_id, req->ind_payload_ptr);
+
+         start_us[next % LOC_SYNC_BATCH_WINDOW] = loc_metrics_now_us();
+         if (select_id < 0)
+         {
+            req->status = eLOC_CLIENT_FAILURE_NOT_ENOUGH_MEMORY;
+         }
+         else
+         {
+            req->status = locClientSendReq(client_handle, req->req_id,
+                                           req->req_payload);
+            if (req->status != eLOC_CLIENT_SUCCESS)
+            {
+               loc_free_slot(select_id);
+               select_id = -1;
+            }
+         }
+         select_ids[next % LOC_SYNC_BATCH_WINDOW] = select_id;
+         next++;
+      }
+
+      // then wait for the oldest
+      loc_sync_batch_req_s_type *req = &reqs[done];
+      int select_id = select_ids[done % LOC_SYNC_BATCH_WINDOW];
+      if (select_id >= 0)
+      {
+         rc = loc_sync_wait_for_ind(select_id, timeout_msec / 1000, req->ind_id);
+         if (rc == -ETIMEDOUT)
+         {
+            req->status = eLOC_CLIENT_FAILURE_TIMEOUT;
+            loc_metrics_msg_timeout(req->req_id);
+         }
+         else if (rc < 0)
+         {
+            req->status = eLOC_CLIENT_FAILURE_INTERNAL;
+         }
+         else
+         {
+            loc_metrics_record_latency(req->req_id, LOC_METRICS_LATENCY_SYNC,
+               loc_metrics_now_us() - start_us[done % LOC_SYNC_BATCH_WINDOW]);
+         }
+      }
+      done++;
+   }
 
+   LOC_LOGV("%s:%d]: %zu requests sent\n", __func__, __LINE__, count);
+}
@@ -83,6 +83,27 @@ extern locClientStatusEnumType loc_sync_send_req
       void                      *ind_payload_ptr /* can be NULL*/
 );
 
+/* One request of a batch; status is its result, eLOC_CLIENT_SUCCESS
+   once its indication arrived */
+typedef struct {
+      uint32_t                  req_id;
+      locClientReqUnionType     req_payload;
+      uint32_t                  ind_id;
+      void                      *ind_payload_ptr; /* can be NULL */
+      locClientStatusEnumType   status;
+} loc_sync_batch_req_s_type;
+
+/* Sends the requests pipelined, a few in flight at once, and returns
+   when all have been answered or timed out. Indications with the same
+   id are matched to the requests in send order. */
+extern void loc_sync_send_batch
+(
+      locClientHandleType         client_handle,
+      loc_sync_batch_req_s_type   *reqs,
+      size_t                      count,
+      uint32_t                    timeout_msec   /* per request */
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -44,6 +44,8 @@
 
 #include "loc_api_v02_client.h"
 #include "loc_util_log.h"
+#include "loc_trace.h"
+#include "loc_metrics.h"
 
 #ifdef LOC_UTIL_TARGET_OFF_TARGET
 
@@ -562,8 +564,9 @@ static bool locClientGetSizeAndTypeByIndId (uint32_t indId, size_t *pIndSize,
   {
     *pIndType = eventIndType;
 
-    LOC_LOGV("%s:%d]: indId %d is an event size = %d\n", __func__, __LINE__,
-                  indId, (uint32_t)*pIndSize);
+    LOC_TRACE_OR_LOG(LOC_TRACE_IND_LOOKUP, indId, *pIndSize, 0, 0, LOC_LOGV,
+                     "%s:%d]: indId %d is an event size = %d\n", __func__, __LINE__,
+                     indId, (uint32_t)*pIndSize);
     return true;
   }
 
@@ -572,8 +575,9 @@ static bool locClientGetSizeAndTypeByIndId (uint32_t indId, size_t *pIndSize,
   {
     *pIndType = respIndType;
 
-    LOC_LOGV("%s:%d]: indId %d is a resp size = %d\n", __func__, __LINE__,
-                  indId, (uint32_t)*pIndSize);
+    LOC_TRACE_OR_LOG(LOC_TRACE_IND_LOOKUP, indId, *pIndSize, 1, 0, LOC_LOGV,
+                     "%s:%d]: indId %d is a resp size = %d\n", __func__, __LINE__,
+                     indId, (uint32_t)*pIndSize);
     return true;
   }
 
@@ -603,7 +607,9 @@ static bool isClientRegisteredForEvent(
   {
     if(eventIndId == locClientEventIndTable[idx].eventId)
     {
-      LOC_LOGV("%s:%d]: eventId %d registered mask = 0x%04x%04x, "
+      LOC_TRACE_OR_LOG(LOC_TRACE_IND_MASK, eventIndId, eventRegMask >> 32,
+               eventRegMask & 0xFFFFFFFF, idx, LOC_LOGV,
+               "%s:%d]: eventId %d registered mask = 0x%04x%04x, "
                "eventMask = 0x%04x%04x\n", __func__, __LINE__,
                eventIndId,(uint32_t)(eventRegMask>>32),
                (uint32_t)(eventRegMask & 0xFFFFFFFF),
@@ -1251,7 +1257,7 @@ static void locClientErrorCb
 }
 
 
-/** locClientIndCb
+/** locClientHandleInd
  *  @brief handles the indications sent from the service, if a
  *         response indication was received then the it is sent
  *         to the response callback. If a event indication was
@@ -1262,7 +1268,7 @@ static void locClientErrorCb
  *  @param [in] ind_buf_len
  *  @param [in] ind_cb_data */
 
-static void locClientIndCb
+static void locClientHandleInd
 (
  qmi_client_type                user_handle,
  unsigned int                   msg_id,
@@ -1277,9 +1283,10 @@ static void locClientIndCb
   locClientCallbackDataType* pCallbackData =
       (locClientCallbackDataType *)ind_cb_data;
 
-  LOC_LOGV("%s:%d]: Indication: msg_id=%d buf_len=%d pCallbackData = %p\n",
-                __func__, __LINE__, (uint32_t)msg_id, ind_buf_len,
-                pCallbackData);
+  LOC_TRACE_OR_LOG(LOC_TRACE_IND, msg_id, ind_buf_len, 0, 0, LOC_LOGV,
+                   "%s:%d]: Indication: msg_id=%d buf_len=%d pCallbackData = %p\n",
+                   __func__, __LINE__, (uint32_t)msg_id, ind_buf_len,
+                   pCallbackData);
 
   // check callback data
   if(NULL == pCallbackData ||(pCallbackData != pCallbackData->pMe))
@@ -1308,6 +1315,7 @@ static void locClientIndCb
     {
        LOC_LOGW("%s:%d]: client is not registered for event %d\n",
                      __func__, __LINE__, (uint32_t)msg_id);
+       loc_metrics_inc(LOC_METRICS_IND_UNREGISTERED);
        return;
     }
 
@@ -1403,12 +1411,14 @@ static void locClientIndCb
       {
         LOC_LOGE("%s:%d]: Error handling the indication %d\n",
                       __func__, __LINE__, (uint32_t)msg_id);
+        loc_metrics_inc(LOC_METRICS_IND_INVALID);
       }
     }
     else
     {
       LOC_LOGE("%s:%d]: Error decoding indication %d\n",
                     __func__, __LINE__, rc);
+      loc_metrics_inc(LOC_METRICS_IND_DECODE_FAILED);
     }
     if(indBuffer)
     {
@@ -1423,6 +1433,38 @@ static void locClientIndCb
   return;
 }
 
+/** locClientIndCb
+ *  @brief QMI indication callback, traces the handling as a span and,
+ *         if selected, records its cost per message id
+ *  @param [in] user handle
+ *  @param [in] msg_id
+ *  @param [in] ind_buf
+ *  @param [in] ind_buf_len
+ *  @param [in] ind_cb_data */
+
+static void locClientIndCb
+(
+ qmi_client_type                user_handle,
+ unsigned int                   msg_id,
+ void                           *ind_buf,
+ unsigned int                   ind_buf_len,
+ void                           *ind_cb_data
+)
+{
+  uint64_t startUs = 0;
+
+  if (LOC_METRICS_LATENCY_ON(LOC_METRICS_LATENCY_IND)) {
+    startUs = loc_metrics_now_us();
+  }
+  LOC_TRACE_BEGIN(LOC_TRACE_IND_CB, msg_id, ind_buf_len);
+  locClientHandleInd(user_handle, msg_id, ind_buf, ind_buf_len, ind_cb_data);
+  LOC_TRACE_END(LOC_TRACE_IND_CB, 0, 0);
+  if (0 != startUs) {
+    loc_metrics_record_latency(msg_id, LOC_METRICS_LATENCY_IND,
+                               loc_metrics_now_us() - startUs);
+  }
+}
+
 
 /** locClientRegisterEventMask
  *  @brief registers the event mask with loc service
@@ -2260,7 +2302,7 @@ locClientStatusEnumType locClientClose(
   - non-zero error code (see locClientStatusEnumType) - On failure.
 */
 
-locClientStatusEnumType locClientSendReq(
+static locClientStatusEnumType locClientSendReqSync(
   locClientHandleType      handle,
   uint32_t                 reqId,
   locClientReqUnionType    reqPayload )
@@ -2268,6 +2310,7 @@ locClientStatusEnumType locClientSendReq(
   locClientStatusEnumType status = eLOC_CLIENT_SUCCESS;
   qmi_client_error_type rc = QMI_NO_ERR; //No error
   qmiLocGenRespMsgT_v02 resp;
+  uint64_t startUs;
   uint32_t reqLen = 0;
   void *pReqData = NULL;
   locClientCallbackDataType *pCallbackData =
@@ -2303,6 +2346,8 @@ locClientStatusEnumType locClientSendReq(
   // back from the modem, to avoid confusing log order. We trust
   // that the QMI framework is robust.
   EXIT_LOG_CALLFLOW(%s, loc_get_v02_event_name(reqId));
+  LOC_TRACE_BEGIN(LOC_TRACE_QMI_SYNC, reqId, 0);
+  startUs = loc_metrics_now_us();
   rc = qmi_client_send_msg_sync(
       pCallbackData->userHandle,
       reqId,
@@ -2311,6 +2356,7 @@ locClientStatusEnumType locClientSendReq(
       &resp,
       sizeof(resp),
       LOC_CLIENT_ACK_TIMEOUT);
+  LOC_TRACE_END(LOC_TRACE_QMI_SYNC, rc, 0);
 
   LOC_LOGV("%s:%d] qmi_client_send_msg_sync returned %d\n", __func__,
                 __LINE__, rc);
@@ -2318,13 +2364,17 @@ locClientStatusEnumType locClientSendReq(
   if (QMI_SERVICE_ERR == rc)
   {
     LOC_LOGE("%s:%d]: send_msg_sync error: QMI_SERVICE_ERR\n",__func__, __LINE__);
+    loc_metrics_inc(LOC_METRICS_SEND_SERVICE_ERR);
     return(eLOC_CLIENT_FAILURE_PHONE_OFFLINE);
   }
   else if (rc != QMI_NO_ERR)
   {
     LOC_LOGE("%s:%d]: send_msg_sync error: %d\n",__func__, __LINE__, rc);
+    loc_metrics_inc(LOC_METRICS_SEND_QMI_ERR);
     return(eLOC_CLIENT_FAILURE_INTERNAL);
   }
+  loc_metrics_record_latency(reqId, LOC_METRICS_LATENCY_SEND,
+                             loc_metrics_now_us() - startUs);
 
   // map the QCCI response to Loc API v02 status
   status = convertQmiResponseToLocStatus(&resp);
@@ -2343,6 +2393,19 @@ locClientStatusEnumType locClientSendReq(
   return(status);
 }
 
+locClientStatusEnumType locClientSendReq(
+  locClientHandleType      handle,
+  uint32_t                 reqId,
+  locClientReqUnionType    reqPayload )
+{
+  locClientStatusEnumType status;
+
+  LOC_TRACE_BEGIN(LOC_TRACE_SEND_REQ, reqId, 0);
+  status = locClientSendReqSync(handle, reqId, reqPayload);
+  LOC_TRACE_END(LOC_TRACE_SEND_REQ, status, 0);
+  return status;
+}
+
 /** locClientSupportMsgCheck
   @brief Sends a QMI_LOC_GET_SUPPORTED_MSGS_REQ_V02 message to the
          location engine, and then receives a list of all services supported
@@ -26,9 +26,17 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#include <pthread.h>
 #include <loc_api_v02_log.h>
 #include <location_service_v02.h>
 
+/* Names are looked up on every request and indication for callflow
+   logging, so the tables below are indexed by value once, instead of
+   searched each time. The message ids all fit below 0x100, the status
+   enums are small. */
+#define LOC_V02_EVENT_INDEX_SIZE 0x100
+#define LOC_V02_STATUS_INDEX_SIZE 32
+
 static loc_name_val_s_type loc_v02_event_name[] =
 {
     NAME_VAL(QMI_LOC_INFORM_CLIENT_REVISION_REQ_V02),
@@ -285,10 +293,7 @@ static loc_name_val_s_type loc_v02_event_name[] =
 };
 static int loc_v02_event_num = sizeof(loc_v02_event_name) / sizeof(loc_name_val_s_type);
 
-const char* loc_get_v02_event_name(uint32_t event)
-{
-    return loc_get_name_from_val(loc_v02_event_name, loc_v02_event_num, (long) event);
-}
+static const char* loc_v02_event_index[LOC_V02_EVENT_INDEX_SIZE];
 
 static loc_name_val_s_type loc_v02_client_status_name[] =
 {
@@ -309,10 +314,7 @@ static loc_name_val_s_type loc_v02_client_status_name[] =
 };
 static int loc_v02_client_status_num = sizeof(loc_v02_client_status_name) / sizeof(loc_name_val_s_type);
 
-const char* loc_get_v02_client_status_name(locClientStatusEnumType status)
-{
-    return loc_get_name_from_val(loc_v02_client_status_name, loc_v02_client_status_num, (long) status);
-}
+static const char* loc_v02_client_status_index[LOC_V02_STATUS_INDEX_SIZE];
 
 
 static loc_name_val_s_type loc_v02_qmi_status_name[] =
@@ -329,7 +331,65 @@ static loc_name_val_s_type loc_v02_qmi_status_name[] =
 };
 static int loc_v02_qmi_status_num = sizeof(loc_v02_qmi_status_name) / sizeof(loc_name_val_s_type);
 
+static const char* loc_v02_qmi_status_index[LOC_V02_STATUS_INDEX_SIZE];
+
+static pthread_once_t loc_v02_name_index_once = PTHREAD_ONCE_INIT;
+
+/* the first entry of a value wins, as with the table search; a request
+   and its response share an id */
+static void loc_v02_index_names(const loc_name_val_s_type table[], int table_size,
+                                const char* index[], int index_size)
+{
+    int i;
+    for (i = 0; i < table_size; i++)
+    {
+        if (table[i].val >= 0 && table[i].val < index_size &&
+            NULL == index[table[i].val])
+        {
+            index[table[i].val] = table[i].name;
+        }
+    }
+}
+
+static void loc_v02_build_name_index(void)
+{
+    loc_v02_index_names(loc_v02_event_name, loc_v02_event_num,
+                        loc_v02_event_index, LOC_V02_EVENT_INDEX_SIZE);
+    loc_v02_index_names(loc_v02_client_status_name, loc_v02_client_status_num,
+                        loc_v02_client_status_index, LOC_V02_STATUS_INDEX_SIZE);
+    loc_v02_index_names(loc_v02_qmi_status_name, loc_v02_qmi_status_num,
+                        loc_v02_qmi_status_index, LOC_V02_STATUS_INDEX_SIZE);
+}
+
+const char* loc_get_v02_event_name(uint32_t event)
+{
+    pthread_once(&loc_v02_name_index_once, loc_v02_build_name_index);
+    if (event < LOC_V02_EVENT_INDEX_SIZE && NULL != loc_v02_event_index[event])
+    {
+        return loc_v02_event_index[event];
+    }
+    /* not a known id, the table search gives the unknown name */
+    return loc_get_name_from_val(loc_v02_event_name, loc_v02_event_num, (long) event);
+}
+
+const char* loc_get_v02_client_status_name(locClientStatusEnumType status)
+{
+    pthread_once(&loc_v02_name_index_once, loc_v02_build_name_index);
+    if ((uint32_t)status < LOC_V02_STATUS_INDEX_SIZE &&
+        NULL != loc_v02_client_status_index[status])
+    {
+        return loc_v02_client_status_index[status];
+    }
+    return loc_get_name_from_val(loc_v02_client_status_name, loc_v02_client_status_num, (long) status);
+}
+
 const char* loc_get_v02_qmi_status_name(qmiLocStatusEnumT_v02 status)
 {
+    pthread_once(&loc_v02_name_index_once, loc_v02_build_name_index);
+    if ((uint32_t)status < LOC_V02_STATUS_INDEX_SIZE &&
+        NULL != loc_v02_qmi_status_index[status])
+    {
+        return loc_v02_qmi_status_index[status];
+    }
     return loc_get_name_from_val(loc_v02_qmi_status_name, loc_v02_qmi_status_num, (long) status);
 }
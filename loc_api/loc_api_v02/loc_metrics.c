@@ -0,0 +1,376 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_metrics"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <loc_api_v02_log.h>
+#include "loc_metrics.h"
+#include "loc_util_log.h"
+
+/* the QMI LOC message ids all fit below this */
+#define LOC_METRICS_MSG_MAX 0x100
+
+static const char* const loc_metrics_counter_names[LOC_METRICS_COUNTER_MAX] = {
+  "SYNC_NO_SLOT",
+  "SYNC_TIMEOUT",
+  "SEND_SERVICE_ERR",
+  "SEND_QMI_ERR",
+  "IND_UNREGISTERED",
+  "IND_DECODE_FAILED",
+  "IND_INVALID",
+  "ENGINE_RESTART"
+};
+
+static const char* const loc_metrics_latency_names[LOC_METRICS_LATENCY_MAX] = {
+  "send",
+  "sync",
+  "ind"
+};
+
+volatile uint32_t loc_metrics_latency_mask =
+  (1u << LOC_METRICS_LATENCY_SEND) | (1u << LOC_METRICS_LATENCY_SYNC);
+
+static uint64_t loc_metrics_counters[LOC_METRICS_COUNTER_MAX];
+/* allocated on the first metric of a message, never freed */
+static locMetricsMsgType *loc_metrics_msgs[LOC_METRICS_MSG_MAX];
+
+static pthread_mutex_t loc_metrics_dump_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loc_metrics_dump_cond;
+static pthread_once_t loc_metrics_dump_once = PTHREAD_ONCE_INIT;
+static uint32_t loc_metrics_dump_interval = 0;
+
+void loc_metrics_inc(locMetricsCounterType counter)
+{
+  if (counter < LOC_METRICS_COUNTER_MAX) {
+    __atomic_fetch_add(&loc_metrics_counters[counter], 1, __ATOMIC_RELAXED);
+  }
+}
+
+static locMetricsMsgType *loc_metrics_get(uint32_t msgId)
+{
+  locMetricsMsgType *msg;
+  locMetricsMsgType *expected = NULL;
+
+  if (msgId >= LOC_METRICS_MSG_MAX) {
+    return NULL;
+  }
+  msg = __atomic_load_n(&loc_metrics_msgs[msgId], __ATOMIC_ACQUIRE);
+  if (NULL != msg) {
+    return msg;
+  }
+  msg = (locMetricsMsgType *)calloc(1, sizeof(*msg));
+  if (NULL == msg) {
+    return NULL;
+  }
+  if (!__atomic_compare_exchange_n(&loc_metrics_msgs[msgId], &expected, msg,
+                                   0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    // another thread was first
+    free(msg);
+    msg = expected;
+  }
+  return msg;
+}
+
+void loc_metrics_msg_timeout(uint32_t msgId)
+{
+  locMetricsMsgType *msg = loc_metrics_get(msgId);
+
+  loc_metrics_inc(LOC_METRICS_SYNC_TIMEOUT);
+  if (NULL != msg) {
+    __atomic_fetch_add(&msg->timeouts, 1, __ATOMIC_RELAXED);
+  }
+}
+
+static uint32_t loc_metrics_bucket(uint64_t us)
+{
+  uint32_t msb;
+  uint32_t bucket;
+
+  if (us < 4) {
+    return (uint32_t)us;
+  }
+  msb = 63 - __builtin_clzll(us);
+  bucket = (msb - 1) * 4 + (uint32_t)((us >> (msb - 2)) & 3);
+  return bucket < LOC_METRICS_HIST_BUCKETS ? bucket : LOC_METRICS_HIST_BUCKETS - 1;
+}
+
+/* smallest value of the bucket */
+static uint64_t loc_metrics_bucket_floor(uint32_t bucket)
+{
+  if (bucket < 4) {
+    return bucket;
+  }
+  return (uint64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+void loc_metrics_record_latency(uint32_t msgId, locMetricsLatencyType type,
+                                uint64_t us)
+{
+  locMetricsMsgType *msg;
+  locMetricsHistType *hist;
+  uint64_t max;
+
+  if (type >= LOC_METRICS_LATENCY_MAX || !LOC_METRICS_LATENCY_ON(type) ||
+      NULL == (msg = loc_metrics_get(msgId))) {
+    return;
+  }
+  hist = &msg->latency[type];
+  __atomic_fetch_add(&hist->buckets[loc_metrics_bucket(us)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->totalUs, us, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+  max = __atomic_load_n(&hist->maxUs, __ATOMIC_RELAXED);
+  while (us > max &&
+         !__atomic_compare_exchange_n(&hist->maxUs, &max, us, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+void loc_metrics_set_latency_mask(uint32_t mask)
+{
+  loc_metrics_latency_mask = mask;
+}
+
+uint64_t loc_metrics_now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void loc_metrics_get_counters(locMetricsCountersType *counters)
+{
+  int i;
+
+  for (i = 0; i < LOC_METRICS_COUNTER_MAX; i++) {
+    counters->counters[i] = __atomic_load_n(&loc_metrics_counters[i],
+                                            __ATOMIC_RELAXED);
+  }
+}
+
+static void loc_metrics_copy_hist(locMetricsHistType *dst,
+                                  const locMetricsHistType *src)
+{
+  int i;
+
+  dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+  dst->totalUs = __atomic_load_n(&src->totalUs, __ATOMIC_RELAXED);
+  dst->maxUs = __atomic_load_n(&src->maxUs, __ATOMIC_RELAXED);
+  for (i = 0; i < LOC_METRICS_HIST_BUCKETS; i++) {
+    dst->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+  }
+}
+
+int loc_metrics_get_msg(uint32_t msgId, locMetricsMsgType *msg)
+{
+  const locMetricsMsgType *src;
+  int i;
+
+  if (msgId >= LOC_METRICS_MSG_MAX ||
+      NULL == (src = __atomic_load_n(&loc_metrics_msgs[msgId], __ATOMIC_ACQUIRE))) {
+    return -1;
+  }
+  msg->timeouts = __atomic_load_n(&src->timeouts, __ATOMIC_RELAXED);
+  for (i = 0; i < LOC_METRICS_LATENCY_MAX; i++) {
+    loc_metrics_copy_hist(&msg->latency[i], &src->latency[i]);
+  }
+  return 0;
+}
+
+uint64_t loc_metrics_percentile_us(const locMetricsHistType *hist, uint32_t pct)
+{
+  uint64_t count = 0;
+  uint64_t total = 0;
+  uint64_t target;
+  uint32_t i;
+
+  for (i = 0; i < LOC_METRICS_HIST_BUCKETS; i++) {
+    total += hist->buckets[i];
+  }
+  if (0 == total) {
+    return 0;
+  }
+  target = (total * (pct > 100 ? 100 : pct) + 99) / 100;
+  for (i = 0; i < LOC_METRICS_HIST_BUCKETS - 1; i++) {
+    count += hist->buckets[i];
+    if (count >= target) {
+      break;
+    }
+  }
+  if (LOC_METRICS_HIST_BUCKETS - 1 == i ||
+      loc_metrics_bucket_floor(i + 1) - 1 > hist->maxUs) {
+    return hist->maxUs;
+  }
+  return loc_metrics_bucket_floor(i + 1) - 1;
+}
+
+const char* loc_metrics_counter_name(locMetricsCounterType counter)
+{
+  return counter < LOC_METRICS_COUNTER_MAX ?
+      loc_metrics_counter_names[counter] : "UNKNOWN";
+}
+
+void loc_metrics_dump(void)
+{
+  locMetricsCountersType counters;
+  locMetricsMsgType msg;
+  uint32_t id;
+  int i;
+
+  loc_metrics_get_counters(&counters);
+  for (i = 0; i < LOC_METRICS_COUNTER_MAX; i++) {
+    LOC_LOGI("%s: %llu\n", loc_metrics_counter_names[i],
+             (unsigned long long)counters.counters[i]);
+  }
+  for (id = 0; id < LOC_METRICS_MSG_MAX; id++) {
+    if (0 != loc_metrics_get_msg(id, &msg)) {
+      continue;
+    }
+    for (i = 0; i < LOC_METRICS_LATENCY_MAX; i++) {
+      const locMetricsHistType *hist = &msg.latency[i];
+
+      if (0 == hist->count) {
+        continue;
+      }
+      LOC_LOGI("%s %s: count %llu timeouts %llu avg %llu p50 %llu p99 %llu "
+               "max %llu us\n", loc_get_v02_event_name(id),
+               loc_metrics_latency_names[i],
+               (unsigned long long)hist->count,
+               (unsigned long long)msg.timeouts,
+               (unsigned long long)(hist->totalUs / hist->count),
+               (unsigned long long)loc_metrics_percentile_us(hist, 50),
+               (unsigned long long)loc_metrics_percentile_us(hist, 99),
+               (unsigned long long)hist->maxUs);
+    }
+  }
+}
+
+int loc_metrics_write_json(const char *path)
+{
+  locMetricsCountersType counters;
+  locMetricsMsgType msg;
+  FILE *file;
+  uint32_t id;
+  int messages = 0;
+  int i;
+
+  file = fopen(path, "w");
+  if (NULL == file) {
+    LOC_LOGE("%s:%d]: cannot open %s\n", __func__, __LINE__, path);
+    return -1;
+  }
+  loc_metrics_get_counters(&counters);
+  fputs("{\"counters\":{", file);
+  for (i = 0; i < LOC_METRICS_COUNTER_MAX; i++) {
+    fprintf(file, "%s\"%s\":%llu", i ? "," : "", loc_metrics_counter_names[i],
+            (unsigned long long)counters.counters[i]);
+  }
+  fputs("},\"messages\":[", file);
+  for (id = 0; id < LOC_METRICS_MSG_MAX; id++) {
+    if (0 != loc_metrics_get_msg(id, &msg)) {
+      continue;
+    }
+    fprintf(file, "%s\n{\"id\":%u,\"name\":\"%s\",\"timeouts\":%llu",
+            messages++ ? "," : "", id, loc_get_v02_event_name(id),
+            (unsigned long long)msg.timeouts);
+    for (i = 0; i < LOC_METRICS_LATENCY_MAX; i++) {
+      const locMetricsHistType *hist = &msg.latency[i];
+
+      if (0 == hist->count) {
+        continue;
+      }
+      fprintf(file, ",\"%s\":{\"count\":%llu,\"avg_us\":%llu,\"p50_us\":%llu,"
+              "\"p99_us\":%llu,\"max_us\":%llu}", loc_metrics_latency_names[i],
+              (unsigned long long)hist->count,
+              (unsigned long long)(hist->totalUs / hist->count),
+              (unsigned long long)loc_metrics_percentile_us(hist, 50),
+              (unsigned long long)loc_metrics_percentile_us(hist, 99),
+              (unsigned long long)hist->maxUs);
+    }
+    fputc('}', file);
+  }
+  fputs("\n]}\n", file);
+  fclose(file);
+  return 0;
+}
+
+static void *loc_metrics_dump_thread(void *arg)
+{
+  (void)arg;
+  pthread_mutex_lock(&loc_metrics_dump_lock);
+  for (;;) {
+    if (0 == loc_metrics_dump_interval) {
+      pthread_cond_wait(&loc_metrics_dump_cond, &loc_metrics_dump_lock);
+    } else {
+      struct timespec ts;
+
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      ts.tv_sec += loc_metrics_dump_interval;
+      if (ETIMEDOUT == pthread_cond_timedwait(&loc_metrics_dump_cond,
+                                              &loc_metrics_dump_lock, &ts)) {
+        pthread_mutex_unlock(&loc_metrics_dump_lock);
+        loc_metrics_dump();
+        pthread_mutex_lock(&loc_metrics_dump_lock);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void loc_metrics_start_dump(void)
+{
+  pthread_condattr_t attr;
+  pthread_t thread;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&loc_metrics_dump_cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (0 == pthread_create(&thread, NULL, loc_metrics_dump_thread, NULL)) {
+    pthread_detach(thread);
+  } else {
+    LOC_LOGE("%s:%d]: failed to start dump thread\n", __func__, __LINE__);
+  }
+}
+
+void loc_metrics_set_dump_interval(uint32_t intervalSec)
+{
+  pthread_once(&loc_metrics_dump_once, loc_metrics_start_dump);
+  pthread_mutex_lock(&loc_metrics_dump_lock);
+  loc_metrics_dump_interval = intervalSec;
+  pthread_cond_signal(&loc_metrics_dump_cond);
+  pthread_mutex_unlock(&loc_metrics_dump_lock);
+}
@@ -0,0 +1,121 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_METRICS_H
+#define LOC_METRICS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/* Counters of the failures of the QMI LOC transport and latency
+   histograms per message id. All updates are atomic adds, so they are
+   cheap enough to stay on in production; a snapshot reads each value
+   atomically, but not all of them at one instant. The indication
+   histogram adds two clock reads per indication and is off unless
+   selected with loc_metrics_set_latency_mask. */
+
+typedef enum {
+  LOC_METRICS_SYNC_NO_SLOT = 0,   /* loc_sync_select_ind -ENOMEM */
+  LOC_METRICS_SYNC_TIMEOUT,       /* indication wait -ETIMEDOUT */
+  LOC_METRICS_SEND_SERVICE_ERR,   /* QMI_SERVICE_ERR, phone offline */
+  LOC_METRICS_SEND_QMI_ERR,       /* any other QMI send error */
+  LOC_METRICS_IND_UNREGISTERED,   /* event dropped, not registered */
+  LOC_METRICS_IND_DECODE_FAILED,
+  LOC_METRICS_IND_INVALID,        /* decoded, but failed validation */
+  LOC_METRICS_ENGINE_RESTART,     /* service unavailable, errorCb */
+  LOC_METRICS_COUNTER_MAX
+} locMetricsCounterType;
+
+typedef enum {
+  LOC_METRICS_LATENCY_SEND = 0,   /* locClientSendReq, to the QMI response */
+  LOC_METRICS_LATENCY_SYNC,       /* loc_sync_send_req, to the indication */
+  LOC_METRICS_LATENCY_IND,        /* locClientIndCb, decode and dispatch */
+  LOC_METRICS_LATENCY_MAX
+} locMetricsLatencyType;
+
+/* latency types recorded, by locMetricsLatencyType bit; send and sync
+   by default */
+extern volatile uint32_t loc_metrics_latency_mask;
+
+#define LOC_METRICS_LATENCY_ON(type) \
+  (loc_metrics_latency_mask & (1u << (type)))
+
+/* log-linear: 4 buckets per power of 2 microseconds, up to 32s */
+#define LOC_METRICS_HIST_BUCKETS 96
+
+typedef struct {
+  uint64_t count;
+  uint64_t totalUs;
+  uint64_t maxUs;
+  uint64_t buckets[LOC_METRICS_HIST_BUCKETS];
+} locMetricsHistType;
+
+typedef struct {
+  uint64_t timeouts;
+  locMetricsHistType latency[LOC_METRICS_LATENCY_MAX];
+} locMetricsMsgType;
+
+typedef struct {
+  uint64_t counters[LOC_METRICS_COUNTER_MAX];
+} locMetricsCountersType;
+
+void loc_metrics_inc(locMetricsCounterType counter);
+/* a sync request for msgId timed out, also counts SYNC_TIMEOUT */
+void loc_metrics_msg_timeout(uint32_t msgId);
+/* ignored unless type is selected */
+void loc_metrics_record_latency(uint32_t msgId, locMetricsLatencyType type,
+                                uint64_t us);
+void loc_metrics_set_latency_mask(uint32_t mask);
+/* monotonic clock in microseconds, for latency measurements */
+uint64_t loc_metrics_now_us(void);
+
+void loc_metrics_get_counters(locMetricsCountersType *counters);
+/* 0 and a copy of the metrics of msgId, -1 if it has none */
+int loc_metrics_get_msg(uint32_t msgId, locMetricsMsgType *msg);
+/* upper bound in microseconds of the pct percentile */
+uint64_t loc_metrics_percentile_us(const locMetricsHistType *hist,
+                                   uint32_t pct);
+const char* loc_metrics_counter_name(locMetricsCounterType counter);
+
+/* log all counters and the messages with metrics */
+void loc_metrics_dump(void);
+/* dump every intervalSec seconds, 0 stops */
+void loc_metrics_set_dump_interval(uint32_t intervalSec);
+/* write the same as JSON to path, for tracking across builds; 0, or -1
+   if path cannot be written */
+int loc_metrics_write_json(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOC_METRICS_H */
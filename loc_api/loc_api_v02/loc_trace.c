@@ -0,0 +1,406 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_trace"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "loc_trace.h"
+#include "loc_util_log.h"
+
+/* records per thread, a power of 2 */
+#define LOC_TRACE_RING_SIZE 1024
+#define LOC_TRACE_DRAIN_INTERVAL_MS 100
+#define LOC_TRACE_DRAIN_BATCH 64
+
+/* single producer, the owning thread, and single consumer, the drain
+   under loc_trace_drain_lock. A ring is kept when its thread exits and
+   taken by the next new thread. */
+typedef struct locTraceRing {
+  locTraceRecordType records[LOC_TRACE_RING_SIZE];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t tid;
+  int inUse;
+  struct locTraceRing *next;
+} locTraceRing;
+
+/* args names the arguments in exported JSON; endArg names the one an
+   end record carries */
+typedef struct {
+  const char *name;
+  const char *format;
+  const char *args[4];
+  const char *endArg;
+} locTraceEventInfo;
+
+static const locTraceEventInfo loc_trace_events[LOC_TRACE_EVENT_MAX] = {
+  { "IND", "msg_id=%u buf_len=%u",
+    { "msg_id", "len" }, NULL },
+  { "IND_LOOKUP", "indId %u size = %u type %u",
+    { "ind_id", "size", "type" }, NULL },
+  { "IND_MASK", "eventId %u registered mask = 0x%08x%08x table %u",
+    { "event_id", "mask_hi", "mask_lo", "table" }, NULL },
+  { "SYNC_IND", "ind_id = %u",
+    { "ind_id" }, NULL },
+  { "SYNC_MATCH", "slot %u selected for ind %u",
+    { "slot", "ind_id" }, NULL },
+  { "SYNC_COPY", "slot %u payload size = %u",
+    { "slot", "size" }, NULL },
+  { "SYNC_EARLY", "slot %u ind %u arrived before wait",
+    { "slot", "ind_id" }, NULL },
+  { "NMEA", "length %u type 0x%08x",
+    { "len", "type" }, NULL },
+  { "SYNC_REQ", "req_id %u ind_id %u",
+    { "req_id", "ind_id" }, "status" },
+  { "SEND_REQ", "req_id %u",
+    { "req_id" }, "status" },
+  { "QMI_SYNC", "req_id %u",
+    { "req_id" }, "rc" },
+  { "SYNC_WAIT", "ind_id %u slot %u",
+    { "ind_id", "slot" }, "rc" },
+  { "IND_CB", "msg_id %u len %u",
+    { "msg_id", "len" }, NULL },
+  { "EVENT_CB", "event_id %u",
+    { "event_id" }, NULL },
+  { "REPORT_POSITION", "",
+    { NULL }, NULL },
+  { "REPORT_SV", "",
+    { NULL }, NULL },
+  { "REPORT_NMEA", "",
+    { NULL }, NULL }
+};
+
+static const char * const loc_trace_phases[] = { "i", "B", "E" };
+
+volatile uint32_t loc_trace_mask = 0;
+
+static locTraceRing *loc_trace_rings = NULL;
+static pthread_key_t loc_trace_key;
+static pthread_once_t loc_trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_once_t loc_trace_drain_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t loc_trace_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static locTraceSinkType loc_trace_sink = NULL;
+static void *loc_trace_sink_context = NULL;
+static uint64_t loc_trace_dropped = 0;
+
+/* Chrome trace export, under loc_trace_drain_lock */
+static FILE *loc_trace_export_file = NULL;
+static int loc_trace_export_count = 0;
+
+static void loc_trace_release_ring(void *ring)
+{
+  __atomic_store_n(&((locTraceRing *)ring)->inUse, 0, __ATOMIC_RELEASE);
+}
+
+static void loc_trace_create_key(void)
+{
+  pthread_key_create(&loc_trace_key, loc_trace_release_ring);
+}
+
+/* the ring of the calling thread, NULL if none can be had */
+static locTraceRing *loc_trace_get_ring(void)
+{
+  locTraceRing *ring;
+
+  pthread_once(&loc_trace_key_once, loc_trace_create_key);
+  ring = (locTraceRing *)pthread_getspecific(loc_trace_key);
+  if (NULL != ring) {
+    return ring;
+  }
+
+  // reuse the ring of a thread that exited
+  for (ring = __atomic_load_n(&loc_trace_rings, __ATOMIC_ACQUIRE);
+       NULL != ring; ring = ring->next) {
+    if (__sync_bool_compare_and_swap(&ring->inUse, 0, 1)) {
+      break;
+    }
+  }
+  if (NULL == ring) {
+    ring = (locTraceRing *)calloc(1, sizeof(*ring));
+    if (NULL == ring) {
+      return NULL;
+    }
+    ring->inUse = 1;
+    do {
+      ring->next = __atomic_load_n(&loc_trace_rings, __ATOMIC_RELAXED);
+    } while (!__sync_bool_compare_and_swap(&loc_trace_rings, ring->next, ring));
+  }
+  ring->tid = (uint32_t)syscall(SYS_gettid);
+  pthread_setspecific(loc_trace_key, ring);
+  return ring;
+}
+
+static void loc_trace_record(uint16_t event, uint16_t phase,
+                             uint32_t a0, uint32_t a1,
+                             uint32_t a2, uint32_t a3)
+{
+  locTraceRing *ring = loc_trace_get_ring();
+  locTraceRecordType *record;
+  struct timespec ts;
+  uint32_t head;
+
+  if (NULL == ring) {
+    __sync_fetch_and_add(&loc_trace_dropped, 1);
+    return;
+  }
+  head = ring->head;
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+      LOC_TRACE_RING_SIZE) {
+    __sync_fetch_and_add(&loc_trace_dropped, 1);
+    return;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  record = &ring->records[head & (LOC_TRACE_RING_SIZE - 1)];
+  record->timestampNs = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  record->tid = ring->tid;
+  record->event = event;
+  record->phase = phase;
+  record->args[0] = a0;
+  record->args[1] = a1;
+  record->args[2] = a2;
+  record->args[3] = a3;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void loc_trace(uint16_t event, uint32_t a0, uint32_t a1,
+               uint32_t a2, uint32_t a3)
+{
+  loc_trace_record(event, LOC_TRACE_PHASE_INSTANT, a0, a1, a2, a3);
+}
+
+void loc_trace_phase(uint16_t event, uint16_t phase, uint32_t a0, uint32_t a1)
+{
+  loc_trace_record(event, phase, a0, a1, 0, 0);
+}
+
+int loc_trace_format(const locTraceRecordType *record, char *buf, size_t size)
+{
+  const locTraceEventInfo *info;
+  int len;
+
+  if (record->event >= LOC_TRACE_EVENT_MAX ||
+      record->phase > LOC_TRACE_PHASE_END) {
+    return snprintf(buf, size, "[%llu.%06llu] tid %u unknown event %u",
+                    (unsigned long long)(record->timestampNs / 1000000000ULL),
+                    (unsigned long long)(record->timestampNs % 1000000000ULL / 1000),
+                    record->tid, record->event);
+  }
+  info = &loc_trace_events[record->event];
+  len = snprintf(buf, size, "[%llu.%06llu] tid %u %s%s: ",
+                 (unsigned long long)(record->timestampNs / 1000000000ULL),
+                 (unsigned long long)(record->timestampNs % 1000000000ULL / 1000),
+                 record->tid, info->name,
+                 LOC_TRACE_PHASE_BEGIN == record->phase ? " begin" :
+                 LOC_TRACE_PHASE_END == record->phase ? " end" : "");
+  if (len < 0 || (size_t)len >= size) {
+    return len;
+  }
+  if (LOC_TRACE_PHASE_END == record->phase) {
+    if (NULL == info->endArg) {
+      return len;
+    }
+    return len + snprintf(buf + len, size - len, "%s %d",
+                          info->endArg, (int32_t)record->args[0]);
+  }
+  return len + snprintf(buf + len, size - len, info->format,
+                        record->args[0], record->args[1],
+                        record->args[2], record->args[3]);
+}
+
+/* writes one Chrome trace event per record */
+static void loc_trace_export_sink(const locTraceRecordType *records,
+                                  size_t count, void *context)
+{
+  FILE *file = (FILE *)context;
+  size_t i;
+  int j;
+
+  for (i = 0; i < count; i++) {
+    const locTraceRecordType *record = &records[i];
+    const locTraceEventInfo *info;
+    int first = 1;
+
+    if (record->event >= LOC_TRACE_EVENT_MAX ||
+        record->phase > LOC_TRACE_PHASE_END) {
+      continue;
+    }
+    info = &loc_trace_events[record->event];
+    fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"loc\",\"ph\":\"%s\","
+            "\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%u",
+            loc_trace_export_count++ ? "," : "",
+            info->name, loc_trace_phases[record->phase],
+            (unsigned long long)(record->timestampNs / 1000),
+            (unsigned long long)(record->timestampNs % 1000),
+            (int)getpid(), record->tid);
+    if (LOC_TRACE_PHASE_INSTANT == record->phase) {
+      fputs(",\"s\":\"t\"", file);
+    }
+    if (LOC_TRACE_PHASE_END == record->phase) {
+      if (NULL != info->endArg) {
+        fprintf(file, ",\"args\":{\"%s\":%d}",
+                info->endArg, (int32_t)record->args[0]);
+      }
+    } else {
+      for (j = 0; j < 4 && NULL != info->args[j]; j++) {
+        fprintf(file, "%s\"%s\":%u", first ? ",\"args\":{" : ",",
+                info->args[j], record->args[j]);
+        first = 0;
+      }
+      if (!first) {
+        fputc('}', file);
+      }
+    }
+    fputc('}', file);
+  }
+}
+
+void loc_trace_flush(void)
+{
+  locTraceRecordType batch[LOC_TRACE_DRAIN_BATCH];
+  locTraceRing *ring;
+  char text[160];
+
+  pthread_mutex_lock(&loc_trace_drain_lock);
+  for (ring = __atomic_load_n(&loc_trace_rings, __ATOMIC_ACQUIRE);
+       NULL != ring; ring = ring->next) {
+    for (;;) {
+      uint32_t tail = ring->tail;
+      uint32_t count = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+      uint32_t i;
+
+      if (0 == count) {
+        break;
+      }
+      if (count > LOC_TRACE_DRAIN_BATCH) {
+        count = LOC_TRACE_DRAIN_BATCH;
+      }
+      for (i = 0; i < count; i++) {
+        batch[i] = ring->records[(tail + i) & (LOC_TRACE_RING_SIZE - 1)];
+      }
+      __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+
+      if (NULL != loc_trace_sink) {
+        loc_trace_sink(batch, count, loc_trace_sink_context);
+      } else {
+        for (i = 0; i < count; i++) {
+          loc_trace_format(&batch[i], text, sizeof(text));
+          LOC_LOGI("%s\n", text);
+        }
+      }
+    }
+  }
+  pthread_mutex_unlock(&loc_trace_drain_lock);
+}
+
+static void *loc_trace_drain_thread(void *arg)
+{
+  (void)arg;
+  for (;;) {
+    usleep(LOC_TRACE_DRAIN_INTERVAL_MS * 1000);
+    loc_trace_flush();
+  }
+  return NULL;
+}
+
+static void loc_trace_start_drain(void)
+{
+  pthread_t thread;
+
+  if (0 == pthread_create(&thread, NULL, loc_trace_drain_thread, NULL)) {
+    pthread_detach(thread);
+  } else {
+    LOC_LOGE("%s:%d]: failed to start drain thread\n", __func__, __LINE__);
+  }
+}
+
+void loc_trace_set_mask(uint32_t mask)
+{
+  if (0 != mask) {
+    pthread_once(&loc_trace_drain_once, loc_trace_start_drain);
+  }
+  loc_trace_mask = mask;
+}
+
+void loc_trace_set_sink(locTraceSinkType sink, void *context)
+{
+  pthread_mutex_lock(&loc_trace_drain_lock);
+  loc_trace_sink = sink;
+  loc_trace_sink_context = context;
+  pthread_mutex_unlock(&loc_trace_drain_lock);
+}
+
+uint64_t loc_trace_get_dropped(void)
+{
+  return __atomic_load_n(&loc_trace_dropped, __ATOMIC_RELAXED);
+}
+
+int loc_trace_export_start(const char *path)
+{
+  FILE *file;
+
+  loc_trace_export_stop();
+  file = fopen(path, "w");
+  if (NULL == file) {
+    LOC_LOGE("%s:%d]: cannot open %s\n", __func__, __LINE__, path);
+    return -1;
+  }
+  // records already queued belong to the previous sink
+  loc_trace_flush();
+
+  pthread_mutex_lock(&loc_trace_drain_lock);
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+  loc_trace_export_file = file;
+  loc_trace_export_count = 0;
+  loc_trace_sink = loc_trace_export_sink;
+  loc_trace_sink_context = file;
+  pthread_mutex_unlock(&loc_trace_drain_lock);
+  return 0;
+}
+
+void loc_trace_export_stop(void)
+{
+  loc_trace_flush();
+
+  pthread_mutex_lock(&loc_trace_drain_lock);
+  if (NULL != loc_trace_export_file) {
+    fputs("\n]}\n", loc_trace_export_file);
+    fclose(loc_trace_export_file);
+    loc_trace_export_file = NULL;
+    loc_trace_sink = NULL;
+    loc_trace_sink_context = NULL;
+  }
+  pthread_mutex_unlock(&loc_trace_drain_lock);
+}
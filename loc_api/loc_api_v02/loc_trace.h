@@ -0,0 +1,173 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOC_TRACE_H
+#define LOC_TRACE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary trace of the hot log sites. A traced site writes a fixed
+   record, event id, timestamp and four integers, into a lock free ring
+   of the calling thread; a drain thread formats the records, or hands
+   them raw to a sink, e.g. a file for offline decoding. Every site
+   logs as before until it is selected in the trace mask.
+
+   Span events record a begin and an end, so the time spent in a QMI
+   transaction and its parts can be followed; they can be written out
+   as Chrome trace event JSON with loc_trace_export_start. */
+
+typedef enum {
+  LOC_TRACE_IND = 0,          /* msg id, length */
+  LOC_TRACE_IND_LOOKUP,       /* ind id, size, 0 event / 1 resp */
+  LOC_TRACE_IND_MASK,         /* event id, reg mask high, low, table index */
+  LOC_TRACE_SYNC_IND,         /* ind id */
+  LOC_TRACE_SYNC_MATCH,       /* slot, ind id */
+  LOC_TRACE_SYNC_COPY,        /* slot, payload size */
+  LOC_TRACE_SYNC_EARLY,       /* slot, ind id */
+  LOC_TRACE_NMEA,             /* length, sentence type chars */
+  /* spans */
+  LOC_TRACE_SYNC_REQ,         /* req id, ind id; end: status */
+  LOC_TRACE_SEND_REQ,         /* req id; end: status */
+  LOC_TRACE_QMI_SYNC,         /* req id; end: qmi error */
+  LOC_TRACE_SYNC_WAIT,        /* ind id, slot; end: result */
+  LOC_TRACE_IND_CB,           /* msg id, length */
+  LOC_TRACE_EVENT_CB,         /* event id */
+  LOC_TRACE_REPORT_POSITION,
+  LOC_TRACE_REPORT_SV,
+  LOC_TRACE_REPORT_NMEA,
+  LOC_TRACE_EVENT_MAX
+} locTraceEventType;
+
+/* all span events */
+#define LOC_TRACE_SPAN_MASK \
+  (((1u << LOC_TRACE_EVENT_MAX) - 1) & ~((1u << LOC_TRACE_SYNC_REQ) - 1))
+
+typedef enum {
+  LOC_TRACE_PHASE_INSTANT = 0,
+  LOC_TRACE_PHASE_BEGIN,
+  LOC_TRACE_PHASE_END
+} locTracePhaseType;
+
+typedef struct {
+  uint64_t timestampNs;
+  uint32_t tid;
+  uint16_t event;
+  uint16_t phase;
+  uint32_t args[4];
+} locTraceRecordType;
+
+/* receives drained records instead of the log */
+typedef void (*locTraceSinkType)(const locTraceRecordType *records,
+                                 size_t count, void *context);
+
+extern volatile uint32_t loc_trace_mask;
+
+/* select the sites, by locTraceEventType bit, that trace instead of
+   log; the drain thread starts with the first selection */
+void loc_trace_set_mask(uint32_t mask);
+void loc_trace_set_sink(locTraceSinkType sink, void *context);
+
+void loc_trace(uint16_t event, uint32_t a0, uint32_t a1,
+               uint32_t a2, uint32_t a3);
+void loc_trace_phase(uint16_t event, uint16_t phase, uint32_t a0, uint32_t a1);
+
+/* drain all rings now, from any thread */
+void loc_trace_flush(void);
+
+/* text of a record, for the log and offline decoders */
+int loc_trace_format(const locTraceRecordType *record, char *buf, size_t size);
+
+/* records lost to a full ring */
+uint64_t loc_trace_get_dropped(void);
+
+/* write the drained records to path as Chrome trace event JSON, in
+   place of the log or sink, until loc_trace_export_stop. Returns 0, or
+   -1 if path cannot be written. */
+int loc_trace_export_start(const char *path);
+void loc_trace_export_stop(void);
+
+#define LOC_TRACE_ON(event) \
+  (loc_trace_mask & (1u << (event)))
+
+/* trace the site if it is selected, otherwise log it with the given
+   LOC_LOG macro and format */
+#define LOC_TRACE_OR_LOG(event, a0, a1, a2, a3, LOG, ...)          \
+  do {                                                             \
+    if (LOC_TRACE_ON(event)) {                                     \
+      loc_trace((event), (uint32_t)(a0), (uint32_t)(a1),           \
+                (uint32_t)(a2), (uint32_t)(a3));                   \
+    } else {                                                       \
+      LOG(__VA_ARGS__);                                            \
+    }                                                              \
+  } while (0)
+
+#define LOC_TRACE_BEGIN(event, a0, a1)                             \
+  do {                                                             \
+    if (LOC_TRACE_ON(event)) {                                     \
+      loc_trace_phase((event), LOC_TRACE_PHASE_BEGIN,              \
+                      (uint32_t)(a0), (uint32_t)(a1));             \
+    }                                                              \
+  } while (0)
+
+#define LOC_TRACE_END(event, a0, a1)                               \
+  do {                                                             \
+    if (LOC_TRACE_ON(event)) {                                     \
+      loc_trace_phase((event), LOC_TRACE_PHASE_END,                \
+                      (uint32_t)(a0), (uint32_t)(a1));             \
+    }                                                              \
+  } while (0)
+
+#ifdef __cplusplus
+}
+
+/* span of the enclosing scope */
+class LocTraceSpan {
+  uint16_t mEvent;
+  bool mOn;
+public:
+  inline LocTraceSpan(uint16_t event, uint32_t a0 = 0, uint32_t a1 = 0) :
+    mEvent(event), mOn(LOC_TRACE_ON(event)) {
+    if (mOn) {
+      loc_trace_phase(mEvent, LOC_TRACE_PHASE_BEGIN, a0, a1);
+    }
+  }
+  inline ~LocTraceSpan() {
+    if (mOn) {
+      loc_trace_phase(mEvent, LOC_TRACE_PHASE_END, 0, 0);
+    }
+  }
+};
+#endif
+
+#endif /* LOC_TRACE_H */